@@ -0,0 +1,56 @@
+#ifndef ONYX_ASYNCIO_H
+#define ONYX_ASYNCIO_H
+
+/*
+ * Batched file reads. Many reads are in flight at once, on Linux through
+ * io_uring and elsewhere, or where the kernel doesn't allow io_uring, through
+ * pread on a pool of threads. Loaders hand over every file they need in one
+ * call so reading is bound by the disk rather than by one blocking syscall
+ * after another.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ONYX_READ_TO_END UINT64_MAX
+
+typedef struct Onyx_FileRead {
+    const char* filename;
+    // bytes [offset, offset + size) of the file. ONYX_READ_TO_END reads
+    // until the end of the file.
+    uint64_t    offset;
+    uint64_t    size;
+    // Where the bytes go, caller memory or e.g. the hostData of a staging
+    // region. If NULL a buffer is allocated with hell_Malloc that the caller
+    // frees. It has a zero byte after the data so text can be parsed in
+    // place.
+    void*       dst;
+    // set by the read. size is set to the file's remaining size for
+    // ONYX_READ_TO_END.
+    uint64_t    bytesRead;
+    bool        ok;
+} Onyx_FileRead;
+
+typedef enum {
+    // io_uring where available, otherwise threads
+    ONYX_IO_BACKEND_DEFAULT,
+    ONYX_IO_BACKEND_URING,
+    ONYX_IO_BACKEND_THREADS,
+} Onyx_IoBackend;
+
+// Reads everything and returns once all reads are done, true if every one of
+// them read all of its bytes. A read is ok if its file opened and had all the
+// bytes asked for. Large reads are split so a single file also keeps several
+// requests in flight.
+bool onyx_ReadFiles(uint32_t count, Onyx_FileRead* reads);
+// Uses a given backend, for comparing them. ONYX_IO_BACKEND_URING falls back
+// to threads if io_uring can't be set up.
+bool onyx_ReadFilesWithBackend(Onyx_IoBackend backend, uint32_t count,
+                               Onyx_FileRead* reads);
+
+// Reads a whole file into a zero terminated buffer allocated with
+// hell_Malloc. NULL if the file can't be read.
+void* onyx_ReadWholeFile(const char* filename, size_t* size);
+
+#endif /* end of include guard: ONYX_ASYNCIO_H */
@@ -0,0 +1,76 @@
+#ifndef ONYX_BINDLESS_H
+#define ONYX_BINDLESS_H
+
+/*
+ * Bindless scene textures. Every texture of a scene is written to one array
+ * of combined image samplers at the slot of its handle id, which stays the
+ * same for as long as the texture exists. Materials carry the slots of their
+ * textures, so shaders index the array and draws don't switch descriptor
+ * sets per material. Slot 0 is the scene's default texture, which is what
+ * NULL_TEXTURE samples, and slots without a texture show it as well.
+ *
+ * There is one descriptor set per frame in flight, each brought up to date
+ * when its frame is updated. The binding is update after bind, so a set can
+ * be updated after it was bound for recording.
+ */
+
+#include "scene.h"
+
+typedef struct Onyx_BindlessTextures Onyx_BindlessTextures;
+
+typedef struct Onyx_BindlessParms {
+    // slots in the array, 0 for 4096. Clamped to the device limits. Textures
+    // with larger handle ids aren't written, materials show the default
+    // texture in their place.
+    uint32_t           textureCount;
+    // descriptor sets, 0 for 2
+    uint32_t           frameCount;
+    VkShaderStageFlags stageFlags;
+} Onyx_BindlessParms;
+
+// A material as shaders see it, see shaders/bindless.glsl which mirrors this
+// layout.
+typedef struct Onyx_BindlessMaterial {
+    Coal_Vec3 color;
+    float     roughness;
+    uint32_t  albedoSlot;
+    uint32_t  roughnessSlot;
+    uint32_t  normalSlot;
+    uint32_t  padding;
+} Onyx_BindlessMaterial;
+
+// whether the device can update sampled image arrays after bind and leave
+// slots of them invalid
+bool onyx_BindlessTexturesSupported(const Onyx_Instance* instance);
+// NULL if they aren't supported. Every slot of every set shows the default
+// texture until the first update.
+Onyx_BindlessTextures* onyx_CreateBindlessTextures(
+    Onyx_Memory* memory, Onyx_Scene* scene, const Onyx_BindlessParms* parms);
+// the sets must no longer be in use
+void onyx_DestroyBindlessTextures(Onyx_BindlessTextures* bindless);
+
+// Writes the textures added, changed or removed since the last update into
+// the set of frame, which no submitted work may still be using. Call it once
+// a frame before onyx_SceneEndFrame, so removed textures are taken out of the
+// array before their images go away.
+void onyx_UpdateBindlessTextures(Onyx_BindlessTextures* bindless,
+                                 uint32_t               frame);
+
+VkDescriptorSetLayout onyx_GetBindlessTextureLayout(
+    const Onyx_BindlessTextures* bindless);
+VkDescriptorSet onyx_GetBindlessTextureSet(
+    const Onyx_BindlessTextures* bindless, uint32_t frame);
+uint32_t onyx_GetBindlessTextureCount(const Onyx_BindlessTextures* bindless);
+
+// The slot shaders sample tex at. Textures with ids past the slots aren't in
+// the array and get slot 0, the default texture.
+uint32_t onyx_GetBindlessSlot(const Onyx_BindlessTextures* bindless,
+                              Onyx_TextureHandle           tex);
+
+// Writes the materials of the bindless textures' scene in object array order,
+// the order of onyx_SceneGetMaterialIndex, for a storage buffer shaders index
+// by material. dst holds onyx_SceneGetMaterialCount of them.
+void onyx_WriteBindlessMaterials(const Onyx_BindlessTextures* bindless,
+                                 Onyx_BindlessMaterial*       dst);
+
+#endif /* end of include guard: ONYX_BINDLESS_H */
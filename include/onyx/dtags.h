@@ -13,3 +13,5 @@
 #define ONYX_DEBUG_TAG_PIPE          "ONYX_PIPE"
 #define ONYX_DEBUG_TAG_SHADE         "ONYX_SHADE"
 #define ONYX_DEBUG_TAG_GEO           "ONYX_GEO"
+#define ONYX_DEBUG_TAG_PARALLEL      "ONYX_PARALLEL"
+#define ONYX_DEBUG_TAG_IO            "ONYX_IO"
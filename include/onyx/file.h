@@ -2,21 +2,160 @@
 #define ONYX_F_FILE_H
 
 #include <stdint.h>
+#include <stdio.h>
 #include "geo.h"
 #include "filegeo.h"
 
-// Must be freed
+// Must be freed. The arrays and the names share one allocation with every
+// attribute and the indices 64 byte aligned.
 Onyx_FileGeo onyx_CreateFileGeo(const uint32_t vertexCount, const uint32_t indexCount, 
         const uint32_t attrCount, 
         const Onyx_GeoAttributeSize attrSizes[/*attrCount*/], 
         const char attrNames[/*attrCount*/][ONYX_R_ATTR_NAME_LEN]);
+
+// Caller memory geos are carved from, so tools going through many files
+// don't allocate per file. Geos created in an arena are still freed with
+// onyx_FreeFileGeo, which then only frees arrays that moved out of it, before
+// the arena is reset.
+typedef struct Onyx_FileGeoArena {
+    uint8_t* data;
+    size_t   size;
+    size_t   used;
+} Onyx_FileGeoArena;
+
+Onyx_FileGeoArena onyx_CreateFileGeoArena(size_t size);
+void              onyx_ResetFileGeoArena(Onyx_FileGeoArena* arena);
+void              onyx_FreeFileGeoArena(Onyx_FileGeoArena* arena);
+// the bytes a geo takes in an arena
+size_t            onyx_GetFileGeoBlockSize(uint32_t vertexCount, uint32_t indexCount,
+                                           uint32_t attrCount,
+                                           const Onyx_GeoAttributeSize attrSizes[/*attrCount*/]);
+// Like onyx_CreateFileGeo in the arena, or in a block of its own if arena is
+// NULL or full.
+Onyx_FileGeo onyx_CreateFileGeoInArena(Onyx_FileGeoArena* arena,
+        const uint32_t vertexCount, const uint32_t indexCount,
+        const uint32_t attrCount,
+        const Onyx_GeoAttributeSize attrSizes[/*attrCount*/],
+        const char attrNames[/*attrCount*/][ONYX_R_ATTR_NAME_LEN]);
+// Resizes one of the attribute or index arrays of a geo from size to newSize
+// bytes, keeping the contents up to the smaller of the two, and returns it.
+// Arrays in the geo's block are copied out of it.
+void*        onyx_ResizeFileGeoArray(Onyx_FileGeo* fprim, void* array,
+                                     size_t size, size_t newSize);
 Onyx_FileGeo onyx_CreateFileGeoFromGeo(Onyx_Memory* memory, const Onyx_Geometry* rprim);
+
+typedef enum {
+    // header, attributes and indices packed back to back, optional chunks
+    // after them
+    ONYX_GEO_FILE_VERSION_1 = 1,
+    // a table of sections with aligned offsets, attribute type tags and a
+    // CRC-32C per section
+    ONYX_GEO_FILE_VERSION_2 = 2,
+} Onyx_GeoFileVersion;
+
+// Compression of version 2 sections. Sections are coded in independent
+// blocks that are encoded and decoded on every hardware thread.
+typedef enum {
+    ONYX_GEO_CODEC_NONE,
+    // general purpose LZ in the LZ4 block format
+    ONYX_GEO_CODEC_LZ,
+    // zigzag varints of the index deltas, then LZ
+    ONYX_GEO_CODEC_INDEX,
+    // byte planes of the per vertex deltas, then LZ
+    ONYX_GEO_CODEC_VERTEX,
+} Onyx_GeoCodec;
+
+// Codecs only apply to version 2. A section is stored raw if coding doesn't
+// make it smaller.
+typedef struct Onyx_WriteGeoParms {
+    Onyx_GeoFileVersion version;
+    Onyx_GeoCodec       attributeCodec;
+    Onyx_GeoCodec       indexCodec;
+} Onyx_WriteGeoParms;
+
+int               onyx_WriteFileGeoEx(const char* filename, const Onyx_FileGeo* fprim,
+                                      const Onyx_WriteGeoParms* parms);
+// Writes a version 2 geo file at the current position of file, for containers
+// that embed geo files. Its offsets are relative to where it starts, so it
+// should start 256 byte aligned for readers that map it. Returns its size.
+uint64_t          onyx_WriteFileGeoToStream(FILE* file, const Onyx_FileGeo* fprim,
+                                            const Onyx_WriteGeoParms* parms);
+// writes the latest version
 int               onyx_WriteFileGeo(const char* filename, const Onyx_FileGeo* fprim);
-// 1 is success
+// 1 is success. Reads either version. Returns 0 for files that can't be
+// opened, are truncated or malformed, or fail their checksums (version 2).
 int               onyx_ReadFileGeo(const char* filename, Onyx_FileGeo* fprim);
+// onyx_ReadFileGeo into an arena, see onyx_CreateFileGeoInArena
+int               onyx_ReadFileGeoInArena(const char* filename, Onyx_FileGeoArena* arena,
+                                          Onyx_FileGeo* fprim);
+// Reads many geo files with one batch of reads and decodes them on
+// threadCount threads, 0 uses every hardware thread. Returns false if any of
+// them can't be read, none are left to free then.
+bool              onyx_ReadFileGeos(uint32_t count, const char* const filenames[],
+                                    uint32_t threadCount, Onyx_FileGeo fprims[]);
+// Like onyx_ReadFileGeo but maps the file instead of reading it. Sections
+// that are suitably aligned in the file are used in place, anything else is
+// copied once. Version 2 files are always aligned. Returns 0 for files that
+// are truncated, malformed or fail their checksums.
+// onyx_FreeFileGeo unmaps the file.
+int               onyx_MapFileGeo(const char* filename, Onyx_FileGeo* fprim);
+// Copies a version 2 geo file held in memory into an owned geo. Returns 0 if
+// it is malformed or fails its checksums.
+int               onyx_ReadFileGeoFromMemory(const void* data, size_t size,
+                                             Onyx_FileGeo* fprim);
 void              onyx_FreeFileGeo(Onyx_FileGeo* fprim);
 void              onyx_PrintFileGeo(const Onyx_FileGeo* prim);
+// CRC-32C of data, continuing from crc. Pass 0 to start.
+uint32_t          onyx_Crc32c(uint32_t crc, const void* data, size_t size);
+// Encodes size bytes of src into a new allocation returned in dst that the
+// caller frees with hell_Free. elemSize is the attribute size for
+// ONYX_GEO_CODEC_VERTEX. Returns the encoded size. A threadCount of 0 uses
+// every hardware thread.
+size_t            onyx_EncodeGeoSection(Onyx_GeoCodec codec, const void* src, size_t size,
+                                        uint32_t elemSize, uint32_t threadCount, void** dst);
+// false if src is malformed or doesn't decode to exactly size bytes
+bool              onyx_DecodeGeoSection(Onyx_GeoCodec codec, const void* src, size_t srcSize,
+                                        uint32_t elemSize, uint32_t threadCount, void* dst,
+                                        size_t size);
 Onyx_Geometry onyx_CreateGeoFromFileGeo(Onyx_Memory* memory, VkBufferUsageFlags extraBufferUsageFlags, const Onyx_FileGeo *fprim);
+
+typedef enum {
+    // merge duplicate vertices after reading. see onyx_WeldFileGeo.
+    ONYX_LOAD_GEO_WELD_BIT = 1 << 0,
+    // stream the file through host transfer memory in chunks instead of
+    // reading it whole. see onyx_StreamGeo. requires transferToDevice and
+    // can't be combined with welding.
+    ONYX_LOAD_GEO_STREAM_BIT = 1 << 1,
+} Onyx_LoadGeoFlagBits;
+typedef uint32_t Onyx_LoadGeoFlags;
+
+typedef struct Onyx_LoadGeoParms {
+    VkBufferUsageFlags extraBufferUsageFlags;
+    bool               transferToDevice;
+    Onyx_LoadGeoFlags  flags;
+    float              weldEpsilon;
+    // 0 uses every hardware thread
+    uint32_t           threadCount;
+    // staging chunk size and how many chunks are in flight when streaming. 0
+    // uses 1 MiB and 3. the size must be a multiple of 4, counts above 8 are
+    // clamped to 8.
+    uint32_t           streamChunkSize;
+    uint32_t           streamChunkCount;
+} Onyx_LoadGeoParms;
+
+// Reads the sections of a geo file in chunks straight into staging memory
+// and copies them to device buffers on the transfer queue, reading the next
+// chunk while earlier ones are copied. Host memory use is bounded by the
+// chunk size and count, the host transfer memory must hold that many chunks.
+// Returns false if the file is malformed, fails its checksums or has coded
+// sections, which have to be decoded on the host.
+bool onyx_StreamGeo(Onyx_Memory* memory, const char* filename,
+                    const Onyx_LoadGeoParms* parms, Onyx_Geometry* geo);
+
+// .obj and .ply files are imported with onyx_ImportFileGeo, anything else is
+// read as a geo file.
+Onyx_Geometry onyx_LoadGeoEx(Onyx_Memory* memory, const char* filename,
+                             const Onyx_LoadGeoParms* parms);
 Onyx_Geometry onyx_LoadGeo(Onyx_Memory* memory, VkBufferUsageFlags extraBufferUsageFlags, const char* filename,
                  const bool transferToDevice);
 
@@ -2,18 +2,69 @@
 #define ONYX_FILE_GEO_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 
+#define ONYX_R_MAX_LODS 8
+
+// A level of detail is a range of the index buffer. All levels share the same
+// vertices. Level 0 is the full detail geometry and always starts at index 0.
+// error is the object space distance the level deviates from level 0.
+typedef struct Onyx_GeoLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float    error;
+} Onyx_GeoLod;
+
+// Axis aligned box and a bounding sphere around the box center, in object
+// space.
+typedef struct Onyx_GeoBounds {
+    float min[3];
+    float max[3];
+    float center[3];
+    float radius;
+} Onyx_GeoBounds;
+
+// index count including the coarser levels of detail
+static inline uint32_t
+onyx_GetTotalIndexCount(uint32_t indexCount, uint32_t lodCount,
+                        const Onyx_GeoLod* lods)
+{
+    if (lodCount < 2)
+        return indexCount;
+    return lods[lodCount - 1].firstIndex + lods[lodCount - 1].indexCount;
+}
+
+// indexCount is the index count of the full detail geometry. if lodCount is
+// non-zero the indices of the coarser levels follow directly after those in
+// the indices array. bounds are only meaningful if boundsValid is set.
+// mapData is set if the geo was opened with onyx_MapFileGeo. The arrays then
+// point into the read only file mapping where the file layout allows it and
+// into mapScratch otherwise, and must not be reallocated or written.
+// Otherwise every array lives in block, one allocation laid out by
+// onyx_CreateFileGeo. Arrays that change size must go through
+// onyx_ResizeFileGeoArray, which moves them out of the block.
 typedef struct {
-    uint32_t  attrCount;
-    uint32_t  vertexCount;
-    uint32_t  indexCount;
-    uint32_t  padding;
-    uint8_t*  attrSizes;
-    char**    attrNames;
-    void**    attributes;
-    uint32_t* indices;
+    uint32_t    attrCount;
+    uint32_t    vertexCount;
+    uint32_t    indexCount;
+    uint32_t    padding;
+    uint8_t*    attrSizes;
+    char**      attrNames;
+    void**      attributes;
+    uint32_t*   indices;
+    uint32_t    lodCount;
+    Onyx_GeoLod lods[ONYX_R_MAX_LODS];
+    Onyx_GeoBounds bounds;
+    bool           boundsValid;
+    void*          mapData;
+    size_t         mapSize;
+    void*          mapScratch;
+    void*          block;
+    size_t         blockSize;
+    // false if the block is in a caller's Onyx_FileGeoArena
+    bool           ownsBlock;
 } Onyx_FileGeo;
 
 
 #endif /* end of include guard: ONYX_FILE_GEO_H */
-
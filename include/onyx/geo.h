@@ -3,6 +3,7 @@
 
 #include "memory.h"
 #include "attribute.h"
+#include "filegeo.h"
 #include <stdint.h>
 
 #define ONYX_R_MAX_VERT_ATTRIBUTES 8
@@ -12,12 +13,46 @@ typedef uint32_t      Onyx_GeoIndex;
 typedef Onyx_GeoIndex Onyx_AttrIndex;
 typedef uint8_t       Onyx_GeoAttributeSize;
 
+// the semantic of the standard attribute names in attribute.h
+typedef enum OnyxAttributeTypes {
+    ONYX_ATTRIBUTE_TYPE_POS,
+    ONYX_ATTRIBUTE_TYPE_UV,
+    ONYX_ATTRIBUTE_TYPE_NORMAL,
+    ONYX_ATTRIBUTE_TYPE_TANGENT,
+    ONYX_ATTRIBUTE_TYPE_BITANGENT,
+    ONYX_ATTRIBUTE_TYPE_UVW,
+    ONYX_ATTRIBUTE_TYPE_SIGN,
+    ONYX_ATTRIBUTE_TYPE_COUNT
+} OnyxAttributeTypes;
+
+// byte range [begin, end) relative to the start of an attribute plane or of
+// the index region. empty if end <= begin.
+typedef struct Onyx_GeoDirtyRange {
+    VkDeviceSize begin;
+    VkDeviceSize end;
+} Onyx_GeoDirtyRange;
+
 // vertexRegion.offset is the byte offset info the buffer where the vertex data
 // is kept. attrOffsets store the byte offset relative to the vertexRegion
 // offset where the individual attribute data is kept attrSizes stores how many
 // bytes each individual attribute element takes up attrCount is how many
 // different attribute types the primitive holds vertexRegion.size is the total
 // size of the vertex attribute data
+// indexCount is the index count of the full detail geometry. if lodCount is
+// non-zero the index region also holds the indices of the coarser levels,
+// described by lods.
+// attrSemantics holds the attribute index + 1 of each OnyxAttributeTypes, 0 if
+// the geo has no attribute of that type. It is filled from attrNames by
+// onyx_UpdateGeoSemantics, which the creation and load functions call.
+// bounds are computed from the positions by onyx_UpdateGeoBounds and are only
+// meaningful while boundsValid is set.
+// arena is set if the geo was sub-allocated from an Onyx_GeoArena (see
+// geoarena.h); firstIndex and vertexOffset then locate it in the arena's
+// buffers. Both are 0 otherwise.
+// deviceVertexRegion and deviceIndexRegion are device local copies of the
+// host regions made by onyx_CreateGeoDeviceMirror. When present they are what
+// gets bound, and attrDirty and indexDirty track the bytes written on the host
+// since the last onyx_CmdUploadGeoDirtyRanges.
 typedef struct Onyx_Geometry {
     uint32_t          vertexCount;
     uint32_t          indexCount;
@@ -28,6 +63,18 @@ typedef struct Onyx_Geometry {
     Onyx_GeoAttributeSize
         attrSizes[ONYX_R_MAX_VERT_ATTRIBUTES]; // individual element sizes
     VkDeviceSize attrOffsets[ONYX_R_MAX_VERT_ATTRIBUTES];
+    uint32_t     lodCount;
+    Onyx_GeoLod  lods[ONYX_R_MAX_LODS];
+    uint8_t      attrSemantics[ONYX_ATTRIBUTE_TYPE_COUNT];
+    Onyx_GeoBounds bounds;
+    bool           boundsValid;
+    struct Onyx_GeoArena* arena;
+    uint32_t              firstIndex;
+    int32_t               vertexOffset;
+    Onyx_BufferRegion     deviceVertexRegion;
+    Onyx_BufferRegion     deviceIndexRegion;
+    Onyx_GeoDirtyRange    attrDirty[ONYX_R_MAX_VERT_ATTRIBUTES];
+    Onyx_GeoDirtyRange    indexDirty;
 } Onyx_Geometry;
 
 typedef enum onyx_GeometryType {
@@ -45,14 +92,6 @@ typedef enum onyx_GeometryFlag {
     ONYX_GEOMETRY_FLAG_MAX
 } onyx_GeometryFlag; 
 
-typedef enum OnyxAttributeTypes {
-    ONYX_ATTRIBUTE_TYPE_POS,
-    ONYX_ATTRIBUTE_TYPE_UV,
-    ONYX_ATTRIBUTE_TYPE_NORMAL,
-    ONYX_ATTRIBUTE_TYPE_TANGENT,
-    ONYX_ATTRIBUTE_TYPE_BITANGENT,
-} OnyxAttributeTypes;
-
 typedef uint32_t OnyxFlags;
 
 typedef struct OnyxGeometry {
@@ -147,7 +186,99 @@ void* onyx_GetGeoAttribute2(const Onyx_Geometry* prim, const char* name);
 Onyx_GeoIndex* onyx_GetGeoIndices(const Onyx_Geometry* prim);
 void onyx_BindGeo(const VkCommandBuffer cmdBuf, const Onyx_Geometry* prim);
 void onyx_DrawGeo(const VkCommandBuffer cmdBuf, const Onyx_Geometry* prim);
+// draws a single level of detail. lod 0 is the same as onyx_DrawGeo.
+void onyx_DrawGeoLod(const VkCommandBuffer cmdBuf, const Onyx_Geometry* prim,
+                     uint32_t lod);
+// What is bound on a command buffer, so consecutive geo draws can skip
+// redundant vkCmdBindVertexBuffers and vkCmdBindIndexBuffer calls. If a geo's
+// data sits at a whole number of elements past what is bound in the same
+// buffers, as in the shared block buffers or an arena, nothing is rebound and
+// the difference goes into the draw's vertexOffset and firstIndex. Assumes the
+// pipeline's binding strides are the attribute sizes, as with
+// onyx_GetVertexDescription. The counters count calls issued and skipped.
+typedef struct Onyx_GeoBindState {
+    VkCommandBuffer cmdBuf;
+    uint32_t        vertexBufferCount;
+    VkBuffer        vertexBuffers[ONYX_R_MAX_VERT_ATTRIBUTES];
+    VkDeviceSize    vertexOffsets[ONYX_R_MAX_VERT_ATTRIBUTES];
+    VkBuffer        indexBuffer;
+    VkDeviceSize    indexOffset;
+    uint32_t        vertexBindCount;
+    uint32_t        vertexBindSkipCount;
+    uint32_t        indexBindCount;
+    uint32_t        indexBindSkipCount;
+} Onyx_GeoBindState;
+
+// the offsets to add to a draw of a geo bound through an Onyx_GeoBindState
+typedef struct Onyx_GeoDrawOffsets {
+    uint32_t firstIndex;
+    int32_t  vertexOffset;
+} Onyx_GeoDrawOffsets;
+
+// call when starting to record cmdBuf. clears the counters.
+void onyx_InitGeoBindState(Onyx_GeoBindState* state, VkCommandBuffer cmdBuf);
+// forget what is bound, e.g. after binding buffers without the state.
+// keeps the counters.
+void onyx_InvalidateGeoBindState(Onyx_GeoBindState* state);
+Onyx_GeoDrawOffsets onyx_BindGeoCached(Onyx_GeoBindState*   state,
+                                       const Onyx_Geometry* prim);
+void onyx_DrawGeoCached(Onyx_GeoBindState* state, const Onyx_Geometry* prim);
+void onyx_DrawGeoLodCached(Onyx_GeoBindState* state, const Onyx_Geometry* prim,
+                           uint32_t lod);
+#ifndef ONYX_NO_BUFFER_DEVICE_ADDRESS
+// Everything a vertex pulling shader needs to fetch a geo's data, see
+// shaders/geo-record.glsl which mirrors this layout. attributes is indexed by
+// OnyxAttributeTypes and is 0 for types the geo does not have. The addresses
+// are those of the device mirror if the geo has one. Pipelines for pulled geos
+// have no vertex input, use a zeroed Onyx_VertexDescription.
+typedef struct Onyx_GeoRecord {
+    VkDeviceAddress attributes[ONYX_ATTRIBUTE_TYPE_COUNT];
+    VkDeviceAddress indices;
+    uint32_t        vertexCount;
+    uint32_t        indexCount;
+    uint32_t        padding[2];
+} Onyx_GeoRecord;
+
+Onyx_GeoRecord onyx_GetGeoRecord(const Onyx_Geometry* prim);
+void onyx_WriteGeoRecords(const Onyx_Geometry* const* prims, uint32_t count,
+                          Onyx_GeoRecord* dst);
+// Binds only the geo's index buffer, through the bind state so consecutive
+// geos in one buffer share a bind, and draws it with recordIndex as
+// firstInstance for the shader to find its record with gl_InstanceIndex.
+void onyx_DrawGeoPulled(Onyx_GeoBindState* state, const Onyx_Geometry* prim,
+                        uint32_t lod, uint32_t recordIndex);
+#endif
+
+// returns the coarsest lod whose error projected to the screen stays under
+// maxPixelError. projScale is the viewport height in pixels divided by
+// 2 * tan(fovy / 2), distance is the view space distance to the geometry.
+uint32_t onyx_SelectGeoLod(const Onyx_Geometry* prim, float distance,
+                           float projScale, float maxPixelError);
 void onyx_TransferGeoToDevice(Onyx_Memory* memory, Onyx_Geometry* prim);
+// Like onyx_TransferGeoToDevice for many geos, with the copies of up to 256
+// geos recorded into one command buffer and submitted together.
+void onyx_TransferGeosToDevice(Onyx_Memory* memory, uint32_t count,
+                               Onyx_Geometry* const geos[/*count*/]);
+
+// Unlike onyx_TransferGeoToDevice this keeps the host regions. They become the
+// staging memory for the device copies, which are what onyx_BindGeo binds from
+// then on. Calling it again replaces the mirror, which is needed after the
+// host regions grew. The geo must be host visible and not in an arena.
+void onyx_CreateGeoDeviceMirror(Onyx_Memory* memory, Onyx_Geometry* prim);
+// Record which part of the host data was written. Ranges of an attribute or
+// of the indices are merged into one covering range.
+void onyx_MarkGeoAttributeDirty(Onyx_Geometry* prim, uint32_t attrIndex,
+                                uint32_t firstVertex, uint32_t vertexCount);
+void onyx_MarkGeoIndicesDirty(Onyx_Geometry* prim, uint32_t firstIndex,
+                              uint32_t indexCount);
+// everything, for when the written ranges are not known
+void onyx_MarkGeoDirty(Onyx_Geometry* prim);
+// Records copies of the dirty ranges from the host regions to the device
+// mirror, with barriers against the vertex input stage on both sides, and
+// clears the ranges. The host data of those ranges must not be written again
+// until the command buffer has executed. Returns the number of bytes copied.
+VkDeviceSize onyx_CmdUploadGeoDirtyRanges(VkCommandBuffer cmdBuf,
+                                          Onyx_Geometry*  prim);
 void onyx_FreeGeo(Onyx_Geometry* prim);
 void onyx_PrintGeo(const Onyx_Geometry* prim);
 
@@ -158,4 +289,48 @@ VkDeviceSize onyx_GetAttrRange(const Onyx_Geometry* prim, const char* attrname);
 
 int onyx_GetAttrIndex(const Onyx_Geometry* geo, const char* attrname);
 
+// must be called if attrNames are changed after creation
+void onyx_UpdateGeoSemantics(Onyx_Geometry* geo);
+// -1 if the name is not one of the standard names
+int onyx_GetAttributeTypeFromName(const char* attrname);
+
+// -1 if the geo has no attribute of that type
+static inline int
+onyx_GetGeoAttrIndexOfType(const Onyx_Geometry* geo, OnyxAttributeTypes type)
+{
+    return (int)geo->attrSemantics[type] - 1;
+}
+
+// NULL if the geo has no attribute of that type
+static inline void*
+onyx_GetGeoAttributeOfType(const Onyx_Geometry* geo, OnyxAttributeTypes type)
+{
+    const uint8_t i = geo->attrSemantics[type];
+    return i ? geo->vertexRegion.hostData + geo->attrOffsets[i - 1] : NULL;
+}
+
+static inline float*
+onyx_GetGeoPositions(const Onyx_Geometry* geo)
+{
+    return (float*)onyx_GetGeoAttributeOfType(geo, ONYX_ATTRIBUTE_TYPE_POS);
+}
+
+static inline float*
+onyx_GetGeoNormals(const Onyx_Geometry* geo)
+{
+    return (float*)onyx_GetGeoAttributeOfType(geo, ONYX_ATTRIBUTE_TYPE_NORMAL);
+}
+
+static inline float*
+onyx_GetGeoUVs(const Onyx_Geometry* geo)
+{
+    return (float*)onyx_GetGeoAttributeOfType(geo, ONYX_ATTRIBUTE_TYPE_UV);
+}
+
+static inline float*
+onyx_GetGeoTangents(const Onyx_Geometry* geo)
+{
+    return (float*)onyx_GetGeoAttributeOfType(geo, ONYX_ATTRIBUTE_TYPE_TANGENT);
+}
+
 #endif /* end of include guard: R_GEO_H */
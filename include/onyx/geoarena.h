@@ -0,0 +1,102 @@
+#ifndef ONYX_GEO_ARENA_H
+#define ONYX_GEO_ARENA_H
+
+/*
+ * Shared vertex and index buffers for many geometries of the same vertex
+ * layout. Geometries sub-allocated from an arena only differ in firstIndex and
+ * vertexOffset, so after binding the arena once any number of them can be
+ * drawn with a single vkCmdDrawIndexedIndirect.
+ */
+
+#include "geo.h"
+
+typedef struct Onyx_ArenaRange {
+    uint32_t offset;
+    uint32_t count;
+} Onyx_ArenaRange;
+
+// free ranges sorted by offset
+typedef struct Onyx_ArenaFreeList {
+    uint32_t         count;
+    uint32_t         capacity;
+    Onyx_ArenaRange* ranges;
+} Onyx_ArenaFreeList;
+
+// the vertex region holds one plane of vertexCapacity elements per attribute,
+// attrOffsets are the plane offsets relative to the region offset.
+typedef struct Onyx_GeoArena {
+    Onyx_Memory*          memory;
+    uint32_t              vertexCapacity;
+    uint32_t              indexCapacity;
+    uint32_t              attrCount;
+    Onyx_GeoAttributeSize attrSizes[ONYX_R_MAX_VERT_ATTRIBUTES];
+    char         attrNames[ONYX_R_MAX_VERT_ATTRIBUTES][ONYX_R_ATTR_NAME_LEN];
+    VkDeviceSize attrOffsets[ONYX_R_MAX_VERT_ATTRIBUTES];
+    Onyx_BufferRegion  vertexRegion;
+    Onyx_BufferRegion  indexRegion;
+    Onyx_ArenaFreeList freeVertices;
+    Onyx_ArenaFreeList freeIndices;
+    // device features needed to draw many geos with one indirect call
+    bool multiDrawIndirect;
+    bool drawIndirectFirstInstance;
+} Onyx_GeoArena;
+
+// The arena lives in host graphics memory like a freshly created geometry.
+// attrNames may be NULL.
+void onyx_CreateGeoArena(Onyx_Memory* memory, VkBufferUsageFlags extraBufferFlags,
+                         uint32_t vertexCapacity, uint32_t indexCapacity,
+                         uint32_t                    attrCount,
+                         const Onyx_GeoAttributeSize attrSizes[/*attrCount*/],
+                         const char* const attrNames[/*attrCount*/],
+                         Onyx_GeoArena*    arena);
+// geometries allocated from the arena must not be used afterwards
+void onyx_DestroyGeoArena(Onyx_GeoArena* arena);
+
+// Sub-allocates a geometry with the arena's vertex layout using first fit.
+// The geometry's regions point into the arena's buffers, so the host
+// accessors, onyx_BindGeo and onyx_DrawGeo work as for any other geometry.
+// The vertex region runs from the geometry's first vertex in the first
+// attribute plane to its last vertex in the last plane, so it covers other
+// geometries' vertices in between and must not be copied whole. Its indices are relative to its first vertex. onyx_FreeGeo returns the
+// ranges to the arena. Arena geometries can't be welded, resized or
+// transferred to the device on their own.
+// Returns false if the arena has no free range big enough.
+bool onyx_CreateArenaGeometry(Onyx_GeoArena* arena, uint32_t vertexCount,
+                              uint32_t indexCount, Onyx_Geometry* geo);
+// Copies a host visible geometry with the same attribute sizes into the
+// arena, including its levels of detail and bounds.
+bool onyx_CopyGeoToArena(Onyx_GeoArena* arena, const Onyx_Geometry* src,
+                         Onyx_Geometry* dst);
+void onyx_FreeArenaGeometry(Onyx_Geometry* geo);
+
+// Binds the arena's vertex planes and index buffer.
+void onyx_BindGeoArena(VkCommandBuffer cmdBuf, const Onyx_GeoArena* arena);
+
+// The draw of a level of detail of the geometry. Works for any geometry, for
+// one outside an arena firstIndex and vertexOffset are relative to its own
+// buffers. Pass the draw's index as firstInstance to look up per draw data
+// with gl_InstanceIndex in the shader.
+VkDrawIndexedIndirectCommand onyx_GetGeoDrawCommand(const Onyx_Geometry* geo,
+                                                    uint32_t             lod,
+                                                    uint32_t instanceCount,
+                                                    uint32_t firstInstance);
+// Writes one command per geometry of the arena to dst with firstInstance set
+// to the geometry's position in geos, so shaders find its per draw data with
+// gl_InstanceIndex. Without drawIndirectFirstInstance firstInstance is 0 and
+// shaders have to use gl_DrawID, which counts the draws of one call and so
+// also needs multiDrawIndirect. lods may be NULL for level 0.
+void onyx_WriteArenaDrawCommands(const Onyx_GeoArena*          arena,
+                                 const Onyx_Geometry* const*   geos,
+                                 const uint32_t* lods, uint32_t count,
+                                 VkDrawIndexedIndirectCommand* dst);
+
+// Binds the arena and draws drawCount tightly packed
+// VkDrawIndexedIndirectCommands from commands, which must have been created
+// with the indirect buffer usage. Falls back to one indirect call per draw if
+// the device lacks multiDrawIndirect. Without drawIndirectFirstInstance every
+// command's firstInstance must be 0.
+void onyx_CmdDrawArenaIndirect(VkCommandBuffer cmdBuf, const Onyx_GeoArena* arena,
+                               const Onyx_BufferRegion* commands,
+                               uint32_t                 drawCount);
+
+#endif /* end of include guard: ONYX_GEO_ARENA_H */
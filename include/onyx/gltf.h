@@ -0,0 +1,52 @@
+#ifndef ONYX_GLTF_H
+#define ONYX_GLTF_H
+
+/*
+ * glTF 2.0 binary (.glb) import into an Onyx_Scene.
+ */
+
+#include "scene.h"
+
+typedef struct Onyx_GltfImportParms {
+    VkBufferUsageFlags extraBufferUsageFlags;
+    VkImageUsageFlags  extraImageUsageFlags;
+    // move the geometry to device memory once it is filled
+    bool               transferToDevice;
+    bool               createMips;
+    // threads decoding images and filling geometry, 0 uses every hardware
+    // thread
+    uint32_t           threadCount;
+} Onyx_GltfImportParms;
+
+// Everything an import created. The scene doesn't own geometry or images, so
+// they live here until onyx_FreeGltfScene. geos holds one geometry per glTF
+// mesh primitive, shared by every node that instances the mesh. images and
+// textures are indexed like the glTF images, materials like the glTF
+// materials with a default material appended if a primitive has none.
+typedef struct Onyx_GltfScene {
+    uint32_t              geoCount;
+    Onyx_Geometry*        geos;
+    uint32_t              imageCount;
+    Onyx_Image*           images;
+    Onyx_TextureHandle*   textures;
+    uint32_t              materialCount;
+    Onyx_MaterialHandle*  materials;
+    uint32_t              primCount;
+    Onyx_PrimitiveHandle* prims;
+} Onyx_GltfScene;
+
+// Adds the nodes of the file's default scene (every root node if it has none)
+// with their world transforms. Mesh primitives become geometries with pos,
+// nor, uv, tan and sin attributes as far as the file has them. Triangle lists
+// are imported, other modes are skipped. Accessors that are tightly packed
+// floats are copied in one go, others are converted per element. Images are
+// decoded in parallel. Materials take the base color, roughness and the base
+// color, metallic roughness and normal textures. Returns false if the file
+// can't be read or is malformed, nothing is added to the scene then.
+bool onyx_ImportGlb(Onyx_Memory* memory, Onyx_Scene* scene, const char* filename,
+                    const Onyx_GltfImportParms* parms, Onyx_GltfScene* gltf);
+// removes what the import added to the scene and frees the geometry and
+// images
+void onyx_FreeGltfScene(Onyx_Scene* scene, Onyx_GltfScene* gltf);
+
+#endif /* end of include guard: ONYX_GLTF_H */
@@ -68,6 +68,46 @@ void onyx_LoadImageData(Onyx_Memory* memory, int w, int h, uint8_t channelCount,
     Onyx_MemoryType memoryType,
     Onyx_Image* image);
 
+typedef struct Onyx_ImageData {
+    int         width;
+    int         height;
+    uint8_t     channelCount;
+    VkFormat    format;
+    const void* data;
+} Onyx_ImageData;
+
+// Like onyx_LoadImageData for many images, with the copies and mip blits of up
+// to 64 images recorded into one command buffer and submitted together.
+void onyx_LoadImagesData(Onyx_Memory* memory, uint32_t count,
+    const Onyx_ImageData* datas,
+    VkImageUsageFlags usageFlags,
+    const VkImageAspectFlags aspectMask,
+    const VkSampleCountFlags sampleCount,
+    const VkFilter filter,
+    const VkImageLayout layout,
+    const bool createMips,
+    Onyx_MemoryType memoryType,
+    Onyx_Image* images);
+
+// Like onyx_LoadImage for many files. They are read and decoded on
+// threadCount threads, 0 uses every hardware thread, with an
+// Onyx_ImageLoader, and uploaded in batches while the rest are still
+// decoding. Returns false if any file can't be read or decoded, no image is
+// left then.
+bool onyx_LoadImages(Onyx_Memory* memory, uint32_t count,
+    const char* const filenames[],
+    const uint8_t channelCount,
+    const VkFormat format,
+    VkImageUsageFlags usageFlags,
+    const VkImageAspectFlags aspectMask,
+    const VkSampleCountFlags sampleCount,
+    const VkFilter filter,
+    const VkImageLayout layout,
+    const bool createMips,
+    Onyx_MemoryType memoryType,
+    uint32_t threadCount,
+    Onyx_Image* images);
+
 int
 onyx_write_image_to_png_buf(Onyx_Image* img,
                             VkImageLayout layout,
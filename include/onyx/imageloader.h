@@ -0,0 +1,61 @@
+#ifndef ONYX_IMAGE_LOADER_H
+#define ONYX_IMAGE_LOADER_H
+
+/*
+ * Asynchronous image loading. Files are read and decoded on a pool of worker
+ * threads while the thread that owns the memory uploads the images that are
+ * already decoded, so decoding overlaps with earlier uploads. Every request
+ * gets an id to poll or wait on.
+ */
+
+#include "image.h"
+
+typedef struct Onyx_ImageLoader Onyx_ImageLoader;
+
+// 0 is never a valid id
+typedef uint32_t Onyx_ImageLoadId;
+
+typedef struct Onyx_ImageLoadParms {
+    uint8_t            channelCount;
+    VkFormat           format;
+    VkImageUsageFlags  usageFlags;
+    VkImageAspectFlags aspectMask;
+    VkSampleCountFlags sampleCount;
+    VkFilter           filter;
+    VkImageLayout      layout;
+    bool               createMips;
+    Onyx_MemoryType    memoryType;
+} Onyx_ImageLoadParms;
+
+typedef enum {
+    // reading, decoding or waiting to be uploaded
+    ONYX_IMAGE_LOAD_PENDING,
+    ONYX_IMAGE_LOAD_READY,
+    // the file can't be read or decoded
+    ONYX_IMAGE_LOAD_FAILED,
+} Onyx_ImageLoadStatus;
+
+// Decodes on threadCount threads, 0 uses every hardware thread. Only the
+// calling thread may use the loader, the workers never touch memory.
+Onyx_ImageLoader*    onyx_CreateImageLoader(Onyx_Memory* memory,
+                                            uint32_t     threadCount);
+// Waits for the decodes that are running and frees every image that wasn't
+// taken with onyx_WaitImageLoad. Queued requests are dropped.
+void                 onyx_DestroyImageLoader(Onyx_ImageLoader* loader);
+// Queues a read and decode of filename and returns at once.
+Onyx_ImageLoadId     onyx_RequestImageLoad(Onyx_ImageLoader*          loader,
+                                           const char*                filename,
+                                           const Onyx_ImageLoadParms* parms);
+// Uploads every image decoded so far, those with the same parms in one
+// submit. Returns the number of requests still pending.
+uint32_t             onyx_UpdateImageLoader(Onyx_ImageLoader* loader);
+// Doesn't upload, so images stay pending until an update or a wait.
+Onyx_ImageLoadStatus onyx_GetImageLoadStatus(const Onyx_ImageLoader* loader,
+                                             Onyx_ImageLoadId        id);
+// Uploads decoded images until the one for id is ready and hands it over, the
+// caller frees it. The id is released either way. Returns false if the image
+// failed to load.
+bool                 onyx_WaitImageLoad(Onyx_ImageLoader* loader,
+                                        Onyx_ImageLoadId id, Onyx_Image* image);
+
+#endif /* end of include guard: ONYX_IMAGE_LOADER_H */
@@ -0,0 +1,42 @@
+#ifndef ONYX_IMAGE_SAVER_H
+#define ONYX_IMAGE_SAVER_H
+
+/*
+ * Asynchronous image saving. The copy of an image to host memory is recorded
+ * into a command buffer of the caller's, followed by an event the saver
+ * polls, so nothing waits on the device. Once the copy is done the texels
+ * are encoded to PNG or JPEG and written on a pool of worker threads.
+ */
+
+#include "image.h"
+
+typedef struct Onyx_ImageSaver Onyx_ImageSaver;
+
+// Called on the thread that updates the saver once the file is written, or
+// the save failed.
+typedef void (*Onyx_ImageSavedFn)(const char* filename, bool ok, void* data);
+
+// Encodes on threadCount threads, 0 uses every hardware thread. Only the
+// calling thread may use the saver, the workers never touch memory.
+Onyx_ImageSaver* onyx_CreateImageSaver(Onyx_Memory* memory,
+                                       uint32_t     threadCount);
+// Waits for the device to be idle and finishes every save whose copy ran.
+// Saves whose command buffers were never submitted fail.
+void             onyx_DestroyImageSaver(Onyx_ImageSaver* saver);
+// Records a copy of the first level of image, which is in layout and is left
+// in it, into cmdBuf and returns. The file is written after cmdBuf has run.
+// fn may be NULL. Returns false if the image's format is neither 1 nor 4
+// channels of 8 bits. BGRA images are written as RGBA.
+bool             onyx_CmdSaveImage(Onyx_ImageSaver* saver,
+                                   VkCommandBuffer cmdBuf,
+                                   const Onyx_Image* image,
+                                   VkImageLayout layout,
+                                   Onyx_V_ImageFileType fileType,
+                                   const char* filename, Onyx_ImageSavedFn fn,
+                                   void* data);
+// Hands the copies that are done to the workers and calls back for the files
+// that are written. Returns the number of saves not finished yet, so call it
+// once a frame or poll it until 0.
+uint32_t         onyx_UpdateImageSaver(Onyx_ImageSaver* saver);
+
+#endif /* end of include guard: ONYX_IMAGE_SAVER_H */
@@ -0,0 +1,37 @@
+#ifndef ONYX_IMPORT_H
+#define ONYX_IMPORT_H
+
+/*
+ * Importers for interchange mesh formats. They produce the same Onyx_FileGeo
+ * that onyx_ReadFileGeo does, with pos and, when the file has them, nor and
+ * uv attributes, an index list of triangles and valid bounds.
+ */
+
+#include "filegeo.h"
+
+typedef enum {
+    ONYX_GEO_IMPORT_FORMAT_NONE,
+    ONYX_GEO_IMPORT_FORMAT_OBJ,
+    ONYX_GEO_IMPORT_FORMAT_PLY,
+} Onyx_GeoImportFormat;
+
+// by the file extension, ignoring case
+Onyx_GeoImportFormat onyx_GetGeoImportFormat(const char* filename);
+
+// Wavefront OBJ. v, vt, vn and f lines are read, everything else is skipped.
+// Polygons are fanned into triangles. Corners that share the same position,
+// uv and normal indices become one vertex. Lines are parsed on threadCount
+// threads, 0 uses every hardware thread. Returns false if the file can't be
+// read or is malformed.
+bool onyx_ImportObj(const char* filename, uint32_t threadCount,
+                    Onyx_FileGeo* fprim);
+// Stanford PLY, ascii or binary of either endianness. The vertex element's
+// x y z, nx ny nz and u v (or s t) properties are read along with the face
+// element's vertex_indices list. Polygons are fanned into triangles.
+bool onyx_ImportPly(const char* filename, uint32_t threadCount,
+                    Onyx_FileGeo* fprim);
+// dispatches on onyx_GetGeoImportFormat
+bool onyx_ImportFileGeo(const char* filename, uint32_t threadCount,
+                        Onyx_FileGeo* fprim);
+
+#endif /* end of include guard: ONYX_IMPORT_H */
@@ -0,0 +1,107 @@
+#ifndef ONYX_MESHPROC_H
+#define ONYX_MESHPROC_H
+
+/*
+ * CPU side mesh processing for Onyx_Geometry and Onyx_FileGeo.
+ */
+
+#include "geo.h"
+#include "filegeo.h"
+
+typedef enum {
+    // vertices on open borders of the mesh will not be collapsed
+    ONYX_SIMPLIFY_LOCK_BORDER_BIT = 1 << 0,
+} Onyx_SimplifyFlagBits;
+typedef uint32_t Onyx_SimplifyFlags;
+
+// Quadric error edge collapse simplification of an indexed triangle list.
+// Vertices are never moved or created so the result indexes the same vertex
+// data as the input. Vertices sharing a position but differing in some other
+// attribute (uv or normal seams) only collapse along the seam, both sides at
+// once, so seams stay closed. Simplification stops when the index count
+// reaches targetIndexCount or the next collapse would exceed targetError
+// (object space distance). dst may alias indices and must hold indexCount
+// indices. Returns the new index count. If error is not NULL it receives the
+// object space error of the result.
+uint32_t onyx_SimplifyIndices(uint32_t* dst, const uint32_t* indices,
+                              uint32_t indexCount, const float* positions,
+                              uint32_t vertexCount, uint32_t positionStride,
+                              uint32_t targetIndexCount, float targetError,
+                              Onyx_SimplifyFlags flags, float* error);
+
+// Builds a chain of lodCount levels, each with roughly reduction times the
+// triangles of the previous one, and stores it in the geometry's lods.
+// Any existing chain is rebuilt from level 0. The chain stops early if a level
+// can't be reduced any further. The geometry must be host visible.
+// Returns the resulting lod count.
+uint32_t onyx_GenerateGeoLods(Onyx_Geometry* geo, uint32_t lodCount,
+                              float reduction, Onyx_SimplifyFlags flags);
+uint32_t onyx_GenerateFileGeoLods(Onyx_FileGeo* fgeo, uint32_t lodCount,
+                                  float reduction, Onyx_SimplifyFlags flags);
+
+typedef struct Onyx_TangentSpaceInfo {
+    uint32_t        vertexCount;
+    uint32_t        indexCount;
+    const uint32_t* indices;
+    const float*    positions; // 3 floats per vertex
+    const float*    normals;   // 3 floats per vertex
+    const float*    uvs;       // 2 floats per vertex
+    float*          tangents;  // 3 floats per vertex
+    float*          signs;     // 1 float per vertex, the bitangent sign
+    // 0 uses every hardware thread
+    uint32_t        threadCount;
+} Onyx_TangentSpaceInfo;
+
+// mikktspace tangents of an indexed triangle list. Pieces of the mesh that
+// share no vertex values are processed on separate threads, the result is the
+// same as a single threaded mikktspace run.
+bool onyx_GenerateTangents(const Onyx_TangentSpaceInfo* info);
+// Fills the tan and sin attributes from pos, nor and uv. The geometry must be
+// host visible. Returns false if an attribute is missing.
+bool onyx_GenerateGeoTangents(Onyx_Geometry* geo, uint32_t threadCount);
+
+// Merges vertices that are equal in every attribute, rewrites the indices and
+// compacts the attribute data. The first of a set of equal vertices is kept
+// and vertices keep their relative order. If epsilon is > 0 attributes made of
+// floats are snapped to a grid of that size before comparing, so values closer
+// than epsilon usually merge (values on either side of a grid line do not).
+// A FileGeo without indices is treated as triangle soup and gets an index
+// list. An Onyx_Geometry must be indexed and host visible; its vertex region
+// is not shrunk but its planes are packed to the new vertex count.
+// Returns the new vertex count.
+uint32_t onyx_WeldFileGeo(Onyx_FileGeo* fgeo, float epsilon,
+                          uint32_t threadCount);
+uint32_t onyx_WeldGeo(Onyx_Geometry* geo, float epsilon, uint32_t threadCount);
+
+// Reorders the triangles of an indexed triangle list so consecutive
+// triangles reuse vertices that are still in the post transform cache.
+// dst may alias indices.
+void  onyx_OptimizeVertexCache(uint32_t* dst, const uint32_t* indices,
+                               uint32_t indexCount, uint32_t vertexCount);
+// Average cache misses per triangle, simulating a FIFO cache of cacheSize
+// vertices. 3 is no reuse at all, around 0.5 is about as good as it gets.
+float onyx_GetVertexCacheAcmr(const uint32_t* indices, uint32_t indexCount,
+                              uint32_t vertexCount, uint32_t cacheSize);
+// Reorders the triangles of each level of detail for the vertex cache, then
+// the vertices in the order the triangles first use them.
+void  onyx_OptimizeFileGeo(Onyx_FileGeo* fgeo);
+// Rounds the floats of the attribute named attrName, or of every attribute
+// made of floats if it is NULL, to mantissaBits bits of mantissa. The relative
+// error is at most 2^-(mantissaBits + 1) and the zeroed low bits make the
+// vertex codec compress better. Returns false if no attribute matched.
+bool  onyx_QuantizeFileGeo(Onyx_FileGeo* fgeo, const char* attrName,
+                           uint32_t mantissaBits);
+
+// Box and sphere of vertexCount tightly packed xyz positions. Uses AVX2 or SSE
+// where available. All zero for vertexCount 0.
+void onyx_ComputeBounds(const float* positions, uint32_t vertexCount,
+                        Onyx_GeoBounds* bounds);
+// Recompute the bounds from the pos attribute (or a 12 byte first attribute if
+// nothing is named pos). The geometry must be host visible. Returns false and
+// leaves the bounds untouched otherwise.
+bool onyx_UpdateGeoBounds(Onyx_Geometry* geo);
+bool onyx_UpdateFileGeoBounds(Onyx_FileGeo* fgeo);
+// Updates the bounds if they are not valid. NULL if they can't be computed.
+const Onyx_GeoBounds* onyx_GetGeoBounds(Onyx_Geometry* geo);
+
+#endif /* end of include guard: ONYX_MESHPROC_H */
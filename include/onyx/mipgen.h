@@ -0,0 +1,47 @@
+#ifndef ONYX_MIPGEN_H
+#define ONYX_MIPGEN_H
+
+/*
+ * Mip chain generation with a compute shader. Up to 12 levels are made in one
+ * dispatch: every workgroup reduces a 64x64 tile down to a single texel in
+ * shared memory and the last workgroup to finish reduces what they wrote the
+ * rest of the way. Works on formats that can't be blitted as long as they can
+ * be storage images, and is recorded into the caller's command buffer rather
+ * than submitted and waited on.
+ */
+
+#include "memory.h"
+
+typedef struct Onyx_MipGenerator Onyx_MipGenerator;
+
+typedef enum {
+    // average in linear space. Implied by sRGB formats, which are written
+    // through a UNORM view.
+    ONYX_MIP_SRGB_BIT           = 1 << 0,
+    // weights colors by their alpha so transparent texels don't bleed into
+    // the lower levels
+    ONYX_MIP_ALPHA_WEIGHTED_BIT = 1 << 1,
+} Onyx_MipFlagBits;
+typedef uint32_t Onyx_MipFlags;
+
+Onyx_MipGenerator* onyx_CreateMipGenerator(Onyx_Memory* memory);
+// the device must be idle or past every recording
+void               onyx_DestroyMipGenerator(Onyx_MipGenerator* gen);
+// True if images of format can have their mips made by the generator, which
+// also needs them to have VK_IMAGE_USAGE_STORAGE_BIT.
+bool               onyx_CanGenerateMips(Onyx_MipGenerator* gen,
+                                        VkFormat           format);
+// Records the generation of every level of image from level 0, which must be
+// in image->layout, and moves all of them to finalLayout. The views and
+// descriptors it uses are held until onyx_ResetMipGenerator, so the command
+// buffer must be done before that is called. Returns false, recording
+// nothing, if the format isn't supported.
+bool               onyx_CmdGenerateMips(Onyx_MipGenerator* gen,
+                                        VkCommandBuffer cmdBuf, Onyx_Image* image,
+                                        Onyx_MipFlags flags,
+                                        VkImageLayout finalLayout);
+// Frees what the recordings so far hold on to. Call once the command buffers
+// they went into have completed, after waiting on their fence for example.
+void               onyx_ResetMipGenerator(Onyx_MipGenerator* gen);
+
+#endif /* end of include guard: ONYX_MIPGEN_H */
@@ -9,13 +9,26 @@ extern "C" {
 #include "video.h"
 #include "memory.h"
 #include "image.h"
+#include "imageloader.h"
+#include "imagesaver.h"
+#include "mipgen.h"
+#include "texfile.h"
+#include "texstream.h"
+#include "bindless.h"
 #include "swapchain.h"
 #include "scene.h"
 #include "render.h"
 #include "raytrace.h"
 #include "renderpass.h"
 #include "geo.h"
+#include "geoarena.h"
 #include "file.h"
+#include "import.h"
+#include "gltf.h"
+#include "scenefile.h"
+#include "meshproc.h"
+#include "parallel.h"
+#include "asyncio.h"
 #include "pipeline.h"
 
 typedef VkDevice Onyx_Device;
@@ -0,0 +1,40 @@
+#ifndef ONYX_PARALLEL_H
+#define ONYX_PARALLEL_H
+
+#include <stdint.h>
+
+// called once per task. thread is in [0, threadCount) and can be used to index
+// per thread scratch data.
+typedef void (*Onyx_ParallelTaskFn)(void* data, uint32_t task, uint32_t thread);
+
+uint32_t onyx_GetHardwareThreadCount(void);
+
+// Runs fn for every task in [0, taskCount) spread over threadCount threads,
+// including the calling one, and returns once all of them are done. Tasks are
+// handed out in order but may finish in any order. A threadCount of 0 uses
+// every hardware thread.
+void onyx_ParallelFor(uint32_t threadCount, uint32_t taskCount,
+                      Onyx_ParallelTaskFn fn, void* data);
+
+// Long lived worker threads that run tasks in the order they are submitted,
+// for work that overlaps with what the submitting thread does next, unlike
+// onyx_ParallelFor which blocks until everything is done.
+typedef struct Onyx_TaskPool Onyx_TaskPool;
+typedef void (*Onyx_PoolTaskFn)(void* data, uint32_t thread);
+
+// A threadCount of 0 uses every hardware thread. NULL if no thread could be
+// started.
+Onyx_TaskPool* onyx_CreateTaskPool(uint32_t threadCount);
+uint32_t       onyx_GetTaskPoolThreadCount(const Onyx_TaskPool* pool);
+// thread is in [0, onyx_GetTaskPoolThreadCount)
+void           onyx_SubmitPoolTask(Onyx_TaskPool* pool, Onyx_PoolTaskFn fn,
+                                   void* data);
+// returns once every submitted task is done
+void           onyx_WaitTaskPool(Onyx_TaskPool* pool);
+// Blocks until more than finished tasks have finished, or nothing is left to
+// run, and returns how many have. Start with 0 to wait for tasks one by one.
+uint64_t       onyx_WaitPoolTaskDone(Onyx_TaskPool* pool, uint64_t finished);
+// runs the tasks still queued, then stops the threads
+void           onyx_DestroyTaskPool(Onyx_TaskPool* pool);
+
+#endif /* end of include guard: ONYX_PARALLEL_H */
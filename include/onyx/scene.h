@@ -56,6 +56,8 @@ typedef enum {
     ONYX_PRIM_ADDED_BIT            = 1 << 0,
     ONYX_PRIM_REMOVED_BIT          = 1 << 1,
     ONYX_PRIM_TOPOLOGY_CHANGED_BIT = 1 << 2,
+    // vertex data was written, no change in vertex or index count
+    ONYX_PRIM_ATTRIBUTES_CHANGED_BIT = 1 << 3,
     ONYX_PRIM_LAST_BIT_PLUS_1,
 } Onyx_PrimDirtyFlagBits;
 typedef uint8_t Onyx_PrimDirtyFlags;
@@ -265,6 +267,10 @@ void onyx_SceneEndFrame(Onyx_Scene*);
 // Does not own the image
 Onyx_TextureHandle onyx_SceneAddTexture(Onyx_Scene*  scene,
                                            Onyx_Image* image);
+// Points the texture at another image and marks it changed so consumers
+// rewrite their descriptors. Does not own the image either.
+void onyx_SceneUpdateTexture(Onyx_Scene* scene, Onyx_TextureHandle tex,
+                             Onyx_Image* image);
 
 Onyx_Material* onyx_GetMaterial(const Onyx_Scene*   s,
                                 Onyx_MaterialHandle handle);
@@ -295,10 +301,26 @@ const Onyx_Camera* onyx_SceneGetCamera(const Onyx_Scene* scene);
 // Writeable access to the geo held by the prim. 
 // Must pass flags to indicate how the geo will be modified.
 // Can return NULL indicating prim has no geo yet.
+// Topology or attribute flags invalidate the geo's bounds; they are recomputed
+// in onyx_SceneEndFrame if the geo is host visible.
+// For a geo with a device mirror the topology flag marks the whole geo for
+// upload. With the attributes flag mark the written ranges with
+// onyx_MarkGeoAttributeDirty so only those are uploaded.
 Onyx_Geometry* onyx_SceneGetPrimGeo(Onyx_Scene*          scene,
                                     Onyx_PrimitiveHandle prim,
                                     Onyx_PrimDirtyFlags  flags);
 
+// Object space bounds of the prim's geo, computed now if they are not valid.
+// NULL if the prim has no geo or the bounds can't be computed.
+const Onyx_GeoBounds* onyx_SceneGetPrimBounds(Onyx_Scene*          scene,
+                                              Onyx_PrimitiveHandle prim);
+
+// Picks the level of detail of the prim's geo whose error projects to at most
+// maxPixelError pixels on a viewport viewportHeight pixels tall.
+uint32_t onyx_SceneSelectPrimLod(const Onyx_Scene* scene,
+                                 Onyx_PrimitiveHandle prim,
+                                 float viewportHeight, float maxPixelError);
+
 Onyx_Primitive* 
 onyx_SceneGetPrimitive(Onyx_Scene* s, Onyx_PrimitiveHandle handle);
 
@@ -311,6 +333,43 @@ void onyx_SceneDirtyAll(Onyx_Scene* s);
 
 void onyx_SceneCameraUpdateAspectRatio(Onyx_Scene* s, float ar);
 
+typedef enum {
+    ONYX_SCENE_OBJECT_PRIM,
+    ONYX_SCENE_OBJECT_LIGHT,
+    ONYX_SCENE_OBJECT_MATERIAL,
+    ONYX_SCENE_OBJECT_TEXTURE,
+    ONYX_SCENE_OBJECT_TYPE_COUNT,
+} Onyx_SceneObjectType;
+
+// What the object map of one object type holds: the handle id of each object
+// in the order of the object array, and the ids of removed objects waiting
+// for reuse from the bottom of the stack up.
+typedef struct Onyx_SceneObjectIds {
+    uint32_t             count;
+    Onyx_SceneObjectInt* ids;
+    uint32_t             freeCount;
+    Onyx_SceneObjectInt* freeIds;
+} Onyx_SceneObjectIds;
+
+// allocates ids, free with onyx_FreeSceneObjectIds
+void onyx_SceneGetObjectIds(const Onyx_Scene* s, Onyx_SceneObjectType type,
+                            Onyx_SceneObjectIds* ids);
+void onyx_FreeSceneObjectIds(Onyx_SceneObjectIds* ids);
+// Replaces every object of a type in one go, e.g. when restoring a saved
+// scene. objects holds ids->count Onyx_Primitive, Onyx_Light, Onyx_Material
+// or Onyx_Texture in object array order. The ids must be those of
+// onyx_SceneGetObjectIds, so handles held elsewhere keep working. Everything
+// is marked added as if it went through onyx_SceneAdd* and the dirty sets of
+// the type are replaced. Meant for a scene that has only its defaults.
+void onyx_SceneRestoreObjects(Onyx_Scene* s, Onyx_SceneObjectType type,
+                              const void*                objects,
+                              const Onyx_SceneObjectIds* ids);
+
+// the geo of the default prim and the image of the default texture, which the
+// scene owns
+Onyx_Geometry* onyx_SceneGetDefaultGeo(Onyx_Scene* s);
+Onyx_Image*    onyx_SceneGetDefaultImage(Onyx_Scene* s);
+
 static inline Onyx_PrimitiveHandle onyx_CreatePrimitiveHandle(Onyx_SceneObjectInt i) 
 {
     return (Onyx_PrimitiveHandle){.id = i}; 
@@ -0,0 +1,105 @@
+#ifndef ONYX_SCENE_FILE_H
+#define ONYX_SCENE_FILE_H
+
+/*
+ * Binary scene files. A scene file holds the prims, lights, materials,
+ * textures and camera of an Onyx_Scene along with the ids of its object maps,
+ * so handles taken before saving still refer to the same objects after
+ * loading. Geometry and images are embedded, geometry as version 2 geo files
+ * and images as PNG, or referenced by path.
+ */
+
+#include "scene.h"
+#include "file.h"
+
+typedef struct Onyx_WriteSceneParms {
+    // codecs of the embedded geo files
+    Onyx_GeoCodec               attributeCodec;
+    Onyx_GeoCodec               indexCodec;
+    // Geometry and images that are stored as paths instead of being embedded,
+    // for those that were loaded from files. Relative paths are resolved
+    // against the directory of the scene file when loading.
+    uint32_t                    geoRefCount;
+    const Onyx_Geometry* const* refGeos;
+    const char* const*          refGeoPaths;
+    uint32_t                    imageRefCount;
+    const Onyx_Image* const*    refImages;
+    const char* const*          refImagePaths;
+} Onyx_WriteSceneParms;
+
+// Call after onyx_SceneEndFrame so removed objects are gone. Geometry that
+// lives only on the device and every embedded image are read back through
+// memory. The scene's own default geo and image are never written, the scene
+// that is loaded into has its own. Returns false if an embedded image has a
+// format that can't be written as PNG.
+bool onyx_WriteSceneFile(Onyx_Memory* memory, Onyx_Scene* scene,
+                         const char*                 filename,
+                         const Onyx_WriteSceneParms* parms);
+
+// What a scene file holds of a scene: its objects in object array order,
+// their ids and the camera. Prims and textures refer to geometry and images
+// by address.
+typedef struct Onyx_SceneFileObjects {
+    Onyx_SceneObjectIds   ids[ONYX_SCENE_OBJECT_TYPE_COUNT];
+    const Onyx_Primitive* prims;
+    const Onyx_Light*     lights;
+    const Onyx_Material*  materials;
+    const Onyx_Texture*   textures;
+    Coal_Mat4             cameraXform;
+    Coal_Mat4             cameraProj;
+    // stored as the scene's own, whichever scene loads the file
+    const Onyx_Geometry*  defaultGeo;
+    const Onyx_Image*     defaultImage;
+    // Set by onyx_ReadSceneFileObjects: zeroed stand-ins for the file's
+    // geometry and images in file order, followed by the default ones.
+    uint32_t              geoCount;
+    Onyx_Geometry*        geos;
+    uint32_t              imageCount;
+    Onyx_Image*           images;
+} Onyx_SceneFileObjects;
+
+// onyx_WriteSceneFile without a scene. memory may be NULL if every geometry
+// is host visible or referenced and every image is referenced.
+bool onyx_WriteSceneFileObjects(Onyx_Memory*                 memory,
+                                const Onyx_SceneFileObjects* objects,
+                                const char*                  filename,
+                                const Onyx_WriteSceneParms*  parms);
+
+typedef struct Onyx_LoadSceneParms {
+    VkBufferUsageFlags extraBufferUsageFlags;
+    VkImageUsageFlags  extraImageUsageFlags;
+    // move the geometry to device memory
+    bool               transferToDevice;
+    bool               createMips;
+    // threads decoding geometry and images, 0 uses every hardware thread
+    uint32_t           threadCount;
+} Onyx_LoadSceneParms;
+
+// The geometry and images a load created. The scene doesn't own them.
+typedef struct Onyx_SceneFileResources {
+    uint32_t       geoCount;
+    Onyx_Geometry* geos;
+    uint32_t       imageCount;
+    Onyx_Image*    images;
+} Onyx_SceneFileResources;
+
+// Loads into a scene fresh from onyx_CreateScene, replacing its default
+// objects. Geometry and images are decoded on parms->threadCount threads and
+// uploaded with a few batched submits. Returns false if the file is
+// malformed, fails its checksums or references files that can't be read,
+// leaving the scene untouched.
+bool onyx_LoadSceneFile(Onyx_Memory* memory, const char* filename,
+                        const Onyx_LoadSceneParms* parms, Onyx_Scene* scene,
+                        Onyx_SceneFileResources* resources);
+// the scene must not use the resources anymore
+void onyx_FreeSceneFileResources(Onyx_SceneFileResources* resources);
+
+// Reads and checks a scene file like onyx_LoadSceneFile but leaves its
+// geometry and images undecoded, so it needs no device. Prims and textures
+// point at the stand-ins in objects. Returns false if the file is malformed
+// or fails its checksums.
+bool onyx_ReadSceneFileObjects(const char* filename,
+                               Onyx_SceneFileObjects* objects);
+void onyx_FreeSceneFileObjects(Onyx_SceneFileObjects* objects);
+
+#endif /* end of include guard: ONYX_SCENE_FILE_H */
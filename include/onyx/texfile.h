@@ -0,0 +1,86 @@
+#ifndef ONYX_TEXFILE_H
+#define ONYX_TEXFILE_H
+
+/*
+ * Textures stored in the format they are sampled in, usually block
+ * compressed, with their whole mip chain. They are read from KTX2 and DDS
+ * files and uploaded level by level without decoding, or decoded to RGBA8 on
+ * devices that can't sample the format. Also has BC1 and BC7 encoders to
+ * build such textures offline.
+ */
+
+#include "image.h"
+
+#define ONYX_TEXTURE_MAX_LEVELS 16
+
+typedef struct Onyx_TextureLevel {
+    // offset into data
+    size_t offset;
+    size_t size;
+} Onyx_TextureLevel;
+
+typedef struct Onyx_TextureFile {
+    VkFormat          format;
+    uint32_t          width;
+    uint32_t          height;
+    uint32_t          levelCount;
+    // largest first
+    Onyx_TextureLevel levels[ONYX_TEXTURE_MAX_LEVELS];
+    uint8_t*          data;
+    size_t            dataSize;
+} Onyx_TextureFile;
+
+// Reads a KTX2 or DDS file, told apart by their identifiers. Only 2D
+// textures without layers or faces, and KTX2 files without
+// supercompression, are supported. Returns false if the file can't be read
+// or is of a kind that isn't.
+bool     onyx_ReadTextureFile(const char* filename, Onyx_TextureFile* tex);
+// Reads only the header. data stays NULL and the level offsets are into the
+// file, for reading levels when they are needed.
+bool     onyx_ReadTextureFileInfo(const char* filename, Onyx_TextureFile* tex);
+// Writes a KTX2 file. Returns false if it can't be written or the format
+// has no data format descriptor here, which only BC1, BC7 and RGBA8 have.
+bool     onyx_WriteKtx2(const char* filename, const Onyx_TextureFile* tex);
+void     onyx_FreeTextureFile(Onyx_TextureFile* tex);
+
+// Texel block dimensions and byte size of the block compressed, ASTC and a
+// few plain formats. False for any other format.
+bool     onyx_GetFormatBlock(VkFormat format, uint32_t* blockWidth,
+                             uint32_t* blockHeight, uint32_t* blockSize);
+// 0 for formats onyx_GetFormatBlock doesn't know
+size_t   onyx_GetTextureLevelSize(VkFormat format, uint32_t width,
+                                  uint32_t height);
+
+// The RGBA8 format BC1 to BC5 and BC7 decode to, keeping sRGB and SNORM.
+// VK_FORMAT_UNDEFINED for formats that can't be decoded, BC6H and ASTC
+// among them.
+VkFormat onyx_GetDecodedFormat(VkFormat format);
+// Decodes blocks to 4 byte texels. Returns false if the format can't be.
+bool     onyx_DecodeBlocks(VkFormat format, uint32_t width, uint32_t height,
+                           const void* blocks, uint8_t* texels);
+// Encode RGBA8 texels spread over every hardware thread. BC1 drops alpha.
+void     onyx_EncodeBC1(uint32_t width, uint32_t height, const uint8_t* texels,
+                        void* blocks);
+void     onyx_EncodeBC7(uint32_t width, uint32_t height, const uint8_t* texels,
+                        void* blocks);
+// Builds a texture from RGBA8 texels. format is one of the BC1 RGB, BC7 or
+// R8G8B8A8 formats, the sRGB ones filter the mips in linear space.
+void     onyx_CompressTexture(uint32_t width, uint32_t height,
+                              const uint8_t* texels, VkFormat format,
+                              bool createMips, Onyx_TextureFile* tex);
+// Same from an image file that stb_image can read. False if it can't.
+bool     onyx_CompressImageFile(const char* filename, VkFormat format,
+                                bool createMips, Onyx_TextureFile* tex);
+
+// True if the device can sample images of format. Block compressed formats
+// also need their device feature, which is enabled when there is one.
+bool     onyx_CanSampleFormat(const Onyx_Memory* memory, VkFormat format);
+// Uploads every level of tex in one submit and leaves them in layout, which
+// blocks until done. A format the device can't sample is decoded first if
+// it can be. Returns false, without touching image, if it can't.
+bool     onyx_LoadTextureFile(Onyx_Memory* memory, const Onyx_TextureFile* tex,
+                              VkImageUsageFlags usageFlags, VkFilter filter,
+                              VkImageLayout layout, Onyx_MemoryType memoryType,
+                              Onyx_Image* image);
+
+#endif /* end of include guard: ONYX_TEXFILE_H */
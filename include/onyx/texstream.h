@@ -0,0 +1,99 @@
+#ifndef ONYX_TEXSTREAM_H
+#define ONYX_TEXSTREAM_H
+
+/*
+ * Mip level streaming of scene textures from KTX2 and DDS files. A texture
+ * starts out with its smallest levels, its tail, and gets larger levels as
+ * they are asked for, within a budget of device bytes. When the budget runs
+ * out the largest levels of the textures asked for least recently are
+ * dropped. A texture's levels live in one image that is reallocated with
+ * more or fewer levels, the levels both images have copied on the device,
+ * and the scene's texture is pointed at the new image. Levels the old image
+ * doesn't have are read from disk, including dropped levels asked for again.
+ */
+
+#include "scene.h"
+#include "texfile.h"
+
+typedef struct Onyx_TextureStreamer Onyx_TextureStreamer;
+
+typedef struct Onyx_TextureStreamerParms {
+    // device bytes the levels of every streamed texture may take together.
+    // Tails are loaded even past it. 0 for no limit.
+    uint64_t budget;
+    // bytes read and uploaded by one update at most, 0 for 16 MB. At least
+    // one level is always uploaded.
+    uint64_t maxUploadBytes;
+    // levels no larger than this on either side make up the tail, which is
+    // never dropped. 0 for 64.
+    uint32_t tailSize;
+    // updates that can be recorded before the first of them is known to be
+    // done. Replaced images are freed this many updates later. 0 for 2.
+    uint32_t framesInFlight;
+    VkFilter filter;
+} Onyx_TextureStreamerParms;
+
+typedef struct Onyx_TextureResidency {
+    uint32_t levelCount;
+    // the largest level on the device, levelCount while the texture still
+    // shows the scene's default image
+    uint32_t residentMip;
+    uint32_t tailMip;
+    // the largest level asked for, valid if lastRequest is the last update
+    uint32_t requestedMip;
+    uint64_t lastRequest;
+    uint64_t residentBytes;
+} Onyx_TextureResidency;
+
+typedef struct Onyx_TextureStreamerStats {
+    uint32_t textureCount;
+    uint64_t residentBytes;
+    uint64_t budget;
+    // of the last update
+    uint64_t uploadedBytes;
+    uint64_t evictedBytes;
+    uint64_t updateCount;
+} Onyx_TextureStreamerStats;
+
+Onyx_TextureStreamer* onyx_CreateTextureStreamer(
+    Onyx_Memory* memory, Onyx_Scene* scene,
+    const Onyx_TextureStreamerParms* parms);
+// the device must be idle. Textures stay in the scene, showing images that
+// no longer exist, so remove them first.
+void onyx_DestroyTextureStreamer(Onyx_TextureStreamer* streamer);
+
+// Adds the texture in filename to the scene. It shows the default image
+// until an update loads its tail. NULL_TEXTURE if the file can't be read.
+Onyx_TextureHandle onyx_StreamTexture(Onyx_TextureStreamer* streamer,
+                                      const char*           filename);
+void onyx_RemoveStreamedTexture(Onyx_TextureStreamer* streamer,
+                                Onyx_TextureHandle    tex);
+
+// Asks for level mip and the smaller ones of tex to be made resident by the
+// next update. Textures that aren't asked for keep their levels until the
+// budget needs them, so ask every frame for what is visible.
+void onyx_RequestTextureMip(Onyx_TextureStreamer* streamer,
+                            Onyx_TextureHandle tex, uint32_t mip);
+// The same from feedback the shaders wrote: mips[id] is the largest level
+// sampled from the texture with handle id, or ONYX_TEXTURE_NOT_SAMPLED.
+// Ids without a streamed texture are skipped.
+#define ONYX_TEXTURE_NOT_SAMPLED 0xff
+void onyx_ApplyTextureFeedback(Onyx_TextureStreamer* streamer, uint32_t count,
+                               const uint8_t* mips);
+
+// Reads the levels asked for, decides what fits the budget and records the
+// copies into cmdBuf, leaving every image in SHADER_READ_ONLY_OPTIMAL for the
+// fragment shader. Textures whose image changed are marked changed in the
+// scene, so call it before the scene's consumers update. Blocks on the file
+// reads only.
+void onyx_CmdUpdateTextureStreamer(Onyx_TextureStreamer* streamer,
+                                   VkCommandBuffer       cmdBuf);
+
+// false if tex isn't streamed
+bool onyx_GetTextureResidency(const Onyx_TextureStreamer* streamer,
+                              Onyx_TextureHandle tex,
+                              Onyx_TextureResidency* residency);
+void onyx_GetTextureStreamerStats(const Onyx_TextureStreamer* streamer,
+                                  Onyx_TextureStreamerStats*  stats);
+
+#endif /* end of include guard: ONYX_TEXSTREAM_H */
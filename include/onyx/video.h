@@ -41,6 +41,11 @@ typedef struct Onyx_Instance {
     VkPhysicalDeviceRayTracingPipelinePropertiesKHR    rtProperties;
     VkPhysicalDeviceAccelerationStructurePropertiesKHR accelStructProperties;
     VkPhysicalDeviceProperties                         deviceProperties;
+    // the core features the device was created with
+    VkPhysicalDeviceFeatures                           enabledFeatures;
+    // every descriptor indexing feature the device supports is enabled.
+    // pNext is NULL.
+    VkPhysicalDeviceDescriptorIndexingFeatures         enabledDescriptorIndexing;
 } Onyx_Instance;
 
 
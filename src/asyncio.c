@@ -0,0 +1,427 @@
+#include "asyncio.h"
+#include "dtags.h"
+#include "parallel.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#if UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HAS_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_IO, fmt, ##__VA_ARGS__)
+
+// Reads are split into chunks of this size, which are what is in flight.
+#define CHUNK_SIZE (1 << 20)
+// chunks in flight on the ring
+#define QUEUE_DEPTH 64
+// threads of the fallback, they mostly wait on the disk
+#define IO_THREAD_COUNT 16
+
+typedef struct {
+    uint32_t read;
+    uint64_t offset;
+    uint64_t size;
+    uint8_t* dst;
+    uint64_t done;
+    bool     failed;
+} Chunk;
+
+typedef struct {
+    Onyx_FileRead* reads;
+    uint32_t       count;
+    // buffers allocated here, freed again if their read fails
+    bool*          ownsDst;
+    bool*          opened;
+#if UNIX
+    int*           fds;
+#endif
+    Chunk*         chunks;
+    uint32_t       chunkCount;
+} Batch;
+
+// the size of the file, or -1 if it can't be opened
+static int64_t
+openFile(Batch* b, uint32_t i)
+{
+    const char* filename = b->reads[i].filename;
+#if UNIX
+    const int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    b->fds[i]    = fd;
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+        return -1;
+    return st.st_size;
+#else
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+        return -1;
+    int64_t size = -1;
+    if (_fseeki64(file, 0, SEEK_END) == 0)
+        size = _ftelli64(file);
+    fclose(file);
+    return size;
+#endif
+}
+
+static void
+prepareBatch(uint32_t count, Onyx_FileRead* reads, Batch* b)
+{
+    memset(b, 0, sizeof(*b));
+    b->reads   = reads;
+    b->count   = count;
+    b->ownsDst = hell_Malloc(count + 1);
+    b->opened  = hell_Malloc(count + 1);
+#if UNIX
+    b->fds = hell_Malloc((count + 1) * sizeof(int));
+#endif
+    uint64_t chunkCount = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Onyx_FileRead* r  = &reads[i];
+        const int64_t  fileSize = openFile(b, i);
+        r->bytesRead  = 0;
+        r->ok         = false;
+        b->ownsDst[i] = false;
+        b->opened[i]  = fileSize >= 0;
+        if (fileSize < 0)
+        {
+            DPRINT("Can't open %s\n", r->filename);
+            continue;
+        }
+        if (r->size == ONYX_READ_TO_END)
+        {
+            assert(!r->dst && "reads to the end allocate their buffer");
+            r->size = (uint64_t)fileSize > r->offset ? fileSize - r->offset : 0;
+        }
+        if (!r->dst)
+        {
+            r->dst = hell_Malloc(r->size + 1);
+            ((uint8_t*)r->dst)[r->size] = 0;
+            b->ownsDst[i]               = true;
+        }
+        chunkCount += (r->size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    }
+    assert(chunkCount < UINT32_MAX);
+    b->chunks = hell_Malloc((chunkCount + 1) * sizeof(Chunk));
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const Onyx_FileRead* r = &reads[i];
+        if (!b->opened[i])
+            continue;
+        for (uint64_t pos = 0; pos < r->size; pos += CHUNK_SIZE)
+        {
+            const uint64_t size = r->size - pos < CHUNK_SIZE ? r->size - pos
+                                                             : CHUNK_SIZE;
+            b->chunks[b->chunkCount++] = (Chunk){
+                .read   = i,
+                .offset = r->offset + pos,
+                .size   = size,
+                .dst    = (uint8_t*)r->dst + pos,
+            };
+        }
+    }
+}
+
+static bool
+finishBatch(Batch* b)
+{
+    for (uint32_t i = 0; i < b->chunkCount; i++)
+    {
+        const Chunk*   c = &b->chunks[i];
+        Onyx_FileRead* r = &b->reads[c->read];
+        r->bytesRead += c->done;
+        if (c->failed)
+            b->opened[c->read] = false;
+    }
+    bool ok = true;
+    for (uint32_t i = 0; i < b->count; i++)
+    {
+        Onyx_FileRead* r = &b->reads[i];
+        r->ok            = b->opened[i] && r->bytesRead == r->size;
+        if (!r->ok && b->ownsDst[i])
+        {
+            hell_Free(r->dst);
+            r->dst = NULL;
+        }
+        ok = ok && r->ok;
+#if UNIX
+        if (b->fds[i] >= 0)
+            close(b->fds[i]);
+#endif
+    }
+    hell_Free(b->ownsDst);
+    hell_Free(b->opened);
+#if UNIX
+    hell_Free(b->fds);
+#endif
+    hell_Free(b->chunks);
+    return ok;
+}
+
+// reads what is left of a chunk, stopping early at the end of the file
+static void
+readChunk(const Batch* b, Chunk* c)
+{
+#if UNIX
+    const int fd = b->fds[c->read];
+    while (c->done < c->size)
+    {
+        const ssize_t n =
+            pread(fd, c->dst + c->done, c->size - c->done, c->offset + c->done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            c->failed = true;
+        if (n <= 0)
+            return;
+        c->done += n;
+    }
+#else
+    FILE* file = fopen(b->reads[c->read].filename, "rb");
+    if (!file || _fseeki64(file, c->offset + c->done, SEEK_SET) != 0)
+        c->failed = true;
+    else
+        c->done += fread(c->dst + c->done, 1, c->size - c->done, file);
+    if (file)
+        fclose(file);
+#endif
+}
+
+static void
+readChunkTask(void* data, uint32_t task, uint32_t thread)
+{
+    Batch* b = data;
+    readChunk(b, &b->chunks[task]);
+}
+
+static void
+readWithThreads(Batch* b)
+{
+    onyx_ParallelFor(IO_THREAD_COUNT, b->chunkCount, readChunkTask, b);
+}
+
+#if HAS_URING
+typedef struct {
+    int                  fd;
+    uint32_t             entries;
+    uint32_t*            sqHead;
+    uint32_t*            sqTail;
+    uint32_t*            sqMask;
+    uint32_t*            sqArray;
+    uint32_t*            cqHead;
+    uint32_t*            cqTail;
+    uint32_t*            cqMask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void*                sqRing;
+    size_t               sqRingSize;
+    void*                cqRing;
+    size_t               cqRingSize;
+    size_t               sqesSize;
+} Ring;
+
+// Talks to the kernel directly, the few calls needed don't warrant liburing.
+static bool
+createRing(uint32_t entries, Ring* r)
+{
+    memset(r, 0, sizeof(*r));
+    struct io_uring_params p = {0};
+    r->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0)
+        return false;
+    r->entries    = p.sq_entries;
+    r->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+    r->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (r->cqRingSize > r->sqRingSize)
+            r->sqRingSize = r->cqRingSize;
+        r->cqRingSize = r->sqRingSize;
+    }
+    r->sqRing = mmap(NULL, r->sqRingSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (r->sqRing == MAP_FAILED)
+    {
+        close(r->fd);
+        return false;
+    }
+    r->cqRing = r->sqRing;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP))
+        r->cqRing = mmap(NULL, r->cqRingSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    r->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes     = mmap(NULL, r->sqesSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->cqRing == MAP_FAILED || r->sqes == MAP_FAILED)
+    {
+        if (r->sqes != MAP_FAILED)
+            munmap(r->sqes, r->sqesSize);
+        if (r->cqRing != MAP_FAILED && r->cqRing != r->sqRing)
+            munmap(r->cqRing, r->cqRingSize);
+        munmap(r->sqRing, r->sqRingSize);
+        close(r->fd);
+        return false;
+    }
+    uint8_t* sq = r->sqRing;
+    uint8_t* cq = r->cqRing;
+    r->sqHead   = (uint32_t*)(sq + p.sq_off.head);
+    r->sqTail   = (uint32_t*)(sq + p.sq_off.tail);
+    r->sqMask   = (uint32_t*)(sq + p.sq_off.ring_mask);
+    r->sqArray  = (uint32_t*)(sq + p.sq_off.array);
+    r->cqHead   = (uint32_t*)(cq + p.cq_off.head);
+    r->cqTail   = (uint32_t*)(cq + p.cq_off.tail);
+    r->cqMask   = (uint32_t*)(cq + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    return true;
+}
+
+static void
+destroyRing(Ring* r)
+{
+    munmap(r->sqes, r->sqesSize);
+    if (r->cqRing != r->sqRing)
+        munmap(r->cqRing, r->cqRingSize);
+    munmap(r->sqRing, r->sqRingSize);
+    close(r->fd);
+}
+
+static void
+pushRead(Ring* r, const Batch* b, uint32_t chunkIndex)
+{
+    const Chunk*         c    = &b->chunks[chunkIndex];
+    const uint32_t       tail = *r->sqTail;
+    const uint32_t       i    = tail & *r->sqMask;
+    struct io_uring_sqe* sqe  = &r->sqes[i];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = IORING_OP_READ;
+    sqe->fd        = b->fds[c->read];
+    sqe->off       = c->offset + c->done;
+    sqe->addr      = (uintptr_t)(c->dst + c->done);
+    sqe->len       = c->size - c->done;
+    sqe->user_data = chunkIndex;
+    r->sqArray[i]  = i;
+    __atomic_store_n(r->sqTail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// Keeps up to a ring's worth of chunks in flight. Short reads are queued
+// again for the rest of their chunk.
+static void
+readWithRing(Ring* r, Batch* b)
+{
+    uint32_t* retries    = hell_Malloc((b->chunkCount + 1) * sizeof(uint32_t));
+    uint32_t  retryCount = 0;
+    uint32_t  next       = 0;
+    uint32_t  inFlight   = 0;
+    // pushed but not yet taken by the kernel
+    uint32_t  unsubmitted = 0;
+    while (next < b->chunkCount || retryCount || inFlight || unsubmitted)
+    {
+        while (inFlight + unsubmitted < r->entries &&
+               (retryCount || next < b->chunkCount))
+        {
+            pushRead(r, b, retryCount ? retries[--retryCount] : next++);
+            unsubmitted++;
+        }
+        const int n = syscall(__NR_io_uring_enter, r->fd, unsubmitted, 1,
+                              IORING_ENTER_GETEVENTS, NULL, 0);
+        if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            // can't recover what is in flight, so wait for nothing and
+            // finish on this thread
+            DPRINT("io_uring_enter failed: %s\n", strerror(errno));
+            break;
+        }
+        if (n > 0)
+        {
+            unsubmitted -= n;
+            inFlight += n;
+        }
+        uint32_t       head = *r->cqHead;
+        const uint32_t tail = __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+        {
+            const struct io_uring_cqe* cqe   = &r->cqes[head & *r->cqMask];
+            const uint32_t             index = cqe->user_data;
+            Chunk*                     c     = &b->chunks[index];
+            inFlight--;
+            if (cqe->res == -EAGAIN || cqe->res == -EINTR)
+                retries[retryCount++] = index;
+            else if (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP)
+                // kernels before 5.6 don't know IORING_OP_READ
+                readChunk(b, c);
+            else if (cqe->res < 0)
+                c->failed = true;
+            else if (cqe->res > 0)
+            {
+                c->done += cqe->res;
+                if (c->done < c->size)
+                    retries[retryCount++] = index;
+            }
+        }
+        __atomic_store_n(r->cqHead, head, __ATOMIC_RELEASE);
+    }
+    // only if the ring broke down, chunks that were in flight are read again
+    if (inFlight || unsubmitted || retryCount || next < b->chunkCount)
+        readWithThreads(b);
+    hell_Free(retries);
+}
+#endif
+
+bool
+onyx_ReadFilesWithBackend(Onyx_IoBackend backend, uint32_t count,
+                          Onyx_FileRead* reads)
+{
+    Batch b;
+    prepareBatch(count, reads, &b);
+    if (b.chunkCount == 1)
+        // not worth the setup
+        readChunk(&b, &b.chunks[0]);
+    else if (b.chunkCount > 1)
+    {
+        bool done = false;
+#if HAS_URING
+        Ring ring;
+        if (backend != ONYX_IO_BACKEND_THREADS &&
+            createRing(b.chunkCount < QUEUE_DEPTH ? b.chunkCount : QUEUE_DEPTH,
+                       &ring))
+        {
+            readWithRing(&ring, &b);
+            destroyRing(&ring);
+            done = true;
+        }
+        else if (backend != ONYX_IO_BACKEND_THREADS)
+            DPRINT("io_uring isn't available, reading on threads\n");
+#endif
+        if (!done)
+            readWithThreads(&b);
+    }
+    return finishBatch(&b);
+}
+
+bool
+onyx_ReadFiles(uint32_t count, Onyx_FileRead* reads)
+{
+    return onyx_ReadFilesWithBackend(ONYX_IO_BACKEND_DEFAULT, count, reads);
+}
+
+void*
+onyx_ReadWholeFile(const char* filename, size_t* size)
+{
+    Onyx_FileRead read = {.filename = filename, .size = ONYX_READ_TO_END};
+    if (!onyx_ReadFiles(1, &read))
+        return NULL;
+    *size = read.bytesRead;
+    return read.dst;
+}
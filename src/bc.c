@@ -0,0 +1,793 @@
+#include "texfile.h"
+#include "parallel.h"
+#include <hell/common.h>
+#include <hell/minmax.h>
+#include <math.h>
+#include <string.h>
+
+// BC1 to BC5 and BC7 decoding and BC1 and BC7 encoding. The encoders fit
+// endpoints along the principal axis of each block's colors and refine them
+// once with least squares. BC7 is only encoded with mode 6, one subset with
+// 8 bit endpoints and 16 levels, which handles color and alpha alike.
+
+typedef uint8_t Texel[4];
+
+typedef struct {
+    uint8_t subsets;
+    uint8_t partitionBits;
+    uint8_t rotationBits;
+    uint8_t indexSelectionBits;
+    uint8_t colorBits;
+    uint8_t alphaBits;
+    uint8_t endpointPBits;
+    uint8_t sharedPBits;
+    uint8_t indexBits;
+    uint8_t index2Bits;
+} Bc7Mode;
+
+static const Bc7Mode bc7Modes[8] = {
+    {3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+    {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+    {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+    {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+    {1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+    {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+    {1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+    {2, 6, 0, 0, 5, 5, 1, 0, 2, 0},
+};
+
+// bit i is the subset of texel i
+static const uint16_t bc7Partitions2[64] = {
+    0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+    0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+    0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+    0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+    0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+    0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+    0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+    0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+};
+
+static const uint8_t bc7Partitions3[64][16] = {
+    {0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2},
+    {0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1},
+    {0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1},
+    {0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2},
+    {0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2},
+    {0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2},
+    {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2},
+    {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2},
+    {0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2},
+    {0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2},
+    {0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2},
+    {0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2},
+    {0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0},
+    {0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2},
+    {0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0},
+    {0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2},
+    {0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1},
+    {0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2},
+    {0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1},
+    {0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2},
+    {0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0},
+    {0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0},
+    {0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2},
+    {0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0},
+    {0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1},
+    {0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2},
+    {0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2},
+    {0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1},
+    {0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1},
+    {0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2},
+    {0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1},
+    {0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2},
+    {0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0},
+    {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0},
+    {0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0},
+    {0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0},
+    {0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1},
+    {0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1},
+    {0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2},
+    {0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1},
+    {0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2},
+    {0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1},
+    {0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1},
+    {0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1},
+    {0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1},
+    {0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2},
+    {0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1},
+    {0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2},
+    {0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2},
+    {0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2},
+    {0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2},
+    {0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2},
+    {0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2},
+    {0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2},
+    {0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2},
+    {0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2},
+    {0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1},
+    {0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2},
+    {0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2},
+    {0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0},
+};
+
+// texels whose index is stored with one bit less, for the second subset of
+// two and the second and third of three. The first subset's is texel 0.
+static const uint8_t bc7Anchors2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 2,  8,  2,  2,  8,  8,  15, 2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15, 6,  8,  2,  8,  15, 15, 2,  8,  2,  2,  2,  15, 15, 6,
+    6,  2,  6,  8,  15, 15, 2,  2,  15, 15, 15, 15, 15, 2,  2,  15,
+};
+
+static const uint8_t bc7Anchors3[2][64] = {
+    {3,  3,  15, 15, 8,  3,  15, 15, 8,  8,  6,  6,  6,  5,  3,  3,
+     3,  3,  8,  15, 3,  3,  6,  10, 5,  8,  8,  6,  8,  5,  15, 15,
+     8,  15, 3,  5,  6,  10, 8,  15, 15, 3,  15, 5,  15, 15, 15, 15,
+     3,  15, 5,  5,  5,  8,  5,  10, 5,  10, 8,  13, 15, 12, 3,  3},
+    {15, 8,  8,  3,  15, 15, 3,  8,  15, 15, 15, 15, 15, 15, 15, 8,
+     15, 8,  15, 3,  15, 8,  15, 8,  3,  15, 6,  10, 15, 15, 10, 8,
+     15, 3,  15, 10, 10, 8,  9,  10, 6,  15, 8,  15, 3,  6,  6,  8,
+     15, 3,  15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3,  15, 15, 8},
+};
+
+static const uint8_t bc7Weights2[4]  = {0, 21, 43, 64};
+static const uint8_t bc7Weights3[8]  = {0, 9, 18, 27, 37, 46, 55, 64};
+static const uint8_t bc7Weights4[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                        34, 38, 43, 47, 51, 55, 60, 64};
+
+typedef struct {
+    const uint8_t* data;
+    uint32_t       pos;
+} BitReader;
+
+static uint32_t
+readBits(BitReader* r, uint32_t count)
+{
+    uint32_t v = 0;
+    for (uint32_t i = 0; i < count; i++, r->pos++)
+        v |= ((r->data[r->pos >> 3] >> (r->pos & 7)) & 1u) << i;
+    return v;
+}
+
+static void
+writeBits(uint8_t* data, uint32_t* pos, uint32_t v, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++, (*pos)++)
+        data[*pos >> 3] |= ((v >> i) & 1u) << (*pos & 7);
+}
+
+static const uint8_t*
+bc7Weights(uint32_t bits)
+{
+    return bits == 2 ? bc7Weights2 : bits == 3 ? bc7Weights3 : bc7Weights4;
+}
+
+static uint8_t
+interpolate(uint32_t e0, uint32_t e1, uint32_t w)
+{
+    return (uint8_t)(((64 - w) * e0 + w * e1 + 32) >> 6);
+}
+
+static void
+decodeBc7Block(const uint8_t* block, Texel out[16])
+{
+    BitReader r    = {block, 0};
+    uint32_t  mode = 0;
+    while (mode < 8 && !readBits(&r, 1))
+        mode++;
+    // reserved, decodes to transparent black
+    if (mode == 8)
+    {
+        memset(out, 0, 16 * sizeof(Texel));
+        return;
+    }
+    const Bc7Mode* m         = &bc7Modes[mode];
+    const uint32_t partition = readBits(&r, m->partitionBits);
+    const uint32_t rotation  = readBits(&r, m->rotationBits);
+    const uint32_t selection = readBits(&r, m->indexSelectionBits);
+    const uint32_t n         = m->subsets * 2;
+
+    uint32_t ep[6][4];
+    for (uint32_t c = 0; c < 3; c++)
+        for (uint32_t e = 0; e < n; e++)
+            ep[e][c] = readBits(&r, m->colorBits);
+    for (uint32_t e = 0; e < n; e++)
+        ep[e][3] = m->alphaBits ? readBits(&r, m->alphaBits) : 255;
+
+    uint32_t colorBits = m->colorBits;
+    uint32_t alphaBits = m->alphaBits;
+    if (m->endpointPBits || m->sharedPBits)
+    {
+        uint32_t p[6];
+        if (m->endpointPBits)
+            for (uint32_t e = 0; e < n; e++)
+                p[e] = readBits(&r, 1);
+        else
+            for (uint32_t s = 0; s < m->subsets; s++)
+                p[2 * s] = p[2 * s + 1] = readBits(&r, 1);
+        for (uint32_t e = 0; e < n; e++)
+            for (uint32_t c = 0; c < (alphaBits ? 4u : 3u); c++)
+                ep[e][c] = ep[e][c] << 1 | p[e];
+        colorBits++;
+        if (alphaBits)
+            alphaBits++;
+    }
+    for (uint32_t e = 0; e < n; e++)
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            const uint32_t bits = c < 3 ? colorBits : alphaBits;
+            if (bits == 0)
+                continue;
+            ep[e][c] <<= 8 - bits;
+            ep[e][c] |= ep[e][c] >> bits;
+        }
+
+    uint8_t subset[16];
+    bool    anchor[16] = {true};
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        if (m->subsets == 2)
+            subset[i] = (bc7Partitions2[partition] >> i) & 1;
+        else if (m->subsets == 3)
+            subset[i] = bc7Partitions3[partition][i];
+        else
+            subset[i] = 0;
+    }
+    if (m->subsets == 2)
+        anchor[bc7Anchors2[partition]] = true;
+    else if (m->subsets == 3)
+    {
+        anchor[bc7Anchors3[0][partition]] = true;
+        anchor[bc7Anchors3[1][partition]] = true;
+    }
+
+    uint32_t index[16], index2[16];
+    for (uint32_t i = 0; i < 16; i++)
+        index[i] = readBits(&r, m->indexBits - anchor[i]);
+    for (uint32_t i = 0; i < 16 && m->index2Bits; i++)
+        index2[i] = readBits(&r, m->index2Bits - (i == 0));
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        const uint32_t* e0 = ep[2 * subset[i]];
+        const uint32_t* e1 = ep[2 * subset[i] + 1];
+        uint32_t        colorIndex = index[i], alphaIndex = index[i];
+        uint32_t        colorIndexBits = m->indexBits,
+                 alphaIndexBits        = m->indexBits;
+        if (m->index2Bits)
+        {
+            colorIndex     = selection ? index2[i] : index[i];
+            colorIndexBits = selection ? m->index2Bits : m->indexBits;
+            alphaIndex     = selection ? index[i] : index2[i];
+            alphaIndexBits = selection ? m->indexBits : m->index2Bits;
+        }
+        const uint8_t* cw = bc7Weights(colorIndexBits);
+        const uint8_t* aw = bc7Weights(alphaIndexBits);
+        for (uint32_t c = 0; c < 3; c++)
+            out[i][c] = interpolate(e0[c], e1[c], cw[colorIndex]);
+        out[i][3] = interpolate(e0[3], e1[3], aw[alphaIndex]);
+        if (rotation)
+        {
+            const uint8_t t      = out[i][3];
+            out[i][3]            = out[i][rotation - 1];
+            out[i][rotation - 1] = t;
+        }
+    }
+}
+
+static void
+expand565(uint16_t c, uint8_t* out)
+{
+    const uint32_t r = c >> 11 & 31, g = c >> 5 & 63, b = c & 31;
+    out[0] = r << 3 | r >> 2;
+    out[1] = g << 2 | g >> 4;
+    out[2] = b << 3 | b >> 2;
+    out[3] = 255;
+}
+
+// Builds the palette the way the decoder does. The three color mode with
+// transparent black is only used by BC1 when c0 <= c1.
+static void
+bc1Palette(uint16_t c0, uint16_t c1, bool threeColor, Texel pal[4])
+{
+    expand565(c0, pal[0]);
+    expand565(c1, pal[1]);
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        if (threeColor)
+        {
+            pal[2][c] = (pal[0][c] + pal[1][c]) / 2;
+            pal[3][c] = 0;
+        }
+        else
+        {
+            pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+            pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+        }
+    }
+    pal[2][3] = 255;
+    pal[3][3] = threeColor ? 0 : 255;
+}
+
+static void
+decodeColorBlock(const uint8_t* block, bool allowThreeColor, Texel out[16])
+{
+    const uint16_t c0 = block[0] | block[1] << 8;
+    const uint16_t c1 = block[2] | block[3] << 8;
+    Texel          pal[4];
+    bc1Palette(c0, c1, allowThreeColor && c0 <= c1, pal);
+    const uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 |
+                             (uint32_t)block[7] << 24;
+    for (uint32_t i = 0; i < 16; i++)
+        memcpy(out[i], pal[indices >> 2 * i & 3], sizeof(Texel));
+}
+
+// BC3 alpha and BC4 and BC5 channels, into channel c of out
+static void
+decodeChannelBlock(const uint8_t* block, bool snorm, uint32_t c, Texel out[16])
+{
+    int32_t pal[8];
+    pal[0] = snorm ? MAX((int8_t)block[0], -127) : block[0];
+    pal[1] = snorm ? MAX((int8_t)block[1], -127) : block[1];
+    if (pal[0] > pal[1])
+        for (int32_t k = 1; k < 7; k++)
+            pal[k + 1] = ((7 - k) * pal[0] + k * pal[1]) / 7;
+    else
+    {
+        for (int32_t k = 1; k < 5; k++)
+            pal[k + 1] = ((5 - k) * pal[0] + k * pal[1]) / 5;
+        pal[6] = snorm ? -127 : 0;
+        pal[7] = snorm ? 127 : 255;
+    }
+    uint64_t indices = 0;
+    for (uint32_t i = 0; i < 6; i++)
+        indices |= (uint64_t)block[2 + i] << 8 * i;
+    for (uint32_t i = 0; i < 16; i++)
+        out[i][c] = (uint8_t)pal[indices >> 3 * i & 7];
+}
+
+static bool
+decodeBlock(VkFormat format, const uint8_t* block, Texel out[16])
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        decodeColorBlock(block, true, out);
+        // the RGB formats ignore the alpha of the three color mode
+        if (format == VK_FORMAT_BC1_RGB_UNORM_BLOCK ||
+            format == VK_FORMAT_BC1_RGB_SRGB_BLOCK)
+            for (uint32_t i = 0; i < 16; i++)
+                out[i][3] = 255;
+        return true;
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+        decodeColorBlock(block + 8, false, out);
+        for (uint32_t i = 0; i < 16; i++)
+            out[i][3] = (block[i / 2] >> 4 * (i & 1) & 15) * 17;
+        return true;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        decodeColorBlock(block + 8, false, out);
+        decodeChannelBlock(block, false, 3, out);
+        return true;
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK: {
+        const bool snorm = format == VK_FORMAT_BC4_SNORM_BLOCK ||
+                           format == VK_FORMAT_BC5_SNORM_BLOCK;
+        const bool two = format == VK_FORMAT_BC5_UNORM_BLOCK ||
+                         format == VK_FORMAT_BC5_SNORM_BLOCK;
+        // missing channels read as 0 and alpha as 1
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            out[i][1] = out[i][2] = 0;
+            out[i][3]             = snorm ? 127 : 255;
+        }
+        decodeChannelBlock(block, snorm, 0, out);
+        if (two)
+            decodeChannelBlock(block + 8, snorm, 1, out);
+        return true;
+    }
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        decodeBc7Block(block, out);
+        return true;
+    default:
+        return false;
+    }
+}
+
+VkFormat
+onyx_GetDecodedFormat(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+        return VK_FORMAT_R8G8B8A8_UNORM;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return VK_FORMAT_R8G8B8A8_SRGB;
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+        return VK_FORMAT_R8G8B8A8_SNORM;
+    default:
+        return VK_FORMAT_UNDEFINED;
+    }
+}
+
+bool
+onyx_DecodeBlocks(VkFormat format, uint32_t width, uint32_t height,
+                  const void* blocks, uint8_t* texels)
+{
+    uint32_t bw, bh, blockSize;
+    if (onyx_GetDecodedFormat(format) == VK_FORMAT_UNDEFINED ||
+        !onyx_GetFormatBlock(format, &bw, &bh, &blockSize))
+        return false;
+    const uint8_t* block = blocks;
+    for (uint32_t by = 0; by < height; by += 4)
+        for (uint32_t bx = 0; bx < width; bx += 4, block += blockSize)
+        {
+            Texel out[16];
+            decodeBlock(format, block, out);
+            // edge blocks hang over the image
+            for (uint32_t y = 0; y < 4 && by + y < height; y++)
+                for (uint32_t x = 0; x < 4 && bx + x < width; x++)
+                    memcpy(texels + ((size_t)(by + y) * width + bx + x) * 4,
+                           out[y * 4 + x], sizeof(Texel));
+        }
+    return true;
+}
+
+// endpoints along the principal axis through the mean of the block, over the
+// first channelCount channels
+static void
+fitAxis(const Texel px[16], uint32_t channelCount, float e0[4], float e1[4])
+{
+    float mean[4] = {0};
+    for (uint32_t i = 0; i < 16; i++)
+        for (uint32_t c = 0; c < channelCount; c++)
+            mean[c] += px[i][c] / 16.f;
+    float cov[4][4] = {0};
+    for (uint32_t i = 0; i < 16; i++)
+        for (uint32_t a = 0; a < channelCount; a++)
+            for (uint32_t b = 0; b < channelCount; b++)
+                cov[a][b] += (px[i][a] - mean[a]) * (px[i][b] - mean[b]);
+    // power iteration, starting from the channel that varies most
+    float    axis[4] = {0};
+    uint32_t start   = 0;
+    for (uint32_t c = 1; c < channelCount; c++)
+        if (cov[c][c] > cov[start][start])
+            start = c;
+    for (uint32_t c = 0; c < channelCount; c++)
+        axis[c] = cov[start][c];
+    for (uint32_t it = 0; it < 8; it++)
+    {
+        float next[4] = {0}, len = 0;
+        for (uint32_t a = 0; a < channelCount; a++)
+        {
+            for (uint32_t b = 0; b < channelCount; b++)
+                next[a] += cov[a][b] * axis[b];
+            len += next[a] * next[a];
+        }
+        if (len < 1e-12f)
+            break;
+        len = 1.f / sqrtf(len);
+        for (uint32_t c = 0; c < channelCount; c++)
+            axis[c] = next[c] * len;
+    }
+    float lo = 0, hi = 0;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        float t = 0;
+        for (uint32_t c = 0; c < channelCount; c++)
+            t += (px[i][c] - mean[c]) * axis[c];
+        lo = MIN(lo, t);
+        hi = MAX(hi, t);
+    }
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+        e0[c] = MIN(MAX(mean[c] + axis[c] * hi, 0.f), 255.f);
+        e1[c] = MIN(MAX(mean[c] + axis[c] * lo, 0.f), 255.f);
+    }
+}
+
+// Least squares endpoints for the given weights of e1, in [0, 1]. False if
+// the weights don't determine them.
+static bool
+solveEndpoints(const Texel px[16], const float w[16], uint32_t channelCount,
+               float e0[4], float e1[4])
+{
+    float aa = 0, ab = 0, bb = 0, ax[4] = {0}, bx[4] = {0};
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        const float a = 1.f - w[i], b = w[i];
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (uint32_t c = 0; c < channelCount; c++)
+        {
+            ax[c] += a * px[i][c];
+            bx[c] += b * px[i][c];
+        }
+    }
+    const float det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f)
+        return false;
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+        e0[c] = MIN(MAX((bb * ax[c] - ab * bx[c]) / det, 0.f), 255.f);
+        e1[c] = MIN(MAX((aa * bx[c] - ab * ax[c]) / det, 0.f), 255.f);
+    }
+    return true;
+}
+
+static uint32_t
+texelError(const uint8_t* a, const uint8_t* b, uint32_t channelCount)
+{
+    uint32_t err = 0;
+    for (uint32_t c = 0; c < channelCount; c++)
+        err += (a[c] - b[c]) * (a[c] - b[c]);
+    return err;
+}
+
+static uint16_t
+to565(const float c[4])
+{
+    const uint32_t r = (uint32_t)(c[0] * 31.f / 255.f + 0.5f);
+    const uint32_t g = (uint32_t)(c[1] * 63.f / 255.f + 0.5f);
+    const uint32_t b = (uint32_t)(c[2] * 31.f / 255.f + 0.5f);
+    return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+// c0 > c1 keeps the block in four color mode, equal endpoints use index 0
+static uint32_t
+fitBc1(const Texel px[16], uint16_t* c0, uint16_t* c1, uint32_t* indices)
+{
+    if (*c0 < *c1)
+    {
+        const uint16_t t = *c0;
+        *c0              = *c1;
+        *c1              = t;
+    }
+    Texel pal[4];
+    bc1Palette(*c0, *c1, false, pal);
+    uint32_t total = 0;
+    *indices       = 0;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t best = 0, bestErr = UINT32_MAX;
+        for (uint32_t k = 0; k < (*c0 == *c1 ? 1u : 4u); k++)
+        {
+            const uint32_t err = texelError(px[i], pal[k], 3);
+            if (err < bestErr)
+            {
+                bestErr = err;
+                best    = k;
+            }
+        }
+        *indices |= best << 2 * i;
+        total += bestErr;
+    }
+    return total;
+}
+
+static void
+encodeBc1Block(const Texel px[16], uint8_t* out)
+{
+    float e0[4], e1[4];
+    fitAxis(px, 3, e0, e1);
+    uint16_t c0 = to565(e0), c1 = to565(e1);
+    uint32_t indices;
+    uint32_t err = fitBc1(px, &c0, &c1, &indices);
+
+    static const float weights[4] = {0.f, 1.f, 1.f / 3.f, 2.f / 3.f};
+    float              w[16];
+    for (uint32_t i = 0; i < 16; i++)
+        w[i] = weights[indices >> 2 * i & 3];
+    if (err && c0 != c1 && solveEndpoints(px, w, 3, e0, e1))
+    {
+        uint16_t d0 = to565(e0), d1 = to565(e1);
+        uint32_t refined;
+        const uint32_t refinedErr = fitBc1(px, &d0, &d1, &refined);
+        if (refinedErr < err)
+        {
+            c0      = d0;
+            c1      = d1;
+            indices = refined;
+        }
+    }
+    out[0] = c0 & 0xff;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xff;
+    out[3] = c1 >> 8;
+    for (uint32_t i = 0; i < 4; i++)
+        out[4 + i] = indices >> 8 * i & 0xff;
+}
+
+// 7 bit endpoint channels plus a p bit shared by the endpoint's channels,
+// the p bit that rounds best is kept. Opaque blocks need p = 1 to reach an
+// alpha of 255, a p bit of 0 would leave them at 254.
+static void
+quantizeBc7Endpoint(const float e[4], bool opaque, uint8_t q[4], uint8_t* p)
+{
+    uint32_t bestErr = UINT32_MAX;
+    for (uint32_t pb = opaque; pb < 2; pb++)
+    {
+        uint8_t  v[4];
+        uint32_t err = 0;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            const int32_t x = (int32_t)floorf((e[c] - pb) / 2.f + 0.5f);
+            v[c]            = (uint8_t)MIN(MAX(x, 0), 127);
+            if (opaque && c == 3)
+                v[c] = 127;
+            const float d   = (float)(v[c] << 1 | pb) - e[c];
+            err += (uint32_t)(d * d);
+        }
+        if (err < bestErr)
+        {
+            bestErr = err;
+            memcpy(q, v, 4);
+            *p = pb;
+        }
+    }
+}
+
+static uint32_t
+fitBc7(const Texel px[16], const uint8_t q[2][4], const uint8_t p[2],
+       uint8_t indices[16])
+{
+    Texel pal[16];
+    for (uint32_t k = 0; k < 16; k++)
+        for (uint32_t c = 0; c < 4; c++)
+            pal[k][c] = interpolate(q[0][c] << 1 | p[0], q[1][c] << 1 | p[1],
+                                    bc7Weights4[k]);
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t best = 0, bestErr = UINT32_MAX;
+        for (uint32_t k = 0; k < 16; k++)
+        {
+            const uint32_t err = texelError(px[i], pal[k], 4);
+            if (err < bestErr)
+            {
+                bestErr = err;
+                best    = k;
+            }
+        }
+        indices[i] = best;
+        total += bestErr;
+    }
+    return total;
+}
+
+static void
+encodeBc7Block(const Texel px[16], uint8_t* out)
+{
+    float   e[2][4];
+    uint8_t q[2][4], p[2], indices[16];
+    bool    opaque = true;
+    for (uint32_t i = 0; i < 16; i++)
+        opaque &= px[i][3] == 255;
+    fitAxis(px, 4, e[0], e[1]);
+    quantizeBc7Endpoint(e[0], opaque, q[0], &p[0]);
+    quantizeBc7Endpoint(e[1], opaque, q[1], &p[1]);
+    uint32_t err = fitBc7(px, q, p, indices);
+
+    float w[16];
+    for (uint32_t i = 0; i < 16; i++)
+        w[i] = bc7Weights4[indices[i]] / 64.f;
+    if (err && solveEndpoints(px, w, 4, e[0], e[1]))
+    {
+        uint8_t rq[2][4], rp[2], refined[16];
+        quantizeBc7Endpoint(e[0], opaque, rq[0], &rp[0]);
+        quantizeBc7Endpoint(e[1], opaque, rq[1], &rp[1]);
+        const uint32_t refinedErr = fitBc7(px, rq, rp, refined);
+        if (refinedErr < err)
+        {
+            memcpy(q, rq, sizeof(q));
+            memcpy(p, rp, sizeof(p));
+            memcpy(indices, refined, sizeof(indices));
+        }
+    }
+    // texel 0's index is stored without its top bit, so it must be clear
+    if (indices[0] & 8)
+    {
+        uint8_t t[4];
+        memcpy(t, q[0], 4);
+        memcpy(q[0], q[1], 4);
+        memcpy(q[1], t, 4);
+        const uint8_t tp = p[0];
+        p[0]             = p[1];
+        p[1]             = tp;
+        for (uint32_t i = 0; i < 16; i++)
+            indices[i] = 15 - indices[i];
+    }
+
+    memset(out, 0, 16);
+    uint32_t pos = 0;
+    writeBits(out, &pos, 1 << 6, 7);
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        writeBits(out, &pos, q[0][c], 7);
+        writeBits(out, &pos, q[1][c], 7);
+    }
+    writeBits(out, &pos, p[0], 1);
+    writeBits(out, &pos, p[1], 1);
+    for (uint32_t i = 0; i < 16; i++)
+        writeBits(out, &pos, indices[i], i == 0 ? 3 : 4);
+    assert(pos == 128);
+}
+
+typedef struct {
+    uint32_t       width;
+    uint32_t       height;
+    const uint8_t* texels;
+    uint8_t*       blocks;
+    uint32_t       blockSize;
+    void (*encodeBlock)(const Texel px[16], uint8_t* out);
+} EncodeJob;
+
+// one row of blocks per task
+static void
+encodeRow(void* data, uint32_t task, uint32_t thread)
+{
+    const EncodeJob* job     = data;
+    const uint32_t   columns = (job->width + 3) / 4;
+    uint8_t*         out     = job->blocks + (size_t)task * columns * job->blockSize;
+    for (uint32_t bx = 0; bx < columns; bx++, out += job->blockSize)
+    {
+        // edge blocks repeat the last row and column
+        Texel px[16];
+        for (uint32_t y = 0; y < 4; y++)
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                const uint32_t ix = MIN(bx * 4 + x, job->width - 1);
+                const uint32_t iy = MIN(task * 4 + y, job->height - 1);
+                memcpy(px[y * 4 + x],
+                       job->texels + ((size_t)iy * job->width + ix) * 4,
+                       sizeof(Texel));
+            }
+        job->encodeBlock((const Texel*)px, out);
+    }
+}
+
+static void
+encode(uint32_t width, uint32_t height, const uint8_t* texels, void* blocks,
+       uint32_t blockSize, void (*encodeBlock)(const Texel[16], uint8_t*))
+{
+    EncodeJob job = {width, height, texels, blocks, blockSize, encodeBlock};
+    onyx_ParallelFor(0, (height + 3) / 4, encodeRow, &job);
+}
+
+void
+onyx_EncodeBC1(uint32_t width, uint32_t height, const uint8_t* texels,
+               void* blocks)
+{
+    encode(width, height, texels, blocks, 8, encodeBc1Block);
+}
+
+void
+onyx_EncodeBC7(uint32_t width, uint32_t height, const uint8_t* texels,
+               void* blocks)
+{
+    encode(width, height, texels, blocks, 16, encodeBc7Block);
+}
@@ -0,0 +1,281 @@
+#include "bindless.h"
+#include "dtags.h"
+#include "pipeline.h"
+#include "video.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <hell/minmax.h>
+#include <string.h>
+
+// Every slot remembers the descriptor it should hold and which sets don't
+// hold it yet. Slots that differ from some set are kept in a list, so an
+// update only touches what changed. The scene is only looked at when its
+// textures are dirty, and then every texture is compared with its slot,
+// which also catches textures dirtied without a dirty set entry.
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_IMG, fmt, ##__VA_ARGS__)
+
+#define DEFAULT_TEXTURE_COUNT 4096
+#define DEFAULT_FRAME_COUNT   2
+#define MAX_FRAME_COUNT       32
+
+typedef struct {
+    VkImageView view;
+    VkSampler   sampler;
+    // bit f is set while set f still holds an older descriptor
+    uint32_t    staleSets;
+    // the last diff that found a texture for the slot
+    uint64_t    seen;
+} Slot;
+
+struct Onyx_BindlessTextures {
+    VkDevice              device;
+    Onyx_Scene*           scene;
+    VkDescriptorSetLayout layout;
+    VkDescriptorPool      pool;
+    VkDescriptorSet       sets[MAX_FRAME_COUNT];
+    uint32_t              frameCount;
+    uint32_t              textureCount;
+    Slot*                 slots;
+    uint32_t*             staleSlots;
+    uint32_t              staleCount;
+    uint64_t              diffCount;
+};
+
+_Static_assert(sizeof(Onyx_BindlessMaterial) == 32,
+               "Onyx_BindlessMaterial must match BindlessMaterial in "
+               "bindless.glsl");
+
+static void
+setSlot(Onyx_BindlessTextures* b, uint32_t slot, const Onyx_Image* image)
+{
+    Slot* s = &b->slots[slot];
+    if (s->view == image->view && s->sampler == image->sampler)
+        return;
+    s->view    = image->view;
+    s->sampler = image->sampler;
+    if (!s->staleSets)
+        b->staleSlots[b->staleCount++] = slot;
+    s->staleSets = (uint32_t)((1ull << b->frameCount) - 1);
+}
+
+static void
+diffScene(Onyx_BindlessTextures* b)
+{
+    const Onyx_Image*   defaultImage = onyx_SceneGetDefaultImage(b->scene);
+    Onyx_SceneObjectIds ids;
+    Onyx_SceneObjectInt count;
+    onyx_SceneGetObjectIds(b->scene, ONYX_SCENE_OBJECT_TEXTURE, &ids);
+    const Onyx_Texture* textures = onyx_SceneGetTextures(b->scene, &count);
+    assert(ids.count == count);
+    const uint64_t diff    = ++b->diffCount;
+    uint32_t       skipped = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint32_t slot = ids.ids[i];
+        if (slot >= b->textureCount)
+        {
+            skipped++;
+            continue;
+        }
+        // removed textures go at the end of the frame, and their images
+        // may go with them
+        const bool removed = textures[i].dirt & ONYX_TEX_REMOVED_BIT;
+        setSlot(b, slot, removed ? defaultImage : textures[i].devImage);
+        b->slots[slot].seen = diff;
+    }
+    for (uint32_t slot = 0; slot < b->textureCount; slot++)
+        if (b->slots[slot].seen != diff)
+            setSlot(b, slot, defaultImage);
+    if (skipped)
+        DPRINT("%d textures have ids past the %d bindless slots\n", skipped,
+               b->textureCount);
+    onyx_FreeSceneObjectIds(&ids);
+}
+
+// writes the slots whose descriptors set frame doesn't hold yet
+static void
+writeSet(Onyx_BindlessTextures* b, uint32_t frame)
+{
+    if (!b->staleCount)
+        return;
+    VkDescriptorImageInfo* infos =
+        hell_Malloc(b->staleCount * sizeof(VkDescriptorImageInfo));
+    VkWriteDescriptorSet* writes =
+        hell_Malloc(b->staleCount * sizeof(VkWriteDescriptorSet));
+    uint32_t writeCount = 0, n = 0;
+    for (uint32_t i = 0; i < b->staleCount; i++)
+    {
+        const uint32_t slot = b->staleSlots[i];
+        Slot*          s    = &b->slots[slot];
+        if (s->staleSets & (1u << frame))
+        {
+            infos[writeCount]  = (VkDescriptorImageInfo){
+                .sampler     = s->sampler,
+                .imageView   = s->view,
+                .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            };
+            writes[writeCount] = (VkWriteDescriptorSet){
+                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet          = b->sets[frame],
+                .dstBinding      = 0,
+                .dstArrayElement = slot,
+                .descriptorCount = 1,
+                .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo      = &infos[writeCount],
+            };
+            writeCount++;
+            s->staleSets &= ~(1u << frame);
+        }
+        if (s->staleSets)
+            b->staleSlots[n++] = slot;
+    }
+    b->staleCount = n;
+    if (writeCount)
+        vkUpdateDescriptorSets(b->device, writeCount, writes, 0, NULL);
+    hell_Free(infos);
+    hell_Free(writes);
+}
+
+bool
+onyx_BindlessTexturesSupported(const Onyx_Instance* instance)
+{
+    const VkPhysicalDeviceDescriptorIndexingFeatures* f =
+        &instance->enabledDescriptorIndexing;
+    return f->descriptorBindingSampledImageUpdateAfterBind &&
+           f->descriptorBindingPartiallyBound;
+}
+
+Onyx_BindlessTextures*
+onyx_CreateBindlessTextures(Onyx_Memory* memory, Onyx_Scene* scene,
+                            const Onyx_BindlessParms* parms)
+{
+    const Onyx_Instance* instance = onyx_GetMemoryInstance(memory);
+    if (!onyx_BindlessTexturesSupported(instance))
+    {
+        DPRINT("Bindless textures aren't supported\n");
+        return NULL;
+    }
+    VkPhysicalDeviceDescriptorIndexingProperties limits = {
+        .sType =
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES};
+    VkPhysicalDeviceProperties2 properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &limits};
+    vkGetPhysicalDeviceProperties2(instance->physicalDevice, &properties);
+
+    Onyx_BindlessTextures* b = hell_Malloc(sizeof(Onyx_BindlessTextures));
+    memset(b, 0, sizeof(*b));
+    b->device     = onyx_GetDevice(instance);
+    b->scene      = scene;
+    b->frameCount = parms->frameCount ? parms->frameCount : DEFAULT_FRAME_COUNT;
+    assert(b->frameCount <= MAX_FRAME_COUNT);
+    uint32_t count =
+        parms->textureCount ? parms->textureCount : DEFAULT_TEXTURE_COUNT;
+    count = MIN(count, limits.maxPerStageDescriptorUpdateAfterBindSampledImages);
+    count = MIN(count, limits.maxPerStageDescriptorUpdateAfterBindSamplers);
+    count = MIN(count, limits.maxDescriptorSetUpdateAfterBindSampledImages);
+    count = MIN(count, limits.maxDescriptorSetUpdateAfterBindSamplers);
+    b->textureCount = count;
+
+    const Onyx_DescriptorBinding binding = {
+        .descriptorCount = count,
+        .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .stageFlags      = parms->stageFlags,
+        .bindingFlags    = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
+    };
+    onyx_CreateDescriptorSetLayout(b->device, 1, &binding, &b->layout);
+
+    const VkDescriptorPoolSize poolSize = {
+        .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = count * b->frameCount,
+    };
+    const VkDescriptorPoolCreateInfo poolInfo = {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .maxSets       = b->frameCount,
+        .poolSizeCount = 1,
+        .pPoolSizes    = &poolSize,
+    };
+    V_ASSERT(vkCreateDescriptorPool(b->device, &poolInfo, NULL, &b->pool));
+    VkDescriptorSetLayout layouts[MAX_FRAME_COUNT];
+    for (uint32_t f = 0; f < b->frameCount; f++)
+        layouts[f] = b->layout;
+    onyx_AllocateDescriptorSets(b->device, b->pool, b->frameCount, layouts,
+                                b->sets);
+
+    // every slot is stale in every set, so the default goes everywhere
+    b->slots      = hell_Malloc(count * sizeof(Slot));
+    b->staleSlots = hell_Malloc(count * sizeof(uint32_t));
+    memset(b->slots, 0, count * sizeof(Slot));
+    const Onyx_Image* defaultImage = onyx_SceneGetDefaultImage(scene);
+    for (uint32_t slot = 0; slot < count; slot++)
+        setSlot(b, slot, defaultImage);
+    for (uint32_t f = 0; f < b->frameCount; f++)
+        writeSet(b, f);
+    return b;
+}
+
+void
+onyx_DestroyBindlessTextures(Onyx_BindlessTextures* b)
+{
+    vkDestroyDescriptorPool(b->device, b->pool, NULL);
+    vkDestroyDescriptorSetLayout(b->device, b->layout, NULL);
+    hell_Free(b->slots);
+    hell_Free(b->staleSlots);
+    hell_Free(b);
+}
+
+void
+onyx_UpdateBindlessTextures(Onyx_BindlessTextures* b, uint32_t frame)
+{
+    assert(frame < b->frameCount);
+    if (onyx_SceneGetDirt(b->scene) & ONYX_SCENE_TEXTURES_BIT)
+        diffScene(b);
+    writeSet(b, frame);
+}
+
+VkDescriptorSetLayout
+onyx_GetBindlessTextureLayout(const Onyx_BindlessTextures* b)
+{
+    return b->layout;
+}
+
+VkDescriptorSet
+onyx_GetBindlessTextureSet(const Onyx_BindlessTextures* b, uint32_t frame)
+{
+    assert(frame < b->frameCount);
+    return b->sets[frame];
+}
+
+uint32_t
+onyx_GetBindlessTextureCount(const Onyx_BindlessTextures* b)
+{
+    return b->textureCount;
+}
+
+uint32_t
+onyx_GetBindlessSlot(const Onyx_BindlessTextures* b, Onyx_TextureHandle tex)
+{
+    return tex.id < b->textureCount ? tex.id : 0;
+}
+
+void
+onyx_WriteBindlessMaterials(const Onyx_BindlessTextures* b,
+                            Onyx_BindlessMaterial*       dst)
+{
+    Onyx_SceneObjectInt  count;
+    const Onyx_Material* materials = onyx_SceneGetMaterials(b->scene, &count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const Onyx_Material* m = &materials[i];
+        dst[i]                 = (Onyx_BindlessMaterial){
+            .color         = m->color,
+            .roughness     = m->roughness,
+            .albedoSlot    = onyx_GetBindlessSlot(b, m->textureAlbedo),
+            .roughnessSlot = onyx_GetBindlessSlot(b, m->textureRoughness),
+            .normalSlot    = onyx_GetBindlessSlot(b, m->textureNormal),
+        };
+    }
+}
@@ -0,0 +1,315 @@
+#include "meshproc.h"
+#include "attribute.h"
+#include <hell/common.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// Bounds over tightly packed xyz positions. The x86 paths load 4 (SSE) or 8
+// (AVX2) vertices as three registers and transpose them to x, y and z
+// registers so the box and the sphere radius can be done with plain vertical
+// min, max and multiply-add. The AVX2 path is picked at runtime.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BOUNDS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+typedef struct {
+    float min[3];
+    float max[3];
+} Box;
+
+static void
+boxScalar(const float* p, uint32_t count, Box* box)
+{
+    for (uint32_t v = 0; v < count; v++, p += 3)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            box->min[k] = p[k] < box->min[k] ? p[k] : box->min[k];
+            box->max[k] = p[k] > box->max[k] ? p[k] : box->max[k];
+        }
+    }
+}
+
+static float
+radiusSqScalar(const float* p, uint32_t count, const float c[3], float r2)
+{
+    for (uint32_t v = 0; v < count; v++, p += 3)
+    {
+        float dx = p[0] - c[0], dy = p[1] - c[1], dz = p[2] - c[2];
+        float d2 = dx * dx + dy * dy + dz * dz;
+        r2       = d2 > r2 ? d2 : r2;
+    }
+    return r2;
+}
+
+#if BOUNDS_X86
+
+// a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+#define TRANSPOSE_SSE(a, b, c, x, y, z)                                        \
+    do {                                                                       \
+        __m128 t0 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));             \
+        __m128 t1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));             \
+        x         = _mm_shuffle_ps(a, t0, _MM_SHUFFLE(2, 0, 3, 0));            \
+        y         = _mm_shuffle_ps(t1, t0, _MM_SHUFFLE(3, 1, 2, 0));           \
+        z         = _mm_shuffle_ps(t1, c, _MM_SHUFFLE(3, 0, 3, 1));            \
+    } while (0)
+
+static float
+hmin128(__m128 v)
+{
+    float f[4];
+    _mm_storeu_ps(f, v);
+    return fminf(fminf(f[0], f[1]), fminf(f[2], f[3]));
+}
+
+static float
+hmax128(__m128 v)
+{
+    float f[4];
+    _mm_storeu_ps(f, v);
+    return fmaxf(fmaxf(f[0], f[1]), fmaxf(f[2], f[3]));
+}
+
+static uint32_t
+boxSSE(const float* p, uint32_t count, Box* box)
+{
+    __m128         minx = _mm_set1_ps(box->min[0]), maxx = _mm_set1_ps(box->max[0]);
+    __m128         miny = _mm_set1_ps(box->min[1]), maxy = _mm_set1_ps(box->max[1]);
+    __m128         minz = _mm_set1_ps(box->min[2]), maxz = _mm_set1_ps(box->max[2]);
+    const uint32_t n    = count & ~3u;
+    for (uint32_t v = 0; v < n; v += 4, p += 12)
+    {
+        __m128 a = _mm_loadu_ps(p + 0);
+        __m128 b = _mm_loadu_ps(p + 4);
+        __m128 c = _mm_loadu_ps(p + 8);
+        __m128 x, y, z;
+        TRANSPOSE_SSE(a, b, c, x, y, z);
+        minx = _mm_min_ps(minx, x);
+        maxx = _mm_max_ps(maxx, x);
+        miny = _mm_min_ps(miny, y);
+        maxy = _mm_max_ps(maxy, y);
+        minz = _mm_min_ps(minz, z);
+        maxz = _mm_max_ps(maxz, z);
+    }
+    box->min[0] = hmin128(minx);
+    box->min[1] = hmin128(miny);
+    box->min[2] = hmin128(minz);
+    box->max[0] = hmax128(maxx);
+    box->max[1] = hmax128(maxy);
+    box->max[2] = hmax128(maxz);
+    return n;
+}
+
+static uint32_t
+radiusSqSSE(const float* p, uint32_t count, const float ctr[3], float* r2)
+{
+    const __m128   cx = _mm_set1_ps(ctr[0]);
+    const __m128   cy = _mm_set1_ps(ctr[1]);
+    const __m128   cz = _mm_set1_ps(ctr[2]);
+    __m128         m  = _mm_set1_ps(*r2);
+    const uint32_t n  = count & ~3u;
+    for (uint32_t v = 0; v < n; v += 4, p += 12)
+    {
+        __m128 a = _mm_loadu_ps(p + 0);
+        __m128 b = _mm_loadu_ps(p + 4);
+        __m128 c = _mm_loadu_ps(p + 8);
+        __m128 x, y, z;
+        TRANSPOSE_SSE(a, b, c, x, y, z);
+        x = _mm_sub_ps(x, cx);
+        y = _mm_sub_ps(y, cy);
+        z = _mm_sub_ps(z, cz);
+        __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                               _mm_mul_ps(z, z));
+        m         = _mm_max_ps(m, d2);
+    }
+    *r2 = hmax128(m);
+    return n;
+}
+
+// 8 vertices are 3 full registers. swapping 128 bit halves gives two sets of
+// the SSE layout, one per half, and the in-lane shuffles transpose both.
+#define TRANSPOSE_AVX(p, x, y, z)                                              \
+    do {                                                                       \
+        __m256 l0 = _mm256_loadu_ps(p + 0);                                    \
+        __m256 l1 = _mm256_loadu_ps(p + 8);                                    \
+        __m256 l2 = _mm256_loadu_ps(p + 16);                                   \
+        __m256 a  = _mm256_permute2f128_ps(l0, l1, 0x30);                      \
+        __m256 b  = _mm256_permute2f128_ps(l0, l2, 0x21);                      \
+        __m256 c  = _mm256_permute2f128_ps(l1, l2, 0x30);                      \
+        __m256 t0 = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));          \
+        __m256 t1 = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));          \
+        x         = _mm256_shuffle_ps(a, t0, _MM_SHUFFLE(2, 0, 3, 0));         \
+        y         = _mm256_shuffle_ps(t1, t0, _MM_SHUFFLE(3, 1, 2, 0));        \
+        z         = _mm256_shuffle_ps(t1, c, _MM_SHUFFLE(3, 0, 3, 1));         \
+    } while (0)
+
+TARGET_AVX2 static uint32_t
+boxAVX2(const float* p, uint32_t count, Box* box)
+{
+    __m256         minx = _mm256_set1_ps(box->min[0]), maxx = _mm256_set1_ps(box->max[0]);
+    __m256         miny = _mm256_set1_ps(box->min[1]), maxy = _mm256_set1_ps(box->max[1]);
+    __m256         minz = _mm256_set1_ps(box->min[2]), maxz = _mm256_set1_ps(box->max[2]);
+    const uint32_t n    = count & ~7u;
+    for (uint32_t v = 0; v < n; v += 8, p += 24)
+    {
+        __m256 x, y, z;
+        TRANSPOSE_AVX(p, x, y, z);
+        minx = _mm256_min_ps(minx, x);
+        maxx = _mm256_max_ps(maxx, x);
+        miny = _mm256_min_ps(miny, y);
+        maxy = _mm256_max_ps(maxy, y);
+        minz = _mm256_min_ps(minz, z);
+        maxz = _mm256_max_ps(maxz, z);
+    }
+    box->min[0] = hmin128(_mm_min_ps(_mm256_castps256_ps128(minx), _mm256_extractf128_ps(minx, 1)));
+    box->min[1] = hmin128(_mm_min_ps(_mm256_castps256_ps128(miny), _mm256_extractf128_ps(miny, 1)));
+    box->min[2] = hmin128(_mm_min_ps(_mm256_castps256_ps128(minz), _mm256_extractf128_ps(minz, 1)));
+    box->max[0] = hmax128(_mm_max_ps(_mm256_castps256_ps128(maxx), _mm256_extractf128_ps(maxx, 1)));
+    box->max[1] = hmax128(_mm_max_ps(_mm256_castps256_ps128(maxy), _mm256_extractf128_ps(maxy, 1)));
+    box->max[2] = hmax128(_mm_max_ps(_mm256_castps256_ps128(maxz), _mm256_extractf128_ps(maxz, 1)));
+    return n;
+}
+
+TARGET_AVX2 static uint32_t
+radiusSqAVX2(const float* p, uint32_t count, const float ctr[3], float* r2)
+{
+    const __m256   cx = _mm256_set1_ps(ctr[0]);
+    const __m256   cy = _mm256_set1_ps(ctr[1]);
+    const __m256   cz = _mm256_set1_ps(ctr[2]);
+    __m256         m  = _mm256_set1_ps(*r2);
+    const uint32_t n  = count & ~7u;
+    for (uint32_t v = 0; v < n; v += 8, p += 24)
+    {
+        __m256 x, y, z;
+        TRANSPOSE_AVX(p, x, y, z);
+        x         = _mm256_sub_ps(x, cx);
+        y         = _mm256_sub_ps(y, cy);
+        z         = _mm256_sub_ps(z, cz);
+        __m256 d2 = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)),
+            _mm256_mul_ps(z, z));
+        m = _mm256_max_ps(m, d2);
+    }
+    *r2 = hmax128(_mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1)));
+    return n;
+}
+
+static bool
+hasAVX2(void)
+{
+    static int cached = -1;
+    if (cached < 0)
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        bool avx2 = false;
+        if (info[0] >= 7)
+        {
+            __cpuid(info, 1);
+            // os saves ymm registers and the cpu has avx
+            bool osxsave = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+            if (osxsave && (_xgetbv(0) & 6) == 6)
+            {
+                __cpuidex(info, 7, 0);
+                avx2 = info[1] & (1 << 5);
+            }
+        }
+        cached = avx2;
+#else
+        cached = __builtin_cpu_supports("avx2");
+#endif
+    }
+    return cached;
+}
+
+#endif
+
+void
+onyx_ComputeBounds(const float* positions, uint32_t vertexCount,
+                   Onyx_GeoBounds* bounds)
+{
+    memset(bounds, 0, sizeof(*bounds));
+    if (vertexCount == 0)
+        return;
+
+    Box      box  = {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+    uint32_t done = 0;
+#if BOUNDS_X86
+    const bool avx2 = hasAVX2();
+    done            = avx2 ? boxAVX2(positions, vertexCount, &box)
+                           : boxSSE(positions, vertexCount, &box);
+#endif
+    boxScalar(positions + done * 3, vertexCount - done, &box);
+
+    float r2 = 0.f;
+    for (int k = 0; k < 3; k++)
+    {
+        bounds->min[k]    = box.min[k];
+        bounds->max[k]    = box.max[k];
+        bounds->center[k] = 0.5f * (box.min[k] + box.max[k]);
+    }
+
+    // sphere around the box center. not minimal but a single pass.
+    done = 0;
+#if BOUNDS_X86
+    done = avx2 ? radiusSqAVX2(positions, vertexCount, bounds->center, &r2)
+                : radiusSqSSE(positions, vertexCount, bounds->center, &r2);
+#endif
+    r2             = radiusSqScalar(positions + done * 3, vertexCount - done,
+                                    bounds->center, r2);
+    bounds->radius = sqrtf(r2);
+}
+
+bool
+onyx_UpdateGeoBounds(Onyx_Geometry* geo)
+{
+    if (!geo->vertexRegion.hostData)
+        return false;
+    int posIndex = onyx_GetGeoAttrIndexOfType(geo, ONYX_ATTRIBUTE_TYPE_POS);
+    // unnamed geometry keeps positions first
+    if (posIndex < 0 && geo->attrCount > 0 && geo->attrSizes[0] == 12)
+        posIndex = 0;
+    if (posIndex < 0)
+        return false;
+    const float* positions =
+        (const float*)(geo->vertexRegion.hostData + geo->attrOffsets[posIndex]);
+    onyx_ComputeBounds(positions, geo->vertexCount, &geo->bounds);
+    geo->boundsValid = true;
+    return true;
+}
+
+const Onyx_GeoBounds*
+onyx_GetGeoBounds(Onyx_Geometry* geo)
+{
+    if (!geo->boundsValid && !onyx_UpdateGeoBounds(geo))
+        return NULL;
+    return &geo->bounds;
+}
+
+bool
+onyx_UpdateFileGeoBounds(Onyx_FileGeo* fgeo)
+{
+    int posIndex = -1;
+    for (uint32_t i = 0; i < fgeo->attrCount && posIndex < 0; i++)
+        if (strncmp(fgeo->attrNames[i], POS_NAME, ATTR_NAME_LEN) == 0)
+            posIndex = i;
+    // unnamed geometry keeps positions first
+    if (posIndex < 0 && fgeo->attrCount > 0 && fgeo->attrSizes[0] == 12)
+        posIndex = 0;
+    if (posIndex < 0)
+        return false;
+    onyx_ComputeBounds(fgeo->attributes[posIndex], fgeo->vertexCount,
+                       &fgeo->bounds);
+    fgeo->boundsValid = true;
+    return true;
+}
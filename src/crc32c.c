@@ -0,0 +1,97 @@
+#include "file.h"
+#include <string.h>
+
+// CRC-32C (Castagnoli), the checksum of the geo file sections. Uses the
+// crc32 instructions of SSE 4.2 or ARMv8 when available and a byte table
+// otherwise.
+
+#define POLY 0x82f63b78u
+
+#define C1(c) ((c) & 1 ? POLY ^ ((c) >> 1) : (c) >> 1)
+#define C8(c) C1(C1(C1(C1(C1(C1(C1(C1(c))))))))
+#define R2(n) C8(n), C8(n + 1)
+#define R4(n) R2(n), R2(n + 2)
+#define R16(n) R4(n), R4(n + 4), R4(n + 8), R4(n + 12)
+#define R64(n) R16(n), R16(n + 16), R16(n + 32), R16(n + 48)
+
+static const uint32_t g_table[256] = {R64(0u), R64(64u), R64(128u), R64(192u)};
+
+static uint32_t
+crcTable(uint32_t crc, const uint8_t* p, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        crc = g_table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_SSE42
+#else
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+
+TARGET_SSE42 static uint32_t
+crcSSE42(uint32_t crc, const uint8_t* p, size_t size)
+{
+    uint64_t c = crc;
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+    }
+    crc = (uint32_t)c;
+    for (; size > 0; size--, p++)
+        crc = _mm_crc32_u8(crc, *p);
+    return crc;
+}
+
+static bool
+hasSSE42(void)
+{
+    static int cached = -1;
+    if (cached < 0)
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        cached = (info[2] >> 20) & 1;
+#else
+        cached = __builtin_cpu_supports("sse4.2");
+#endif
+    }
+    return cached;
+}
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+
+static uint32_t
+crcARM(uint32_t crc, const uint8_t* p, size_t size)
+{
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+    }
+    for (; size > 0; size--, p++)
+        crc = __crc32cb(crc, *p);
+    return crc;
+}
+#endif
+
+uint32_t
+onyx_Crc32c(uint32_t crc, const void* data, size_t size)
+{
+    crc = ~crc;
+#if defined(__x86_64__) || defined(_M_X64)
+    if (hasSSE42())
+        return ~crcSSE42(crc, data, size);
+#elif defined(__ARM_FEATURE_CRC32)
+    return ~crcARM(crc, data, size);
+#endif
+    return ~crcTable(crc, data, size);
+}
@@ -1,13 +1,30 @@
 #include "file.h"
+#include "asyncio.h"
+#include "command.h"
 #include "geo.h"
+#include "import.h"
 #include "memory.h"
+#include "meshproc.h"
+#include "parallel.h"
+#include "dtags.h"
 #include <hell/attributes.h>
 #include <hell/common.h>
+#include <hell/debug.h>
+#include <hell/minmax.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif WIN32
+#include <windows.h>
+#endif
+
 #if UNIX
 _Static_assert(sizeof(uint8_t) == sizeof(Onyx_GeoAttributeSize),
                "sizeof(Onyx_R_AttributeSize) must be 1");
@@ -15,8 +32,22 @@ _Static_assert(sizeof(uint8_t) == sizeof(Onyx_GeoAttributeSize),
 
 typedef Onyx_FileGeo FPrim;
 
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_GEO, fmt, ##__VA_ARGS__)
+
 #define FCHECK
 
+// optional chunks may follow the indices. each one starts with a 4 character
+// tag and the byte size of the data after it. readers skip tags they don't
+// know, so older files and older readers keep working.
+#define LODS_TAG "LODS"
+// the Onyx_GeoBounds of the geo as 10 floats
+#define BNDS_TAG "BNDS"
+
+typedef struct {
+    char     tag[4];
+    uint32_t size;
+} ChunkHeader;
+
 static void
 printPrim(const FPrim* prim)
 {
@@ -57,45 +88,163 @@ onyx_PrintFileGeo(const Onyx_FileGeo* prim)
     printPrim(prim);
 }
 
+// attributes and indices start on cache lines
+#define BLOCK_ALIGN 64
+
+static uint64_t
+alignUp(uint64_t offset, uint64_t alignment)
+{
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+// Block layout: the attribute and name pointers, the sizes, the names, then
+// every attribute and the indices each on their own cache line. Offsets are
+// from an aligned base, the block has room to align it.
+static size_t
+getBlockLayout(uint32_t vertexCount, uint32_t indexCount, uint32_t attrCount,
+               const Onyx_GeoAttributeSize attrSizes[], size_t attrOffsets[],
+               size_t* indexOffset)
+{
+    size_t size = attrCount * (sizeof(void*) + sizeof(char*)) +
+                  attrCount * sizeof(Onyx_GeoAttributeSize) +
+                  attrCount * ONYX_R_ATTR_NAME_LEN;
+    for (uint32_t i = 0; i < attrCount; i++)
+    {
+        size           = alignUp(size, BLOCK_ALIGN);
+        attrOffsets[i] = size;
+        size += (size_t)vertexCount * attrSizes[i];
+    }
+    size         = alignUp(size, BLOCK_ALIGN);
+    *indexOffset = size;
+    size += (size_t)indexCount * sizeof(Onyx_GeoIndex);
+    return size + BLOCK_ALIGN - 1;
+}
+
+size_t
+onyx_GetFileGeoBlockSize(uint32_t vertexCount, uint32_t indexCount,
+                         uint32_t                    attrCount,
+                         const Onyx_GeoAttributeSize attrSizes[])
+{
+    assert(attrCount <= ONYX_R_MAX_VERT_ATTRIBUTES);
+    size_t attrOffsets[ONYX_R_MAX_VERT_ATTRIBUTES];
+    size_t indexOffset;
+    return getBlockLayout(vertexCount, indexCount, attrCount, attrSizes,
+                          attrOffsets, &indexOffset);
+}
+
+Onyx_FileGeoArena
+onyx_CreateFileGeoArena(size_t size)
+{
+    return (Onyx_FileGeoArena){.data = hell_Malloc(size), .size = size};
+}
+
+void
+onyx_ResetFileGeoArena(Onyx_FileGeoArena* arena)
+{
+    arena->used = 0;
+}
+
+void
+onyx_FreeFileGeoArena(Onyx_FileGeoArena* arena)
+{
+    hell_Free(arena->data);
+    memset(arena, 0, sizeof(*arena));
+}
+
 Onyx_FileGeo
-onyx_CreateFileGeo(const uint32_t vertexCount, const uint32_t indexCount,
-                       const uint32_t             attrCount,
-                       const Onyx_GeoAttributeSize attrSizes[/*attrCount*/],
-                       const char attrNames[/*attrCount*/][ONYX_R_ATTR_NAME_LEN])
+onyx_CreateFileGeoInArena(Onyx_FileGeoArena* arena, const uint32_t vertexCount,
+                          const uint32_t              indexCount,
+                          const uint32_t              attrCount,
+                          const Onyx_GeoAttributeSize attrSizes[/*attrCount*/],
+                          const char attrNames[/*attrCount*/][ONYX_R_ATTR_NAME_LEN])
 {
+    assert(attrCount <= ONYX_R_MAX_VERT_ATTRIBUTES);
     Onyx_FileGeo fprim = {.vertexCount = vertexCount,
                               .indexCount  = indexCount,
                               .attrCount   = attrCount};
 
-    fprim.attrSizes  = hell_Malloc(attrCount * sizeof(Onyx_GeoAttributeSize));
-    fprim.indices    = hell_Malloc(indexCount * sizeof(Onyx_GeoIndex));
-    fprim.attrNames  = hell_Malloc(attrCount * sizeof(char*));
-    fprim.attributes = hell_Malloc(attrCount * sizeof(void*));
+    size_t       attrOffsets[ONYX_R_MAX_VERT_ATTRIBUTES];
+    size_t       indexOffset;
+    const size_t size = getBlockLayout(vertexCount, indexCount, attrCount,
+                                       attrSizes, attrOffsets, &indexOffset);
+    if (arena && arena->size - arena->used >= size)
+    {
+        fprim.block = arena->data + arena->used;
+        arena->used += size;
+    }
+    else
+    {
+        fprim.block     = hell_Malloc(size);
+        fprim.ownsBlock = true;
+    }
+    fprim.blockSize = size;
+
+    uint8_t* base = (uint8_t*)alignUp((uintptr_t)fprim.block, BLOCK_ALIGN);
+    fprim.attributes = (void**)base;
+    fprim.attrNames  = (char**)(fprim.attributes + attrCount);
+    fprim.attrSizes  = (Onyx_GeoAttributeSize*)(fprim.attrNames + attrCount);
+    char* names      = (char*)(fprim.attrSizes + attrCount);
+    fprim.indices    = (Onyx_GeoIndex*)(base + indexOffset);
 
     for (int i = 0; i < attrCount; i++)
     {
         fprim.attrSizes[i]  = attrSizes[i];
-        fprim.attrNames[i]  = hell_Malloc(ONYX_R_ATTR_NAME_LEN);
-        fprim.attributes[i] = hell_Malloc(vertexCount * attrSizes[i]);
+        fprim.attrNames[i]  = names + i * ONYX_R_ATTR_NAME_LEN;
+        fprim.attributes[i] = base + attrOffsets[i];
     }
 
     if (attrNames != NULL)
-    {
-        for (int i = 0; i < attrCount; i++)
-        {
-            memcpy(fprim.attrNames[i], attrNames[i], ONYX_R_ATTR_NAME_LEN);
-        }
-    }
+        memcpy(names, attrNames, attrCount * ONYX_R_ATTR_NAME_LEN);
+    else
+        memset(names, 0, attrCount * ONYX_R_ATTR_NAME_LEN);
 
     return fprim;
 }
 
+Onyx_FileGeo
+onyx_CreateFileGeo(const uint32_t vertexCount, const uint32_t indexCount,
+                       const uint32_t             attrCount,
+                       const Onyx_GeoAttributeSize attrSizes[/*attrCount*/],
+                       const char attrNames[/*attrCount*/][ONYX_R_ATTR_NAME_LEN])
+{
+    return onyx_CreateFileGeoInArena(NULL, vertexCount, indexCount, attrCount,
+                                     attrSizes, attrNames);
+}
+
+// the end is included so empty arrays at the end of the block count
+static bool
+isInBlock(const Onyx_FileGeo* fprim, const void* array)
+{
+    const uintptr_t p     = (uintptr_t)array;
+    const uintptr_t block = (uintptr_t)fprim->block;
+    return fprim->block && p >= block && p <= block + fprim->blockSize;
+}
+
+void*
+onyx_ResizeFileGeoArray(Onyx_FileGeo* fprim, void* array, size_t size,
+                        size_t newSize)
+{
+    assert(!fprim->mapData);
+    if (!isInBlock(fprim, array))
+        return hell_Realloc(array, newSize);
+    void* moved = hell_Malloc(newSize);
+    memcpy(moved, array, size < newSize ? size : newSize);
+    return moved;
+}
+
 Onyx_FileGeo
 onyx_CreateFileGeoFromGeo(Onyx_Memory* memory, const Onyx_Geometry* rprim)
 {
-    Onyx_FileGeo fprim = onyx_CreateFileGeo(
-        rprim->vertexCount, rprim->indexCount, rprim->attrCount,
-        rprim->attrSizes, rprim->attrNames);
+    const uint32_t indexCount =
+        onyx_GetTotalIndexCount(rprim->indexCount, rprim->lodCount, rprim->lods);
+    Onyx_FileGeo fprim =
+        onyx_CreateFileGeo(rprim->vertexCount, indexCount, rprim->attrCount,
+                           rprim->attrSizes, rprim->attrNames);
+    fprim.indexCount = rprim->indexCount;
+    fprim.lodCount   = rprim->lodCount;
+    memcpy(fprim.lods, rprim->lods, sizeof(fprim.lods));
+    fprim.bounds      = rprim->bounds;
+    fprim.boundsValid = rprim->boundsValid;
 
     Onyx_BufferRegion hostVertRegion;
     Onyx_BufferRegion hostIndexRegion;
@@ -114,7 +263,7 @@ onyx_CreateFileGeoFromGeo(Onyx_Memory* memory, const Onyx_Geometry* rprim)
         hostVertRegion = onyx_RequestBufferRegion(
             memory, attrDataSize, 0, ONYX_MEMORY_HOST_GRAPHICS_TYPE);
         hostIndexRegion = onyx_RequestBufferRegion(
-            memory, rprim->indexCount * sizeof(Onyx_GeoIndex), 0,
+            memory, indexCount * sizeof(Onyx_GeoIndex), 0,
             ONYX_MEMORY_HOST_GRAPHICS_TYPE);
         onyx_CopyBufferRegion(&rprim->vertexRegion, &hostVertRegion);
         onyx_CopyBufferRegion(&rprim->indexRegion, &hostIndexRegion);
@@ -136,7 +285,7 @@ onyx_CreateFileGeoFromGeo(Onyx_Memory* memory, const Onyx_Geometry* rprim)
     }
 
     memcpy(fprim.indices, hostIndexRegion.hostData,
-           rprim->indexCount * sizeof(Onyx_GeoIndex));
+           indexCount * sizeof(Onyx_GeoIndex));
 
     if (!rprim->vertexRegion.hostData)
     {
@@ -151,10 +300,12 @@ Onyx_Geometry
 onyx_CreateGeoFromFileGeo(Onyx_Memory* memory, VkBufferUsageFlags extraBufferUsageFlags,
  const Onyx_FileGeo* fprim)
 {
+    const uint32_t indexCount =
+        onyx_GetTotalIndexCount(fprim->indexCount, fprim->lodCount, fprim->lods);
     Onyx_Geometry rprim =
-        onyx_CreateGeometry(memory, extraBufferUsageFlags, fprim->vertexCount, fprim->indexCount,
+        onyx_CreateGeometry(memory, extraBufferUsageFlags, fprim->vertexCount, indexCount,
                              fprim->attrCount, fprim->attrSizes);
-    const size_t indexDataSize = fprim->indexCount * sizeof(Onyx_GeoIndex);
+    const size_t indexDataSize = indexCount * sizeof(Onyx_GeoIndex);
     for (int i = 0; i < fprim->attrCount; i++)
     {
         void* dst = onyx_GetGeoAttribute(&rprim, i);
@@ -162,15 +313,38 @@ onyx_CreateGeoFromFileGeo(Onyx_Memory* memory, VkBufferUsageFlags extraBufferUsa
                rprim.attrSizes[i] * rprim.vertexCount);
         memcpy(rprim.attrNames[i], fprim->attrNames[i], ONYX_R_ATTR_NAME_LEN);
     }
+    onyx_UpdateGeoSemantics(&rprim);
     memcpy(rprim.indexRegion.hostData, fprim->indices, indexDataSize);
+    // the region holds every level but draws of the geo cover level 0 only
+    rprim.indexCount = fprim->indexCount;
+    rprim.lodCount   = fprim->lodCount;
+    memcpy(rprim.lods, fprim->lods, sizeof(rprim.lods));
+    rprim.bounds      = fprim->bounds;
+    rprim.boundsValid = fprim->boundsValid;
+    if (!rprim.boundsValid)
+        onyx_UpdateGeoBounds(&rprim);
     return rprim;
 }
 
-int
-onyx_WriteFileGeo(const char* filename, const Onyx_FileGeo* fprim)
+// the bounds to store, computed if the geo has none
+static bool
+getWriteBounds(const Onyx_FileGeo* fprim, Onyx_GeoBounds* bounds)
+{
+    if (fprim->boundsValid)
+    {
+        *bounds = fprim->bounds;
+        return true;
+    }
+    Onyx_FileGeo tmp = *fprim;
+    if (!onyx_UpdateFileGeoBounds(&tmp))
+        return false;
+    *bounds = tmp.bounds;
+    return true;
+}
+
+static void
+writeFileGeoV1(FILE* file, const Onyx_FileGeo* fprim)
 {
-    FILE* file = fopen(filename, "wb");
-    assert(file);
     const size_t headerSize = offsetof(Onyx_FileGeo, attrSizes);
     assert(headerSize == 16);
     const size_t indexDataSize = sizeof(Onyx_GeoIndex) * fprim->indexCount;
@@ -192,76 +366,1428 @@ onyx_WriteFileGeo(const char* filename, const Onyx_FileGeo* fprim)
     }
     r = fwrite(fprim->indices, indexDataSize, 1, file);
     assert(r == 1);
-    r = fclose(file);
+    if (fprim->lodCount > 1)
+    {
+        const uint32_t tailCount =
+            onyx_GetTotalIndexCount(fprim->indexCount, fprim->lodCount, fprim->lods) -
+            fprim->indexCount;
+        const size_t tableSize = sizeof(Onyx_GeoLod) * fprim->lodCount;
+        ChunkHeader  chunk     = {.size = sizeof(uint32_t) + tableSize +
+                                     tailCount * sizeof(Onyx_GeoIndex)};
+        memcpy(chunk.tag, LODS_TAG, 4);
+        r = fwrite(&chunk, sizeof(chunk), 1, file);
+        assert(r == 1);
+        r = fwrite(&fprim->lodCount, sizeof(uint32_t), 1, file);
+        assert(r == 1);
+        r = fwrite(fprim->lods, tableSize, 1, file);
+        assert(r == 1);
+        r = fwrite(fprim->indices + fprim->indexCount,
+                   tailCount * sizeof(Onyx_GeoIndex), 1, file);
+        assert(r == 1);
+    }
+    Onyx_GeoBounds bounds;
+    if (getWriteBounds(fprim, &bounds))
+    {
+        _Static_assert(sizeof(Onyx_GeoBounds) == 10 * sizeof(float),
+                       "Onyx_GeoBounds must be tightly packed");
+        ChunkHeader chunk = {.size = sizeof(bounds)};
+        memcpy(chunk.tag, BNDS_TAG, 4);
+        r = fwrite(&chunk, sizeof(chunk), 1, file);
+        assert(r == 1);
+        r = fwrite(&bounds, sizeof(bounds), 1, file);
+        assert(r == 1);
+    }
+}
+
+// Version 2 starts with a header and a table of sections. Every section has
+// its offset, size and CRC-32C in the table, so readers can check the data and
+// find the sections without walking the file. Attribute and index data start
+// at 256 byte offsets, which is enough for a mapped file to be used in place
+// by anything including buffer copies. Version 1 files begin with the
+// attribute count, which can never read as the magic.
+#define GEO_MAGIC "OGEO"
+#define ATTR_TAG "ATTR"
+#define INDX_TAG "INDX"
+#define DATA_ALIGNMENT 256
+#define MAX_SECTIONS (ONYX_R_MAX_VERT_ATTRIBUTES + 3)
+
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint32_t attrCount;
+    uint32_t vertexCount;
+    // level 0. the INDX section holds every level.
+    uint32_t indexCount;
+    uint32_t lodCount;
+    uint32_t sectionCount;
+    uint32_t flags;
+    // CRC-32C of the header with this field zeroed and then the section table
+    uint32_t tableCrc;
+    uint32_t padding[7];
+} GeoHeaderV2;
+
+typedef struct {
+    char     tag[4];
+    uint32_t crc;
+    uint64_t offset;
+    uint64_t size;
+    // ATTR sections only. attrType is the OnyxAttributeTypes + 1 of the name,
+    // 0 for attributes without a standard semantic.
+    char     name[ONYX_R_ATTR_NAME_LEN];
+    uint8_t  elemSize;
+    uint8_t  attrType;
+    // Onyx_GeoCodec of ATTR and INDX sections. size and crc are those of the
+    // coded data.
+    uint8_t  codec;
+    uint8_t  padding;
+} GeoSectionV2;
+
+_Static_assert(sizeof(GeoHeaderV2) == 64, "GeoHeaderV2 must be 64 bytes");
+_Static_assert(sizeof(GeoSectionV2) == 32, "GeoSectionV2 must be 32 bytes");
+
+// replaces data and size with the coded section if that is smaller
+static Onyx_GeoCodec
+codeSection(Onyx_GeoCodec codec, uint32_t elemSize, const void** data,
+            uint64_t* size, void** coded)
+{
+    if (codec == ONYX_GEO_CODEC_NONE || *size == 0)
+        return ONYX_GEO_CODEC_NONE;
+    void*        buf;
+    const size_t codedSize =
+        onyx_EncodeGeoSection(codec, *data, *size, elemSize, 0, &buf);
+    if (codedSize >= *size)
+    {
+        hell_Free(buf);
+        return ONYX_GEO_CODEC_NONE;
+    }
+    *coded = buf;
+    *data  = buf;
+    *size  = codedSize;
+    return codec;
+}
+
+static void
+addSection(GeoSectionV2* sections, uint32_t* count, uint64_t* end,
+           const char* tag, const void* data, uint64_t size, uint64_t alignment)
+{
+    assert(*count < MAX_SECTIONS);
+    GeoSectionV2* s = &sections[(*count)++];
+    memset(s, 0, sizeof(*s));
+    memcpy(s->tag, tag, 4);
+    s->offset = alignUp(*end, alignment);
+    s->size   = size;
+    s->crc    = onyx_Crc32c(0, data, size);
+    *end      = s->offset + size;
+}
+
+// returns the bytes written
+static uint64_t
+writeFileGeoV2(FILE* file, const Onyx_FileGeo* fprim,
+               const Onyx_WriteGeoParms* parms)
+{
+    assert(fprim->attrCount <= ONYX_R_MAX_VERT_ATTRIBUTES);
+    const uint32_t totalIndexCount =
+        onyx_GetTotalIndexCount(fprim->indexCount, fprim->lodCount, fprim->lods);
+    const uint32_t lodCount = fprim->lodCount > 1 ? fprim->lodCount : 0;
+    Onyx_GeoBounds bounds;
+    const bool     hasBounds = getWriteBounds(fprim, &bounds);
+
+    GeoSectionV2 sections[MAX_SECTIONS];
+    const void*  sectionData[MAX_SECTIONS];
+    void*        coded[MAX_SECTIONS] = {0};
+    uint32_t     count               = 0;
+    // the table comes first so its size must be known up front
+    const uint32_t sectionCount =
+        fprim->attrCount + 1 + (lodCount ? 1 : 0) + (hasBounds ? 1 : 0);
+    uint64_t end = sizeof(GeoHeaderV2) + sectionCount * sizeof(GeoSectionV2);
+    for (uint32_t i = 0; i < fprim->attrCount; i++)
+    {
+        const void* data = fprim->attributes[i];
+        uint64_t    size = (uint64_t)fprim->vertexCount * fprim->attrSizes[i];
+        const Onyx_GeoCodec codec = codeSection(
+            parms->attributeCodec, fprim->attrSizes[i], &data, &size, &coded[count]);
+        sectionData[count] = data;
+        addSection(sections, &count, &end, ATTR_TAG, data, size, DATA_ALIGNMENT);
+        GeoSectionV2* s = &sections[count - 1];
+        memcpy(s->name, fprim->attrNames[i], ONYX_R_ATTR_NAME_LEN);
+        s->elemSize = fprim->attrSizes[i];
+        s->attrType = onyx_GetAttributeTypeFromName(fprim->attrNames[i]) + 1;
+        s->codec    = codec;
+    }
+    const void* indexData = fprim->indices;
+    uint64_t    indexSize = (uint64_t)totalIndexCount * sizeof(Onyx_GeoIndex);
+    const Onyx_GeoCodec indexCodec = codeSection(
+        parms->indexCodec, sizeof(Onyx_GeoIndex), &indexData, &indexSize, &coded[count]);
+    sectionData[count] = indexData;
+    addSection(sections, &count, &end, INDX_TAG, indexData, indexSize,
+               DATA_ALIGNMENT);
+    sections[count - 1].codec = indexCodec;
+    if (lodCount)
+    {
+        sectionData[count] = fprim->lods;
+        addSection(sections, &count, &end, LODS_TAG, fprim->lods,
+                   lodCount * sizeof(Onyx_GeoLod), 16);
+    }
+    if (hasBounds)
+    {
+        sectionData[count] = &bounds;
+        addSection(sections, &count, &end, BNDS_TAG, &bounds, sizeof(bounds), 16);
+    }
+
+    GeoHeaderV2 header = {
+        .version      = 2,
+        .attrCount    = fprim->attrCount,
+        .vertexCount  = fprim->vertexCount,
+        .indexCount   = fprim->indexCount,
+        .lodCount     = lodCount,
+        .sectionCount = count,
+    };
+    assert(count == sectionCount);
+    memcpy(header.magic, GEO_MAGIC, 4);
+    header.tableCrc = onyx_Crc32c(0, &header, sizeof(header));
+    header.tableCrc =
+        onyx_Crc32c(header.tableCrc, sections, count * sizeof(GeoSectionV2));
+
+    static const uint8_t zeros[DATA_ALIGNMENT] = {0};
+    size_t               r;
+    r = fwrite(&header, sizeof(header), 1, file);
+    assert(r == 1);
+    r = fwrite(sections, sizeof(GeoSectionV2), count, file);
+    assert(r == count);
+    uint64_t pos = sizeof(header) + count * sizeof(GeoSectionV2);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        assert(sections[i].offset - pos < DATA_ALIGNMENT);
+        r = fwrite(zeros, 1, sections[i].offset - pos, file);
+        assert(r == sections[i].offset - pos);
+        if (sections[i].size)
+        {
+            r = fwrite(sectionData[i], sections[i].size, 1, file);
+            assert(r == 1);
+        }
+        pos = sections[i].offset + sections[i].size;
+    }
+    for (uint32_t i = 0; i < count; i++)
+        if (coded[i])
+            hell_Free(coded[i]);
+    return pos;
+}
+
+int
+onyx_WriteFileGeoEx(const char* filename, const Onyx_FileGeo* fprim,
+                    const Onyx_WriteGeoParms* parms)
+{
+    FILE* file = fopen(filename, "wb");
+    assert(file);
+    if (parms->version == ONYX_GEO_FILE_VERSION_1)
+    {
+        assert(parms->attributeCodec == ONYX_GEO_CODEC_NONE &&
+               parms->indexCodec == ONYX_GEO_CODEC_NONE);
+        writeFileGeoV1(file, fprim);
+    }
+    else
+    {
+        assert(parms->version == ONYX_GEO_FILE_VERSION_2);
+        writeFileGeoV2(file, fprim, parms);
+    }
+    int r = fclose(file);
     assert(r == 0);
     return 1;
 }
 
+uint64_t
+onyx_WriteFileGeoToStream(FILE* file, const Onyx_FileGeo* fprim,
+                          const Onyx_WriteGeoParms* parms)
+{
+    assert(parms->version == ONYX_GEO_FILE_VERSION_2);
+    return writeFileGeoV2(file, fprim, parms);
+}
+
+int
+onyx_WriteFileGeo(const char* filename, const Onyx_FileGeo* fprim)
+{
+    const Onyx_WriteGeoParms parms = {.version = ONYX_GEO_FILE_VERSION_2};
+    return onyx_WriteFileGeoEx(filename, fprim, &parms);
+}
+
+static void*
+mapFile(const char* filename, size_t* size)
+{
+#if UNIX
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    void*       data = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+            data = NULL;
+        else
+        {
+            // everything gets read once front to back
+            madvise(data, st.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+            *size = st.st_size;
+        }
+    }
+    close(fd);
+    return data;
+#elif WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+    LARGE_INTEGER fileSize;
+    void*         data = NULL;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+    {
+        HANDLE mapping =
+            CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping)
+        {
+            // the view keeps the mapping alive
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+            *size = fileSize.QuadPart;
+        }
+    }
+    CloseHandle(file);
+    return data;
+#endif
+}
+
+static void
+unmapFile(void* data, size_t size)
+{
+#if UNIX
+    munmap(data, size);
+#elif WIN32
+    UnmapViewOfFile(data);
+#endif
+}
+
+// where the sections of a geo file are
+typedef struct {
+    uint32_t       attrCount;
+    uint32_t       vertexCount;
+    uint32_t       indexCount;
+    uint8_t        attrSizes[ONYX_R_MAX_VERT_ATTRIBUTES];
+    const char*    attrNames[ONYX_R_MAX_VERT_ATTRIBUTES];
+    const uint8_t* attributes[ONYX_R_MAX_VERT_ATTRIBUTES];
+    const uint8_t* indices;
+    // stored size and Onyx_GeoCodec of coded version 2 sections
+    size_t         attrCodedSizes[ONYX_R_MAX_VERT_ATTRIBUTES];
+    uint8_t        attrCodecs[ONYX_R_MAX_VERT_ATTRIBUTES];
+    size_t         indexCodedSize;
+    uint8_t        indexCodec;
+    uint32_t       lodCount;
+    const uint8_t* lods;
+    // indices of the coarser levels if they don't follow level 0
+    const uint8_t* lodIndices;
+    const uint8_t* bounds;
+} GeoLayout;
+
+typedef struct {
+    const uint8_t* data;
+    size_t         size;
+    size_t         pos;
+} Cursor;
+
+// NULL if fewer than size bytes are left
+static const uint8_t*
+take(Cursor* c, size_t size)
+{
+    if (size > c->size - c->pos)
+        return NULL;
+    const uint8_t* p = c->data + c->pos;
+    c->pos += size;
+    return p;
+}
+
+// Level 0 must be the full detail range and every level must lie in the index
+// array, which the last one ends. Whatever draws or rewrites the levels trusts
+// them. Sets *totalIndexCount to the length of that array.
+static bool
+checkLods(const Onyx_GeoLod* lods, uint32_t lodCount, uint32_t indexCount,
+          uint64_t* totalIndexCount)
+{
+    *totalIndexCount = indexCount;
+    if (!lodCount)
+        return true;
+    *totalIndexCount = (uint64_t)lods[lodCount - 1].firstIndex +
+                       lods[lodCount - 1].indexCount;
+    if (lods[0].firstIndex != 0 || lods[0].indexCount != indexCount ||
+        *totalIndexCount > UINT32_MAX)
+        return false;
+    for (uint32_t i = 0; i < lodCount; i++)
+        if ((uint64_t)lods[i].firstIndex + lods[i].indexCount > *totalIndexCount)
+            return false;
+    return true;
+}
+
+static bool
+parseLayoutV1(const uint8_t* data, size_t size, GeoLayout* l)
+{
+    Cursor         c      = {data, size, 0};
+    const uint8_t* header = take(&c, 16);
+    if (!header)
+        return false;
+    memset(l, 0, sizeof(*l));
+    memcpy(&l->attrCount, header, 4);
+    memcpy(&l->vertexCount, header + 4, 4);
+    memcpy(&l->indexCount, header + 8, 4);
+    if (l->attrCount > ONYX_R_MAX_VERT_ATTRIBUTES)
+        return false;
+    const uint8_t* sizes = take(&c, l->attrCount);
+    const uint8_t* names = take(&c, l->attrCount * ONYX_R_ATTR_NAME_LEN);
+    if (!sizes || !names)
+        return false;
+    memcpy(l->attrSizes, sizes, l->attrCount);
+    for (uint32_t i = 0; i < l->attrCount; i++)
+        l->attrNames[i] = (const char*)names + i * ONYX_R_ATTR_NAME_LEN;
+    for (uint32_t i = 0; i < l->attrCount; i++)
+    {
+        l->attrCodedSizes[i] = (size_t)l->vertexCount * l->attrSizes[i];
+        l->attributes[i]     = take(&c, l->attrCodedSizes[i]);
+        if (!l->attributes[i])
+            return false;
+    }
+    l->indexCodedSize = (size_t)l->indexCount * sizeof(Onyx_GeoIndex);
+    if (!(l->indices = take(&c, l->indexCodedSize)))
+        return false;
+    ChunkHeader chunk;
+    const uint8_t* p;
+    while ((p = take(&c, sizeof(chunk))))
+    {
+        memcpy(&chunk, p, sizeof(chunk));
+        const uint8_t* body = take(&c, chunk.size);
+        if (!body)
+            return false;
+        if (memcmp(chunk.tag, BNDS_TAG, 4) == 0 &&
+            chunk.size == sizeof(Onyx_GeoBounds))
+            l->bounds = body;
+        else if (memcmp(chunk.tag, LODS_TAG, 4) == 0 && chunk.size >= 4)
+        {
+            memcpy(&l->lodCount, body, 4);
+            const size_t tableSize = l->lodCount * sizeof(Onyx_GeoLod);
+            if (l->lodCount < 2 || l->lodCount > ONYX_R_MAX_LODS ||
+                4 + tableSize > chunk.size)
+                return false;
+            l->lods       = body + 4;
+            l->lodIndices = body + 4 + tableSize;
+            Onyx_GeoLod lods[ONYX_R_MAX_LODS];
+            memcpy(lods, l->lods, tableSize);
+            uint64_t total;
+            if (!checkLods(lods, l->lodCount, l->indexCount, &total) ||
+                (total - l->indexCount) * sizeof(Onyx_GeoIndex) >
+                    chunk.size - 4 - tableSize)
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool
+isValidHeaderV2(const GeoHeaderV2* header)
+{
+    return memcmp(header->magic, GEO_MAGIC, 4) == 0 && header->version == 2 &&
+           header->attrCount <= ONYX_R_MAX_VERT_ATTRIBUTES &&
+           header->sectionCount <= MAX_SECTIONS &&
+           header->lodCount <= ONYX_R_MAX_LODS && header->lodCount != 1;
+}
+
+static bool
+checkTableCrcV2(GeoHeaderV2 header, const void* table)
+{
+    const uint32_t tableCrc = header.tableCrc;
+    header.tableCrc         = 0;
+    const uint32_t crc      = onyx_Crc32c(0, &header, sizeof(header));
+    return onyx_Crc32c(crc, table, header.sectionCount * sizeof(GeoSectionV2)) ==
+           tableCrc;
+}
+
+// checks the table and the CRC of every section
+static bool
+parseLayoutV2(const uint8_t* data, size_t size, GeoLayout* l)
+{
+    GeoHeaderV2 header;
+    if (size < sizeof(header))
+        return false;
+    memcpy(&header, data, sizeof(header));
+    if (!isValidHeaderV2(&header))
+        return false;
+    const size_t tableSize = header.sectionCount * sizeof(GeoSectionV2);
+    if (tableSize > size - sizeof(header) ||
+        !checkTableCrcV2(header, data + sizeof(header)))
+        return false;
+
+    memset(l, 0, sizeof(*l));
+    l->attrCount   = header.attrCount;
+    l->vertexCount = header.vertexCount;
+    l->indexCount  = header.indexCount;
+    l->lodCount    = header.lodCount;
+    uint32_t attrIndex = 0;
+    for (uint32_t i = 0; i < header.sectionCount; i++)
+    {
+        GeoSectionV2 s;
+        memcpy(&s, data + sizeof(header) + i * sizeof(s), sizeof(s));
+        if (s.offset > size || s.size > size - s.offset)
+            return false;
+        const uint8_t* body = data + s.offset;
+        if (onyx_Crc32c(0, body, s.size) != s.crc)
+            return false;
+        if (memcmp(s.tag, ATTR_TAG, 4) == 0)
+        {
+            const uint64_t rawSize = (uint64_t)l->vertexCount * s.elemSize;
+            if (attrIndex == l->attrCount || s.codec > ONYX_GEO_CODEC_VERTEX ||
+                (s.codec == ONYX_GEO_CODEC_NONE && s.size != rawSize))
+                return false;
+            l->attrCodecs[attrIndex]     = s.codec;
+            l->attrCodedSizes[attrIndex] = s.size;
+            l->attrSizes[attrIndex]      = s.elemSize;
+            l->attrNames[attrIndex]      = (const char*)data + sizeof(header) +
+                                      i * sizeof(s) +
+                                      offsetof(GeoSectionV2, name);
+            l->attributes[attrIndex]     = body;
+            attrIndex++;
+        }
+        else if (memcmp(s.tag, INDX_TAG, 4) == 0)
+        {
+            if (s.codec > ONYX_GEO_CODEC_VERTEX)
+                return false;
+            l->indices        = body;
+            l->indexCodec     = s.codec;
+            l->indexCodedSize = s.size;
+        }
+        else if (memcmp(s.tag, LODS_TAG, 4) == 0)
+        {
+            if (s.size != l->lodCount * sizeof(Onyx_GeoLod))
+                return false;
+            l->lods = body;
+        }
+        else if (memcmp(s.tag, BNDS_TAG, 4) == 0)
+        {
+            if (s.size != sizeof(Onyx_GeoBounds))
+                return false;
+            l->bounds = body;
+        }
+    }
+    if (attrIndex != l->attrCount || !l->indices || (l->lodCount && !l->lods))
+        return false;
+    Onyx_GeoLod lods[ONYX_R_MAX_LODS];
+    if (l->lodCount)
+        memcpy(lods, l->lods, l->lodCount * sizeof(Onyx_GeoLod));
+    uint64_t totalIndexCount;
+    return checkLods(lods, l->lodCount, l->indexCount, &totalIndexCount) &&
+           (l->indexCodec != ONYX_GEO_CODEC_NONE ||
+            l->indexCodedSize == totalIndexCount * sizeof(Onyx_GeoIndex));
+}
+
+static bool
+isFileGeoV2(const uint8_t* data, size_t size)
+{
+    return size >= 4 && memcmp(data, GEO_MAGIC, 4) == 0;
+}
+
+static bool
+parseLayout(const uint8_t* data, size_t size, GeoLayout* l)
+{
+    if (isFileGeoV2(data, size))
+        return parseLayoutV2(data, size, l);
+    return parseLayoutV1(data, size, l);
+}
+
+static size_t
+align16(size_t size)
+{
+    return (size + 15) & ~(size_t)15;
+}
+
+static bool
+isAligned(const void* p, size_t alignment)
+{
+    return ((uintptr_t)p & (alignment - 1)) == 0;
+}
+
+// points fprim at the layout, copying or decoding into one scratch allocation
+// whatever can't be used in place. false if a section fails to decode.
+static bool
+fileGeoFromLayout(const GeoLayout* l, Onyx_FileGeo* fprim)
+{
+    const uint32_t attrCount = l->attrCount;
+    Onyx_GeoLod    lods[ONYX_R_MAX_LODS];
+    if (l->lodCount)
+        memcpy(lods, l->lods, l->lodCount * sizeof(Onyx_GeoLod));
+    const uint32_t totalIndexCount =
+        onyx_GetTotalIndexCount(l->indexCount, l->lodCount, lods);
+    // version 1 stores the coarser levels apart from level 0 so those get
+    // joined
+    const bool copyIndices = l->lodIndices || l->indexCodec ||
+                             !isAligned(l->indices, sizeof(Onyx_GeoIndex));
+    bool inPlace[ONYX_R_MAX_VERT_ATTRIBUTES];
+
+    size_t scratchSize =
+        attrCount * (sizeof(void*) + sizeof(char*)) + align16(attrCount);
+    for (uint32_t i = 0; i < attrCount; i++)
+    {
+        inPlace[i] = !l->attrCodecs[i] && isAligned(l->attributes[i], 4);
+        if (!inPlace[i])
+            scratchSize += align16((size_t)l->vertexCount * l->attrSizes[i]);
+    }
+    if (copyIndices)
+        scratchSize += (size_t)totalIndexCount * sizeof(Onyx_GeoIndex);
+
+    uint8_t* scratch   = hell_Malloc(scratchSize);
+    fprim->mapScratch  = scratch;
+    fprim->attrCount   = attrCount;
+    fprim->vertexCount = l->vertexCount;
+    fprim->indexCount  = l->indexCount;
+    fprim->attributes  = (void**)scratch;
+    scratch += attrCount * sizeof(void*);
+    fprim->attrNames = (char**)scratch;
+    scratch += attrCount * sizeof(char*);
+    fprim->attrSizes = scratch;
+    memcpy(fprim->attrSizes, l->attrSizes, attrCount);
+    scratch += align16(attrCount);
+    bool ok = true;
+    for (uint32_t i = 0; i < attrCount; i++)
+    {
+        fprim->attrNames[i] = (char*)l->attrNames[i];
+        if (inPlace[i])
+        {
+            fprim->attributes[i] = (void*)l->attributes[i];
+            continue;
+        }
+        const size_t size = (size_t)l->vertexCount * l->attrSizes[i];
+        ok = ok && onyx_DecodeGeoSection(l->attrCodecs[i], l->attributes[i],
+                                         l->attrCodedSizes[i], l->attrSizes[i],
+                                         0, scratch, size);
+        fprim->attributes[i] = scratch;
+        scratch += align16(size);
+    }
+    if (copyIndices)
+    {
+        const size_t levelSize = l->indexCount * sizeof(Onyx_GeoIndex);
+        if (l->indexCodec)
+            ok = ok && onyx_DecodeGeoSection(
+                           l->indexCodec, l->indices, l->indexCodedSize,
+                           sizeof(Onyx_GeoIndex), 0, scratch,
+                           (size_t)totalIndexCount * sizeof(Onyx_GeoIndex));
+        else
+            memcpy(scratch, l->indices, levelSize);
+        if (l->lodIndices)
+            memcpy(scratch + levelSize, l->lodIndices,
+                   (totalIndexCount - l->indexCount) * sizeof(Onyx_GeoIndex));
+        fprim->indices = (uint32_t*)scratch;
+    }
+    else
+        fprim->indices = (uint32_t*)l->indices;
+
+    fprim->lodCount = l->lodCount;
+    memcpy(fprim->lods, lods, sizeof(lods));
+    fprim->boundsValid = l->bounds != NULL;
+    if (l->bounds)
+        memcpy(&fprim->bounds, l->bounds, sizeof(Onyx_GeoBounds));
+    return ok;
+}
+
+int
+onyx_MapFileGeo(const char* filename, Onyx_FileGeo* fprim)
+{
+    memset(fprim, 0, sizeof(*fprim));
+    size_t         size = 0;
+    const uint8_t* data = mapFile(filename, &size);
+    if (!data)
+        return 0;
+    GeoLayout layout;
+    if (!parseLayout(data, size, &layout))
+    {
+        DPRINT("Malformed geo file %s\n", filename);
+        unmapFile((void*)data, size);
+        return 0;
+    }
+    if (!fileGeoFromLayout(&layout, fprim))
+    {
+        DPRINT("Corrupt section in geo file %s\n", filename);
+        hell_Free(fprim->mapScratch);
+        memset(fprim, 0, sizeof(*fprim));
+        unmapFile((void*)data, size);
+        return 0;
+    }
+    fprim->mapData = (void*)data;
+    fprim->mapSize = size;
+    return 1;
+}
+
+// Reads either version. The coded sections of version 2 decode with
+// threadCount threads, 0 for every hardware thread.
+static int
+readFileGeoFromMemory(const void* data, size_t size, Onyx_FileGeoArena* arena,
+                      uint32_t threadCount, Onyx_FileGeo* fprim)
+{
+    memset(fprim, 0, sizeof(*fprim));
+    GeoLayout l;
+    if (!parseLayout(data, size, &l))
+        return 0;
+    char names[ONYX_R_MAX_VERT_ATTRIBUTES][ONYX_R_ATTR_NAME_LEN];
+    for (uint32_t i = 0; i < l.attrCount; i++)
+        memcpy(names[i], l.attrNames[i], ONYX_R_ATTR_NAME_LEN);
+    Onyx_GeoLod lods[ONYX_R_MAX_LODS] = {0};
+    if (l.lodCount)
+        memcpy(lods, l.lods, l.lodCount * sizeof(Onyx_GeoLod));
+    const uint32_t totalIndexCount =
+        onyx_GetTotalIndexCount(l.indexCount, l.lodCount, lods);
+    *fprim = onyx_CreateFileGeoInArena(arena, l.vertexCount, totalIndexCount,
+                                       l.attrCount, l.attrSizes, names);
+    bool ok = true;
+    for (uint32_t i = 0; i < l.attrCount && ok; i++)
+        ok = onyx_DecodeGeoSection(l.attrCodecs[i], l.attributes[i],
+                                   l.attrCodedSizes[i], l.attrSizes[i],
+                                   threadCount, fprim->attributes[i],
+                                   (size_t)l.vertexCount * l.attrSizes[i]);
+    // version 1 stores the indices of the coarser levels apart from level 0
+    const uint32_t sectionIndexCount =
+        l.lodIndices ? l.indexCount : totalIndexCount;
+    ok = ok && onyx_DecodeGeoSection(l.indexCodec, l.indices, l.indexCodedSize,
+                                     sizeof(Onyx_GeoIndex), threadCount,
+                                     fprim->indices,
+                                     sectionIndexCount * sizeof(Onyx_GeoIndex));
+    if (ok && l.lodIndices)
+        memcpy(fprim->indices + l.indexCount, l.lodIndices,
+               (totalIndexCount - l.indexCount) * sizeof(Onyx_GeoIndex));
+    fprim->indexCount = l.indexCount;
+    fprim->lodCount   = l.lodCount;
+    memcpy(fprim->lods, lods, sizeof(lods));
+    fprim->boundsValid = l.bounds != NULL;
+    if (l.bounds)
+        memcpy(&fprim->bounds, l.bounds, sizeof(Onyx_GeoBounds));
+    if (!ok)
+        onyx_FreeFileGeo(fprim);
+    return ok;
+}
+
+int
+onyx_ReadFileGeoFromMemory(const void* data, size_t size, Onyx_FileGeo* fprim)
+{
+    if (!isFileGeoV2(data, size))
+        return 0;
+    return readFileGeoFromMemory(data, size, NULL, 0, fprim);
+}
+
+// reads the whole file and copies it into an owned geo
+static int
+readFileGeoV2(const char* filename, Onyx_FileGeoArena* arena,
+              Onyx_FileGeo* fprim)
+{
+    memset(fprim, 0, sizeof(*fprim));
+    size_t   size;
+    uint8_t* data = onyx_ReadWholeFile(filename, &size);
+    if (!data)
+        return 0;
+    const int ok = readFileGeoFromMemory(data, size, arena, 0, fprim);
+    hell_Free(data);
+    return ok;
+}
+
 int
 onyx_ReadFileGeo(const char* filename, Onyx_FileGeo* fprim)
 {
-    FILE* file = fopen(filename, "rb");
-    assert(file);
-    size_t r;
+    return onyx_ReadFileGeoInArena(filename, NULL, fprim);
+}
+
+// fread that is fine with 0 bytes
+static bool
+readBytes(FILE* file, void* dst, uint64_t size)
+{
+    return size == 0 || fread(dst, size, 1, file) == 1;
+}
+
+// Checks the counts against the file size before allocating, so garbage
+// headers don't turn into huge allocations.
+static bool
+readFileGeoV1(FILE* file, Onyx_FileGeoArena* arena, Onyx_FileGeo* fprim)
+{
     const size_t headerSize = offsetof(Onyx_FileGeo, attrSizes);
     assert(headerSize == 16);
-    r = fread(fprim, headerSize, 1, file);
-    assert(r == 1);
-    fprim->attrSizes =
-        hell_Malloc(fprim->attrCount * sizeof(Onyx_GeoAttributeSize));
-    fprim->indices    = hell_Malloc(fprim->indexCount * sizeof(Onyx_GeoIndex));
-    fprim->attrNames  = hell_Malloc(fprim->attrCount * sizeof(char*));
-    fprim->attributes = hell_Malloc(fprim->attrCount * sizeof(void*));
-    r = fread(fprim->attrSizes, fprim->attrCount * sizeof(Onyx_GeoAttributeSize),
-              1, file);
-    assert(r);
-    for (int i = 0; i < fprim->attrCount; i++)
+    if (fseek(file, 0, SEEK_END) != 0)
+        return false;
+    const uint64_t fileSize = ftell(file);
+    rewind(file);
+    Onyx_FileGeo header;
+    if (!readBytes(file, &header, headerSize) ||
+        header.attrCount > ONYX_R_MAX_VERT_ATTRIBUTES)
+        return false;
+    // sizes and names come before the data, so the block is laid out from
+    // them before reading the rest straight into it
+    Onyx_GeoAttributeSize attrSizes[ONYX_R_MAX_VERT_ATTRIBUTES];
+    char attrNames[ONYX_R_MAX_VERT_ATTRIBUTES][ONYX_R_ATTR_NAME_LEN];
+    if (!readBytes(file, attrSizes,
+                   header.attrCount * sizeof(Onyx_GeoAttributeSize)) ||
+        !readBytes(file, attrNames, header.attrCount * ONYX_R_ATTR_NAME_LEN))
+        return false;
+    uint64_t dataSize = (uint64_t)header.indexCount * sizeof(Onyx_GeoIndex);
+    for (uint32_t i = 0; i < header.attrCount; i++)
+        dataSize += (uint64_t)header.vertexCount * attrSizes[i];
+    if (dataSize > fileSize - ftell(file))
+        return false;
+    *fprim = onyx_CreateFileGeoInArena(arena, header.vertexCount,
+                                       header.indexCount, header.attrCount,
+                                       attrSizes, attrNames);
+    bool ok = true;
+    for (int i = 0; i < fprim->attrCount && ok; i++)
+        ok = readBytes(file, fprim->attributes[i],
+                       (uint64_t)fprim->vertexCount * fprim->attrSizes[i]);
+    ok = ok && readBytes(file, fprim->indices,
+                         fprim->indexCount * sizeof(Onyx_GeoIndex));
+    ChunkHeader chunk;
+    while (ok && fread(&chunk, sizeof(chunk), 1, file) == 1)
     {
-        fprim->attrNames[i] = hell_Malloc(ONYX_R_ATTR_NAME_LEN);
-        r = fread(fprim->attrNames[i], ONYX_R_ATTR_NAME_LEN, 1, file);
-        assert(r);
+        if (memcmp(chunk.tag, BNDS_TAG, 4) == 0 &&
+            chunk.size == sizeof(Onyx_GeoBounds))
+        {
+            ok = readBytes(file, &fprim->bounds, sizeof(Onyx_GeoBounds));
+            fprim->boundsValid = ok;
+            continue;
+        }
+        if (memcmp(chunk.tag, LODS_TAG, 4) != 0)
+        {
+            ok = fseek(file, chunk.size, SEEK_CUR) == 0;
+            continue;
+        }
+        uint32_t lodCount;
+        ok = chunk.size >= 4 && readBytes(file, &lodCount, sizeof(uint32_t)) &&
+             lodCount > 1 && lodCount <= ONYX_R_MAX_LODS &&
+             4 + lodCount * sizeof(Onyx_GeoLod) <= chunk.size &&
+             readBytes(file, fprim->lods, sizeof(Onyx_GeoLod) * lodCount);
+        if (!ok)
+            break;
+        fprim->lodCount = lodCount;
+        uint64_t total;
+        const uint64_t tailSize = chunk.size - 4 - lodCount * sizeof(Onyx_GeoLod);
+        if (!checkLods(fprim->lods, lodCount, fprim->indexCount, &total) ||
+            (total - fprim->indexCount) * sizeof(Onyx_GeoIndex) > tailSize ||
+            tailSize > fileSize - ftell(file))
+        {
+            ok = false;
+            break;
+        }
+        fprim->indices = onyx_ResizeFileGeoArray(
+            fprim, fprim->indices, fprim->indexCount * sizeof(Onyx_GeoIndex),
+            total * sizeof(Onyx_GeoIndex));
+        const uint64_t indexSize = (total - fprim->indexCount) * sizeof(Onyx_GeoIndex);
+        // the chunk may hold more than this version knows about
+        ok = readBytes(file, fprim->indices + fprim->indexCount, indexSize) &&
+             fseek(file, tailSize - indexSize, SEEK_CUR) == 0;
     }
-    for (int i = 0; i < fprim->attrCount; i++)
+    if (!ok)
+        onyx_FreeFileGeo(fprim);
+    return ok;
+}
+
+int
+onyx_ReadFileGeoInArena(const char* filename, Onyx_FileGeoArena* arena,
+                        Onyx_FileGeo* fprim)
+{
+    memset(fprim, 0, sizeof(*fprim));
+    FILE* file = fopen(filename, "rb");
+    if (!file)
     {
-        fprim->attributes[i] =
-            hell_Malloc(fprim->vertexCount * fprim->attrSizes[i]);
-        r = fread(fprim->attributes[i],
-                  fprim->vertexCount * fprim->attrSizes[i], 1, file);
-        assert(r);
+        DPRINT("Can't open geo file %s\n", filename);
+        return 0;
     }
-    fread(fprim->indices, fprim->indexCount * sizeof(Onyx_GeoIndex), 1, file);
-    assert(r == 1);
-    return 1;
+    char magic[4];
+    int  ok;
+    if (fread(magic, 4, 1, file) == 1 && isFileGeoV2((uint8_t*)magic, 4))
+    {
+        fclose(file);
+        ok = readFileGeoV2(filename, arena, fprim);
+    }
+    else
+    {
+        ok = readFileGeoV1(file, arena, fprim);
+        fclose(file);
+    }
+    if (!ok)
+        DPRINT("Malformed geo file %s\n", filename);
+    return ok;
+}
+
+typedef struct {
+    const char* const* filenames;
+    Onyx_FileRead*     reads;
+    Onyx_FileGeo*      fprims;
+    int*               ok;
+} ReadGeosContext;
+
+static void
+decodeGeoFileTask(void* data, uint32_t task, uint32_t thread)
+{
+    ReadGeosContext*     ctx  = data;
+    const Onyx_FileRead* read = &ctx->reads[task];
+    if (!read->ok)
+        ctx->ok[task] = 0;
+    else
+        // the files already decode in parallel, so each one uses one thread
+        ctx->ok[task] = readFileGeoFromMemory(read->dst, read->bytesRead, NULL,
+                                              1, &ctx->fprims[task]);
+    if (!ctx->ok[task])
+        DPRINT("Can't read geo file %s\n", ctx->filenames[task]);
+}
+
+bool
+onyx_ReadFileGeos(uint32_t count, const char* const filenames[],
+                  uint32_t threadCount, Onyx_FileGeo fprims[])
+{
+    Onyx_FileRead* reads = hell_Malloc((count + 1) * sizeof(Onyx_FileRead));
+    for (uint32_t i = 0; i < count; i++)
+        reads[i] = (Onyx_FileRead){.filename = filenames[i],
+                                   .size     = ONYX_READ_TO_END};
+    onyx_ReadFiles(count, reads);
+    ReadGeosContext ctx = {
+        .filenames = filenames,
+        .reads     = reads,
+        .fprims    = fprims,
+        .ok        = hell_Malloc((count + 1) * sizeof(int)),
+    };
+    memset(fprims, 0, count * sizeof(Onyx_FileGeo));
+    onyx_ParallelFor(threadCount, count, decodeGeoFileTask, &ctx);
+    bool ok = true;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ok = ok && ctx.ok[i];
+        hell_Free(reads[i].dst);
+    }
+    if (!ok)
+        for (uint32_t i = 0; i < count; i++)
+            if (ctx.ok[i])
+                onyx_FreeFileGeo(&fprims[i]);
+    hell_Free(ctx.ok);
+    hell_Free(reads);
+    return ok;
+}
+
+// Streaming loads read the file with stdio instead of mapping it, so they
+// only need the offsets of the sections.
+typedef struct {
+    uint64_t offset;
+    uint64_t size;
+    // version 2 only
+    uint32_t crc;
+    bool     checkCrc;
+} FileRange;
+
+typedef struct {
+    uint32_t       attrCount;
+    uint32_t       vertexCount;
+    uint32_t       indexCount;
+    uint8_t        attrSizes[ONYX_R_MAX_VERT_ATTRIBUTES];
+    char           attrNames[ONYX_R_MAX_VERT_ATTRIBUTES][ONYX_R_ATTR_NAME_LEN];
+    FileRange      attributes[ONYX_R_MAX_VERT_ATTRIBUTES];
+    // every level in version 2, level 0 in version 1
+    FileRange      indices;
+    // version 1 only
+    FileRange      lodIndices;
+    uint32_t       lodCount;
+    Onyx_GeoLod    lods[ONYX_R_MAX_LODS];
+    Onyx_GeoBounds bounds;
+    bool           boundsValid;
+} StreamLayout;
+
+static bool
+seekFile(FILE* file, uint64_t offset)
+{
+#if WIN32
+    return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, offset, SEEK_SET) == 0;
+#endif
+}
+
+static bool
+readAt(FILE* file, uint64_t offset, void* dst, size_t size)
+{
+    return seekFile(file, offset) && (size == 0 || fread(dst, size, 1, file) == 1);
+}
+
+// takes size bytes at *pos, false if they run past the end of the file
+static bool
+takeRange(uint64_t* pos, uint64_t size, uint64_t fileSize, FileRange* range)
+{
+    if (size > fileSize - *pos)
+        return false;
+    *range = (FileRange){.offset = *pos, .size = size};
+    *pos += size;
+    return true;
+}
+
+static bool
+readStreamLayoutV1(FILE* file, uint64_t fileSize, StreamLayout* l)
+{
+    uint32_t header[4];
+    if (fileSize < sizeof(header) || !readAt(file, 0, header, sizeof(header)))
+        return false;
+    l->attrCount   = header[0];
+    l->vertexCount = header[1];
+    l->indexCount  = header[2];
+    if (l->attrCount > ONYX_R_MAX_VERT_ATTRIBUTES)
+        return false;
+    uint64_t pos = sizeof(header) + l->attrCount * (1 + ONYX_R_ATTR_NAME_LEN);
+    if (pos > fileSize || !readBytes(file, l->attrSizes, l->attrCount) ||
+        !readBytes(file, l->attrNames, l->attrCount * ONYX_R_ATTR_NAME_LEN))
+        return false;
+    for (uint32_t i = 0; i < l->attrCount; i++)
+        if (!takeRange(&pos, (uint64_t)l->vertexCount * l->attrSizes[i],
+                       fileSize, &l->attributes[i]))
+            return false;
+    if (!takeRange(&pos, (uint64_t)l->indexCount * sizeof(Onyx_GeoIndex),
+                   fileSize, &l->indices))
+        return false;
+    ChunkHeader chunk;
+    while (fileSize - pos >= sizeof(chunk))
+    {
+        if (!readAt(file, pos, &chunk, sizeof(chunk)))
+            return false;
+        const uint64_t body = pos + sizeof(chunk);
+        if (chunk.size > fileSize - body)
+            return false;
+        pos = body + chunk.size;
+        if (memcmp(chunk.tag, BNDS_TAG, 4) == 0 &&
+            chunk.size == sizeof(Onyx_GeoBounds))
+        {
+            if (!readAt(file, body, &l->bounds, sizeof(l->bounds)))
+                return false;
+            l->boundsValid = true;
+        }
+        else if (memcmp(chunk.tag, LODS_TAG, 4) == 0 && chunk.size >= 4)
+        {
+            if (!readAt(file, body, &l->lodCount, 4) || l->lodCount < 2 ||
+                l->lodCount > ONYX_R_MAX_LODS)
+                return false;
+            const size_t tableSize = l->lodCount * sizeof(Onyx_GeoLod);
+            if (4 + tableSize > chunk.size ||
+                fread(l->lods, tableSize, 1, file) != 1)
+                return false;
+            uint64_t total;
+            uint64_t tail = body + 4 + tableSize;
+            if (!checkLods(l->lods, l->lodCount, l->indexCount, &total) ||
+                !takeRange(&tail, (total - l->indexCount) * sizeof(Onyx_GeoIndex),
+                           pos, &l->lodIndices))
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool
+readStreamLayoutV2(FILE* file, uint64_t fileSize, StreamLayout* l)
+{
+    GeoHeaderV2  header;
+    GeoSectionV2 table[MAX_SECTIONS];
+    if (fileSize < sizeof(header) || !readAt(file, 0, &header, sizeof(header)) ||
+        !isValidHeaderV2(&header))
+        return false;
+    const size_t tableSize = header.sectionCount * sizeof(GeoSectionV2);
+    if (tableSize > fileSize - sizeof(header) ||
+        (tableSize && fread(table, tableSize, 1, file) != 1) ||
+        !checkTableCrcV2(header, table))
+        return false;
+    l->attrCount       = header.attrCount;
+    l->vertexCount     = header.vertexCount;
+    l->indexCount      = header.indexCount;
+    l->lodCount        = header.lodCount;
+    uint32_t attrIndex = 0;
+    bool     hasIndices = false, hasLods = false;
+    for (uint32_t i = 0; i < header.sectionCount; i++)
+    {
+        const GeoSectionV2* s = &table[i];
+        if (s->offset > fileSize || s->size > fileSize - s->offset)
+            return false;
+        const FileRange range = {
+            .offset = s->offset, .size = s->size, .crc = s->crc, .checkCrc = true};
+        if (memcmp(s->tag, ATTR_TAG, 4) == 0)
+        {
+            if (s->codec != ONYX_GEO_CODEC_NONE)
+            {
+                DPRINT("Coded geo sections can't be streamed\n");
+                return false;
+            }
+            if (attrIndex == l->attrCount ||
+                s->size != (uint64_t)l->vertexCount * s->elemSize)
+                return false;
+            l->attrSizes[attrIndex] = s->elemSize;
+            memcpy(l->attrNames[attrIndex], s->name, ONYX_R_ATTR_NAME_LEN);
+            l->attributes[attrIndex++] = range;
+        }
+        else if (memcmp(s->tag, INDX_TAG, 4) == 0)
+        {
+            if (s->codec != ONYX_GEO_CODEC_NONE)
+            {
+                DPRINT("Coded geo sections can't be streamed\n");
+                return false;
+            }
+            l->indices = range;
+            hasIndices = true;
+        }
+        else if (memcmp(s->tag, LODS_TAG, 4) == 0)
+        {
+            if (s->size != l->lodCount * sizeof(Onyx_GeoLod) ||
+                !readAt(file, s->offset, l->lods, s->size) ||
+                onyx_Crc32c(0, l->lods, s->size) != s->crc)
+                return false;
+            hasLods = true;
+        }
+        else if (memcmp(s->tag, BNDS_TAG, 4) == 0)
+        {
+            if (s->size != sizeof(Onyx_GeoBounds) ||
+                !readAt(file, s->offset, &l->bounds, s->size) ||
+                onyx_Crc32c(0, &l->bounds, s->size) != s->crc)
+                return false;
+            l->boundsValid = true;
+        }
+    }
+    if (attrIndex != l->attrCount || !hasIndices || (l->lodCount && !hasLods))
+        return false;
+    uint64_t totalIndexCount;
+    return checkLods(l->lods, l->lodCount, l->indexCount, &totalIndexCount) &&
+           l->indices.size == totalIndexCount * sizeof(Onyx_GeoIndex);
+}
+
+#define DEFAULT_STREAM_CHUNK_SIZE (1 << 20)
+#define DEFAULT_STREAM_CHUNK_COUNT 3
+#define MAX_STREAM_CHUNKS 8
+
+// a ring of staging slots. a slot is reused once the transfer queue is done
+// copying out of it, so reading the next chunk overlaps the earlier copies.
+typedef struct {
+    const Onyx_Instance* instance;
+    FILE*                file;
+    size_t               chunkSize;
+    uint32_t             chunkCount;
+    uint32_t             next;
+    Onyx_BufferRegion    staging[MAX_STREAM_CHUNKS];
+    Onyx_Command         cmds[MAX_STREAM_CHUNKS];
+    bool                 pending[MAX_STREAM_CHUNKS];
+    // staging memory is usually write combined and slow to read, so chunks
+    // are read here first to check their CRC
+    uint8_t*             bounce;
+} Stream;
+
+static void
+waitForChunk(Stream* s, uint32_t chunk)
+{
+    if (s->pending[chunk])
+        onyx_WaitForFence(onyx_GetDevice(s->instance), &s->cmds[chunk].fence);
+    s->pending[chunk] = false;
+}
+
+// queues copies of the range to dst in chunks, false if the file can't be
+// read or the range fails its CRC
+static bool
+streamRange(Stream* s, const FileRange* range, const Onyx_BufferRegion* dst,
+            VkDeviceSize dstOffset)
+{
+    if (!seekFile(s->file, range->offset))
+        return false;
+    uint32_t crc = 0;
+    for (uint64_t done = 0; done < range->size;)
+    {
+        const size_t size = range->size - done < s->chunkSize
+                                ? range->size - done
+                                : s->chunkSize;
+        const uint32_t chunk = s->next;
+        s->next              = (s->next + 1) % s->chunkCount;
+        if (fread(s->bounce, size, 1, s->file) != 1)
+            return false;
+        if (range->checkCrc)
+            crc = onyx_Crc32c(crc, s->bounce, size);
+        waitForChunk(s, chunk);
+        const Onyx_BufferRegion* staging = &s->staging[chunk];
+        memcpy(staging->hostData, s->bounce, size);
+
+        Onyx_Command* cmd = &s->cmds[chunk];
+        onyx_ResetCommand(cmd);
+        onyx_BeginCommandBufferOneTimeSubmit(cmd->buffer);
+        const VkBufferCopy copy = {
+            .srcOffset = staging->offset,
+            .dstOffset = dst->offset + dstOffset + done,
+            .size      = size,
+        };
+        vkCmdCopyBuffer(cmd->buffer, staging->buffer, dst->buffer, 1, &copy);
+        onyx_EndCommandBuffer(cmd->buffer);
+        const VkSubmitInfo si = {
+            .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers    = &cmd->buffer,
+        };
+        onyx_QueueSubmit(onyx_GetTransferQueue(s->instance, 0), 1, &si,
+                         cmd->fence);
+        s->pending[chunk] = true;
+        done += size;
+    }
+    return !range->checkCrc || crc == range->crc;
+}
+
+static void
+recordOwnershipBarrier(VkCommandBuffer cmdBuf, const Onyx_BufferRegion* regions,
+                       uint32_t regionCount, VkPipelineStageFlags srcStage,
+                       VkPipelineStageFlags dstStage, VkAccessFlags srcAccess,
+                       VkAccessFlags dstAccess, uint32_t srcFamily,
+                       uint32_t dstFamily)
+{
+    VkBufferMemoryBarrier barriers[2];
+    assert(regionCount <= 2);
+    for (uint32_t i = 0; i < regionCount; i++)
+        barriers[i] = (VkBufferMemoryBarrier){
+            .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask       = srcAccess,
+            .dstAccessMask       = dstAccess,
+            .srcQueueFamilyIndex = srcFamily,
+            .dstQueueFamilyIndex = dstFamily,
+            .buffer              = regions[i].buffer,
+            .offset              = regions[i].offset,
+            .size                = regions[i].size,
+        };
+    vkCmdPipelineBarrier(cmdBuf, srcStage, dstStage, 0, 0, NULL, regionCount,
+                         barriers, 0, NULL);
+}
+
+// Device buffers are exclusive to the graphics queue family. When the copies
+// ran on a separate transfer family the transfer queue releases the regions
+// and the graphics queue acquires them, otherwise one barrier makes the copies
+// visible to vertex input and vertex pulling.
+static void
+handOverToGraphics(const Onyx_Instance* instance,
+                   const Onyx_BufferRegion* regions, uint32_t regionCount)
+{
+    const uint32_t transferFamily =
+        onyx_GetQueueFamilyIndex(instance, ONYX_V_QUEUE_TRANSFER_TYPE);
+    const uint32_t graphicsFamily =
+        onyx_GetQueueFamilyIndex(instance, ONYX_V_QUEUE_GRAPHICS_TYPE);
+    const VkPipelineStageFlags useStages =
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+    const VkAccessFlags useAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+                                    VK_ACCESS_INDEX_READ_BIT |
+                                    VK_ACCESS_SHADER_READ_BIT;
+
+    Onyx_Command release = onyx_CreateCommand(instance, ONYX_V_QUEUE_TRANSFER_TYPE);
+    // created signaled
+    onyx_WaitForFence(onyx_GetDevice(instance), &release.fence);
+    onyx_BeginCommandBufferOneTimeSubmit(release.buffer);
+    if (transferFamily == graphicsFamily)
+        recordOwnershipBarrier(release.buffer, regions, regionCount,
+                               VK_PIPELINE_STAGE_TRANSFER_BIT, useStages,
+                               VK_ACCESS_TRANSFER_WRITE_BIT, useAccess,
+                               VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
+    else
+        recordOwnershipBarrier(release.buffer, regions, regionCount,
+                               VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                               VK_ACCESS_TRANSFER_WRITE_BIT, 0, transferFamily,
+                               graphicsFamily);
+    onyx_EndCommandBuffer(release.buffer);
+    if (transferFamily == graphicsFamily)
+    {
+        const VkSubmitInfo si = {
+            .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers    = &release.buffer,
+        };
+        onyx_QueueSubmit(onyx_GetTransferQueue(instance, 0), 1, &si,
+                         release.fence);
+        onyx_WaitForFence(onyx_GetDevice(instance), &release.fence);
+        onyx_DestroyCommand(release);
+        return;
+    }
+    onyx_SubmitTransferCommand(instance, 0, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               NULL, VK_NULL_HANDLE, &release);
+
+    Onyx_Command acquire = onyx_CreateCommand(instance, ONYX_V_QUEUE_GRAPHICS_TYPE);
+    onyx_WaitForFence(onyx_GetDevice(instance), &acquire.fence);
+    onyx_BeginCommandBufferOneTimeSubmit(acquire.buffer);
+    recordOwnershipBarrier(acquire.buffer, regions, regionCount,
+                           VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, useStages, 0,
+                           useAccess, transferFamily, graphicsFamily);
+    onyx_EndCommandBuffer(acquire.buffer);
+    onyx_SubmitGraphicsCommand(instance, 0, useStages, 1, &release.semaphore, 0,
+                               NULL, acquire.fence, acquire.buffer);
+    onyx_WaitForFence(onyx_GetDevice(instance), &acquire.fence);
+    onyx_DestroyCommand(acquire);
+    onyx_DestroyCommand(release);
+}
+
+bool
+onyx_StreamGeo(Onyx_Memory* memory, const char* filename,
+               const Onyx_LoadGeoParms* parms, Onyx_Geometry* geo)
+{
+    memset(geo, 0, sizeof(*geo));
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+        return false;
+    StreamLayout l        = {0};
+    char         magic[4] = {0};
+    bool         ok       = fread(magic, 4, 1, file) == 1 &&
+                  fseek(file, 0, SEEK_END) == 0;
+#if WIN32
+    const uint64_t fileSize = ok ? _ftelli64(file) : 0;
+#else
+    const uint64_t fileSize = ok ? ftello(file) : 0;
+#endif
+    if (ok && isFileGeoV2((uint8_t*)magic, 4))
+        ok = readStreamLayoutV2(file, fileSize, &l);
+    else if (ok)
+        ok = readStreamLayoutV1(file, fileSize, &l);
+    // without vertex data there is no vertex buffer to stream into
+    if (!ok || l.attrCount == 0 || l.vertexCount == 0)
+    {
+        fclose(file);
+        return false;
+    }
+
+    const Onyx_Instance* instance = onyx_GetMemoryInstance(memory);
+    geo->attrCount   = l.attrCount;
+    geo->vertexCount = l.vertexCount;
+    geo->indexCount  = l.indexCount;
+    geo->lodCount    = l.lodCount;
+    memcpy(geo->lods, l.lods, sizeof(geo->lods));
+    geo->bounds      = l.bounds;
+    geo->boundsValid = l.boundsValid;
+    VkDeviceSize vertexSize = 0;
+    for (uint32_t i = 0; i < l.attrCount; i++)
+    {
+        geo->attrSizes[i]   = l.attrSizes[i];
+        geo->attrOffsets[i] = vertexSize;
+        memcpy(geo->attrNames[i], l.attrNames[i], ONYX_R_ATTR_NAME_LEN);
+        vertexSize += l.attributes[i].size;
+    }
+    onyx_UpdateGeoSemantics(geo);
+    const uint32_t totalIndexCount =
+        onyx_GetTotalIndexCount(l.indexCount, l.lodCount, l.lods);
+    Onyx_BufferRegion regions[2];
+    uint32_t          regionCount = 1;
+    geo->vertexRegion             = onyx_RequestBufferRegion(
+        memory, vertexSize,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | parms->extraBufferUsageFlags,
+        ONYX_MEMORY_DEVICE_TYPE);
+    regions[0] = geo->vertexRegion;
+    if (totalIndexCount > 0)
+    {
+        geo->indexRegion = onyx_RequestBufferRegion(
+            memory, (size_t)totalIndexCount * sizeof(Onyx_GeoIndex),
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | parms->extraBufferUsageFlags,
+            ONYX_MEMORY_DEVICE_TYPE);
+        regions[regionCount++] = geo->indexRegion;
+    }
+
+    Stream s = {
+        .instance   = instance,
+        .file       = file,
+        .chunkSize  = parms->streamChunkSize ? parms->streamChunkSize
+                                             : DEFAULT_STREAM_CHUNK_SIZE,
+        .chunkCount = parms->streamChunkCount
+                          ? MIN(parms->streamChunkCount, MAX_STREAM_CHUNKS)
+                          : DEFAULT_STREAM_CHUNK_COUNT,
+    };
+    assert(s.chunkSize % 4 == 0);
+    s.bounce = hell_Malloc(s.chunkSize);
+    for (uint32_t i = 0; i < s.chunkCount; i++)
+    {
+        s.staging[i] = onyx_RequestBufferRegion(memory, s.chunkSize, 0,
+                                                ONYX_MEMORY_HOST_TRANSFER_TYPE);
+        s.cmds[i] = onyx_CreateCommand(instance, ONYX_V_QUEUE_TRANSFER_TYPE);
+        // created signaled
+        onyx_WaitForFence(onyx_GetDevice(instance), &s.cmds[i].fence);
+    }
+
+    for (uint32_t i = 0; i < l.attrCount && ok; i++)
+        ok = streamRange(&s, &l.attributes[i], &geo->vertexRegion,
+                         geo->attrOffsets[i]);
+    if (ok && totalIndexCount > 0)
+        ok = streamRange(&s, &l.indices, &geo->indexRegion, 0);
+    if (ok && l.lodIndices.size)
+        ok = streamRange(&s, &l.lodIndices, &geo->indexRegion,
+                         l.indices.size);
+
+    for (uint32_t i = 0; i < s.chunkCount; i++)
+    {
+        waitForChunk(&s, i);
+        onyx_DestroyCommand(s.cmds[i]);
+        onyx_FreeBufferRegion(&s.staging[i]);
+    }
+    hell_Free(s.bounce);
+    fclose(file);
+    if (!ok)
+    {
+        DPRINT("Failed to stream geo file %s\n", filename);
+        onyx_FreeGeo(geo);
+        return false;
+    }
+    handOverToGraphics(instance, regions, regionCount);
+    return true;
 }
 
 Onyx_Geometry
-onyx_LoadGeo(Onyx_Memory* memory, VkBufferUsageFlags extraBufferUsageFlags, const char* filename,
-                 const bool transferToDevice)
+onyx_LoadGeoEx(Onyx_Memory* memory, const char* filename,
+               const Onyx_LoadGeoParms* parms)
 {
+    if (parms->flags & ONYX_LOAD_GEO_STREAM_BIT)
+    {
+        assert(parms->transferToDevice && !(parms->flags & ONYX_LOAD_GEO_WELD_BIT));
+        Onyx_Geometry geo;
+        if (onyx_StreamGeo(memory, filename, parms, &geo))
+            return geo;
+        // coded files need decoding on the host
+    }
     Onyx_FileGeo fprim;
     int              r;
-    r = onyx_ReadFileGeo(filename, &fprim);
+    // welding modifies the arrays so it needs its own copy. otherwise the
+    // data goes straight from the mapping into the geo's buffers.
+    if (onyx_GetGeoImportFormat(filename) != ONYX_GEO_IMPORT_FORMAT_NONE)
+        r = onyx_ImportFileGeo(filename, parms->threadCount, &fprim);
+    else if (parms->flags & ONYX_LOAD_GEO_WELD_BIT)
+        r = onyx_ReadFileGeo(filename, &fprim);
+    else
+        r = onyx_MapFileGeo(filename, &fprim);
     assert(r);
-    Onyx_Geometry rprim = onyx_CreateGeoFromFileGeo(memory, extraBufferUsageFlags, &fprim);
+    if (parms->flags & ONYX_LOAD_GEO_WELD_BIT)
+        onyx_WeldFileGeo(&fprim, parms->weldEpsilon, parms->threadCount);
+    Onyx_Geometry rprim = onyx_CreateGeoFromFileGeo(memory, parms->extraBufferUsageFlags, &fprim);
     onyx_FreeFileGeo(&fprim);
-    if (transferToDevice)
+    if (parms->transferToDevice)
     {
         onyx_TransferGeoToDevice(memory, &rprim);
     }
     return rprim;
 }
 
+Onyx_Geometry
+onyx_LoadGeo(Onyx_Memory* memory, VkBufferUsageFlags extraBufferUsageFlags, const char* filename,
+                 const bool transferToDevice)
+{
+    Onyx_LoadGeoParms parms = {
+        .extraBufferUsageFlags = extraBufferUsageFlags,
+        .transferToDevice      = transferToDevice,
+    };
+    return onyx_LoadGeoEx(memory, filename, &parms);
+}
+
 void
 onyx_FreeFileGeo(Onyx_FileGeo* fprim)
 {
-    for (int i = 0; i < fprim->attrCount; i++)
+    if (fprim->mapData)
     {
-        hell_Free(fprim->attributes[i]);
-        hell_Free(fprim->attrNames[i]);
+        unmapFile(fprim->mapData, fprim->mapSize);
+        hell_Free(fprim->mapScratch);
+        memset(fprim, 0, sizeof(Onyx_FileGeo));
+        return;
     }
-    hell_Free(fprim->attributes);
-    hell_Free(fprim->indices);
-    hell_Free(fprim->attrNames);
-    hell_Free(fprim->attrSizes);
+    // only arrays that were resized live outside the block
+    for (int i = 0; i < fprim->attrCount; i++)
+        if (!isInBlock(fprim, fprim->attributes[i]))
+            hell_Free(fprim->attributes[i]);
+    if (!isInBlock(fprim, fprim->indices))
+        hell_Free(fprim->indices);
+    if (fprim->ownsBlock)
+        hell_Free(fprim->block);
     memset(fprim, 0, sizeof(Onyx_FileGeo));
 }
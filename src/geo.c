@@ -1,9 +1,11 @@
 #define COAL_SIMPLE_TYPE_NAMES
 #include "geo.h"
 #include "attribute.h"
+#include "command.h"
+#include "geoarena.h"
 #include "dtags.h"
 #include "memory.h"
-#include "mikktspace.h"
+#include "meshproc.h"
 #include "private.h"
 #include "render.h"
 #include <hell/common.h>
@@ -22,84 +24,16 @@ typedef enum {
 } Onyx_R_AttributeType;
 
 static const char* g_attr_names[] = {POS_NAME, NORMAL_NAME, UV_NAME, UVW_NAME, TANGENT_NAME, SIGN_NAME, BITANGENT_NAME};
+static const OnyxAttributeTypes g_attr_types[] = {
+    ONYX_ATTRIBUTE_TYPE_POS,     ONYX_ATTRIBUTE_TYPE_NORMAL,
+    ONYX_ATTRIBUTE_TYPE_UV,      ONYX_ATTRIBUTE_TYPE_UVW,
+    ONYX_ATTRIBUTE_TYPE_TANGENT, ONYX_ATTRIBUTE_TYPE_SIGN,
+    ONYX_ATTRIBUTE_TYPE_BITANGENT};
 
 typedef OnyxGeometry Geometry;
 
 #define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_GEO, fmt, ##__VA_ARGS__)
 
-// mikkt callbacks
-static int
-mikkt_GetNumFaces(const SMikkTSpaceContext* ctx)
-{
-    const Onyx_Geometry* geo = ctx->m_pUserData;
-    return geo->indexCount / 3;
-}
-
-static int
-mikkt_GetNumVerticesOfFace(const SMikkTSpaceContext* ctx, const int iFace)
-{
-    return 3;
-}
-
-static void
-mikkt_GetPosition(const SMikkTSpaceContext* ctx, float fvPosOut[],
-                  const int iFace, const int iVert)
-{
-    const Onyx_Geometry* geo = ctx->m_pUserData;
-    int         index   = iFace * 3 + iVert;
-    int  v = ((int*)geo->indexRegion.hostData)[index];
-
-    Vec3* arr   = onyx_GetGeoAttribute2(geo, POS_NAME);
-    fvPosOut[0] = arr[v].x;
-    fvPosOut[1] = arr[v].y;
-    fvPosOut[2] = arr[v].z;
-}
-
-static void
-mikkt_GetNormal(const SMikkTSpaceContext* pContext, float fvNormOut[],
-                const int iFace, const int iVert)
-{
-    const Onyx_Geometry* geo = pContext->m_pUserData;
-    int         index   = iFace * 3 + iVert;
-    int  v = ((int*)geo->indexRegion.hostData)[index];
-
-    Vec3* arr    = onyx_GetGeoAttribute2(geo, NORMAL_NAME);
-    fvNormOut[0] = arr[v].x;
-    fvNormOut[1] = arr[v].y;
-    fvNormOut[2] = arr[v].z;
-}
-
-static void
-mikkt_GetTexCoord(const SMikkTSpaceContext* pContext, float fvTexcOut[],
-                  const int iFace, const int iVert)
-{
-    const Onyx_Geometry* geo = pContext->m_pUserData;
-    int         index   = iFace * 3 + iVert;
-    int  v = ((int*)geo->indexRegion.hostData)[index];
-
-    Vec2* arr    = onyx_GetGeoAttribute2(geo, UV_NAME);
-    fvTexcOut[0] = arr[v].x;
-    fvTexcOut[1] = arr[v].y;
-}
-
-static void
-mikkt_SetTSpaceBasic(const SMikkTSpaceContext* pContext,
-                     const float fvTangent[], const float fSign,
-                     const int iFace, const int iVert)
-{
-    Onyx_Geometry* geo = pContext->m_pUserData;
-    int         index   = iFace * 3 + iVert;
-    int  v = ((int*)geo->indexRegion.hostData)[index];
-
-    Vec3* tangents = onyx_GetGeoAttribute2(geo, TANGENT_NAME);
-    float* signs  = onyx_GetGeoAttribute2(geo, SIGN_NAME);
-
-    tangents[v].x = fvTangent[0];
-    tangents[v].y = fvTangent[1];
-    tangents[v].z = fvTangent[2];
-    signs[v] = fSign;
-}
-
 static void
 initPrimBuffers(Onyx_Memory* memory, VkBufferUsageFlags extraFlags,
                 Onyx_Geometry* prim)
@@ -130,6 +64,9 @@ initPrimBuffers(Onyx_Memory* memory, VkBufferUsageFlags extraFlags,
             VK_BUFFER_USAGE_INDEX_BUFFER_BIT | extraFlags,
             ONYX_MEMORY_HOST_GRAPHICS_TYPE);
     }
+
+    // for geos named in their initializer
+    onyx_UpdateGeoSemantics(prim);
 }
 
 static void
@@ -203,6 +140,9 @@ onyx_PrintGeo(const Onyx_Geometry* prim)
 void
 onyx_TransferGeoToDevice(Onyx_Memory* memory, Onyx_Geometry* prim)
 {
+    // the arena's buffers are shared with other geos
+    assert(!prim->arena);
+    assert(!prim->deviceVertexRegion.buffer);
     onyx_TransferToDevice(memory, &prim->vertexRegion);
     if (prim->indexCount > 0)
     {
@@ -210,6 +150,212 @@ onyx_TransferGeoToDevice(Onyx_Memory* memory, Onyx_Geometry* prim)
     }
 }
 
+// every region takes a block of the device chain either way, the cap only
+// bounds how much one command buffer records
+#define TRANSFER_BATCH_MAX_GEOS 256
+
+void
+onyx_TransferGeosToDevice(Onyx_Memory* memory, uint32_t count,
+                          Onyx_Geometry* const geos[/*count*/])
+{
+    for (uint32_t first = 0; first < count; first += TRANSFER_BATCH_MAX_GEOS)
+    {
+        const uint32_t batchCount = count - first < TRANSFER_BATCH_MAX_GEOS
+                                        ? count - first
+                                        : TRANSFER_BATCH_MAX_GEOS;
+        Onyx_BufferRegion hostRegions[TRANSFER_BATCH_MAX_GEOS * 2];
+        uint32_t          regionCount = 0;
+
+        Onyx_Command cmd = onyx_CreateCommand(memory->instance,
+                                              ONYX_V_QUEUE_GRAPHICS_TYPE);
+        onyx_BeginCommandBuffer(cmd.buffer);
+        for (uint32_t i = first; i < first + batchCount; i++)
+        {
+            Onyx_Geometry* prim = geos[i];
+            assert(!prim->arena);
+            assert(!prim->deviceVertexRegion.buffer);
+            Onyx_BufferRegion* regions[2] = {&prim->vertexRegion,
+                                             prim->indexCount > 0 ? &prim->indexRegion
+                                                                  : NULL};
+            for (int r = 0; r < 2; r++)
+            {
+                if (!regions[r])
+                    continue;
+                const Onyx_BufferRegion src = *regions[r];
+                assert(src.pChain == &memory->blockChainHostGraphicsBuffer);
+                Onyx_BufferRegion dst = onyx_RequestBufferRegion(
+                    memory, src.size, 0, ONYX_MEMORY_DEVICE_TYPE);
+                const VkBufferCopy copy = {
+                    .srcOffset = src.offset,
+                    .dstOffset = dst.offset,
+                    .size      = src.size,
+                };
+                vkCmdCopyBuffer(cmd.buffer, src.buffer, dst.buffer, 1, &copy);
+                hostRegions[regionCount++] = src;
+                *regions[r]                = dst;
+            }
+        }
+        onyx_EndCommandBuffer(cmd.buffer);
+        onyx_SubmitAndWait(&cmd, 0);
+        onyx_DestroyCommand(cmd);
+        for (uint32_t r = 0; r < regionCount; r++)
+            onyx_FreeBufferRegion(&hostRegions[r]);
+    }
+}
+
+static void
+freeDeviceMirror(Onyx_Geometry* prim)
+{
+    if (prim->deviceVertexRegion.buffer)
+        onyx_FreeBufferRegion(&prim->deviceVertexRegion);
+    if (prim->deviceIndexRegion.buffer)
+        onyx_FreeBufferRegion(&prim->deviceIndexRegion);
+    memset(&prim->deviceVertexRegion, 0, sizeof(prim->deviceVertexRegion));
+    memset(&prim->deviceIndexRegion, 0, sizeof(prim->deviceIndexRegion));
+}
+
+void
+onyx_CreateGeoDeviceMirror(Onyx_Memory* memory, Onyx_Geometry* prim)
+{
+    assert(!prim->arena);
+    assert(prim->vertexRegion.hostData);
+    freeDeviceMirror(prim);
+    prim->deviceVertexRegion = onyx_RequestBufferRegion(
+        memory, prim->vertexRegion.size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        ONYX_MEMORY_DEVICE_TYPE);
+    onyx_CopyBufferRegion(&prim->vertexRegion, &prim->deviceVertexRegion);
+    if (prim->indexCount > 0)
+    {
+        prim->deviceIndexRegion = onyx_RequestBufferRegion(
+            memory, prim->indexRegion.size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            ONYX_MEMORY_DEVICE_TYPE);
+        onyx_CopyBufferRegion(&prim->indexRegion, &prim->deviceIndexRegion);
+    }
+    memset(prim->attrDirty, 0, sizeof(prim->attrDirty));
+    memset(&prim->indexDirty, 0, sizeof(prim->indexDirty));
+}
+
+static void
+growDirtyRange(Onyx_GeoDirtyRange* r, VkDeviceSize begin, VkDeviceSize end)
+{
+    if (end <= begin)
+        return;
+    if (r->end <= r->begin)
+    {
+        r->begin = begin;
+        r->end   = end;
+        return;
+    }
+    r->begin = begin < r->begin ? begin : r->begin;
+    r->end   = end > r->end ? end : r->end;
+}
+
+void
+onyx_MarkGeoAttributeDirty(Onyx_Geometry* prim, uint32_t attrIndex,
+                           uint32_t firstVertex, uint32_t vertexCount)
+{
+    assert(attrIndex < prim->attrCount);
+    assert(firstVertex + vertexCount <= prim->vertexCount);
+    const VkDeviceSize size = prim->attrSizes[attrIndex];
+    growDirtyRange(&prim->attrDirty[attrIndex], firstVertex * size,
+                   (VkDeviceSize)(firstVertex + vertexCount) * size);
+}
+
+void
+onyx_MarkGeoIndicesDirty(Onyx_Geometry* prim, uint32_t firstIndex,
+                         uint32_t indexCount)
+{
+    growDirtyRange(&prim->indexDirty, firstIndex * sizeof(Onyx_GeoIndex),
+                   (VkDeviceSize)(firstIndex + indexCount) *
+                       sizeof(Onyx_GeoIndex));
+}
+
+void
+onyx_MarkGeoDirty(Onyx_Geometry* prim)
+{
+    for (uint32_t i = 0; i < prim->attrCount; i++)
+        onyx_MarkGeoAttributeDirty(prim, i, 0, prim->vertexCount);
+    onyx_MarkGeoIndicesDirty(
+        prim, 0,
+        onyx_GetTotalIndexCount(prim->indexCount, prim->lodCount, prim->lods));
+}
+
+// appends a copy, merging it into the previous one if they are contiguous
+static void
+addCopy(VkBufferCopy* copies, uint32_t* count, VkDeviceSize src,
+        VkDeviceSize dst, VkDeviceSize size)
+{
+    if (*count > 0)
+    {
+        VkBufferCopy* last = &copies[*count - 1];
+        if (last->srcOffset + last->size == src &&
+            last->dstOffset + last->size == dst)
+        {
+            last->size += size;
+            return;
+        }
+    }
+    copies[(*count)++] = (VkBufferCopy){
+        .srcOffset = src, .dstOffset = dst, .size = size};
+}
+
+VkDeviceSize
+onyx_CmdUploadGeoDirtyRanges(VkCommandBuffer cmdBuf, Onyx_Geometry* prim)
+{
+    assert(prim->deviceVertexRegion.buffer &&
+           "the geo needs a device mirror, see onyx_CreateGeoDeviceMirror");
+    VkBufferCopy vertexCopies[ONYX_R_MAX_VERT_ATTRIBUTES];
+    uint32_t     vertexCopyCount = 0;
+    VkDeviceSize bytes           = 0;
+    for (uint32_t i = 0; i < prim->attrCount; i++)
+    {
+        const Onyx_GeoDirtyRange* r = &prim->attrDirty[i];
+        if (r->end <= r->begin)
+            continue;
+        const VkDeviceSize offset = prim->attrOffsets[i] + r->begin;
+        assert(prim->attrOffsets[i] + r->end <= prim->deviceVertexRegion.size);
+        addCopy(vertexCopies, &vertexCopyCount,
+                prim->vertexRegion.offset + offset,
+                prim->deviceVertexRegion.offset + offset, r->end - r->begin);
+        bytes += r->end - r->begin;
+    }
+    const Onyx_GeoDirtyRange* ir         = &prim->indexDirty;
+    const bool                indexDirty = ir->end > ir->begin;
+    if (indexDirty)
+    {
+        assert(ir->end <= prim->deviceIndexRegion.size);
+        bytes += ir->end - ir->begin;
+    }
+    if (bytes == 0)
+        return 0;
+
+    // draws recorded earlier may still be reading what we overwrite
+    onyx_v_MemoryBarrier(cmdBuf, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, 0);
+    if (vertexCopyCount > 0)
+        vkCmdCopyBuffer(cmdBuf, prim->vertexRegion.buffer,
+                        prim->deviceVertexRegion.buffer, vertexCopyCount,
+                        vertexCopies);
+    if (indexDirty)
+    {
+        const VkBufferCopy copy = {
+            .srcOffset = prim->indexRegion.offset + ir->begin,
+            .dstOffset = prim->deviceIndexRegion.offset + ir->begin,
+            .size      = ir->end - ir->begin};
+        vkCmdCopyBuffer(cmdBuf, prim->indexRegion.buffer,
+                        prim->deviceIndexRegion.buffer, 1, &copy);
+    }
+    onyx_v_MemoryBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+                         VK_ACCESS_TRANSFER_WRITE_BIT,
+                         VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+                             VK_ACCESS_INDEX_READ_BIT);
+
+    memset(prim->attrDirty, 0, sizeof(prim->attrDirty));
+    memset(&prim->indexDirty, 0, sizeof(prim->indexDirty));
+    return bytes;
+}
+
 Onyx_Geometry
 onyx_CreateTriangle(Onyx_Memory* memory)
 {
@@ -261,6 +407,7 @@ onyx_CreateCube(Onyx_Memory* memory, const bool isClockWise)
     {
         memcpy(prim.attrNames[i], attrNames[i], ONYX_R_ATTR_NAME_LEN);
     }
+    onyx_UpdateGeoSemantics(&prim);
 
     Vec3* pPositions = onyx_GetGeoAttribute(&prim, 0);
     Vec3* pNormals   = onyx_GetGeoAttribute(&prim, 1);
@@ -397,6 +544,7 @@ onyx_CreateCubeWithTangents(Onyx_Memory* memory, const bool isClockWise)
     {
         memcpy(geo.attrNames[i], attrNames[i], ONYX_R_ATTR_NAME_LEN);
     }
+    onyx_UpdateGeoSemantics(&geo);
 
     Vec3* pPositions = onyx_GetGeoAttribute(&geo, 0);
     Vec3* pNormals   = onyx_GetGeoAttribute(&geo, 1);
@@ -507,20 +655,8 @@ onyx_CreateCubeWithTangents(Onyx_Memory* memory, const bool isClockWise)
             indices[face * 6 + 5] = 4 * face + 3;
         }
 
-    SMikkTSpaceInterface mikkt_interface = {
-        .m_getNumFaces          = mikkt_GetNumFaces,
-        .m_getNormal            = mikkt_GetNormal,
-        .m_getNumVerticesOfFace = mikkt_GetNumVerticesOfFace,
-        .m_getPosition          = mikkt_GetPosition,
-        .m_getTexCoord          = mikkt_GetTexCoord,
-        .m_setTSpaceBasic       = mikkt_SetTSpaceBasic,
-    };
-
-    SMikkTSpaceContext mikkt_context = {.m_pInterface = &mikkt_interface,
-                                        .m_pUserData  = &geo};
-
     onyx_PrintGeo(&geo);
-    tbool r = genTangSpaceDefault(&mikkt_context);
+    bool r = onyx_GenerateGeoTangents(&geo, 1);
     assert(r);
 
     onyx_PrintGeo(&geo);
@@ -723,6 +859,7 @@ onyx_CreateGeometry2(Onyx_Memory* memory, VkBufferUsageFlags extraBufferFlags,
         assert(found);
         memcpy(g.attrNames[i], attrNames[i], ATTR_NAME_LEN);
     }
+    onyx_UpdateGeoSemantics(&g);
     return g;
 }
 
@@ -871,23 +1008,221 @@ onyx_GetGeoIndices(const Onyx_Geometry* prim)
     return (Onyx_GeoIndex*)prim->indexRegion.hostData;
 }
 
+// the regions to bind. prefers the device mirror if there is one.
+static const Onyx_BufferRegion*
+getBindVertexRegion(const Onyx_Geometry* prim)
+{
+    return prim->deviceVertexRegion.buffer ? &prim->deviceVertexRegion
+                                           : &prim->vertexRegion;
+}
+
+static const Onyx_BufferRegion*
+getBindIndexRegion(const Onyx_Geometry* prim)
+{
+    return prim->deviceIndexRegion.buffer ? &prim->deviceIndexRegion
+                                          : &prim->indexRegion;
+}
+
 void
 onyx_BindGeo(const VkCommandBuffer cmdBuf, const Onyx_Geometry* prim)
 {
     VkBuffer     vertBuffers[ONYX_R_MAX_VERT_ATTRIBUTES];
     VkDeviceSize attrOffsets[ONYX_R_MAX_VERT_ATTRIBUTES];
 
+    const Onyx_BufferRegion* vertexRegion = getBindVertexRegion(prim);
+    const Onyx_BufferRegion* indexRegion  = getBindIndexRegion(prim);
+
     for (int i = 0; i < prim->attrCount; i++)
     {
-        vertBuffers[i] = prim->vertexRegion.buffer;
-        attrOffsets[i] = prim->attrOffsets[i] + prim->vertexRegion.offset;
+        vertBuffers[i] = vertexRegion->buffer;
+        attrOffsets[i] = prim->attrOffsets[i] + vertexRegion->offset;
     }
 
     vkCmdBindVertexBuffers(cmdBuf, 0, prim->attrCount, vertBuffers,
                            attrOffsets);
 
-    vkCmdBindIndexBuffer(cmdBuf, prim->indexRegion.buffer,
-                         prim->indexRegion.offset, ONYX_VERT_INDEX_TYPE);
+    vkCmdBindIndexBuffer(cmdBuf, indexRegion->buffer, indexRegion->offset,
+                         ONYX_VERT_INDEX_TYPE);
+}
+
+void
+onyx_InitGeoBindState(Onyx_GeoBindState* state, VkCommandBuffer cmdBuf)
+{
+    memset(state, 0, sizeof(*state));
+    state->cmdBuf = cmdBuf;
+}
+
+void
+onyx_InvalidateGeoBindState(Onyx_GeoBindState* state)
+{
+    state->vertexBufferCount = 0;
+    state->indexBuffer       = VK_NULL_HANDLE;
+}
+
+// the number of elements the bound offsets have to move forward to reach the
+// geo's data, the same for every attribute. -1 if there is none.
+static int64_t
+vertexShift(const Onyx_GeoBindState* state, const Onyx_Geometry* prim,
+            const VkBuffer* buffers, const VkDeviceSize* offsets)
+{
+    if (state->vertexBufferCount < prim->attrCount)
+        return -1;
+    int64_t shift = -1;
+    for (uint32_t i = 0; i < prim->attrCount; i++)
+    {
+        if (buffers[i] != state->vertexBuffers[i] ||
+            offsets[i] < state->vertexOffsets[i])
+            return -1;
+        const VkDeviceSize delta = offsets[i] - state->vertexOffsets[i];
+        if (delta % prim->attrSizes[i] != 0)
+            return -1;
+        const int64_t s = delta / prim->attrSizes[i];
+        if (shift >= 0 && s != shift)
+            return -1;
+        shift = s;
+    }
+    return shift <= INT32_MAX ? shift : -1;
+}
+
+// returns the first index of the region relative to what ends up bound
+static uint32_t
+bindIndicesCached(Onyx_GeoBindState* state, const Onyx_BufferRegion* region)
+{
+    const VkDeviceSize offset = region->offset;
+    if (region->buffer == state->indexBuffer && offset >= state->indexOffset &&
+        (offset - state->indexOffset) % sizeof(Onyx_GeoIndex) == 0)
+    {
+        state->indexBindSkipCount++;
+        return (offset - state->indexOffset) / sizeof(Onyx_GeoIndex);
+    }
+    vkCmdBindIndexBuffer(state->cmdBuf, region->buffer, offset,
+                         ONYX_VERT_INDEX_TYPE);
+    state->indexBuffer = region->buffer;
+    state->indexOffset = offset;
+    state->indexBindCount++;
+    return 0;
+}
+
+Onyx_GeoDrawOffsets
+onyx_BindGeoCached(Onyx_GeoBindState* state, const Onyx_Geometry* prim)
+{
+    Onyx_GeoDrawOffsets      draw         = {0};
+    const Onyx_BufferRegion* vertexRegion = getBindVertexRegion(prim);
+    const Onyx_BufferRegion* indexRegion  = getBindIndexRegion(prim);
+
+    VkBuffer     buffers[ONYX_R_MAX_VERT_ATTRIBUTES];
+    VkDeviceSize offsets[ONYX_R_MAX_VERT_ATTRIBUTES];
+    for (uint32_t i = 0; i < prim->attrCount; i++)
+    {
+        buffers[i] = vertexRegion->buffer;
+        offsets[i] = prim->attrOffsets[i] + vertexRegion->offset;
+    }
+
+    const int64_t shift = vertexShift(state, prim, buffers, offsets);
+    if (shift >= 0)
+    {
+        draw.vertexOffset = (int32_t)shift;
+        state->vertexBindSkipCount++;
+    }
+    else
+    {
+        // only rebind the span of bindings that changed
+        uint32_t first = 0, last = prim->attrCount;
+        while (first < last && first < state->vertexBufferCount &&
+               buffers[first] == state->vertexBuffers[first] &&
+               offsets[first] == state->vertexOffsets[first])
+            first++;
+        while (last > first && last - 1 < state->vertexBufferCount &&
+               buffers[last - 1] == state->vertexBuffers[last - 1] &&
+               offsets[last - 1] == state->vertexOffsets[last - 1])
+            last--;
+        vkCmdBindVertexBuffers(state->cmdBuf, first, last - first,
+                               buffers + first, offsets + first);
+        memcpy(state->vertexBuffers + first, buffers + first,
+               (last - first) * sizeof(VkBuffer));
+        memcpy(state->vertexOffsets + first, offsets + first,
+               (last - first) * sizeof(VkDeviceSize));
+        if (state->vertexBufferCount < prim->attrCount)
+            state->vertexBufferCount = prim->attrCount;
+        state->vertexBindCount++;
+    }
+
+    if (prim->indexCount > 0)
+        draw.firstIndex = bindIndicesCached(state, indexRegion);
+    return draw;
+}
+
+#ifndef ONYX_NO_BUFFER_DEVICE_ADDRESS
+_Static_assert(sizeof(Onyx_GeoRecord) == 80,
+               "Onyx_GeoRecord must match GeoRecord in geo-record.glsl");
+
+Onyx_GeoRecord
+onyx_GetGeoRecord(const Onyx_Geometry* prim)
+{
+    const Onyx_BufferRegion* vertexRegion = getBindVertexRegion(prim);
+    const Onyx_BufferRegion* indexRegion  = getBindIndexRegion(prim);
+    const VkDeviceAddress    base = onyx_GetBufferRegionAddress(vertexRegion);
+    Onyx_GeoRecord           record = {
+        .vertexCount = prim->vertexCount,
+        .indexCount  = prim->indexCount,
+    };
+    for (int t = 0; t < ONYX_ATTRIBUTE_TYPE_COUNT; t++)
+    {
+        const int i = onyx_GetGeoAttrIndexOfType(prim, t);
+        if (i >= 0)
+            record.attributes[t] = base + prim->attrOffsets[i];
+    }
+    if (prim->indexCount > 0)
+        record.indices = onyx_GetBufferRegionAddress(indexRegion);
+    return record;
+}
+
+void
+onyx_WriteGeoRecords(const Onyx_Geometry* const* prims, uint32_t count,
+                     Onyx_GeoRecord* dst)
+{
+    for (uint32_t i = 0; i < count; i++)
+        dst[i] = onyx_GetGeoRecord(prims[i]);
+}
+
+void
+onyx_DrawGeoPulled(Onyx_GeoBindState* state, const Onyx_Geometry* prim,
+                   uint32_t lod, uint32_t recordIndex)
+{
+    assert(prim->indexCount > 0);
+    // the record's attribute addresses already point at the geo's first
+    // vertex so the vertex offset stays 0
+    uint32_t firstIndex = bindIndicesCached(state, getBindIndexRegion(prim));
+    uint32_t indexCount = prim->indexCount;
+    if (lod > 0 && lod < prim->lodCount)
+    {
+        indexCount = prim->lods[lod].indexCount;
+        firstIndex += prim->lods[lod].firstIndex;
+    }
+    vkCmdDrawIndexed(state->cmdBuf, indexCount, 1, firstIndex, 0, recordIndex);
+}
+#endif
+
+void
+onyx_DrawGeoCached(Onyx_GeoBindState* state, const Onyx_Geometry* prim)
+{
+    onyx_DrawGeoLodCached(state, prim, 0);
+}
+
+void
+onyx_DrawGeoLodCached(Onyx_GeoBindState* state, const Onyx_Geometry* prim,
+                      uint32_t lod)
+{
+    const Onyx_GeoDrawOffsets draw = onyx_BindGeoCached(state, prim);
+    uint32_t indexCount = prim->indexCount;
+    uint32_t firstIndex = draw.firstIndex;
+    if (lod > 0 && lod < prim->lodCount)
+    {
+        indexCount = prim->lods[lod].indexCount;
+        firstIndex += prim->lods[lod].firstIndex;
+    }
+    vkCmdDrawIndexed(state->cmdBuf, indexCount, 1, firstIndex,
+                     draw.vertexOffset, 0);
 }
 
 void
@@ -897,24 +1232,86 @@ onyx_DrawGeo(const VkCommandBuffer cmdBuf, const Onyx_Geometry* prim)
     vkCmdDrawIndexed(cmdBuf, prim->indexCount, 1, 0, 0, 0);
 }
 
+void
+onyx_DrawGeoLod(const VkCommandBuffer cmdBuf, const Onyx_Geometry* prim,
+                uint32_t lod)
+{
+    if (lod == 0 || prim->lodCount == 0)
+    {
+        onyx_DrawGeo(cmdBuf, prim);
+        return;
+    }
+    assert(lod < prim->lodCount);
+    onyx_BindGeo(cmdBuf, prim);
+    vkCmdDrawIndexed(cmdBuf, prim->lods[lod].indexCount, 1,
+                     prim->lods[lod].firstIndex, 0, 0);
+}
+
+uint32_t
+onyx_SelectGeoLod(const Onyx_Geometry* prim, float distance, float projScale,
+                  float maxPixelError)
+{
+    if (prim->lodCount < 2)
+        return 0;
+    // inside the geometry every level is too coarse
+    if (distance <= 0.0)
+        return 0;
+    const float scale = projScale / distance;
+    uint32_t    lod   = 0;
+    for (uint32_t i = 1; i < prim->lodCount; i++)
+    {
+        // errors grow monotonically with the level
+        if (prim->lods[i].error * scale > maxPixelError)
+            break;
+        lod = i;
+    }
+    return lod;
+}
+
 void
 onyx_FreeGeo(Onyx_Geometry* prim)
 {
+    if (prim->arena)
+    {
+        onyx_FreeArenaGeometry(prim);
+        return;
+    }
+    freeDeviceMirror(prim);
     onyx_FreeBufferRegion(&prim->vertexRegion);
     onyx_FreeBufferRegion(&prim->indexRegion);
 }
 
-VkDeviceSize
-onyx_GetAttrOffset(const Onyx_Geometry* prim, const char* attrname)
+static uint32_t
+packAttrName(const char* name)
 {
+    uint32_t key = 0;
+    for (int i = 0; i < ATTR_NAME_LEN && name[i]; i++)
+        key |= (uint32_t)(uint8_t)name[i] << (i * 8);
+    return key;
+}
+
+// standard names go through the semantic table, anything else is searched
+static int
+findAttrIndex(const Onyx_Geometry* prim, const char* attrname)
+{
+    int type = onyx_GetAttributeTypeFromName(attrname);
+    if (type >= 0 && prim->attrSemantics[type])
+        return prim->attrSemantics[type] - 1;
     for (int i = 0; i < prim->attrCount; i++)
     {
         if (strncmp(prim->attrNames[i], attrname, ATTR_NAME_LEN) == 0)
-            return prim->vertexRegion.offset + prim->attrOffsets[i];
+            return i;
     }
-    assert(0 &&
+    return -1;
+}
+
+VkDeviceSize
+onyx_GetAttrOffset(const Onyx_Geometry* prim, const char* attrname)
+{
+    int i = findAttrIndex(prim, attrname);
+    assert(i >= 0 &&
            "No attribute by that name found, or prim contains no attributes");
-    return 0;
+    return prim->vertexRegion.offset + prim->attrOffsets[i];
 }
 
 VkDeviceSize
@@ -933,30 +1330,44 @@ onyx_GetGeoAttribute2(const Onyx_Geometry* prim, const char* name)
 int
 onyx_GetAttrIndex(const Onyx_Geometry* prim, const char* attrname)
 {
-    for (int i = 0; i < prim->attrCount; i++)
-    {
-        if (strncmp(prim->attrNames[i], attrname, ATTR_NAME_LEN) == 0)
-            return i;
-    }
-    assert(0 &&
+    int i = findAttrIndex(prim, attrname);
+    assert(i >= 0 &&
            "No attribute by that name found, or prim contains no attributes");
-    return 0;
+    return i < 0 ? 0 : i;
 }
 
 VkDeviceSize
 onyx_GetAttrRange(const Onyx_Geometry* prim, const char* attrname)
 {
-    for (int i = 0; i < prim->attrCount; i++)
+    int i = findAttrIndex(prim, attrname);
+    assert(i >= 0 &&
+           "No attribute by that name found, or prim contains no attributes");
+    // planes of arena geos are not back to back
+    return (VkDeviceSize)prim->vertexCount * prim->attrSizes[i];
+}
+
+int
+onyx_GetAttributeTypeFromName(const char* attrname)
+{
+    // names are at most 4 chars so they compare as a single word
+    const uint32_t key = packAttrName(attrname);
+    for (int i = 0; i < LEN(g_attr_names); i++)
     {
-        if (strncmp(prim->attrNames[i], attrname, ATTR_NAME_LEN) == 0)
-        {
-            if (i < prim->attrCount - 1) // not the last attribute
-                return prim->attrOffsets[i + 1] - prim->attrOffsets[i];
-            else
-                return prim->vertexRegion.size - prim->attrOffsets[i];
-        }
+        if (packAttrName(g_attr_names[i]) == key)
+            return g_attr_types[i];
+    }
+    return -1;
+}
+
+void
+onyx_UpdateGeoSemantics(Onyx_Geometry* geo)
+{
+    memset(geo->attrSemantics, 0, sizeof(geo->attrSemantics));
+    for (int i = 0; i < geo->attrCount; i++)
+    {
+        int type = onyx_GetAttributeTypeFromName(geo->attrNames[i]);
+        // first attribute of a type wins, like the name lookup
+        if (type >= 0 && geo->attrSemantics[type] == 0)
+            geo->attrSemantics[type] = i + 1;
     }
-    assert(0 &&
-           "No attribute by that name found, or prim contains no attributes");
-    return 0;
 }
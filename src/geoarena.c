@@ -0,0 +1,320 @@
+#include "geoarena.h"
+#include "attribute.h"
+#include "dtags.h"
+#include "memory.h"
+#include "video.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <string.h>
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_GEO, fmt, ##__VA_ARGS__)
+
+typedef Onyx_ArenaFreeList FreeList;
+typedef Onyx_ArenaRange    Range;
+
+static void
+initFreeList(FreeList* list, uint32_t capacity)
+{
+    list->capacity  = 16;
+    list->count     = 1;
+    list->ranges    = hell_Malloc(list->capacity * sizeof(Range));
+    list->ranges[0] = (Range){.offset = 0, .count = capacity};
+}
+
+static void
+insertRange(FreeList* list, uint32_t at, Range r)
+{
+    if (list->count == list->capacity)
+    {
+        list->capacity *= 2;
+        list->ranges =
+            hell_Realloc(list->ranges, list->capacity * sizeof(Range));
+    }
+    memmove(list->ranges + at + 1, list->ranges + at,
+            (list->count - at) * sizeof(Range));
+    list->ranges[at] = r;
+    list->count++;
+}
+
+static void
+removeRange(FreeList* list, uint32_t at)
+{
+    memmove(list->ranges + at, list->ranges + at + 1,
+            (list->count - at - 1) * sizeof(Range));
+    list->count--;
+}
+
+// first fit. UINT32_MAX if nothing fits.
+static uint32_t
+allocRange(FreeList* list, uint32_t count)
+{
+    for (uint32_t i = 0; i < list->count; i++)
+    {
+        Range* r = &list->ranges[i];
+        if (r->count < count)
+            continue;
+        const uint32_t offset = r->offset;
+        r->offset += count;
+        r->count -= count;
+        if (r->count == 0)
+            removeRange(list, i);
+        return offset;
+    }
+    return UINT32_MAX;
+}
+
+// merges with the neighbors so the list never holds adjacent ranges
+static void
+freeRange(FreeList* list, uint32_t offset, uint32_t count)
+{
+    if (count == 0)
+        return;
+    uint32_t i = 0;
+    while (i < list->count && list->ranges[i].offset < offset)
+        i++;
+    assert(i == list->count || offset + count <= list->ranges[i].offset);
+    const bool mergePrev =
+        i > 0 && list->ranges[i - 1].offset + list->ranges[i - 1].count == offset;
+    const bool mergeNext =
+        i < list->count && offset + count == list->ranges[i].offset;
+    if (mergePrev && mergeNext)
+    {
+        list->ranges[i - 1].count += count + list->ranges[i].count;
+        removeRange(list, i);
+    }
+    else if (mergePrev)
+        list->ranges[i - 1].count += count;
+    else if (mergeNext)
+    {
+        list->ranges[i].offset = offset;
+        list->ranges[i].count += count;
+    }
+    else
+        insertRange(list, i, (Range){.offset = offset, .count = count});
+}
+
+void
+onyx_CreateGeoArena(Onyx_Memory* memory, VkBufferUsageFlags extraBufferFlags,
+                    uint32_t vertexCapacity, uint32_t indexCapacity,
+                    uint32_t                    attrCount,
+                    const Onyx_GeoAttributeSize attrSizes[/*attrCount*/],
+                    const char* const attrNames[/*attrCount*/],
+                    Onyx_GeoArena*    arena)
+{
+    assert(attrCount > 0 && attrCount <= ONYX_R_MAX_VERT_ATTRIBUTES);
+    assert(vertexCapacity > 0 && indexCapacity > 0);
+    memset(arena, 0, sizeof(*arena));
+    arena->memory         = memory;
+    arena->vertexCapacity = vertexCapacity;
+    arena->indexCapacity  = indexCapacity;
+    arena->attrCount      = attrCount;
+
+    VkDeviceSize size = 0;
+    for (uint32_t i = 0; i < attrCount; i++)
+    {
+        assert(attrSizes[i] > 0);
+        arena->attrSizes[i]   = attrSizes[i];
+        arena->attrOffsets[i] = size;
+        size += (VkDeviceSize)vertexCapacity * attrSizes[i];
+        if (attrNames)
+            strncpy(arena->attrNames[i], attrNames[i], ONYX_R_ATTR_NAME_LEN);
+    }
+
+    arena->vertexRegion = onyx_RequestBufferRegion(
+        memory, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | extraBufferFlags,
+        ONYX_MEMORY_HOST_GRAPHICS_TYPE);
+    arena->indexRegion = onyx_RequestBufferRegion(
+        memory, (size_t)indexCapacity * sizeof(Onyx_GeoIndex),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | extraBufferFlags,
+        ONYX_MEMORY_HOST_GRAPHICS_TYPE);
+
+    initFreeList(&arena->freeVertices, vertexCapacity);
+    initFreeList(&arena->freeIndices, indexCapacity);
+
+    const Onyx_Instance* instance = onyx_GetMemoryInstance(memory);
+    arena->multiDrawIndirect = instance->enabledFeatures.multiDrawIndirect;
+    arena->drawIndirectFirstInstance =
+        instance->enabledFeatures.drawIndirectFirstInstance;
+    DPRINT("Geo arena of %d vertices and %d indices. multiDrawIndirect %d\n",
+           vertexCapacity, indexCapacity, arena->multiDrawIndirect);
+}
+
+void
+onyx_DestroyGeoArena(Onyx_GeoArena* arena)
+{
+    onyx_FreeBufferRegion(&arena->vertexRegion);
+    onyx_FreeBufferRegion(&arena->indexRegion);
+    hell_Free(arena->freeVertices.ranges);
+    hell_Free(arena->freeIndices.ranges);
+    memset(arena, 0, sizeof(*arena));
+}
+
+bool
+onyx_CreateArenaGeometry(Onyx_GeoArena* arena, uint32_t vertexCount,
+                         uint32_t indexCount, Onyx_Geometry* geo)
+{
+    assert(vertexCount > 0 && indexCount > 0);
+    const uint32_t firstVertex = allocRange(&arena->freeVertices, vertexCount);
+    if (firstVertex == UINT32_MAX)
+        return false;
+    const uint32_t firstIndex = allocRange(&arena->freeIndices, indexCount);
+    if (firstIndex == UINT32_MAX)
+    {
+        freeRange(&arena->freeVertices, firstVertex, vertexCount);
+        return false;
+    }
+
+    memset(geo, 0, sizeof(*geo));
+    geo->arena        = arena;
+    geo->vertexCount  = vertexCount;
+    geo->indexCount   = indexCount;
+    geo->attrCount    = arena->attrCount;
+    geo->firstIndex   = firstIndex;
+    geo->vertexOffset = firstVertex;
+    // views into the arena's regions. the vertex region starts at the geo's
+    // part of the first plane and ends with its part of the last, so it also
+    // spans other geos' vertices in between. the attribute offsets select
+    // this geo's part of each plane.
+    const uint32_t     last  = arena->attrCount - 1;
+    const VkDeviceSize begin = arena->attrOffsets[0] +
+                               (VkDeviceSize)firstVertex * arena->attrSizes[0];
+    geo->vertexRegion = arena->vertexRegion;
+    geo->vertexRegion.offset += begin;
+    geo->vertexRegion.size = arena->attrOffsets[last] +
+                             (VkDeviceSize)(firstVertex + vertexCount) *
+                                 arena->attrSizes[last] -
+                             begin;
+    if (geo->vertexRegion.hostData)
+        geo->vertexRegion.hostData += begin;
+    for (uint32_t i = 0; i < arena->attrCount; i++)
+    {
+        geo->attrSizes[i]   = arena->attrSizes[i];
+        geo->attrOffsets[i] = arena->attrOffsets[i] +
+                              (VkDeviceSize)firstVertex * arena->attrSizes[i] -
+                              begin;
+        memcpy(geo->attrNames[i], arena->attrNames[i], ONYX_R_ATTR_NAME_LEN);
+    }
+    const VkDeviceSize indexOffset = (VkDeviceSize)firstIndex * sizeof(Onyx_GeoIndex);
+    geo->indexRegion = arena->indexRegion;
+    geo->indexRegion.offset += indexOffset;
+    geo->indexRegion.size = (VkDeviceSize)indexCount * sizeof(Onyx_GeoIndex);
+    if (geo->indexRegion.hostData)
+        geo->indexRegion.hostData += indexOffset;
+    onyx_UpdateGeoSemantics(geo);
+    return true;
+}
+
+bool
+onyx_CopyGeoToArena(Onyx_GeoArena* arena, const Onyx_Geometry* src,
+                    Onyx_Geometry* dst)
+{
+    assert(src->vertexRegion.hostData && src->indexRegion.hostData);
+    assert(src->attrCount == arena->attrCount);
+    for (uint32_t i = 0; i < src->attrCount; i++)
+        assert(src->attrSizes[i] == arena->attrSizes[i]);
+    const uint32_t indexCount =
+        onyx_GetTotalIndexCount(src->indexCount, src->lodCount, src->lods);
+    if (!onyx_CreateArenaGeometry(arena, src->vertexCount, indexCount, dst))
+        return false;
+    for (uint32_t i = 0; i < src->attrCount; i++)
+    {
+        memcpy(onyx_GetGeoAttribute(dst, i), onyx_GetGeoAttribute(src, i),
+               (size_t)src->vertexCount * src->attrSizes[i]);
+        memcpy(dst->attrNames[i], src->attrNames[i], ONYX_R_ATTR_NAME_LEN);
+    }
+    memcpy(dst->indexRegion.hostData, src->indexRegion.hostData,
+           indexCount * sizeof(Onyx_GeoIndex));
+    onyx_UpdateGeoSemantics(dst);
+    dst->indexCount  = src->indexCount;
+    dst->lodCount    = src->lodCount;
+    memcpy(dst->lods, src->lods, sizeof(dst->lods));
+    dst->bounds      = src->bounds;
+    dst->boundsValid = src->boundsValid;
+    return true;
+}
+
+void
+onyx_FreeArenaGeometry(Onyx_Geometry* geo)
+{
+    Onyx_GeoArena* arena = geo->arena;
+    assert(arena);
+    const uint32_t indexCount =
+        onyx_GetTotalIndexCount(geo->indexCount, geo->lodCount, geo->lods);
+    freeRange(&arena->freeVertices, geo->vertexOffset, geo->vertexCount);
+    freeRange(&arena->freeIndices, geo->firstIndex, indexCount);
+    memset(geo, 0, sizeof(*geo));
+}
+
+void
+onyx_BindGeoArena(VkCommandBuffer cmdBuf, const Onyx_GeoArena* arena)
+{
+    VkBuffer     vertBuffers[ONYX_R_MAX_VERT_ATTRIBUTES];
+    VkDeviceSize attrOffsets[ONYX_R_MAX_VERT_ATTRIBUTES];
+
+    for (uint32_t i = 0; i < arena->attrCount; i++)
+    {
+        vertBuffers[i] = arena->vertexRegion.buffer;
+        attrOffsets[i] = arena->vertexRegion.offset + arena->attrOffsets[i];
+    }
+
+    vkCmdBindVertexBuffers(cmdBuf, 0, arena->attrCount, vertBuffers,
+                           attrOffsets);
+    vkCmdBindIndexBuffer(cmdBuf, arena->indexRegion.buffer,
+                         arena->indexRegion.offset, ONYX_VERT_INDEX_TYPE);
+}
+
+VkDrawIndexedIndirectCommand
+onyx_GetGeoDrawCommand(const Onyx_Geometry* geo, uint32_t lod,
+                       uint32_t instanceCount, uint32_t firstInstance)
+{
+    VkDrawIndexedIndirectCommand cmd = {
+        .indexCount    = geo->indexCount,
+        .instanceCount = instanceCount,
+        .firstIndex    = geo->firstIndex,
+        .vertexOffset  = geo->vertexOffset,
+        .firstInstance = firstInstance,
+    };
+    if (lod > 0 && lod < geo->lodCount)
+    {
+        cmd.indexCount = geo->lods[lod].indexCount;
+        cmd.firstIndex += geo->lods[lod].firstIndex;
+    }
+    return cmd;
+}
+
+void
+onyx_WriteArenaDrawCommands(const Onyx_GeoArena*          arena,
+                            const Onyx_Geometry* const*   geos,
+                            const uint32_t* lods, uint32_t count,
+                            VkDrawIndexedIndirectCommand* dst)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        assert(geos[i]->arena == arena);
+        // the device ignores a non-zero firstInstance without the feature
+        const uint32_t firstInstance = arena->drawIndirectFirstInstance ? i : 0;
+        dst[i] = onyx_GetGeoDrawCommand(geos[i], lods ? lods[i] : 0, 1,
+                                        firstInstance);
+    }
+}
+
+void
+onyx_CmdDrawArenaIndirect(VkCommandBuffer cmdBuf, const Onyx_GeoArena* arena,
+                          const Onyx_BufferRegion* commands, uint32_t drawCount)
+{
+    if (drawCount == 0)
+        return;
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    assert(commands->size >= (VkDeviceSize)drawCount * stride);
+    onyx_BindGeoArena(cmdBuf, arena);
+    if (arena->multiDrawIndirect)
+    {
+        vkCmdDrawIndexedIndirect(cmdBuf, commands->buffer, commands->offset,
+                                 drawCount, stride);
+        return;
+    }
+    for (uint32_t i = 0; i < drawCount; i++)
+        vkCmdDrawIndexedIndirect(cmdBuf, commands->buffer,
+                                 commands->offset + (VkDeviceSize)i * stride, 1,
+                                 stride);
+}
@@ -0,0 +1,477 @@
+#include "file.h"
+#include "parallel.h"
+#include <hell/common.h>
+#include <string.h>
+
+// Compressed geo file sections are split into blocks that are coded on their
+// own so they can be encoded and decoded on many threads. A section body is
+//
+//   uint32_t blockRawSize; uint32_t blockCount; uint32_t blockSizes[blockCount];
+//   blocks...
+//
+// Every block but the last decodes to blockRawSize bytes.
+//
+// The LZ stage is the LZ4 block format: a token with the literal length in the
+// high and the match length - 4 in the low nibble, 255 extension bytes for
+// either, the literals and a 16 bit little endian offset.
+
+#define BLOCK_SIZE (256 * 1024)
+#define MIN_MATCH 4
+// the last match starts at least this far from the end of the block and the
+// last bytes are always literals, as in LZ4
+#define MATCH_LIMIT 12
+#define LAST_LITERALS 5
+#define MAX_OFFSET 65535
+#define HASH_BITS 14
+
+static uint32_t
+read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static void
+write32(uint8_t* p, uint32_t v)
+{
+    memcpy(p, &v, 4);
+}
+
+static uint32_t
+hash4(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static size_t
+lzBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+static uint8_t*
+writeLength(uint8_t* op, size_t len)
+{
+    for (; len >= 255; len -= 255)
+        *op++ = 255;
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+static uint8_t*
+writeSequence(uint8_t* op, const uint8_t* literals, size_t literalCount,
+              size_t matchLen, uint32_t offset)
+{
+    uint8_t* token = op++;
+    *token = (uint8_t)((literalCount < 15 ? literalCount : 15) << 4);
+    if (literalCount >= 15)
+        op = writeLength(op, literalCount - 15);
+    memcpy(op, literals, literalCount);
+    op += literalCount;
+    if (matchLen == 0)
+        return op;
+    *op++ = offset & 0xff;
+    *op++ = offset >> 8;
+    matchLen -= MIN_MATCH;
+    *token |= matchLen < 15 ? matchLen : 15;
+    if (matchLen >= 15)
+        op = writeLength(op, matchLen - 15);
+    return op;
+}
+
+// greedy single probe hash table, dst needs lzBound(size) bytes
+static size_t
+lzCompress(const uint8_t* src, size_t size, uint8_t* dst)
+{
+    uint32_t       table[1 << HASH_BITS];
+    const uint8_t* anchor = src;
+    const uint8_t* ip     = src;
+    const uint8_t* end    = src + size;
+    uint8_t*       op     = dst;
+    memset(table, 0xff, sizeof(table));
+    if (size > MATCH_LIMIT)
+    {
+        const uint8_t* matchLimit = end - MATCH_LIMIT;
+        const uint8_t* copyLimit  = end - LAST_LITERALS;
+        while (ip < matchLimit)
+        {
+            const uint32_t v   = read32(ip);
+            const uint32_t h   = hash4(v);
+            const uint32_t ref = table[h];
+            table[h]           = ip - src;
+            if (ref == UINT32_MAX || ip - src - ref > MAX_OFFSET ||
+                read32(src + ref) != v)
+            {
+                ip++;
+                continue;
+            }
+            const uint8_t* match = src + ref;
+            size_t         len   = MIN_MATCH;
+            while (ip + len < copyLimit && ip[len] == match[len])
+                len++;
+            op     = writeSequence(op, anchor, ip - anchor, len, ip - match);
+            ip    += len;
+            anchor = ip;
+        }
+    }
+    op = writeSequence(op, anchor, end - anchor, 0, 0);
+    return op - dst;
+}
+
+static bool
+readLength(const uint8_t** ip, const uint8_t* end, size_t* len)
+{
+    uint8_t b;
+    do
+    {
+        if (*ip == end)
+            return false;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+// false unless src decodes to exactly size bytes
+static bool
+lzDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t size)
+{
+    const uint8_t* ip   = src;
+    const uint8_t* iend = src + srcSize;
+    uint8_t*       op   = dst;
+    uint8_t*       oend = dst + size;
+    while (ip < iend)
+    {
+        const uint8_t token   = *ip++;
+        size_t        literal = token >> 4;
+        if (literal == 15 && !readLength(&ip, iend, &literal))
+            return false;
+        if (literal > (size_t)(iend - ip) || literal > (size_t)(oend - op))
+            return false;
+        memcpy(op, ip, literal);
+        ip += literal;
+        op += literal;
+        if (ip == iend)
+            break;
+        if (iend - ip < 2)
+            return false;
+        const size_t offset = ip[0] | ip[1] << 8;
+        ip += 2;
+        size_t len = token & 15;
+        if (len == 15 && !readLength(&ip, iend, &len))
+            return false;
+        len += MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - dst) ||
+            len > (size_t)(oend - op))
+            return false;
+        // matches may overlap their own output
+        const uint8_t* match = op - offset;
+        if (offset >= len)
+            memcpy(op, match, len);
+        else
+            for (size_t i = 0; i < len; i++)
+                op[i] = match[i];
+        op += len;
+    }
+    return op == oend;
+}
+
+static uint32_t
+zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t
+unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// indices as varints of the zigzagged difference to the previous index.
+// neighboring triangles share vertices so most differences are small.
+static size_t
+deltaEncodeIndices(const uint8_t* src, size_t size, uint8_t* dst)
+{
+    uint8_t* op   = dst;
+    uint32_t prev = 0;
+    for (size_t i = 0; i < size; i += 4)
+    {
+        const uint32_t index = read32(src + i);
+        uint32_t       v     = zigzag((int32_t)(index - prev));
+        prev                 = index;
+        for (; v >= 0x80; v >>= 7)
+            *op++ = (uint8_t)(v | 0x80);
+        *op++ = (uint8_t)v;
+    }
+    return op - dst;
+}
+
+static bool
+deltaDecodeIndices(const uint8_t* src, size_t srcSize, uint8_t* dst,
+                   size_t size)
+{
+    const uint8_t* ip   = src;
+    const uint8_t* iend = src + srcSize;
+    uint32_t       prev = 0;
+    for (size_t i = 0; i < size; i += 4)
+    {
+        uint32_t v = 0;
+        for (uint32_t shift = 0;; shift += 7)
+        {
+            if (ip == iend || shift > 28)
+                return false;
+            const uint8_t b = *ip++;
+            v |= (uint32_t)(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                break;
+        }
+        prev += (uint32_t)unzigzag(v);
+        write32(dst + i, prev);
+    }
+    return ip == iend;
+}
+
+// byte planes of the differences to the previous vertex. neighboring vertices
+// have similar values, so the high bytes of floats repeat a lot and the LZ
+// stage finds long runs in their planes.
+static void
+vertexToPlanes(const uint8_t* src, size_t size, uint32_t elemSize, uint8_t* dst)
+{
+    const size_t count = size / elemSize;
+    for (uint32_t b = 0; b < elemSize; b++)
+    {
+        uint8_t* plane = dst + b * count;
+        uint8_t  prev  = 0;
+        for (size_t v = 0; v < count; v++)
+        {
+            const uint8_t x = src[v * elemSize + b];
+            plane[v]        = x - prev;
+            prev            = x;
+        }
+    }
+}
+
+static void
+planesToVertex(const uint8_t* src, size_t size, uint32_t elemSize, uint8_t* dst)
+{
+    const size_t count = size / elemSize;
+    for (uint32_t b = 0; b < elemSize; b++)
+    {
+        const uint8_t* plane = src + b * count;
+        uint8_t        prev  = 0;
+        for (size_t v = 0; v < count; v++)
+        {
+            prev                   += plane[v];
+            dst[v * elemSize + b]   = prev;
+        }
+    }
+}
+
+typedef struct {
+    Onyx_GeoCodec  codec;
+    uint32_t       elemSize;
+    const uint8_t* src;
+    size_t         size;
+    size_t         blockRawSize;
+    // encoding: one lzBound sized buffer per block
+    uint8_t**      blocks;
+    size_t*        blockSizes;
+    // decoding
+    const uint8_t* const* encoded;
+    uint8_t*              dst;
+    volatile bool*        failed;
+} CodecJob;
+
+static size_t
+blockRawSize(const CodecJob* job, uint32_t block)
+{
+    const size_t begin = block * job->blockRawSize;
+    return job->size - begin < job->blockRawSize ? job->size - begin
+                                                 : job->blockRawSize;
+}
+
+// an index block has a uint32_t varint size in front of its LZ stream
+static void
+encodeBlock(void* data, uint32_t block, uint32_t thread)
+{
+    CodecJob*      job  = data;
+    const size_t   size = blockRawSize(job, block);
+    const uint8_t* src  = job->src + block * job->blockRawSize;
+    uint8_t*       out  = hell_Malloc(lzBound(size * 5 / 4) + 4);
+    switch (job->codec)
+    {
+        case ONYX_GEO_CODEC_LZ:
+            job->blockSizes[block] = lzCompress(src, size, out);
+            break;
+        case ONYX_GEO_CODEC_INDEX: {
+            // a varint is at most 5 bytes per index
+            uint8_t*     tmp    = hell_Malloc(size * 5 / 4 + 1);
+            const size_t varint = deltaEncodeIndices(src, size, tmp);
+            write32(out, varint);
+            job->blockSizes[block] = 4 + lzCompress(tmp, varint, out + 4);
+            hell_Free(tmp);
+            break;
+        }
+        case ONYX_GEO_CODEC_VERTEX: {
+            uint8_t* tmp = hell_Malloc(size);
+            vertexToPlanes(src, size, job->elemSize, tmp);
+            job->blockSizes[block] = lzCompress(tmp, size, out);
+            hell_Free(tmp);
+            break;
+        }
+        default: assert(0);
+    }
+    job->blocks[block] = out;
+}
+
+static void
+decodeBlock(void* data, uint32_t block, uint32_t thread)
+{
+    CodecJob*      job   = data;
+    const size_t   size  = blockRawSize(job, block);
+    const uint8_t* src   = job->encoded[block];
+    const size_t   srcSz = job->blockSizes[block];
+    uint8_t*       dst   = job->dst + block * job->blockRawSize;
+    bool           ok    = false;
+    switch (job->codec)
+    {
+        case ONYX_GEO_CODEC_LZ: ok = lzDecompress(src, srcSz, dst, size); break;
+        case ONYX_GEO_CODEC_INDEX: {
+            if (srcSz < 4)
+                break;
+            const size_t varint = read32(src);
+            // every index takes 1 to 5 bytes
+            if (varint < size / 4 || varint > size / 4 * 5)
+                break;
+            uint8_t* tmp = hell_Malloc(varint ? varint : 1);
+            ok = lzDecompress(src + 4, srcSz - 4, tmp, varint) &&
+                 deltaDecodeIndices(tmp, varint, dst, size);
+            hell_Free(tmp);
+            break;
+        }
+        case ONYX_GEO_CODEC_VERTEX: {
+            uint8_t* tmp = hell_Malloc(size ? size : 1);
+            ok           = lzDecompress(src, srcSz, tmp, size);
+            if (ok)
+                planesToVertex(tmp, size, job->elemSize, dst);
+            hell_Free(tmp);
+            break;
+        }
+        default: break;
+    }
+    if (!ok)
+        *job->failed = true;
+}
+
+static size_t
+getBlockRawSize(Onyx_GeoCodec codec, uint32_t elemSize)
+{
+    if (codec == ONYX_GEO_CODEC_VERTEX)
+        return BLOCK_SIZE / elemSize * elemSize;
+    return BLOCK_SIZE;
+}
+
+size_t
+onyx_EncodeGeoSection(Onyx_GeoCodec codec, const void* src, size_t size,
+                      uint32_t elemSize, uint32_t threadCount, void** dst)
+{
+    assert(codec != ONYX_GEO_CODEC_NONE);
+    assert(codec != ONYX_GEO_CODEC_INDEX || size % 4 == 0);
+    assert(codec != ONYX_GEO_CODEC_VERTEX || (elemSize && size % elemSize == 0));
+    CodecJob job = {
+        .codec        = codec,
+        .elemSize     = elemSize,
+        .src          = src,
+        .size         = size,
+        .blockRawSize = getBlockRawSize(codec, elemSize),
+    };
+    const uint32_t blockCount =
+        (uint32_t)((size + job.blockRawSize - 1) / job.blockRawSize);
+    job.blocks     = hell_Malloc(blockCount * sizeof(uint8_t*) + 1);
+    job.blockSizes = hell_Malloc(blockCount * sizeof(size_t) + 1);
+    onyx_ParallelFor(threadCount, blockCount, encodeBlock, &job);
+
+    size_t total = 8 + 4 * (size_t)blockCount;
+    for (uint32_t i = 0; i < blockCount; i++)
+        total += job.blockSizes[i];
+    uint8_t* out = hell_Malloc(total);
+    write32(out, (uint32_t)job.blockRawSize);
+    write32(out + 4, blockCount);
+    uint8_t* op = out + 8 + 4 * (size_t)blockCount;
+    for (uint32_t i = 0; i < blockCount; i++)
+    {
+        write32(out + 8 + 4 * i, (uint32_t)job.blockSizes[i]);
+        memcpy(op, job.blocks[i], job.blockSizes[i]);
+        op += job.blockSizes[i];
+        hell_Free(job.blocks[i]);
+    }
+    hell_Free(job.blocks);
+    hell_Free(job.blockSizes);
+    *dst = out;
+    return total;
+}
+
+bool
+onyx_DecodeGeoSection(Onyx_GeoCodec codec, const void* src, size_t srcSize,
+                      uint32_t elemSize, uint32_t threadCount, void* dst,
+                      size_t size)
+{
+    if (codec == ONYX_GEO_CODEC_NONE)
+    {
+        if (srcSize != size)
+            return false;
+        memcpy(dst, src, size);
+        return true;
+    }
+    if (codec > ONYX_GEO_CODEC_VERTEX || srcSize < 8 ||
+        (codec == ONYX_GEO_CODEC_INDEX && size % 4) ||
+        (codec == ONYX_GEO_CODEC_VERTEX && (!elemSize || size % elemSize)))
+        return false;
+    const uint8_t* p          = src;
+    const uint32_t rawSize    = read32(p);
+    const uint32_t blockCount = read32(p + 4);
+    if (rawSize == 0 || (codec == ONYX_GEO_CODEC_INDEX && rawSize % 4) ||
+        (codec == ONYX_GEO_CODEC_VERTEX && rawSize % elemSize) ||
+        blockCount != (size + rawSize - 1) / rawSize ||
+        blockCount > (srcSize - 8) / 4)
+        return false;
+
+    volatile bool failed = false;
+    CodecJob      job    = {
+        .codec        = codec,
+        .elemSize     = elemSize,
+        .size         = size,
+        .blockRawSize = rawSize,
+        .dst          = dst,
+        .failed       = &failed,
+    };
+    const uint8_t** encoded    = hell_Malloc(blockCount * sizeof(uint8_t*) + 1);
+    size_t*         blockSizes = hell_Malloc(blockCount * sizeof(size_t) + 1);
+    const uint8_t*  ip         = p + 8 + 4 * (size_t)blockCount;
+    size_t          left       = srcSize - 8 - 4 * (size_t)blockCount;
+    for (uint32_t i = 0; i < blockCount; i++)
+    {
+        blockSizes[i] = read32(p + 8 + 4 * i);
+        encoded[i]    = ip;
+        if (blockSizes[i] > left)
+        {
+            failed = true;
+            break;
+        }
+        ip += blockSizes[i];
+        left -= blockSizes[i];
+    }
+    if (!failed && left == 0)
+    {
+        job.encoded    = encoded;
+        job.blockSizes = blockSizes;
+        onyx_ParallelFor(threadCount, blockCount, decodeBlock, &job);
+    }
+    else
+        failed = true;
+    hell_Free(encoded);
+    hell_Free(blockSizes);
+    return !failed;
+}
@@ -0,0 +1,1140 @@
+#include "gltf.h"
+#include "asyncio.h"
+#include "attribute.h"
+#include "dtags.h"
+#include "geo.h"
+#include "image.h"
+#include "meshproc.h"
+#include "parallel.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stb_image.h"
+
+// The JSON chunk is parsed into a flat array of tokens in document order.
+// Every token knows the index of the token after its subtree, so lookups walk
+// an object's members without recursion. Array elements are indexed once
+// after parsing, files with many nodes and accessors index them constantly.
+//
+// Everything that can fail is checked before anything is created, so a
+// malformed file adds nothing to the scene: the meshes and node tree are
+// resolved into geometry sources and instances first. Then images are
+// decoded and geometry is filled on every thread, with the allocations and
+// uploads in between done on the calling one.
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_SCENE, fmt, ##__VA_ARGS__)
+
+#define GLB_MAGIC      0x46546C67u
+#define GLB_CHUNK_JSON 0x4E4F534Au
+#define GLB_CHUNK_BIN  0x004E4942u
+
+#define NO_TOKEN       UINT32_MAX
+#define MAX_JSON_DEPTH 64
+#define MAX_NODE_DEPTH 64
+
+typedef enum {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT,
+} JsonType;
+
+typedef struct {
+    JsonType type;
+    // strings exclude the quotes
+    uint32_t start;
+    uint32_t end;
+    // array elements or object members
+    uint32_t count;
+    // the token after this one and its children
+    uint32_t next;
+    // arrays, where their element tokens start in Json.elements
+    uint32_t elements;
+} JsonToken;
+
+typedef struct {
+    const char* text;
+    uint32_t    size;
+    uint32_t    pos;
+    JsonToken*  tokens;
+    uint32_t    tokenCount;
+    uint32_t    tokenCapacity;
+    uint32_t*   elements;
+} Json;
+
+static uint32_t
+addToken(Json* j, JsonType type, uint32_t start)
+{
+    if (j->tokenCount == j->tokenCapacity)
+    {
+        j->tokenCapacity = j->tokenCapacity ? j->tokenCapacity * 2 : 256;
+        j->tokens = hell_Realloc(j->tokens, j->tokenCapacity * sizeof(JsonToken));
+    }
+    j->tokens[j->tokenCount] = (JsonToken){.type = type, .start = start};
+    return j->tokenCount++;
+}
+
+static void
+skipJsonSpace(Json* j)
+{
+    while (j->pos < j->size &&
+           (j->text[j->pos] == ' ' || j->text[j->pos] == '\t' ||
+            j->text[j->pos] == '\n' || j->text[j->pos] == '\r'))
+        j->pos++;
+}
+
+static bool
+parseJsonString(Json* j)
+{
+    const uint32_t t = addToken(j, JSON_STRING, ++j->pos);
+    while (j->pos < j->size && j->text[j->pos] != '"')
+        j->pos += j->text[j->pos] == '\\' ? 2 : 1;
+    if (j->pos >= j->size)
+        return false;
+    j->tokens[t].end  = j->pos++;
+    j->tokens[t].next = j->tokenCount;
+    return true;
+}
+
+static bool
+parseJsonLiteral(Json* j, const char* literal, JsonType type)
+{
+    const uint32_t len = strlen(literal);
+    if (j->size - j->pos < len || memcmp(j->text + j->pos, literal, len) != 0)
+        return false;
+    const uint32_t t = addToken(j, type, j->pos);
+    j->pos += len;
+    j->tokens[t].end  = j->pos;
+    j->tokens[t].next = j->tokenCount;
+    return true;
+}
+
+static bool
+parseJsonValue(Json* j, int depth)
+{
+    skipJsonSpace(j);
+    if (j->pos >= j->size || depth > MAX_JSON_DEPTH)
+        return false;
+    const char c = j->text[j->pos];
+    if (c == '"')
+        return parseJsonString(j);
+    if (c == 't')
+        return parseJsonLiteral(j, "true", JSON_BOOL);
+    if (c == 'f')
+        return parseJsonLiteral(j, "false", JSON_BOOL);
+    if (c == 'n')
+        return parseJsonLiteral(j, "null", JSON_NULL);
+    if (c == '-' || (c >= '0' && c <= '9'))
+    {
+        const uint32_t t = addToken(j, JSON_NUMBER, j->pos);
+        while (j->pos < j->size && strchr("+-.eE0123456789", j->text[j->pos]))
+            j->pos++;
+        j->tokens[t].end  = j->pos;
+        j->tokens[t].next = j->tokenCount;
+        return true;
+    }
+    if (c != '{' && c != '[')
+        return false;
+    const bool     object = c == '{';
+    const char     close  = object ? '}' : ']';
+    const uint32_t t      = addToken(j, object ? JSON_OBJECT : JSON_ARRAY, j->pos++);
+    uint32_t       count  = 0;
+    skipJsonSpace(j);
+    if (j->pos < j->size && j->text[j->pos] == close)
+        j->pos++;
+    else
+    {
+        for (;;)
+        {
+            if (object)
+            {
+                skipJsonSpace(j);
+                if (j->pos >= j->size || j->text[j->pos] != '"' ||
+                    !parseJsonString(j))
+                    return false;
+                skipJsonSpace(j);
+                if (j->pos >= j->size || j->text[j->pos++] != ':')
+                    return false;
+            }
+            if (!parseJsonValue(j, depth + 1))
+                return false;
+            count++;
+            skipJsonSpace(j);
+            if (j->pos >= j->size)
+                return false;
+            const char d = j->text[j->pos++];
+            if (d == close)
+                break;
+            if (d != ',')
+                return false;
+        }
+    }
+    j->tokens[t].count = count;
+    j->tokens[t].end   = j->pos;
+    j->tokens[t].next  = j->tokenCount;
+    return true;
+}
+
+static void
+indexJsonArrays(Json* j)
+{
+    uint32_t elementCount = 0;
+    for (uint32_t t = 0; t < j->tokenCount; t++)
+        if (j->tokens[t].type == JSON_ARRAY)
+            elementCount += j->tokens[t].count;
+    j->elements = hell_Malloc((elementCount + 1) * sizeof(uint32_t));
+    uint32_t e  = 0;
+    for (uint32_t t = 0; t < j->tokenCount; t++)
+    {
+        if (j->tokens[t].type != JSON_ARRAY)
+            continue;
+        j->tokens[t].elements = e;
+        for (uint32_t i = 0, c = t + 1; i < j->tokens[t].count; i++)
+        {
+            j->elements[e++] = c;
+            c                = j->tokens[c].next;
+        }
+    }
+}
+
+static bool
+isJsonString(const Json* j, uint32_t t, const char* s)
+{
+    if (t == NO_TOKEN || j->tokens[t].type != JSON_STRING)
+        return false;
+    const uint32_t len = j->tokens[t].end - j->tokens[t].start;
+    return strlen(s) == len && memcmp(j->text + j->tokens[t].start, s, len) == 0;
+}
+
+// the value of key in obj
+static uint32_t
+jsonGet(const Json* j, uint32_t obj, const char* key)
+{
+    if (obj == NO_TOKEN || j->tokens[obj].type != JSON_OBJECT)
+        return NO_TOKEN;
+    uint32_t t = obj + 1;
+    for (uint32_t i = 0; i < j->tokens[obj].count; i++)
+    {
+        if (isJsonString(j, t, key))
+            return t + 1;
+        t = j->tokens[t + 1].next;
+    }
+    return NO_TOKEN;
+}
+
+static uint32_t
+jsonCount(const Json* j, uint32_t t)
+{
+    return t != NO_TOKEN && j->tokens[t].type == JSON_ARRAY ? j->tokens[t].count
+                                                            : 0;
+}
+
+static uint32_t
+jsonAt(const Json* j, uint32_t arr, uint32_t index)
+{
+    if (index >= jsonCount(j, arr))
+        return NO_TOKEN;
+    return j->elements[j->tokens[arr].elements + index];
+}
+
+static double
+jsonNumber(const Json* j, uint32_t t, double fallback)
+{
+    if (t == NO_TOKEN || j->tokens[t].type != JSON_NUMBER)
+        return fallback;
+    char           buf[64];
+    const uint32_t len = j->tokens[t].end - j->tokens[t].start;
+    if (len >= sizeof(buf))
+        return fallback;
+    memcpy(buf, j->text + j->tokens[t].start, len);
+    buf[len] = '\0';
+    return strtod(buf, NULL);
+}
+
+// -1 if missing or not a non-negative integer
+static int64_t
+jsonIndex(const Json* j, uint32_t t)
+{
+    const double v = jsonNumber(j, t, -1.0);
+    return v >= 0.0 && v == floor(v) && v < (double)UINT32_MAX ? (int64_t)v : -1;
+}
+
+static bool
+jsonBool(const Json* j, uint32_t t)
+{
+    return t != NO_TOKEN && j->tokens[t].type == JSON_BOOL &&
+           j->text[j->tokens[t].start] == 't';
+}
+
+typedef struct {
+    const uint8_t* data;
+    size_t         size;
+    // external buffers are read and freed here, the binary chunk isn't
+    uint8_t*       owned;
+} Buffer;
+
+// one element per glTF accessor element, with data NULL for accessors without
+// a buffer view, which are all zeros
+typedef struct {
+    const uint8_t* data;
+    uint32_t       count;
+    uint32_t       components;
+    uint32_t       componentType;
+    uint32_t       stride;
+    bool           normalized;
+} Accessor;
+
+enum {
+    COMPONENT_BYTE           = 5120,
+    COMPONENT_UNSIGNED_BYTE  = 5121,
+    COMPONENT_SHORT          = 5122,
+    COMPONENT_UNSIGNED_SHORT = 5123,
+    COMPONENT_UNSIGNED_INT   = 5125,
+    COMPONENT_FLOAT          = 5126,
+};
+
+enum { ATTR_POS, ATTR_NORMAL, ATTR_UV, ATTR_TANGENT, ATTR_SIGN, ATTR_COUNT };
+
+static const Onyx_GeoAttributeSize g_attrSizes[ATTR_COUNT] = {12, 12, 8, 12, 4};
+static const char* const g_attrNames[ATTR_COUNT] = {
+    POS_NAME, NORMAL_NAME, UV_NAME, TANGENT_NAME, SIGN_NAME};
+// sign comes from the tangent's w
+static const char* const g_gltfAttrNames[ATTR_COUNT] = {
+    "POSITION", "NORMAL", "TEXCOORD_0", "TANGENT", "TANGENT"};
+static const uint32_t g_attrComponents[ATTR_COUNT] = {3, 3, 2, 4, 4};
+
+typedef struct {
+    Accessor attrs[ATTR_COUNT];
+    bool     hasAttr[ATTR_COUNT];
+    Accessor indices;
+    bool     indexed;
+    uint32_t indexCount;
+    // index into the materials, the default material if the primitive has
+    // none
+    uint32_t material;
+} GeoSource;
+
+typedef struct {
+    uint32_t  mesh;
+    Coal_Mat4 xform;
+} Instance;
+
+typedef struct {
+    const uint8_t* encoded;
+    size_t         encodedSize;
+    uint8_t*       owned;
+    uint8_t*       pixels;
+    int            width;
+    int            height;
+    bool           srgb;
+} ImageSource;
+
+typedef struct {
+    Json         json;
+    Buffer*      buffers;
+    uint32_t     bufferCount;
+    GeoSource*   geoSources;
+    uint32_t     geoSourceCount;
+    // first geo of each mesh, meshCount + 1 entries
+    uint32_t*    meshGeos;
+    uint32_t     meshCount;
+    Instance*    instances;
+    uint32_t     instanceCount;
+    uint32_t     instanceCapacity;
+    ImageSource* imageSources;
+    uint32_t     imageCount;
+    bool         needsDefaultMaterial;
+    Onyx_Geometry* geos;
+    // nodes instantiated so far. glTF nodes form a strict tree, so one
+    // reached twice makes the file malformed.
+    bool*        visitedNodes;
+    uint32_t     nodeCount;
+} Gltf;
+
+static uint32_t
+componentSize(uint32_t type)
+{
+    switch (type)
+    {
+    case COMPONENT_BYTE:
+    case COMPONENT_UNSIGNED_BYTE: return 1;
+    case COMPONENT_SHORT:
+    case COMPONENT_UNSIGNED_SHORT: return 2;
+    case COMPONENT_UNSIGNED_INT:
+    case COMPONENT_FLOAT: return 4;
+    default: return 0;
+    }
+}
+
+static uint32_t
+typeComponents(const Json* j, uint32_t t)
+{
+    static const struct {
+        const char* name;
+        uint32_t    components;
+    } types[] = {{"SCALAR", 1}, {"VEC2", 2}, {"VEC3", 3},  {"VEC4", 4},
+                 {"MAT2", 4},   {"MAT3", 9}, {"MAT4", 16}};
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+        if (isJsonString(j, t, types[i].name))
+            return types[i].components;
+    return 0;
+}
+
+// the byte range of a buffer view, false if it is out of its buffer
+static bool
+getBufferView(const Gltf* g, int64_t index, const uint8_t** data, size_t* size,
+              uint32_t* stride)
+{
+    const Json*    j    = &g->json;
+    const uint32_t view = jsonAt(j, jsonGet(j, 0, "bufferViews"), (uint32_t)index);
+    if (index < 0 || view == NO_TOKEN)
+        return false;
+    const int64_t  buffer = jsonIndex(j, jsonGet(j, view, "buffer"));
+    const int64_t  offset = jsonIndex(j, jsonGet(j, view, "byteOffset"));
+    const int64_t  length = jsonIndex(j, jsonGet(j, view, "byteLength"));
+    if (buffer < 0 || buffer >= g->bufferCount || length < 0)
+        return false;
+    const Buffer*  b     = &g->buffers[buffer];
+    const uint64_t first = offset < 0 ? 0 : offset;
+    if (first > b->size || (uint64_t)length > b->size - first)
+        return false;
+    *data = b->data + first;
+    *size = length;
+    if (stride)
+    {
+        const int64_t s = jsonIndex(j, jsonGet(j, view, "byteStride"));
+        *stride         = s < 0 ? 0 : (uint32_t)s;
+    }
+    return true;
+}
+
+static bool
+getAccessor(const Gltf* g, int64_t index, Accessor* a)
+{
+    const Json*    j        = &g->json;
+    const uint32_t accessor = jsonAt(j, jsonGet(j, 0, "accessors"), (uint32_t)index);
+    if (index < 0 || accessor == NO_TOKEN)
+        return false;
+    if (jsonGet(j, accessor, "sparse") != NO_TOKEN)
+    {
+        DPRINT("Sparse accessors are not supported\n");
+        return false;
+    }
+    const int64_t count = jsonIndex(j, jsonGet(j, accessor, "count"));
+    *a                  = (Accessor){
+        .components    = typeComponents(j, jsonGet(j, accessor, "type")),
+        .componentType = jsonIndex(j, jsonGet(j, accessor, "componentType")),
+        .normalized    = jsonBool(j, jsonGet(j, accessor, "normalized")),
+        .count         = count < 0 ? 0 : (uint32_t)count,
+    };
+    const uint32_t size = componentSize(a->componentType);
+    if (count < 0 || a->components == 0 || size == 0)
+        return false;
+    const int64_t view = jsonIndex(j, jsonGet(j, accessor, "bufferView"));
+    if (view < 0)
+        return jsonGet(j, accessor, "bufferView") == NO_TOKEN;
+    const uint8_t* data;
+    size_t         viewSize;
+    if (!getBufferView(g, view, &data, &viewSize, &a->stride))
+        return false;
+    const int64_t  offset   = jsonIndex(j, jsonGet(j, accessor, "byteOffset"));
+    const uint64_t first    = offset < 0 ? 0 : offset;
+    const uint32_t elemSize = a->components * size;
+    if (a->stride == 0)
+        a->stride = elemSize;
+    if (a->stride < elemSize)
+        return false;
+    if (a->count > 0 &&
+        (first > viewSize ||
+         (uint64_t)(a->count - 1) * a->stride + elemSize > viewSize - first))
+        return false;
+    a->data = data + first;
+    return true;
+}
+
+static inline float
+readComponent(const Accessor* a, const uint8_t* p)
+{
+    switch (a->componentType)
+    {
+    case COMPONENT_BYTE: {
+        const float v = (int8_t)p[0];
+        return a->normalized ? fmaxf(v / 127.f, -1.f) : v;
+    }
+    case COMPONENT_UNSIGNED_BYTE: return a->normalized ? p[0] / 255.f : p[0];
+    case COMPONENT_SHORT: {
+        int16_t v;
+        memcpy(&v, p, 2);
+        return a->normalized ? fmaxf(v / 32767.f, -1.f) : v;
+    }
+    case COMPONENT_UNSIGNED_SHORT: {
+        uint16_t v;
+        memcpy(&v, p, 2);
+        return a->normalized ? v / 65535.f : v;
+    }
+    case COMPONENT_UNSIGNED_INT: {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return (float)v;
+    }
+    default: {
+        float v;
+        memcpy(&v, p, 4);
+        return v;
+    }
+    }
+}
+
+// components [first, first + n) of every element into tightly packed dst.
+// tightly packed floats are copied as they are.
+static void
+copyAccessor(const Accessor* a, uint32_t first, uint32_t n, float* dst)
+{
+    if (!a->data)
+    {
+        memset(dst, 0, (size_t)a->count * n * sizeof(float));
+        return;
+    }
+    if (a->componentType == COMPONENT_FLOAT && first == 0 && a->components == n &&
+        a->stride == n * sizeof(float))
+    {
+        memcpy(dst, a->data, (size_t)a->count * n * sizeof(float));
+        return;
+    }
+    const uint32_t size = componentSize(a->componentType);
+    for (uint32_t i = 0; i < a->count; i++)
+    {
+        const uint8_t* p = a->data + (size_t)i * a->stride;
+        for (uint32_t c = 0; c < n; c++)
+            dst[(size_t)i * n + c] =
+                first + c < a->components ? readComponent(a, p + (first + c) * size)
+                                          : 0.f;
+    }
+}
+
+static inline uint32_t
+readIndex(const Accessor* a, uint32_t i)
+{
+    const uint8_t* p = a->data + (size_t)i * a->stride;
+    if (a->componentType == COMPONENT_UNSIGNED_BYTE)
+        return p[0];
+    if (a->componentType == COMPONENT_UNSIGNED_SHORT)
+    {
+        uint16_t s;
+        memcpy(&s, p, 2);
+        return s;
+    }
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static bool
+resolveGeoSource(const Gltf* g, uint32_t prim, GeoSource* src)
+{
+    const Json* j = &g->json;
+    memset(src, 0, sizeof(*src));
+    const double mode = jsonNumber(j, jsonGet(j, prim, "mode"), 4.0);
+    const uint32_t attributes = jsonGet(j, prim, "attributes");
+    for (int a = 0; a < ATTR_COUNT; a++)
+    {
+        const uint32_t t = jsonGet(j, attributes, g_gltfAttrNames[a]);
+        if (t == NO_TOKEN)
+            continue;
+        if (!getAccessor(g, jsonIndex(j, t), &src->attrs[a]) ||
+            src->attrs[a].components < g_attrComponents[a] - (a == ATTR_TANGENT))
+            return false;
+        src->hasAttr[a] = true;
+    }
+    if (!src->hasAttr[ATTR_POS] || src->attrs[ATTR_POS].count == 0)
+        return false;
+    for (int a = 0; a < ATTR_COUNT; a++)
+        if (src->hasAttr[a] && src->attrs[a].count != src->attrs[ATTR_POS].count)
+            return false;
+    const uint32_t indices = jsonGet(j, prim, "indices");
+    if (indices != NO_TOKEN)
+    {
+        if (!getAccessor(g, jsonIndex(j, indices), &src->indices) ||
+            src->indices.components != 1 ||
+            src->indices.componentType == COMPONENT_FLOAT ||
+            src->indices.componentType == COMPONENT_BYTE ||
+            src->indices.componentType == COMPONENT_SHORT)
+            return false;
+        // out of range indices would read outside the vertex planes
+        const uint32_t vertexCount = src->attrs[ATTR_POS].count;
+        for (uint32_t i = 0; src->indices.data && i < src->indices.count; i++)
+            if (readIndex(&src->indices, i) >= vertexCount)
+                return false;
+        src->indexed    = true;
+        src->indexCount = src->indices.count;
+    }
+    else
+        src->indexCount = src->attrs[ATTR_POS].count;
+    // only triangle lists are imported, other modes leave an empty geo
+    if (mode != 4.0)
+    {
+        DPRINT("Skipping a primitive with mode %g\n", mode);
+        src->indexCount = 0;
+    }
+    if (src->indexCount % 3)
+        return false;
+    return true;
+}
+
+static void
+multiply(const float a[16], const float b[16], float out[16])
+{
+    float r[16];
+    for (int c = 0; c < 4; c++)
+        for (int row = 0; row < 4; row++)
+        {
+            float v = 0.f;
+            for (int k = 0; k < 4; k++)
+                v += a[k * 4 + row] * b[c * 4 + k];
+            r[c * 4 + row] = v;
+        }
+    memcpy(out, r, sizeof(r));
+}
+
+// column major, like glTF
+static void
+getNodeMatrix(const Json* j, uint32_t node, float m[16])
+{
+    const uint32_t matrix = jsonGet(j, node, "matrix");
+    if (jsonCount(j, matrix) == 16)
+    {
+        for (uint32_t i = 0; i < 16; i++)
+            m[i] = jsonNumber(j, jsonAt(j, matrix, i), 0.0);
+        return;
+    }
+    float t[3] = {0, 0, 0}, r[4] = {0, 0, 0, 1}, s[3] = {1, 1, 1};
+    const uint32_t tt = jsonGet(j, node, "translation");
+    const uint32_t rt = jsonGet(j, node, "rotation");
+    const uint32_t st = jsonGet(j, node, "scale");
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        t[i] = jsonNumber(j, jsonAt(j, tt, i), t[i]);
+        s[i] = jsonNumber(j, jsonAt(j, st, i), s[i]);
+    }
+    for (uint32_t i = 0; i < 4; i++)
+        r[i] = jsonNumber(j, jsonAt(j, rt, i), r[i]);
+    const float x = r[0], y = r[1], z = r[2], w = r[3];
+    const float rot[9] = {
+        1 - 2 * (y * y + z * z), 2 * (x * y + z * w),     2 * (x * z - y * w),
+        2 * (x * y - z * w),     1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+        2 * (x * z + y * w),     2 * (y * z - x * w),     1 - 2 * (x * x + y * y)};
+    for (int c = 0; c < 3; c++)
+    {
+        for (int row = 0; row < 3; row++)
+            m[c * 4 + row] = rot[c * 3 + row] * s[c];
+        m[c * 4 + 3] = 0.f;
+    }
+    m[12] = t[0];
+    m[13] = t[1];
+    m[14] = t[2];
+    m[15] = 1.f;
+}
+
+static bool
+addInstances(Gltf* g, uint32_t nodeIndex, const float parent[16], int depth)
+{
+    const Json*    j    = &g->json;
+    const uint32_t node = jsonAt(j, jsonGet(j, 0, "nodes"), nodeIndex);
+    if (node == NO_TOKEN || depth > MAX_NODE_DEPTH ||
+        g->visitedNodes[nodeIndex])
+        return false;
+    g->visitedNodes[nodeIndex] = true;
+    float local[16], world[16];
+    getNodeMatrix(j, node, local);
+    multiply(parent, local, world);
+    const uint32_t meshToken = jsonGet(j, node, "mesh");
+    if (meshToken != NO_TOKEN)
+    {
+        const int64_t mesh = jsonIndex(j, meshToken);
+        if (mesh < 0 || mesh >= g->meshCount)
+            return false;
+        if (g->instanceCount == g->instanceCapacity)
+        {
+            g->instanceCapacity = g->instanceCapacity ? g->instanceCapacity * 2 : 64;
+            g->instances =
+                hell_Realloc(g->instances, g->instanceCapacity * sizeof(Instance));
+        }
+        Instance* inst = &g->instances[g->instanceCount++];
+        inst->mesh     = (uint32_t)mesh;
+        for (int c = 0; c < 4; c++)
+            for (int row = 0; row < 4; row++)
+                inst->xform.e[c][row] = world[c * 4 + row];
+    }
+    const uint32_t children = jsonGet(j, node, "children");
+    for (uint32_t i = 0; i < jsonCount(j, children); i++)
+    {
+        const int64_t child = jsonIndex(j, jsonAt(j, children, i));
+        if (child < 0 || !addInstances(g, (uint32_t)child, world, depth + 1))
+            return false;
+    }
+    return true;
+}
+
+static bool
+resolveInstances(Gltf* g)
+{
+    const Json*    j        = &g->json;
+    const float    ident[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    const uint32_t nodes     = jsonGet(j, 0, "nodes");
+    const uint32_t scenes    = jsonGet(j, 0, "scenes");
+    const int64_t  sceneIdx  = jsonIndex(j, jsonGet(j, 0, "scene"));
+    const uint32_t scene     = jsonAt(j, scenes, sceneIdx < 0 ? 0 : (uint32_t)sceneIdx);
+    g->nodeCount    = jsonCount(j, nodes);
+    g->visitedNodes = hell_Malloc(g->nodeCount + 1);
+    memset(g->visitedNodes, 0, g->nodeCount + 1);
+    if (scene != NO_TOKEN)
+    {
+        const uint32_t roots = jsonGet(j, scene, "nodes");
+        for (uint32_t i = 0; i < jsonCount(j, roots); i++)
+        {
+            const int64_t root = jsonIndex(j, jsonAt(j, roots, i));
+            if (root < 0 || !addInstances(g, (uint32_t)root, ident, 0))
+                return false;
+        }
+        return true;
+    }
+    // no scenes, every node that isn't a child is a root
+    const uint32_t nodeCount = g->nodeCount;
+    bool*          isChild   = hell_Malloc(nodeCount + 1);
+    memset(isChild, 0, nodeCount + 1);
+    for (uint32_t i = 0; i < nodeCount; i++)
+    {
+        const uint32_t children = jsonGet(j, jsonAt(j, nodes, i), "children");
+        for (uint32_t c = 0; c < jsonCount(j, children); c++)
+        {
+            const int64_t child = jsonIndex(j, jsonAt(j, children, c));
+            if (child >= 0 && child < nodeCount)
+                isChild[child] = true;
+        }
+    }
+    bool ok = true;
+    for (uint32_t i = 0; i < nodeCount && ok; i++)
+        if (!isChild[i])
+            ok = addInstances(g, i, ident, 0);
+    hell_Free(isChild);
+    return ok;
+}
+
+static bool
+resolveMeshes(Gltf* g)
+{
+    const Json*    j      = &g->json;
+    const uint32_t meshes = jsonGet(j, 0, "meshes");
+    const uint32_t materialCount = jsonCount(j, jsonGet(j, 0, "materials"));
+    g->meshCount          = jsonCount(j, meshes);
+    g->meshGeos           = hell_Malloc((g->meshCount + 1) * sizeof(uint32_t));
+    g->geoSourceCount     = 0;
+    for (uint32_t m = 0; m < g->meshCount; m++)
+    {
+        g->meshGeos[m] = g->geoSourceCount;
+        g->geoSourceCount +=
+            jsonCount(j, jsonGet(j, jsonAt(j, meshes, m), "primitives"));
+    }
+    g->meshGeos[g->meshCount] = g->geoSourceCount;
+    g->geoSources = hell_Malloc((g->geoSourceCount + 1) * sizeof(GeoSource));
+    for (uint32_t m = 0; m < g->meshCount; m++)
+    {
+        const uint32_t prims = jsonGet(j, jsonAt(j, meshes, m), "primitives");
+        for (uint32_t p = 0; p < jsonCount(j, prims); p++)
+        {
+            const uint32_t prim = jsonAt(j, prims, p);
+            GeoSource*     src  = &g->geoSources[g->meshGeos[m] + p];
+            if (!resolveGeoSource(g, prim, src))
+                return false;
+            const uint32_t matToken = jsonGet(j, prim, "material");
+            const int64_t  material = jsonIndex(j, matToken);
+            if (matToken != NO_TOKEN && (material < 0 || material >= materialCount))
+                return false;
+            src->material = matToken != NO_TOKEN ? (uint32_t)material : materialCount;
+            g->needsDefaultMaterial |= matToken == NO_TOKEN;
+        }
+    }
+    return true;
+}
+
+static char*
+getDirectory(const char* filename)
+{
+    const char* slash = strrchr(filename, '/');
+#if WIN32
+    const char* back = strrchr(filename, '\\');
+    if (back > slash)
+        slash = back;
+#endif
+    const size_t len = slash ? slash - filename + 1 : 0;
+    char*        dir = hell_Malloc(len + 1);
+    memcpy(dir, filename, len);
+    dir[len] = '\0';
+    return dir;
+}
+
+// external files relative to the glb, data uris aren't supported
+static uint8_t*
+readUri(const Json* j, uint32_t uri, const char* dir, size_t* size)
+{
+    const uint32_t len = j->tokens[uri].end - j->tokens[uri].start;
+    const char*    s   = j->text + j->tokens[uri].start;
+    if (len >= 5 && memcmp(s, "data:", 5) == 0)
+    {
+        DPRINT("Data uris are not supported\n");
+        return NULL;
+    }
+    const size_t dirLen = strlen(dir);
+    char*        path   = hell_Malloc(dirLen + len + 1);
+    memcpy(path, dir, dirLen);
+    // undo percent encoding of spaces and the like
+    size_t n = dirLen;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        int c;
+        if (s[i] == '%' && i + 2 < len && sscanf(s + i + 1, "%2x", &c) == 1)
+        {
+            path[n++] = (char)c;
+            i += 2;
+        }
+        else
+            path[n++] = s[i];
+    }
+    path[n]       = '\0';
+    uint8_t* data = onyx_ReadWholeFile(path, size);
+    hell_Free(path);
+    return data;
+}
+
+static bool
+loadBuffers(Gltf* g, const char* filename, const uint8_t* bin, size_t binSize)
+{
+    const Json*    j       = &g->json;
+    const uint32_t buffers = jsonGet(j, 0, "buffers");
+    g->bufferCount         = jsonCount(j, buffers);
+    g->buffers = hell_Malloc((g->bufferCount + 1) * sizeof(Buffer));
+    memset(g->buffers, 0, (g->bufferCount + 1) * sizeof(Buffer));
+    char* dir = getDirectory(filename);
+    bool  ok  = true;
+    for (uint32_t i = 0; i < g->bufferCount && ok; i++)
+    {
+        const uint32_t buffer = jsonAt(j, buffers, i);
+        const int64_t  length = jsonIndex(j, jsonGet(j, buffer, "byteLength"));
+        const uint32_t uri    = jsonGet(j, buffer, "uri");
+        Buffer*        b      = &g->buffers[i];
+        if (uri == NO_TOKEN && i == 0 && bin)
+        {
+            b->data = bin;
+            b->size = binSize;
+        }
+        else if (uri != NO_TOKEN && j->tokens[uri].type == JSON_STRING)
+        {
+            b->owned = readUri(j, uri, dir, &b->size);
+            b->data  = b->owned;
+        }
+        ok = b->data && length >= 0 && (uint64_t)length <= b->size;
+        if (ok)
+            b->size = length;
+    }
+    hell_Free(dir);
+    return ok;
+}
+
+static void
+decodeImage(void* data, uint32_t task, uint32_t thread)
+{
+    ImageSource* src = &((ImageSource*)data)[task];
+    if (!src->encoded)
+        return;
+    int channels;
+    src->pixels = stbi_load_from_memory(src->encoded, (int)src->encodedSize,
+                                        &src->width, &src->height, &channels, 4);
+}
+
+static void
+resolveImages(Gltf* g, const char* filename)
+{
+    const Json*    j      = &g->json;
+    const uint32_t images = jsonGet(j, 0, "images");
+    g->imageCount         = jsonCount(j, images);
+    g->imageSources = hell_Malloc((g->imageCount + 1) * sizeof(ImageSource));
+    memset(g->imageSources, 0, (g->imageCount + 1) * sizeof(ImageSource));
+    char* dir = getDirectory(filename);
+    for (uint32_t i = 0; i < g->imageCount; i++)
+    {
+        const uint32_t image = jsonAt(j, images, i);
+        const uint32_t uri   = jsonGet(j, image, "uri");
+        ImageSource*   src   = &g->imageSources[i];
+        if (uri != NO_TOKEN && j->tokens[uri].type == JSON_STRING)
+        {
+            src->owned   = readUri(j, uri, dir, &src->encodedSize);
+            src->encoded = src->owned;
+        }
+        else if (!getBufferView(g, jsonIndex(j, jsonGet(j, image, "bufferView")),
+                                &src->encoded, &src->encodedSize, NULL))
+            src->encoded = NULL;
+        if (!src->encoded)
+            DPRINT("Image %u of %s can't be read\n", i, filename);
+    }
+    hell_Free(dir);
+    // base color textures hold colors, the rest hold data
+    const uint32_t materials = jsonGet(j, 0, "materials");
+    const uint32_t textures  = jsonGet(j, 0, "textures");
+    for (uint32_t m = 0; m < jsonCount(j, materials); m++)
+    {
+        const uint32_t pbr =
+            jsonGet(j, jsonAt(j, materials, m), "pbrMetallicRoughness");
+        const int64_t texture =
+            jsonIndex(j, jsonGet(j, jsonGet(j, pbr, "baseColorTexture"), "index"));
+        const int64_t image = jsonIndex(
+            j, jsonGet(j, jsonAt(j, textures, texture < 0 ? UINT32_MAX : texture),
+                       "source"));
+        if (image >= 0 && image < g->imageCount)
+            g->imageSources[image].srgb = true;
+    }
+}
+
+static void
+fillGeo(void* data, uint32_t task, uint32_t thread)
+{
+    Gltf*            g   = data;
+    const GeoSource* src = &g->geoSources[task];
+    Onyx_Geometry*   geo = &g->geos[task];
+    uint32_t         attr = 0;
+    for (int a = 0; a < ATTR_COUNT; a++)
+    {
+        if (!src->hasAttr[a])
+            continue;
+        float* dst = onyx_GetGeoAttribute(geo, attr++);
+        if (a == ATTR_SIGN)
+            copyAccessor(&src->attrs[a], 3, 1, dst);
+        else
+            copyAccessor(&src->attrs[a], 0, g_attrSizes[a] / sizeof(float), dst);
+    }
+    // indices were range checked when resolving
+    Onyx_GeoIndex*  indices = onyx_GetGeoIndices(geo);
+    const Accessor* ia      = &src->indices;
+    for (uint32_t i = 0; i < geo->indexCount; i++)
+    {
+        if (!src->indexed)
+            indices[i] = i;
+        else
+            indices[i] = ia->data ? readIndex(ia, i) : 0;
+    }
+    onyx_UpdateGeoBounds(geo);
+}
+
+static void
+freeGltf(Gltf* g)
+{
+    for (uint32_t i = 0; i < g->bufferCount; i++)
+        hell_Free(g->buffers[i].owned);
+    for (uint32_t i = 0; i < g->imageCount; i++)
+    {
+        hell_Free(g->imageSources[i].owned);
+        if (g->imageSources[i].pixels)
+            stbi_image_free(g->imageSources[i].pixels);
+    }
+    hell_Free(g->buffers);
+    hell_Free(g->imageSources);
+    hell_Free(g->geoSources);
+    hell_Free(g->meshGeos);
+    hell_Free(g->instances);
+    hell_Free(g->visitedNodes);
+    hell_Free(g->json.tokens);
+    hell_Free(g->json.elements);
+}
+
+static bool
+parseGlb(const uint8_t* data, size_t size, Gltf* g, const uint8_t** bin,
+         size_t* binSize)
+{
+    uint32_t header[5];
+    if (size < sizeof(header))
+        return false;
+    memcpy(header, data, sizeof(header));
+    if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > size ||
+        header[4] != GLB_CHUNK_JSON || header[3] > header[2] - sizeof(header))
+        return false;
+    g->json.text = (const char*)data + sizeof(header);
+    g->json.size = header[3];
+    *bin         = NULL;
+    *binSize     = 0;
+    const size_t binChunk = sizeof(header) + ((header[3] + 3) & ~3u);
+    if (binChunk + 8 <= header[2])
+    {
+        uint32_t chunk[2];
+        memcpy(chunk, data + binChunk, 8);
+        if (chunk[1] == GLB_CHUNK_BIN && chunk[0] <= header[2] - binChunk - 8)
+        {
+            *bin     = data + binChunk + 8;
+            *binSize = chunk[0];
+        }
+    }
+    if (!parseJsonValue(&g->json, 0) || g->json.tokens[0].type != JSON_OBJECT)
+        return false;
+    // the chunk is padded with spaces, anything else is left over
+    skipJsonSpace(&g->json);
+    if (g->json.pos != g->json.size)
+        return false;
+    indexJsonArrays(&g->json);
+    return true;
+}
+
+static Onyx_TextureHandle
+getTexture(const Json* j, uint32_t info, const Onyx_GltfScene* gltf)
+{
+    const int64_t texture = jsonIndex(j, jsonGet(j, info, "index"));
+    if (texture < 0)
+        return NULL_TEXTURE;
+    const int64_t image = jsonIndex(
+        j, jsonGet(j, jsonAt(j, jsonGet(j, 0, "textures"), texture), "source"));
+    if (image < 0 || image >= gltf->imageCount)
+        return NULL_TEXTURE;
+    return gltf->textures[image];
+}
+
+bool
+onyx_ImportGlb(Onyx_Memory* memory, Onyx_Scene* scene, const char* filename,
+               const Onyx_GltfImportParms* parms, Onyx_GltfScene* gltf)
+{
+    memset(gltf, 0, sizeof(*gltf));
+    size_t   size;
+    uint8_t* data = onyx_ReadWholeFile(filename, &size);
+    if (!data)
+        return false;
+    Gltf           g = {0};
+    const uint8_t* bin;
+    size_t         binSize;
+    if (!parseGlb(data, size, &g, &bin, &binSize) ||
+        !loadBuffers(&g, filename, bin, binSize) || !resolveMeshes(&g) ||
+        !resolveInstances(&g))
+    {
+        DPRINT("Malformed glb file %s\n", filename);
+        freeGltf(&g);
+        hell_Free(data);
+        return false;
+    }
+    resolveImages(&g, filename);
+    onyx_ParallelFor(parms->threadCount, g.imageCount, decodeImage,
+                     g.imageSources);
+
+    const Json* j = &g.json;
+    gltf->imageCount = g.imageCount;
+    gltf->images   = hell_Malloc((g.imageCount + 1) * sizeof(Onyx_Image));
+    gltf->textures = hell_Malloc((g.imageCount + 1) * sizeof(Onyx_TextureHandle));
+    memset(gltf->images, 0, (g.imageCount + 1) * sizeof(Onyx_Image));
+    for (uint32_t i = 0; i < g.imageCount; i++)
+    {
+        ImageSource* src   = &g.imageSources[i];
+        gltf->textures[i]  = NULL_TEXTURE;
+        if (!src->pixels)
+        {
+            if (src->encoded)
+                DPRINT("Image %u of %s can't be decoded\n", i, filename);
+            continue;
+        }
+        onyx_LoadImageData(
+            memory, src->width, src->height, 4, src->pixels,
+            src->srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM,
+            VK_IMAGE_USAGE_SAMPLED_BIT | parms->extraImageUsageFlags,
+            VK_IMAGE_ASPECT_COLOR_BIT, VK_SAMPLE_COUNT_1_BIT, VK_FILTER_LINEAR,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, parms->createMips,
+            ONYX_MEMORY_DEVICE_TYPE, &gltf->images[i]);
+        stbi_image_free(src->pixels);
+        src->pixels       = NULL;
+        gltf->textures[i] = onyx_SceneAddTexture(scene, &gltf->images[i]);
+    }
+
+    const uint32_t materials = jsonGet(j, 0, "materials");
+    gltf->materialCount = jsonCount(j, materials) + g.needsDefaultMaterial;
+    gltf->materials =
+        hell_Malloc((gltf->materialCount + 1) * sizeof(Onyx_MaterialHandle));
+    for (uint32_t m = 0; m < gltf->materialCount; m++)
+    {
+        const uint32_t mat = jsonAt(j, materials, m);
+        const uint32_t pbr = jsonGet(j, mat, "pbrMetallicRoughness");
+        const uint32_t factor = jsonGet(j, pbr, "baseColorFactor");
+        Coal_Vec3      color;
+        color.x = jsonNumber(j, jsonAt(j, factor, 0), 1.0);
+        color.y = jsonNumber(j, jsonAt(j, factor, 1), 1.0);
+        color.z = jsonNumber(j, jsonAt(j, factor, 2), 1.0);
+        gltf->materials[m] = onyx_SceneCreateMaterial(
+            scene, color, jsonNumber(j, jsonGet(j, pbr, "roughnessFactor"), 1.0),
+            getTexture(j, jsonGet(j, pbr, "baseColorTexture"), gltf),
+            getTexture(j, jsonGet(j, pbr, "metallicRoughnessTexture"), gltf),
+            getTexture(j, jsonGet(j, mat, "normalTexture"), gltf));
+    }
+
+    gltf->geoCount = g.geoSourceCount;
+    gltf->geos     = hell_Malloc((g.geoSourceCount + 1) * sizeof(Onyx_Geometry));
+    for (uint32_t i = 0; i < g.geoSourceCount; i++)
+    {
+        const GeoSource*      src = &g.geoSources[i];
+        Onyx_GeoAttributeSize sizes[ATTR_COUNT];
+        const char*           names[ATTR_COUNT];
+        uint8_t               attrCount = 0;
+        for (int a = 0; a < ATTR_COUNT; a++)
+        {
+            if (!src->hasAttr[a])
+                continue;
+            sizes[attrCount]   = g_attrSizes[a];
+            names[attrCount++] = g_attrNames[a];
+        }
+        gltf->geos[i] = onyx_CreateGeometry2(
+            memory, parms->extraBufferUsageFlags, src->attrs[ATTR_POS].count,
+            src->indexCount, attrCount, sizes, names);
+    }
+    g.geos = gltf->geos;
+    onyx_ParallelFor(parms->threadCount, g.geoSourceCount, fillGeo, &g);
+    if (parms->transferToDevice)
+        for (uint32_t i = 0; i < g.geoSourceCount; i++)
+            onyx_TransferGeoToDevice(memory, &gltf->geos[i]);
+
+    for (uint32_t i = 0; i < g.instanceCount; i++)
+        gltf->primCount += g.meshGeos[g.instances[i].mesh + 1] -
+                           g.meshGeos[g.instances[i].mesh];
+    gltf->prims = hell_Malloc((gltf->primCount + 1) * sizeof(Onyx_PrimitiveHandle));
+    uint32_t prim = 0;
+    for (uint32_t i = 0; i < g.instanceCount; i++)
+    {
+        const Instance* inst = &g.instances[i];
+        for (uint32_t k = g.meshGeos[inst->mesh]; k < g.meshGeos[inst->mesh + 1]; k++)
+            gltf->prims[prim++] =
+                onyx_SceneAddPrim(scene, &gltf->geos[k], inst->xform,
+                                  gltf->materials[g.geoSources[k].material]);
+    }
+
+    freeGltf(&g);
+    hell_Free(data);
+    return true;
+}
+
+void
+onyx_FreeGltfScene(Onyx_Scene* scene, Onyx_GltfScene* gltf)
+{
+    for (uint32_t i = 0; i < gltf->primCount; i++)
+        onyx_SceneRemovePrim(scene, gltf->prims[i]);
+    for (uint32_t i = 0; i < gltf->materialCount; i++)
+        onyx_SceneRemoveMaterial(scene, gltf->materials[i]);
+    for (uint32_t i = 0; i < gltf->imageCount; i++)
+    {
+        if (gltf->textures[i].id == NULL_TEXTURE.id)
+            continue;
+        onyx_SceneRemoveTexture(scene, gltf->textures[i]);
+        onyx_FreeImage(&gltf->images[i]);
+    }
+    for (uint32_t i = 0; i < gltf->geoCount; i++)
+        onyx_FreeGeo(&gltf->geos[i]);
+    hell_Free(gltf->prims);
+    hell_Free(gltf->materials);
+    hell_Free(gltf->textures);
+    hell_Free(gltf->images);
+    hell_Free(gltf->geos);
+    memset(gltf, 0, sizeof(*gltf));
+}
@@ -2,7 +2,9 @@
 #include "command.h"
 #include "common.h"
 #include "dtags.h"
+#include "imageloader.h"
 #include "memory.h"
+#include "parallel.h"
 #include "private.h"
 #include "video.h"
 #include <hell/debug.h>
@@ -24,16 +26,14 @@ typedef Onyx_Image        Image;
 
 #define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_IMG, fmt, ##__VA_ARGS__)
 
+// expects every level in TRANSFER_DST_OPTIMAL with level 0 written. The
+// blits filter linearly whatever the image's sampler filter is.
 static void
-createMipMaps(const Onyx_Instance* intstance, const VkFilter filter,
-              const VkImageLayout finalLayout, Image* image)
+cmdCreateMipMaps(VkCommandBuffer cmdBuf, const VkImageLayout finalLayout,
+                 Image* image)
 {
     DPRINT("Creating mips for image %p\n", image->handle);
 
-    Command cmd = onyx_CreateCommand(intstance, ONYX_V_QUEUE_GRAPHICS_TYPE);
-
-    onyx_BeginCommandBuffer(cmd.buffer);
-
     VkImageMemoryBarrier barrier = {
         .sType                       = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .image                       = image->handle,
@@ -58,7 +58,7 @@ createMipMaps(const Onyx_Instance* intstance, const VkFilter filter,
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
-        vkCmdPipelineBarrier(cmd.buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT,
                              VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0,
                              NULL, 1, &barrier);
 
@@ -76,16 +76,17 @@ createMipMaps(const Onyx_Instance* intstance, const VkFilter filter,
                                .baseArrayLayer = 0,
                                .layerCount     = 1}};
 
-        vkCmdBlitImage(cmd.buffer, image->handle,
+        vkCmdBlitImage(cmdBuf, image->handle,
                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image->handle,
-                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, filter);
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                       VK_FILTER_LINEAR);
 
         barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
         barrier.newLayout     = finalLayout,
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
         barrier.dstAccessMask = 0;
 
-        vkCmdPipelineBarrier(cmd.buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT,
                              VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL,
                              0, NULL, 1, &barrier);
 
@@ -102,17 +103,28 @@ createMipMaps(const Onyx_Instance* intstance, const VkFilter filter,
     barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
     barrier.dstAccessMask = 0;
 
-    vkCmdPipelineBarrier(cmd.buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+    vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT,
                          VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0,
                          NULL, 1, &barrier);
 
+    image->layout = finalLayout;
+}
+
+static void
+createMipMaps(const Onyx_Instance* intstance, const VkImageLayout finalLayout,
+              Image* image)
+{
+    Command cmd = onyx_CreateCommand(intstance, ONYX_V_QUEUE_GRAPHICS_TYPE);
+
+    onyx_BeginCommandBuffer(cmd.buffer);
+
+    cmdCreateMipMaps(cmd.buffer, finalLayout, image);
+
     onyx_EndCommandBuffer(cmd.buffer);
 
     onyx_SubmitAndWait(&cmd, 0);
 
     onyx_DestroyCommand(cmd);
-
-    image->layout = finalLayout;
 }
 
 VkImageBlit
@@ -419,7 +431,151 @@ onyx_LoadImageData(Onyx_Memory* memory, int w, int h, uint8_t channelCount,
     onyx_DestroyCommand(cmd);
 
     if (createMips)
-        createMipMaps(memory->instance, VK_FILTER_LINEAR, layout, image);
+        createMipMaps(memory->instance, layout, image);
+}
+
+// staging for one submit of onyx_LoadImagesData. every image takes a block of
+// the host chain, so batches are capped by count as well as size.
+#define LOAD_BATCH_MAX_IMAGES 64
+#define LOAD_BATCH_MAX_BYTES  (64u << 20)
+
+void
+onyx_LoadImagesData(Onyx_Memory* memory, uint32_t count,
+                    const Onyx_ImageData*    datas,
+                    VkImageUsageFlags        usageFlags,
+                    const VkImageAspectFlags aspectMask,
+                    const VkSampleCountFlags sampleCount, const VkFilter filter,
+                    const VkImageLayout layout, const bool createMips,
+                    Onyx_MemoryType memoryType, Image* images)
+{
+    usageFlags |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if (createMips)
+        usageFlags |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+    BufferRegion staging[LOAD_BATCH_MAX_IMAGES];
+    uint32_t     first = 0;
+    while (first < count)
+    {
+        uint32_t     batchCount = 0;
+        VkDeviceSize batchSize  = 0;
+        for (uint32_t i = first; i < count && batchCount < LOAD_BATCH_MAX_IMAGES;
+             i++)
+        {
+            const Onyx_ImageData* d = &datas[i];
+            assert(d->data);
+            const VkDeviceSize pixelSize =
+                (VkDeviceSize)d->width * d->height * d->channelCount;
+            // one oversized image still gets a batch of its own
+            if (batchCount && batchSize + pixelSize > LOAD_BATCH_MAX_BYTES)
+                break;
+            const uint32_t mipLevels =
+                createMips ? floor(log2(fmax(d->width, d->height))) + 1 : 1;
+            images[i] = onyx_CreateImageAndSampler(
+                memory, d->width, d->height, d->format, usageFlags, aspectMask,
+                sampleCount, mipLevels, filter, memoryType);
+            staging[batchCount] = onyx_RequestBufferRegion(
+                memory, images[i].size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                ONYX_MEMORY_HOST_GRAPHICS_TYPE);
+            memcpy(staging[batchCount].hostData, d->data, pixelSize);
+            batchSize += pixelSize;
+            batchCount++;
+        }
+
+        Command cmd =
+            onyx_CreateCommand(memory->instance, ONYX_V_QUEUE_GRAPHICS_TYPE);
+
+        onyx_BeginCommandBuffer(cmd.buffer);
+
+        for (uint32_t k = 0; k < batchCount; k++)
+        {
+            Image*  image   = &images[first + k];
+            Barrier barrier = {.srcStageFlags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                               .dstStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               .srcAccessMask = 0,
+                               .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+
+            onyx_CmdTransitionImageLayout(
+                cmd.buffer, barrier, VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, image->mipLevels,
+                image->handle);
+
+            onyx_CmdCopyBufferToImage(cmd.buffer, 0, &staging[k], image);
+
+            if (createMips)
+                cmdCreateMipMaps(cmd.buffer, layout, image);
+            else
+            {
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = 0;
+                barrier.srcStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT;
+                barrier.dstStageFlags = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+                onyx_CmdTransitionImageLayout(
+                    cmd.buffer, barrier, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    layout, image->mipLevels, image->handle);
+                image->layout = layout;
+            }
+        }
+
+        onyx_EndCommandBuffer(cmd.buffer);
+
+        onyx_SubmitAndWait(&cmd, 0);
+
+        onyx_DestroyCommand(cmd);
+
+        for (uint32_t k = 0; k < batchCount; k++)
+            onyx_FreeBufferRegion(&staging[k]);
+
+        DPRINT("Loaded %d images in one submit\n", batchCount);
+        first += batchCount;
+    }
+}
+
+bool
+onyx_LoadImages(Onyx_Memory* memory, uint32_t count,
+                const char* const filenames[], const uint8_t channelCount,
+                const VkFormat format, VkImageUsageFlags usageFlags,
+                const VkImageAspectFlags aspectMask,
+                const VkSampleCountFlags sampleCount, const VkFilter filter,
+                const VkImageLayout layout, const bool createMips,
+                Onyx_MemoryType memoryType, uint32_t threadCount, Image* images)
+{
+    assert(channelCount < 5);
+    if (count == 0)
+        return true;
+    const Onyx_ImageLoadParms parms = {
+        .channelCount = channelCount,
+        .format       = format,
+        .usageFlags   = usageFlags,
+        .aspectMask   = aspectMask,
+        .sampleCount  = sampleCount,
+        .filter       = filter,
+        .layout       = layout,
+        .createMips   = createMips,
+        .memoryType   = memoryType,
+    };
+    if (threadCount == 0 || threadCount > count)
+        threadCount = count < onyx_GetHardwareThreadCount()
+                          ? count
+                          : onyx_GetHardwareThreadCount();
+    memset(images, 0, count * sizeof(Image));
+    Onyx_ImageLoader* loader = onyx_CreateImageLoader(memory, threadCount);
+    Onyx_ImageLoadId* ids    = hell_Malloc((count + 1) * sizeof(Onyx_ImageLoadId));
+    for (uint32_t i = 0; i < count; i++)
+        ids[i] = onyx_RequestImageLoad(loader, filenames[i], &parms);
+    // waiting in order uploads whatever is decoded by then while the workers
+    // go on with the rest
+    uint32_t loaded = 0;
+    for (uint32_t i = 0; i < count; i++)
+        loaded += onyx_WaitImageLoad(loader, ids[i], &images[i]);
+    if (loaded < count)
+    {
+        for (uint32_t i = 0; i < count; i++)
+            if (images[i].size)
+                onyx_FreeImage(&images[i]);
+    }
+    onyx_DestroyImageLoader(loader);
+    hell_Free(ids);
+    return loaded == count;
 }
 
 void
@@ -431,19 +587,20 @@ onyx_LoadImage(Onyx_Memory* memory, const char* filename,
                const VkImageLayout layout, const bool createMips,
                Onyx_MemoryType memoryType, Image* image)
 {
+    // one image gains nothing from a loader, it is decoded right here
     assert(channelCount < 5);
+    assert(image);
+    assert(image->size == 0);
     int            w, h, n;
     unsigned char* data = stbi_load(filename, &w, &h, &n, channelCount);
     if (!data)
     {
-        hell_Error(HELL_ERR_FATAL, "stb: %s\n", stbi_failure_reason());
+        hell_Error(HELL_ERR_FATAL, "Can't load image %s: %s\n", filename,
+                   stbi_failure_reason());
     }
-    assert(image);
-    assert(image->size == 0);
     onyx_LoadImageData(memory, w, h, channelCount, data, format, usageFlags,
                        aspectMask, sampleCount, filter, layout, createMips,
                        memoryType, image);
-
     stbi_image_free(data);
 }
 
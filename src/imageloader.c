@@ -0,0 +1,288 @@
+#include "imageloader.h"
+#include "asyncio.h"
+#include "dtags.h"
+#include "parallel.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <string.h>
+#include "stb_image.h"
+
+#if WIN32
+#include <windows.h>
+#endif
+
+// Requests are allocated one by one so workers can hold on to them while the
+// slot array grows. A worker only writes its request's data and then its
+// state, everything else belongs to the thread that owns the loader.
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_IMG, fmt, ##__VA_ARGS__)
+
+typedef enum {
+    STATE_QUEUED,
+    STATE_DECODED,
+    STATE_FAILED,
+    STATE_READY,
+} State;
+
+typedef struct {
+    Onyx_ImageLoader*   loader;
+    char*               filename;
+    Onyx_ImageLoadParms parms;
+    Onyx_ImageData      data;
+    Onyx_Image          image;
+    volatile uint32_t   state;
+} Request;
+
+struct Onyx_ImageLoader {
+    Onyx_Memory*      memory;
+    // NULL if no thread could be started, requests are decoded right away
+    Onyx_TaskPool*    pool;
+    uint64_t          finished;
+    // by id - 1, NULL for released ids
+    Request**         requests;
+    uint32_t          requestCount;
+    uint32_t          requestCapacity;
+    uint32_t*         freeSlots;
+    uint32_t          freeCount;
+    volatile uint32_t cancelled;
+};
+
+static uint32_t
+loadAcquire(const volatile uint32_t* v)
+{
+#if WIN32
+    return InterlockedCompareExchange((volatile LONG*)v, 0, 0);
+#else
+    return __atomic_load_n(v, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static void
+storeRelease(volatile uint32_t* v, uint32_t x)
+{
+#if WIN32
+    InterlockedExchange((volatile LONG*)v, x);
+#else
+    __atomic_store_n(v, x, __ATOMIC_RELEASE);
+#endif
+}
+
+static void
+decodeTask(void* data, uint32_t thread)
+{
+    Request* r     = data;
+    State    state = STATE_FAILED;
+    if (!loadAcquire(&r->loader->cancelled))
+    {
+        size_t   size;
+        uint8_t* bytes = onyx_ReadWholeFile(r->filename, &size);
+        int      n;
+        if (bytes && size <= INT32_MAX)
+            r->data.data = stbi_load_from_memory(
+                bytes, (int)size, &r->data.width, &r->data.height, &n,
+                r->data.channelCount);
+        if (r->data.data)
+            state = STATE_DECODED;
+        else
+            DPRINT("Can't decode image %s: %s\n", r->filename,
+                   bytes ? stbi_failure_reason() : "read failed");
+        hell_Free(bytes);
+    }
+    storeRelease(&r->state, state);
+}
+
+static bool
+sameParms(const Onyx_ImageLoadParms* a, const Onyx_ImageLoadParms* b)
+{
+    return a->usageFlags == b->usageFlags && a->aspectMask == b->aspectMask &&
+           a->sampleCount == b->sampleCount && a->filter == b->filter &&
+           a->layout == b->layout && a->createMips == b->createMips &&
+           a->memoryType == b->memoryType;
+}
+
+// onyx_LoadImagesData takes one set of parms, so requests that share them go
+// up together
+static uint32_t
+uploadDecoded(Onyx_ImageLoader* loader)
+{
+    Request**       group  = NULL;
+    Onyx_ImageData* datas  = NULL;
+    Onyx_Image*     images = NULL;
+    uint32_t        pending = 0;
+    for (uint32_t i = 0; i < loader->requestCount; i++)
+    {
+        Request* first = loader->requests[i];
+        if (!first)
+            continue;
+        const uint32_t state = loadAcquire(&first->state);
+        pending += state == STATE_QUEUED;
+        if (state != STATE_DECODED)
+            continue;
+        if (!group)
+        {
+            group  = hell_Malloc(loader->requestCount * sizeof(Request*));
+            datas  = hell_Malloc(loader->requestCount * sizeof(Onyx_ImageData));
+            images = hell_Malloc(loader->requestCount * sizeof(Onyx_Image));
+        }
+        uint32_t n = 0;
+        for (uint32_t j = i; j < loader->requestCount; j++)
+        {
+            Request* r = loader->requests[j];
+            if (r && loadAcquire(&r->state) == STATE_DECODED &&
+                sameParms(&r->parms, &first->parms))
+            {
+                group[n]   = r;
+                datas[n++] = r->data;
+            }
+        }
+        const Onyx_ImageLoadParms* p = &first->parms;
+        memset(images, 0, n * sizeof(Onyx_Image));
+        onyx_LoadImagesData(loader->memory, n, datas, p->usageFlags,
+                            p->aspectMask, p->sampleCount, p->filter,
+                            p->layout, p->createMips, p->memoryType, images);
+        for (uint32_t k = 0; k < n; k++)
+        {
+            group[k]->image = images[k];
+            stbi_image_free((void*)group[k]->data.data);
+            group[k]->data.data = NULL;
+            group[k]->state     = STATE_READY;
+        }
+    }
+    hell_Free(group);
+    hell_Free(datas);
+    hell_Free(images);
+    return pending;
+}
+
+static void
+freeRequest(Request* r)
+{
+    if (r->state == STATE_DECODED)
+        stbi_image_free((void*)r->data.data);
+    else if (r->state == STATE_READY)
+        onyx_FreeImage(&r->image);
+    hell_Free(r->filename);
+    hell_Free(r);
+}
+
+static Request*
+getRequest(const Onyx_ImageLoader* loader, Onyx_ImageLoadId id)
+{
+    assert(id > 0 && id <= loader->requestCount && loader->requests[id - 1]);
+    return loader->requests[id - 1];
+}
+
+Onyx_ImageLoader*
+onyx_CreateImageLoader(Onyx_Memory* memory, uint32_t threadCount)
+{
+    Onyx_ImageLoader* loader = hell_Malloc(sizeof(Onyx_ImageLoader));
+    memset(loader, 0, sizeof(*loader));
+    loader->memory = memory;
+    loader->pool   = onyx_CreateTaskPool(threadCount);
+    return loader;
+}
+
+void
+onyx_DestroyImageLoader(Onyx_ImageLoader* loader)
+{
+    storeRelease(&loader->cancelled, 1);
+    if (loader->pool)
+        onyx_DestroyTaskPool(loader->pool);
+    for (uint32_t i = 0; i < loader->requestCount; i++)
+        if (loader->requests[i])
+            freeRequest(loader->requests[i]);
+    hell_Free(loader->requests);
+    hell_Free(loader->freeSlots);
+    hell_Free(loader);
+}
+
+Onyx_ImageLoadId
+onyx_RequestImageLoad(Onyx_ImageLoader* loader, const char* filename,
+                      const Onyx_ImageLoadParms* parms)
+{
+    assert(parms->channelCount > 0 && parms->channelCount < 5);
+    uint32_t slot;
+    if (loader->freeCount)
+        slot = loader->freeSlots[--loader->freeCount];
+    else
+    {
+        if (loader->requestCount == loader->requestCapacity)
+        {
+            loader->requestCapacity =
+                loader->requestCapacity ? loader->requestCapacity * 2 : 16;
+            loader->requests = hell_Realloc(
+                loader->requests, loader->requestCapacity * sizeof(Request*));
+            loader->freeSlots = hell_Realloc(
+                loader->freeSlots, loader->requestCapacity * sizeof(uint32_t));
+        }
+        slot = loader->requestCount++;
+    }
+
+    const size_t len = strlen(filename) + 1;
+    Request*     r   = hell_Malloc(sizeof(Request));
+    *r               = (Request){
+        .loader   = loader,
+        .filename = hell_Malloc(len),
+        .parms    = *parms,
+        .data     = {.channelCount = parms->channelCount,
+                     .format       = parms->format},
+        .state    = STATE_QUEUED,
+    };
+    memcpy(r->filename, filename, len);
+    loader->requests[slot] = r;
+
+    if (loader->pool)
+        onyx_SubmitPoolTask(loader->pool, decodeTask, r);
+    else
+        decodeTask(r, 0);
+    return slot + 1;
+}
+
+uint32_t
+onyx_UpdateImageLoader(Onyx_ImageLoader* loader)
+{
+    return uploadDecoded(loader);
+}
+
+Onyx_ImageLoadStatus
+onyx_GetImageLoadStatus(const Onyx_ImageLoader* loader, Onyx_ImageLoadId id)
+{
+    switch (loadAcquire(&getRequest(loader, id)->state))
+    {
+    case STATE_READY:
+        return ONYX_IMAGE_LOAD_READY;
+    case STATE_FAILED:
+        return ONYX_IMAGE_LOAD_FAILED;
+    default:
+        return ONYX_IMAGE_LOAD_PENDING;
+    }
+}
+
+bool
+onyx_WaitImageLoad(Onyx_ImageLoader* loader, Onyx_ImageLoadId id,
+                   Onyx_Image* image)
+{
+    Request* r = getRequest(loader, id);
+    uint32_t state;
+    for (;;)
+    {
+        uploadDecoded(loader);
+        state = loadAcquire(&r->state);
+        if (state == STATE_READY || state == STATE_FAILED)
+            break;
+        // the image may have been decoded after the upload, that wakes up
+        // straight away
+        loader->finished =
+            onyx_WaitPoolTaskDone(loader->pool, loader->finished);
+    }
+    if (state == STATE_READY)
+    {
+        *image = r->image;
+        // handed over, so freeing the request leaves it alone
+        r->state = STATE_FAILED;
+    }
+    freeRequest(r);
+    loader->requests[id - 1]                  = NULL;
+    loader->freeSlots[loader->freeCount++] = id - 1;
+    return state == STATE_READY;
+}
@@ -0,0 +1,332 @@
+#include "imagesaver.h"
+#include "dtags.h"
+#include "parallel.h"
+#include "video.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <string.h>
+#include "stb_image_write.h"
+
+#if WIN32
+#include <windows.h>
+#endif
+
+// Saves are allocated one by one so workers can hold on to them while the
+// array grows. A worker only reads its save's texels and writes its state,
+// the copy region and the event belong to the thread that owns the saver.
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_IMG, fmt, ##__VA_ARGS__)
+
+#define JPEG_QUALITY 90
+
+typedef enum {
+    STATE_COPYING,
+    STATE_ENCODING,
+    STATE_WRITTEN,
+    STATE_FAILED,
+} State;
+
+typedef struct {
+    char*                filename;
+    Onyx_V_ImageFileType fileType;
+    uint32_t             width;
+    uint32_t             height;
+    uint8_t              channelCount;
+    bool                 bgra;
+    Onyx_BufferRegion    region;
+    VkEvent              event;
+    Onyx_ImageSavedFn    fn;
+    void*                data;
+    volatile uint32_t    state;
+} Save;
+
+struct Onyx_ImageSaver {
+    Onyx_Memory*   memory;
+    VkDevice       device;
+    // NULL if no thread could be started, saves are encoded right away
+    Onyx_TaskPool* pool;
+    Save**         saves;
+    uint32_t       saveCount;
+    uint32_t       saveCapacity;
+    // reset events of finished saves
+    VkEvent*       events;
+    uint32_t       eventCount;
+    uint32_t       eventCapacity;
+};
+
+static uint32_t
+loadAcquire(const volatile uint32_t* v)
+{
+#if WIN32
+    return InterlockedCompareExchange((volatile LONG*)v, 0, 0);
+#else
+    return __atomic_load_n(v, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static void
+storeRelease(volatile uint32_t* v, uint32_t x)
+{
+#if WIN32
+    InterlockedExchange((volatile LONG*)v, x);
+#else
+    __atomic_store_n(v, x, __ATOMIC_RELEASE);
+#endif
+}
+
+static bool
+getChannels(VkFormat format, uint8_t* channelCount, bool* bgra)
+{
+    *bgra = false;
+    switch (format)
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SNORM:
+    case VK_FORMAT_R8_UINT:
+    case VK_FORMAT_R8_SINT:
+    case VK_FORMAT_R8_SRGB:
+        *channelCount = 1;
+        return true;
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SNORM:
+    case VK_FORMAT_B8G8R8A8_UINT:
+    case VK_FORMAT_B8G8R8A8_SINT:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        *bgra = true;
+        // fallthrough
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SNORM:
+    case VK_FORMAT_R8G8B8A8_UINT:
+    case VK_FORMAT_R8G8B8A8_SINT:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        *channelCount = 4;
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void
+encodeTask(void* data, uint32_t thread)
+{
+    Save*        s     = data;
+    const size_t size  = (size_t)s->width * s->height * s->channelCount;
+    // the copy region is uncached on many devices and the encoders read
+    // every texel more than once, so they get a copy in ordinary memory
+    uint8_t*     texels = hell_Malloc(size);
+    memcpy(texels, s->region.hostData, size);
+    if (s->bgra)
+        for (size_t i = 0; i < size; i += 4)
+        {
+            const uint8_t b = texels[i];
+            texels[i]       = texels[i + 2];
+            texels[i + 2]   = b;
+        }
+    int r = 0;
+    switch (s->fileType)
+    {
+    case ONYX_V_IMAGE_FILE_TYPE_PNG:
+        r = stbi_write_png(s->filename, s->width, s->height, s->channelCount,
+                           texels, 0);
+        break;
+    case ONYX_V_IMAGE_FILE_TYPE_JPG:
+        r = stbi_write_jpg(s->filename, s->width, s->height, s->channelCount,
+                           texels, JPEG_QUALITY);
+        break;
+    }
+    if (!r)
+        DPRINT("Can't write image %s\n", s->filename);
+    hell_Free(texels);
+    storeRelease(&s->state, r ? STATE_WRITTEN : STATE_FAILED);
+}
+
+static void
+startEncode(Onyx_ImageSaver* saver, Save* s)
+{
+    s->state = STATE_ENCODING;
+    if (saver->pool)
+        onyx_SubmitPoolTask(saver->pool, encodeTask, s);
+    else
+        encodeTask(s, 0);
+}
+
+static void
+finishSave(Onyx_ImageSaver* saver, Save* s)
+{
+    const bool ok = s->state == STATE_WRITTEN;
+    if (s->fn)
+        s->fn(s->filename, ok, s->data);
+    onyx_FreeBufferRegion(&s->region);
+    vkResetEvent(saver->device, s->event);
+    if (saver->eventCount == saver->eventCapacity)
+    {
+        saver->eventCapacity =
+            saver->eventCapacity ? saver->eventCapacity * 2 : 8;
+        saver->events = hell_Realloc(saver->events,
+                                     saver->eventCapacity * sizeof(VkEvent));
+    }
+    saver->events[saver->eventCount++] = s->event;
+    hell_Free(s->filename);
+    hell_Free(s);
+}
+
+// finishes the saves that are written or failed and keeps the rest in order
+static uint32_t
+finishSaves(Onyx_ImageSaver* saver)
+{
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < saver->saveCount; i++)
+    {
+        Save*          s     = saver->saves[i];
+        const uint32_t state = loadAcquire(&s->state);
+        if (state == STATE_WRITTEN || state == STATE_FAILED)
+            finishSave(saver, s);
+        else
+            saver->saves[n++] = s;
+    }
+    saver->saveCount = n;
+    return n;
+}
+
+Onyx_ImageSaver*
+onyx_CreateImageSaver(Onyx_Memory* memory, uint32_t threadCount)
+{
+    Onyx_ImageSaver* saver = hell_Malloc(sizeof(Onyx_ImageSaver));
+    memset(saver, 0, sizeof(*saver));
+    saver->memory = memory;
+    saver->device = onyx_GetDevice(onyx_GetMemoryInstance(memory));
+    saver->pool   = onyx_CreateTaskPool(threadCount);
+    return saver;
+}
+
+void
+onyx_DestroyImageSaver(Onyx_ImageSaver* saver)
+{
+    vkDeviceWaitIdle(saver->device);
+    for (uint32_t i = 0; i < saver->saveCount; i++)
+    {
+        Save* s = saver->saves[i];
+        if (s->state != STATE_COPYING)
+            continue;
+        if (vkGetEventStatus(saver->device, s->event) == VK_EVENT_SET)
+            startEncode(saver, s);
+        else
+            s->state = STATE_FAILED;
+    }
+    // runs the encodes still queued
+    if (saver->pool)
+        onyx_DestroyTaskPool(saver->pool);
+    saver->pool = NULL;
+    finishSaves(saver);
+    assert(saver->saveCount == 0);
+    for (uint32_t i = 0; i < saver->eventCount; i++)
+        vkDestroyEvent(saver->device, saver->events[i], NULL);
+    hell_Free(saver->saves);
+    hell_Free(saver->events);
+    hell_Free(saver);
+}
+
+bool
+onyx_CmdSaveImage(Onyx_ImageSaver* saver, VkCommandBuffer cmdBuf,
+                  const Onyx_Image* image, VkImageLayout layout,
+                  Onyx_V_ImageFileType fileType, const char* filename,
+                  Onyx_ImageSavedFn fn, void* data)
+{
+    uint8_t channelCount;
+    bool    bgra;
+    if (!getChannels(image->format, &channelCount, &bgra))
+    {
+        DPRINT("Can't save image %s of format %d\n", filename, image->format);
+        return false;
+    }
+    const uint32_t w = image->extent.width, h = image->extent.height;
+
+    VkEvent event;
+    if (saver->eventCount)
+        event = saver->events[--saver->eventCount];
+    else
+    {
+        const VkEventCreateInfo info = {
+            .sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO};
+        V_ASSERT(vkCreateEvent(saver->device, &info, NULL, &event));
+    }
+
+    const size_t len = strlen(filename) + 1;
+    Save*        s   = hell_Malloc(sizeof(Save));
+    *s               = (Save){
+        .filename     = hell_Malloc(len),
+        .fileType     = fileType,
+        .width        = w,
+        .height       = h,
+        .channelCount = channelCount,
+        .bgra         = bgra,
+        .region       = onyx_RequestBufferRegionAligned(
+            saver->memory, (size_t)w * h * channelCount, 4,
+            ONYX_MEMORY_HOST_TRANSFER_TYPE),
+        .event        = event,
+        .fn           = fn,
+        .data         = data,
+        .state        = STATE_COPYING,
+    };
+    memcpy(s->filename, filename, len);
+    if (saver->saveCount == saver->saveCapacity)
+    {
+        saver->saveCapacity = saver->saveCapacity ? saver->saveCapacity * 2 : 8;
+        saver->saves =
+            hell_Realloc(saver->saves, saver->saveCapacity * sizeof(Save*));
+    }
+    saver->saves[saver->saveCount++] = s;
+
+    // whatever wrote the image last is unknown
+    const Onyx_Barrier toCopy = {
+        .srcStageFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+        .dstStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+    };
+    onyx_CmdTransitionImageLayout(cmdBuf, toCopy, layout,
+                                  VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                  image->mipLevels, image->handle);
+    const VkBufferImageCopy copy = {
+        .bufferOffset     = s->region.offset,
+        .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                             .layerCount = 1},
+        .imageExtent      = {w, h, 1},
+    };
+    vkCmdCopyImageToBuffer(cmdBuf, image->handle,
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           s->region.buffer, 1, &copy);
+    const Onyx_Barrier fromCopy = {
+        .srcStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT,
+        .dstStageFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+    };
+    onyx_CmdTransitionImageLayout(cmdBuf, fromCopy,
+                                  VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, layout,
+                                  image->mipLevels, image->handle);
+
+    // the texels are visible to the host once it sees the event set
+    const VkMemoryBarrier toHost = {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+    };
+    vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &toHost, 0, NULL, 0,
+                         NULL);
+    vkCmdSetEvent(cmdBuf, event, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    return true;
+}
+
+uint32_t
+onyx_UpdateImageSaver(Onyx_ImageSaver* saver)
+{
+    for (uint32_t i = 0; i < saver->saveCount; i++)
+    {
+        Save* s = saver->saves[i];
+        if (s->state == STATE_COPYING &&
+            vkGetEventStatus(saver->device, s->event) == VK_EVENT_SET)
+            startEncode(saver, s);
+    }
+    return finishSaves(saver);
+}
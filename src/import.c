@@ -0,0 +1,1344 @@
+#include "import.h"
+#include "asyncio.h"
+#include "attribute.h"
+#include "dtags.h"
+#include "file.h"
+#include "meshproc.h"
+#include "parallel.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Text is split into chunks that start on line boundaries and each chunk is
+// parsed on its own thread into its own arrays. The arrays are then
+// concatenated in chunk order, so the result is the same as a serial parse.
+//
+// OBJ indexes positions, uvs and normals separately. Every triangle corner is
+// turned into a key of its three indices and the keys are welded, which gives
+// one vertex per distinct key in first use order. When every corner uses the
+// same index for all three (what most exporters write for scans) the keys are
+// skipped and the position indices are used directly.
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_GEO, fmt, ##__VA_ARGS__)
+
+// bytes of text per task
+#define CHUNK_SIZE (1 << 20)
+// vertices or faces per task
+#define RANGE_SIZE 0x10000
+
+typedef struct {
+    void*  data;
+    size_t count;
+    size_t capacity;
+} Array;
+
+static void*
+arrayPush(Array* a, size_t elemSize, size_t n)
+{
+    if (a->count + n > a->capacity)
+    {
+        a->capacity = a->capacity ? a->capacity * 2 : 1024;
+        if (a->capacity < a->count + n)
+            a->capacity = a->count + n;
+        a->data = hell_Realloc(a->data, a->capacity * elemSize);
+    }
+    void* p = (uint8_t*)a->data + a->count * elemSize;
+    a->count += n;
+    return p;
+}
+
+static void
+arrayFree(Array* a)
+{
+    hell_Free(a->data);
+    memset(a, 0, sizeof(*a));
+}
+
+static uint32_t
+taskCount(uint64_t count, uint64_t perTask)
+{
+    return (uint32_t)((count + perTask - 1) / perTask);
+}
+
+typedef struct {
+    const char* begin;
+    const char* end;
+} TextRange;
+
+// splits text into ranges of about CHUNK_SIZE bytes that start on lines
+static uint32_t
+splitLines(const char* text, size_t size, TextRange** ranges)
+{
+    const uint32_t maxCount = taskCount(size, CHUNK_SIZE) + 1;
+    *ranges                 = hell_Malloc(maxCount * sizeof(TextRange));
+    const char* const end   = text + size;
+    const char*       p     = text;
+    uint32_t          count = 0;
+    while (p < end)
+    {
+        const char* split = end - p > CHUNK_SIZE ? p + CHUNK_SIZE : end;
+        if (split < end)
+        {
+            split = memchr(split, '\n', end - split);
+            split = split ? split + 1 : end;
+        }
+        (*ranges)[count++] = (TextRange){p, split};
+        p                  = split;
+    }
+    return count;
+}
+
+static inline const char*
+skipSpace(const char* p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r')
+        p++;
+    return p;
+}
+
+static inline bool
+isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+static inline const char*
+nextLine(const char* p, const char* end)
+{
+    p = memchr(p, '\n', end - p);
+    return p ? p + 1 : end;
+}
+
+static const double g_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Decimal floats without strtod's locale handling. Up to 19 significant
+// digits are kept, which is far more than a float holds, and the result is
+// scaled by an exact power of ten so it's within an ulp of strtof. Returns
+// NULL if there is no number at p.
+static const char*
+parseFloat(const char* p, float* out)
+{
+    const char* start = p;
+    const bool  neg   = *p == '-';
+    if (*p == '-' || *p == '+')
+        p++;
+    uint64_t mantissa = 0;
+    int      digits = 0, exponent = 0;
+    bool     any = false;
+    for (; *p >= '0' && *p <= '9'; p++, any = true)
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        }
+        else
+            exponent++;
+    }
+    if (*p == '.')
+    {
+        for (p++; *p >= '0' && *p <= '9'; p++, any = true)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+    if (!any)
+    {
+        // inf and nan
+        if (!isalpha((unsigned char)*p))
+            return NULL;
+        char* e;
+        *out = strtof(start, &e);
+        return e == start ? NULL : e;
+    }
+    if (*p == 'e' || *p == 'E')
+    {
+        const char* e      = p + 1;
+        const bool  expNeg = *e == '-';
+        if (*e == '-' || *e == '+')
+            e++;
+        if (*e >= '0' && *e <= '9')
+        {
+            int x = 0;
+            for (; *e >= '0' && *e <= '9'; e++)
+                if (x < 10000)
+                    x = x * 10 + (*e - '0');
+            exponent += expNeg ? -x : x;
+            p = e;
+        }
+    }
+    double v = (double)mantissa;
+    if (mantissa == 0)
+        v = 0.0;
+    else if (exponent < 0 && exponent >= -22)
+        v /= g_pow10[-exponent];
+    else if (exponent > 0 && exponent <= 22)
+        v *= g_pow10[exponent];
+    else if (exponent != 0)
+        v *= pow(10.0, exponent);
+    *out = (float)(neg ? -v : v);
+    return p;
+}
+
+static const char*
+parseInt(const char* p, int64_t* out)
+{
+    const bool neg = *p == '-';
+    if (*p == '-' || *p == '+')
+        p++;
+    if (*p < '0' || *p > '9')
+        return NULL;
+    int64_t v = 0;
+    for (; *p >= '0' && *p <= '9'; p++)
+        if (v < INT64_MAX / 10 - 10)
+            v = v * 10 + (*p - '0');
+    *out = neg ? -v : v;
+    return p;
+}
+
+static const char*
+parseFloats(const char* p, float* out, uint32_t count)
+{
+    for (uint32_t i = 0; i < count && p; i++)
+        p = parseFloat(skipSpace(p), &out[i]);
+    return p;
+}
+
+static void
+createImportedGeo(uint32_t vertexCount, bool hasNormals, bool hasUvs,
+                  Onyx_FileGeo* fprim)
+{
+    Onyx_GeoAttributeSize sizes[3] = {12};
+    char                  names[3][ONYX_R_ATTR_NAME_LEN] = {POS_NAME};
+    uint32_t              attrCount = 1;
+    if (hasNormals)
+    {
+        sizes[attrCount] = 12;
+        memcpy(names[attrCount++], NORMAL_NAME, sizeof(NORMAL_NAME));
+    }
+    if (hasUvs)
+    {
+        sizes[attrCount] = 8;
+        memcpy(names[attrCount++], UV_NAME, sizeof(UV_NAME));
+    }
+    *fprim = onyx_CreateFileGeo(vertexCount, 0, attrCount, sizes, names);
+}
+
+// the geo is created without indices, its empty array is in its block and
+// onyx_FreeFileGeo frees indices outside of it
+static void
+setImportedIndices(Onyx_FileGeo* fprim, uint32_t* indices, uint32_t indexCount)
+{
+    fprim->indices    = indices;
+    fprim->indexCount = indexCount;
+}
+
+// OBJ
+
+// Corners are stored with their indices resolved as far as the chunk can.
+// Positive indices are absolute and stored 0 based. Negative indices count
+// back from the elements seen so far, which depends on the chunks before, so
+// they are stored relative to the chunk's first element with RELATIVE_BIT set
+// and resolved once every chunk has been counted.
+#define NO_INDEX      UINT32_MAX
+#define RELATIVE_BIT  0x80000000u
+#define RELATIVE_BIAS 0x40000000
+
+// in the order of the imported attributes
+enum { OBJ_POS, OBJ_NORMAL, OBJ_UV, OBJ_ELEMENT_COUNT };
+
+typedef struct {
+    TextRange range;
+    // positions and normals are 3 floats, uvs 2
+    Array     elements[OBJ_ELEMENT_COUNT];
+    // uint32_t pos, normal and uv index per corner, 3 corners per triangle
+    Array     corners;
+    uint64_t  firstElement[OBJ_ELEMENT_COUNT];
+    uint64_t  firstCorner;
+    bool      anyElement[OBJ_ELEMENT_COUNT];
+    bool      sameIndices[OBJ_ELEMENT_COUNT];
+    bool      failed;
+} ObjChunk;
+
+typedef struct {
+    ObjChunk* chunks;
+    uint32_t  chunkCount;
+    uint64_t  elementCounts[OBJ_ELEMENT_COUNT];
+    // concatenated elements, with a zero element at the end for corners that
+    // lack a uv or normal
+    float*    elements[OBJ_ELEMENT_COUNT];
+    uint32_t* keys;
+    bool      used[OBJ_ELEMENT_COUNT];
+    uint32_t  vertexCount;
+    Onyx_FileGeo* out;
+    uint32_t* indices;
+} ObjContext;
+
+static const uint32_t g_objElementSizes[OBJ_ELEMENT_COUNT] = {3, 3, 2};
+
+static bool
+encodeObjIndex(int64_t i, uint64_t localCount, uint32_t* out)
+{
+    if (i > 0)
+    {
+        if (i > RELATIVE_BIAS)
+            return false;
+        *out = (uint32_t)(i - 1);
+        return true;
+    }
+    const int64_t local = (int64_t)localCount + i;
+    if (i == 0 || local < -RELATIVE_BIAS || local >= RELATIVE_BIAS - 1)
+        return false;
+    *out = RELATIVE_BIT | (uint32_t)(local + RELATIVE_BIAS);
+    return true;
+}
+
+// v, v/vt, v//vn or v/vt/vn
+static const char*
+parseObjCorner(const char* p, ObjChunk* c, uint32_t corner[3])
+{
+    int64_t i;
+    corner[OBJ_UV] = corner[OBJ_NORMAL] = NO_INDEX;
+    if (!(p = parseInt(p, &i)) ||
+        !encodeObjIndex(i, c->elements[OBJ_POS].count, &corner[OBJ_POS]))
+        return NULL;
+    if (*p != '/')
+        return p;
+    if (*++p != '/')
+    {
+        if (!(p = parseInt(p, &i)) ||
+            !encodeObjIndex(i, c->elements[OBJ_UV].count, &corner[OBJ_UV]))
+            return NULL;
+        c->anyElement[OBJ_UV] = true;
+        if (*p != '/')
+            return p;
+    }
+    if (!(p = parseInt(p + 1, &i)) ||
+        !encodeObjIndex(i, c->elements[OBJ_NORMAL].count, &corner[OBJ_NORMAL]))
+        return NULL;
+    c->anyElement[OBJ_NORMAL] = true;
+    return p;
+}
+
+static const char*
+parseObjFace(const char* p, ObjChunk* c)
+{
+    uint32_t first[3], prev[3], cur[3];
+    uint32_t n = 0;
+    for (p = skipSpace(p); *p && *p != '\n' && *p != '#'; p = skipSpace(p), n++)
+    {
+        if (!(p = parseObjCorner(p, c, cur)))
+            return NULL;
+        if (n == 0)
+            memcpy(first, cur, sizeof(cur));
+        else if (n >= 2)
+        {
+            uint32_t* tri = arrayPush(&c->corners, 9 * sizeof(uint32_t), 1);
+            memcpy(tri, first, sizeof(first));
+            memcpy(tri + 3, prev, sizeof(prev));
+            memcpy(tri + 6, cur, sizeof(cur));
+        }
+        memcpy(prev, cur, sizeof(cur));
+    }
+    return n >= 3 ? p : NULL;
+}
+
+static void
+parseObjChunk(void* data, uint32_t task, uint32_t thread)
+{
+    ObjContext* ctx = data;
+    ObjChunk*   c   = &ctx->chunks[task];
+    const char* end = c->range.end;
+    for (const char* p = c->range.begin; p < end; p = nextLine(p, end))
+    {
+        p = skipSpace(p);
+        int element = -1;
+        if (p[0] == 'v' && isSpace(p[1]))
+            element = OBJ_POS, p += 2;
+        else if (p[0] == 'v' && p[1] == 't' && isSpace(p[2]))
+            element = OBJ_UV, p += 3;
+        else if (p[0] == 'v' && p[1] == 'n' && isSpace(p[2]))
+            element = OBJ_NORMAL, p += 3;
+        else if (p[0] == 'f' && isSpace(p[1]))
+        {
+            if (!(p = parseObjFace(p + 1, c)))
+                goto fail;
+            continue;
+        }
+        if (element < 0)
+            continue;
+        const uint32_t n = g_objElementSizes[element];
+        float* v = arrayPush(&c->elements[element], n * sizeof(float), 1);
+        // a uv may leave out v and w
+        if (element == OBJ_UV)
+        {
+            v[1] = 0.f;
+            if (!(p = parseFloat(skipSpace(p), &v[0])))
+                goto fail;
+            const char* q = parseFloat(skipSpace(p), &v[1]);
+            p             = q ? q : p;
+        }
+        else if (!(p = parseFloats(p, v, n)))
+            goto fail;
+    }
+    return;
+fail:
+    c->failed = true;
+}
+
+static inline bool
+resolveObjIndex(uint32_t* i, uint64_t first, uint64_t count)
+{
+    if (*i == NO_INDEX)
+    {
+        // the zero element
+        *i = (uint32_t)count;
+        return true;
+    }
+    uint64_t abs = *i;
+    if (*i & RELATIVE_BIT)
+    {
+        const int64_t local = (int64_t)(*i & ~RELATIVE_BIT) - RELATIVE_BIAS;
+        if ((int64_t)first + local < 0)
+            return false;
+        abs = first + local;
+    }
+    if (abs >= count)
+        return false;
+    *i = (uint32_t)abs;
+    return true;
+}
+
+// resolves the chunk's corners into keys and copies its elements into the
+// concatenated arrays
+static void
+resolveObjChunk(void* data, uint32_t task, uint32_t thread)
+{
+    ObjContext* ctx = data;
+    ObjChunk*   c   = &ctx->chunks[task];
+    for (int e = 0; e < OBJ_ELEMENT_COUNT; e++)
+    {
+        const size_t n = g_objElementSizes[e];
+        if (c->elements[e].count)
+            memcpy(ctx->elements[e] + c->firstElement[e] * n, c->elements[e].data,
+                   c->elements[e].count * n * sizeof(float));
+        c->sameIndices[e] = true;
+    }
+    const uint32_t* src  = c->corners.data;
+    uint32_t*       keys = ctx->keys + c->firstCorner * 3;
+    for (size_t i = 0; i < c->corners.count * 3; i++)
+    {
+        uint32_t key[3];
+        for (int e = 0; e < OBJ_ELEMENT_COUNT; e++)
+        {
+            key[e] = src[i * 3 + e];
+            if (!resolveObjIndex(&key[e], c->firstElement[e],
+                                 ctx->elementCounts[e]))
+            {
+                c->failed = true;
+                return;
+            }
+            if (!ctx->used[e])
+                key[e] = 0;
+            else
+                c->sameIndices[e] &= key[e] == key[OBJ_POS];
+        }
+        memcpy(keys + i * 3, key, sizeof(key));
+    }
+}
+
+static void
+gatherObjVertices(void* data, uint32_t task, uint32_t thread)
+{
+    ObjContext*    ctx   = data;
+    Onyx_FileGeo*  out   = ctx->out;
+    const uint32_t first = task * RANGE_SIZE;
+    const uint32_t last  = first + RANGE_SIZE < ctx->vertexCount
+                               ? first + RANGE_SIZE
+                               : ctx->vertexCount;
+    uint32_t attr = 0;
+    for (int e = 0; e < OBJ_ELEMENT_COUNT; e++)
+    {
+        if (!ctx->used[e])
+            continue;
+        const uint32_t n   = g_objElementSizes[e];
+        float*         dst = out->attributes[attr++];
+        for (uint32_t v = first; v < last; v++)
+            memcpy(dst + v * n, ctx->elements[e] + ctx->keys[v * 3 + e] * n,
+                   n * sizeof(float));
+    }
+}
+
+static void
+copyObjPositionIndices(void* data, uint32_t task, uint32_t thread)
+{
+    ObjContext*    ctx   = data;
+    const uint32_t count = ctx->out->indexCount;
+    const uint32_t first = task * RANGE_SIZE;
+    const uint32_t last  = first + RANGE_SIZE < count ? first + RANGE_SIZE : count;
+    for (uint32_t i = first; i < last; i++)
+        ctx->indices[i] = ctx->keys[i * 3 + OBJ_POS];
+}
+
+static bool
+buildObjGeo(ObjContext* ctx, uint32_t threadCount, Onyx_FileGeo* fprim)
+{
+    uint64_t cornerCount = 0;
+    bool     anyElement[OBJ_ELEMENT_COUNT] = {true};
+    for (uint32_t i = 0; i < ctx->chunkCount; i++)
+    {
+        ObjChunk* c = &ctx->chunks[i];
+        if (c->failed)
+            return false;
+        for (int e = 0; e < OBJ_ELEMENT_COUNT; e++)
+        {
+            c->firstElement[e] = ctx->elementCounts[e];
+            ctx->elementCounts[e] += c->elements[e].count;
+            anyElement[e] |= c->anyElement[e];
+        }
+        c->firstCorner = cornerCount;
+        cornerCount += c->corners.count * 3;
+    }
+    if (ctx->elementCounts[OBJ_POS] == 0 || cornerCount == 0 ||
+        cornerCount > UINT32_MAX ||
+        ctx->elementCounts[OBJ_POS] > UINT32_MAX)
+        return false;
+    for (int e = 0; e < OBJ_ELEMENT_COUNT; e++)
+    {
+        // the zero element is only needed if some corners lack one
+        ctx->used[e]     = anyElement[e];
+        const size_t n   = g_objElementSizes[e];
+        ctx->elements[e] = hell_Malloc((ctx->elementCounts[e] + 1) * n * sizeof(float));
+        memset(ctx->elements[e] + ctx->elementCounts[e] * n, 0, n * sizeof(float));
+    }
+    ctx->keys = hell_Malloc(cornerCount * 3 * sizeof(uint32_t));
+    onyx_ParallelFor(threadCount, ctx->chunkCount, resolveObjChunk, ctx);
+
+    bool sameIndices = true;
+    for (uint32_t i = 0; i < ctx->chunkCount; i++)
+    {
+        if (ctx->chunks[i].failed)
+            return false;
+        for (int e = 0; e < OBJ_ELEMENT_COUNT; e++)
+            sameIndices &= ctx->chunks[i].sameIndices[e];
+    }
+    for (int e = 0; e < OBJ_ELEMENT_COUNT; e++)
+        if (ctx->used[e] && ctx->elementCounts[e] < ctx->elementCounts[OBJ_POS])
+            sameIndices = false;
+
+    ctx->out = fprim;
+    if (sameIndices)
+    {
+        // every corner indexes its position, uv and normal with one index
+        ctx->vertexCount = (uint32_t)ctx->elementCounts[OBJ_POS];
+        createImportedGeo(ctx->vertexCount, ctx->used[OBJ_NORMAL],
+                          ctx->used[OBJ_UV], fprim);
+        uint32_t attr = 0;
+        for (int e = 0; e < OBJ_ELEMENT_COUNT; e++)
+            if (ctx->used[e])
+                memcpy(fprim->attributes[attr++], ctx->elements[e],
+                       (size_t)ctx->vertexCount * g_objElementSizes[e] *
+                           sizeof(float));
+        fprim->indexCount = (uint32_t)cornerCount;
+        ctx->indices      = hell_Malloc(cornerCount * sizeof(uint32_t));
+        onyx_ParallelFor(threadCount, taskCount(cornerCount, RANGE_SIZE),
+                         copyObjPositionIndices, ctx);
+        setImportedIndices(fprim, ctx->indices, (uint32_t)cornerCount);
+        onyx_UpdateFileGeoBounds(fprim);
+        return true;
+    }
+
+    Onyx_GeoAttributeSize keySize = 3 * sizeof(uint32_t);
+    char                  keyName[1][ONYX_R_ATTR_NAME_LEN] = {"key"};
+    Onyx_FileGeo keyGeo = onyx_CreateFileGeo(0, 0, 1, &keySize, keyName);
+    keyGeo.attributes[0] = ctx->keys;
+    keyGeo.vertexCount   = (uint32_t)cornerCount;
+    ctx->vertexCount     = onyx_WeldFileGeo(&keyGeo, 0.f, threadCount);
+    ctx->keys            = keyGeo.attributes[0];
+    createImportedGeo(ctx->vertexCount, ctx->used[OBJ_NORMAL], ctx->used[OBJ_UV],
+                      fprim);
+    onyx_ParallelFor(threadCount, taskCount(ctx->vertexCount, RANGE_SIZE),
+                     gatherObjVertices, ctx);
+    setImportedIndices(fprim, keyGeo.indices, keyGeo.indexCount);
+    keyGeo.indices = NULL;
+    // the keys are freed with the context
+    keyGeo.attributes[0] = NULL;
+    onyx_FreeFileGeo(&keyGeo);
+    onyx_UpdateFileGeoBounds(fprim);
+    return true;
+}
+
+bool
+onyx_ImportObj(const char* filename, uint32_t threadCount, Onyx_FileGeo* fprim)
+{
+    size_t size;
+    // zero terminated so number parsing always stops at the end
+    char*  text = onyx_ReadWholeFile(filename, &size);
+    if (!text)
+        return false;
+    TextRange* ranges;
+    ObjContext ctx = {0};
+    ctx.chunkCount = splitLines(text, size, &ranges);
+    ctx.chunks     = hell_Malloc(ctx.chunkCount * sizeof(ObjChunk));
+    memset(ctx.chunks, 0, ctx.chunkCount * sizeof(ObjChunk));
+    for (uint32_t i = 0; i < ctx.chunkCount; i++)
+        ctx.chunks[i].range = ranges[i];
+    hell_Free(ranges);
+
+    onyx_ParallelFor(threadCount, ctx.chunkCount, parseObjChunk, &ctx);
+    const bool ok = buildObjGeo(&ctx, threadCount, fprim);
+    if (!ok)
+        DPRINT("Malformed obj file %s\n", filename);
+
+    for (uint32_t i = 0; i < ctx.chunkCount; i++)
+    {
+        for (int e = 0; e < OBJ_ELEMENT_COUNT; e++)
+            arrayFree(&ctx.chunks[i].elements[e]);
+        arrayFree(&ctx.chunks[i].corners);
+    }
+    for (int e = 0; e < OBJ_ELEMENT_COUNT; e++)
+        hell_Free(ctx.elements[e]);
+    hell_Free(ctx.keys);
+    hell_Free(ctx.chunks);
+    hell_Free(text);
+    return ok;
+}
+
+// PLY
+
+#define MAX_PLY_ELEMENTS   16
+#define MAX_PLY_PROPERTIES 32
+#define PLY_NAME_LEN       32
+
+typedef enum {
+    PLY_NONE,
+    PLY_INT8,
+    PLY_UINT8,
+    PLY_INT16,
+    PLY_UINT16,
+    PLY_INT32,
+    PLY_UINT32,
+    PLY_FLOAT32,
+    PLY_FLOAT64,
+} PlyType;
+
+static const uint8_t g_plyTypeSizes[] = {0, 1, 1, 2, 2, 4, 4, 4, 8};
+
+typedef enum {
+    PLY_ASCII,
+    PLY_BINARY_LITTLE_ENDIAN,
+    PLY_BINARY_BIG_ENDIAN,
+} PlyFormat;
+
+// vertex properties that are read
+enum { SLOT_X, SLOT_Y, SLOT_Z, SLOT_NX, SLOT_NY, SLOT_NZ, SLOT_U, SLOT_V, SLOT_COUNT };
+
+typedef struct {
+    char    name[PLY_NAME_LEN];
+    // item type for lists
+    PlyType type;
+    // PLY_NONE for scalars
+    PlyType countType;
+    // SLOT_* of vertex properties, -1 if unused
+    int     slot;
+} PlyProperty;
+
+typedef struct {
+    char        name[PLY_NAME_LEN];
+    uint64_t    count;
+    uint32_t    propCount;
+    PlyProperty props[MAX_PLY_PROPERTIES];
+    // 0 if the element has lists
+    uint32_t    stride;
+} PlyElement;
+
+typedef struct {
+    PlyFormat  format;
+    uint32_t   elementCount;
+    PlyElement elements[MAX_PLY_ELEMENTS];
+    int        vertexElement;
+    int        faceElement;
+    // the vertex_indices list of the face element
+    int        indexProp;
+    bool       slots[SLOT_COUNT];
+    size_t     bodyOffset;
+} PlyHeader;
+
+static const char*
+nextToken(const char* p, const char* end, char* tok, size_t cap)
+{
+    while (p < end && isSpace(*p))
+        p++;
+    size_t n = 0;
+    while (p < end && !isspace((unsigned char)*p))
+    {
+        if (n + 1 < cap)
+            tok[n++] = *p;
+        p++;
+    }
+    tok[n] = '\0';
+    return p;
+}
+
+static PlyType
+parsePlyType(const char* s)
+{
+    static const struct {
+        const char* name;
+        PlyType     type;
+    } types[] = {
+        {"char", PLY_INT8},     {"int8", PLY_INT8},     {"uchar", PLY_UINT8},
+        {"uint8", PLY_UINT8},   {"short", PLY_INT16},   {"int16", PLY_INT16},
+        {"ushort", PLY_UINT16}, {"uint16", PLY_UINT16}, {"int", PLY_INT32},
+        {"int32", PLY_INT32},   {"uint", PLY_UINT32},   {"uint32", PLY_UINT32},
+        {"float", PLY_FLOAT32}, {"float32", PLY_FLOAT32}, {"double", PLY_FLOAT64},
+        {"float64", PLY_FLOAT64},
+    };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+        if (strcmp(s, types[i].name) == 0)
+            return types[i].type;
+    return PLY_NONE;
+}
+
+static int
+getPlySlot(const char* name)
+{
+    static const struct {
+        const char* name;
+        int         slot;
+    } slots[] = {
+        {"x", SLOT_X},          {"y", SLOT_Y},          {"z", SLOT_Z},
+        {"nx", SLOT_NX},        {"ny", SLOT_NY},        {"nz", SLOT_NZ},
+        {"u", SLOT_U},          {"v", SLOT_V},          {"s", SLOT_U},
+        {"t", SLOT_V},          {"texture_u", SLOT_U},  {"texture_v", SLOT_V},
+        {"texture_s", SLOT_U},  {"texture_t", SLOT_V},
+    };
+    for (size_t i = 0; i < sizeof(slots) / sizeof(slots[0]); i++)
+        if (strcmp(name, slots[i].name) == 0)
+            return slots[i].slot;
+    return -1;
+}
+
+static bool
+parsePlyHeader(const char* text, size_t size, PlyHeader* h)
+{
+    memset(h, 0, sizeof(*h));
+    h->vertexElement = h->faceElement = h->indexProp = -1;
+    const char* const end = text + size;
+    if (size < 4 || memcmp(text, "ply", 3) != 0)
+        return false;
+    bool hasFormat = false;
+    char tok[PLY_NAME_LEN];
+    for (const char* p = nextLine(text, end); p < end; p = nextLine(p, end))
+    {
+        const char* q = nextToken(p, end, tok, sizeof(tok));
+        if (strcmp(tok, "end_header") == 0)
+        {
+            h->bodyOffset = nextLine(q, end) - text;
+            break;
+        }
+        if (strcmp(tok, "format") == 0)
+        {
+            q = nextToken(q, end, tok, sizeof(tok));
+            if (strcmp(tok, "ascii") == 0)
+                h->format = PLY_ASCII;
+            else if (strcmp(tok, "binary_little_endian") == 0)
+                h->format = PLY_BINARY_LITTLE_ENDIAN;
+            else if (strcmp(tok, "binary_big_endian") == 0)
+                h->format = PLY_BINARY_BIG_ENDIAN;
+            else
+                return false;
+            hasFormat = true;
+        }
+        else if (strcmp(tok, "element") == 0)
+        {
+            if (h->elementCount == MAX_PLY_ELEMENTS)
+                return false;
+            PlyElement* e = &h->elements[h->elementCount++];
+            q             = nextToken(q, end, e->name, sizeof(e->name));
+            q             = nextToken(q, end, tok, sizeof(tok));
+            char* numEnd;
+            e->count = strtoull(tok, &numEnd, 10);
+            if (numEnd == tok)
+                return false;
+            if (strcmp(e->name, "vertex") == 0)
+                h->vertexElement = h->elementCount - 1;
+            else if (strcmp(e->name, "face") == 0)
+                h->faceElement = h->elementCount - 1;
+        }
+        else if (strcmp(tok, "property") == 0)
+        {
+            if (h->elementCount == 0)
+                return false;
+            const int   ei = h->elementCount - 1;
+            PlyElement* e  = &h->elements[ei];
+            if (e->propCount == MAX_PLY_PROPERTIES)
+                return false;
+            PlyProperty* prop = &e->props[e->propCount++];
+            q                 = nextToken(q, end, tok, sizeof(tok));
+            if (strcmp(tok, "list") == 0)
+            {
+                q               = nextToken(q, end, tok, sizeof(tok));
+                prop->countType = parsePlyType(tok);
+                q               = nextToken(q, end, tok, sizeof(tok));
+                if (prop->countType == PLY_NONE ||
+                    prop->countType >= PLY_FLOAT32)
+                    return false;
+            }
+            prop->type = parsePlyType(tok);
+            if (prop->type == PLY_NONE)
+                return false;
+            nextToken(q, end, prop->name, sizeof(prop->name));
+            prop->slot = -1;
+            if (ei == h->vertexElement && !prop->countType)
+            {
+                prop->slot = getPlySlot(prop->name);
+                if (prop->slot >= 0)
+                    h->slots[prop->slot] = true;
+            }
+            if (ei == h->faceElement && prop->countType &&
+                (strcmp(prop->name, "vertex_indices") == 0 ||
+                 strcmp(prop->name, "vertex_index") == 0))
+                h->indexProp = e->propCount - 1;
+        }
+    }
+    if (!hasFormat || h->bodyOffset == 0 || h->vertexElement < 0 ||
+        !h->slots[SLOT_X] || !h->slots[SLOT_Y] || !h->slots[SLOT_Z])
+        return false;
+    if (h->faceElement >= 0 && h->indexProp < 0)
+        return false;
+    for (uint32_t i = 0; i < h->elementCount; i++)
+    {
+        PlyElement* e = &h->elements[i];
+        for (uint32_t j = 0; j < e->propCount; j++)
+        {
+            if (e->props[j].countType)
+            {
+                e->stride = 0;
+                break;
+            }
+            e->stride += g_plyTypeSizes[e->props[j].type];
+        }
+    }
+    return h->elements[h->vertexElement].count <= UINT32_MAX;
+}
+
+static inline double
+readPlyScalar(const uint8_t* p, PlyType type, bool swap)
+{
+    uint8_t b[8];
+    if (swap)
+    {
+        const uint32_t size = g_plyTypeSizes[type];
+        for (uint32_t i = 0; i < size; i++)
+            b[i] = p[size - 1 - i];
+        p = b;
+    }
+    switch (type)
+    {
+    case PLY_INT8: return (int8_t)p[0];
+    case PLY_UINT8: return p[0];
+    case PLY_INT16: { int16_t v; memcpy(&v, p, 2); return v; }
+    case PLY_UINT16: { uint16_t v; memcpy(&v, p, 2); return v; }
+    case PLY_INT32: { int32_t v; memcpy(&v, p, 4); return v; }
+    case PLY_UINT32: { uint32_t v; memcpy(&v, p, 4); return v; }
+    case PLY_FLOAT32: { float v; memcpy(&v, p, 4); return v; }
+    case PLY_FLOAT64: { double v; memcpy(&v, p, 8); return v; }
+    default: return 0.0;
+    }
+}
+
+typedef struct {
+    const PlyHeader* header;
+    const uint8_t*   body;
+    const uint8_t*   end;
+    Onyx_FileGeo*    out;
+    float*           slotDst[SLOT_COUNT];
+    uint32_t         slotStride[SLOT_COUNT];
+    // binary
+    const uint8_t*   vertexData;
+    const uint8_t*   faceData;
+    uint32_t         faceStride;
+    uint32_t         countOffset;
+    uint32_t*        triangles;
+    volatile bool    notTriangles;
+    volatile bool    badIndex;
+    // ascii
+    TextRange*       ranges;
+    uint32_t         rangeCount;
+    uint64_t*        firstLines;
+    Array*           faceIndices;
+    bool*            failed;
+    uint64_t         elementFirstLines[MAX_PLY_ELEMENTS + 1];
+} PlyContext;
+
+static inline bool
+isBigEndian(void)
+{
+    const uint16_t one = 1;
+    return *(const uint8_t*)&one == 0;
+}
+
+static inline void
+storeVertexSlot(PlyContext* ctx, int slot, uint64_t vertex, double value)
+{
+    if (ctx->slotDst[slot])
+        ctx->slotDst[slot][vertex * ctx->slotStride[slot]] = (float)value;
+}
+
+// walks one instance of e at p, storing vertex slots if vertex isn't
+// UINT64_MAX. Returns NULL if the instance runs past end.
+static const uint8_t*
+walkPlyInstance(PlyContext* ctx, const PlyElement* e, const uint8_t* p,
+                uint64_t vertex, Array* triangles, bool* badIndex)
+{
+    const bool swap = (ctx->header->format == PLY_BINARY_BIG_ENDIAN) !=
+                      isBigEndian();
+    for (uint32_t i = 0; i < e->propCount; i++)
+    {
+        const PlyProperty* prop = &e->props[i];
+        const uint32_t     size = g_plyTypeSizes[prop->type];
+        if (!prop->countType)
+        {
+            if (size > (size_t)(ctx->end - p))
+                return NULL;
+            if (vertex != UINT64_MAX && prop->slot >= 0)
+                storeVertexSlot(ctx, prop->slot, vertex,
+                                readPlyScalar(p, prop->type, swap));
+            p += size;
+            continue;
+        }
+        const uint32_t countSize = g_plyTypeSizes[prop->countType];
+        if (countSize > (size_t)(ctx->end - p))
+            return NULL;
+        const double count = readPlyScalar(p, prop->countType, swap);
+        p += countSize;
+        if (count < 0 || count * size > (double)(ctx->end - p))
+            return NULL;
+        if (triangles && (int)i == ctx->header->indexProp)
+        {
+            uint32_t first = 0, prev = 0;
+            for (uint32_t k = 0; k < (uint32_t)count; k++)
+            {
+                const double   v   = readPlyScalar(p + k * size, prop->type, swap);
+                const uint32_t cur = (uint32_t)v;
+                if (v < 0 || v >= ctx->out->vertexCount)
+                    *badIndex = true;
+                if (k == 0)
+                    first = cur;
+                else if (k >= 2)
+                {
+                    uint32_t* tri = arrayPush(triangles, 3 * sizeof(uint32_t), 1);
+                    tri[0]        = first;
+                    tri[1]        = prev;
+                    tri[2]        = cur;
+                }
+                prev = cur;
+            }
+        }
+        p += (size_t)count * size;
+    }
+    return p;
+}
+
+static void
+decodePlyVertices(void* data, uint32_t task, uint32_t thread)
+{
+    PlyContext*       ctx   = data;
+    const PlyElement* e     = &ctx->header->elements[ctx->header->vertexElement];
+    const uint64_t    first = (uint64_t)task * RANGE_SIZE;
+    const uint64_t    last  = first + RANGE_SIZE < e->count ? first + RANGE_SIZE : e->count;
+    for (uint64_t v = first; v < last; v++)
+        walkPlyInstance(ctx, e, ctx->vertexData + v * e->stride, v, NULL, NULL);
+}
+
+// assumes every face is a triangle and flags notTriangles otherwise
+static void
+decodePlyTriangles(void* data, uint32_t task, uint32_t thread)
+{
+    PlyContext*        ctx  = data;
+    const PlyElement*  e    = &ctx->header->elements[ctx->header->faceElement];
+    const PlyProperty* prop = &e->props[ctx->header->indexProp];
+    const bool swap = (ctx->header->format == PLY_BINARY_BIG_ENDIAN) !=
+                      isBigEndian();
+    const uint32_t size       = g_plyTypeSizes[prop->type];
+    const uint32_t countSize  = g_plyTypeSizes[prop->countType];
+    const uint64_t first      = (uint64_t)task * RANGE_SIZE;
+    const uint64_t last  = first + RANGE_SIZE < e->count ? first + RANGE_SIZE : e->count;
+    const double   vertexCount = ctx->out->vertexCount;
+    for (uint64_t f = first; f < last && !ctx->notTriangles; f++)
+    {
+        const uint8_t* p = ctx->faceData + f * ctx->faceStride + ctx->countOffset;
+        if (readPlyScalar(p, prop->countType, swap) != 3)
+        {
+            ctx->notTriangles = true;
+            return;
+        }
+        p += countSize;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const double v = readPlyScalar(p + k * size, prop->type, swap);
+            if (v < 0 || v >= vertexCount)
+                ctx->badIndex = true;
+            ctx->triangles[f * 3 + k] = (uint32_t)v;
+        }
+    }
+}
+
+static const uint8_t*
+skipPlyElement(PlyContext* ctx, const PlyElement* e, const uint8_t* p)
+{
+    if (e->stride)
+        return e->count <= (uint64_t)(ctx->end - p) / e->stride
+                   ? p + e->count * e->stride
+                   : NULL;
+    for (uint64_t i = 0; i < e->count && p; i++)
+        p = walkPlyInstance(ctx, e, p, UINT64_MAX, NULL, NULL);
+    return p;
+}
+
+// returns the end of the face element, NULL if it is malformed
+static const uint8_t*
+decodePlyFaces(PlyContext* ctx, uint32_t threadCount, const uint8_t* p)
+{
+    const PlyHeader*   h    = ctx->header;
+    const PlyElement*  e    = &h->elements[h->faceElement];
+    const PlyProperty* prop = &e->props[h->indexProp];
+    // the stride if every face is a triangle, valid if the index list is the
+    // only list
+    bool     fixed  = e->count <= UINT32_MAX / 3;
+    uint32_t stride = 0;
+    for (uint32_t i = 0; i < e->propCount; i++)
+    {
+        if ((int)i == h->indexProp)
+        {
+            ctx->countOffset = stride;
+            stride += g_plyTypeSizes[prop->countType] + 3 * g_plyTypeSizes[prop->type];
+        }
+        else if (e->props[i].countType)
+            fixed = false;
+        else
+            stride += g_plyTypeSizes[e->props[i].type];
+    }
+    if (fixed && e->count <= (uint64_t)(ctx->end - p) / stride)
+    {
+        ctx->faceData   = p;
+        ctx->faceStride = stride;
+        ctx->triangles  = hell_Malloc((e->count ? e->count : 1) * 3 * sizeof(uint32_t));
+        onyx_ParallelFor(threadCount, taskCount(e->count, RANGE_SIZE),
+                         decodePlyTriangles, ctx);
+        if (!ctx->notTriangles)
+        {
+            setImportedIndices(ctx->out, ctx->triangles, (uint32_t)e->count * 3);
+            return ctx->badIndex ? NULL : p + e->count * stride;
+        }
+        hell_Free(ctx->triangles);
+    }
+    // polygons, fanned in order
+    Array triangles = {0};
+    bool  badIndex  = false;
+    for (uint64_t f = 0; f < e->count && p; f++)
+        p = walkPlyInstance(ctx, e, p, UINT64_MAX, &triangles, &badIndex);
+    if (!p || badIndex || triangles.count * 3 > UINT32_MAX)
+    {
+        arrayFree(&triangles);
+        return NULL;
+    }
+    if (!triangles.data)
+        triangles.data = hell_Malloc(sizeof(uint32_t));
+    setImportedIndices(ctx->out, triangles.data, (uint32_t)triangles.count * 3);
+    return p;
+}
+
+static bool
+decodePlyBinary(PlyContext* ctx, uint32_t threadCount)
+{
+    const PlyHeader* h = ctx->header;
+    const uint8_t*   p = ctx->body;
+    for (int i = 0; i < (int)h->elementCount && p; i++)
+    {
+        const PlyElement* e = &h->elements[i];
+        if (i == h->vertexElement && e->stride)
+        {
+            if (e->count > (uint64_t)(ctx->end - p) / e->stride)
+                return false;
+            ctx->vertexData = p;
+            onyx_ParallelFor(threadCount, taskCount(e->count, RANGE_SIZE),
+                             decodePlyVertices, ctx);
+            p += e->count * e->stride;
+        }
+        else if (i == h->vertexElement)
+        {
+            for (uint64_t v = 0; v < e->count && p; v++)
+                p = walkPlyInstance(ctx, e, p, v, NULL, NULL);
+        }
+        else if (i == h->faceElement)
+            p = decodePlyFaces(ctx, threadCount, p);
+        else
+            p = skipPlyElement(ctx, e, p);
+    }
+    return p != NULL;
+}
+
+// lines with anything but whitespace
+static inline bool
+isPlyLine(const char* p)
+{
+    return *p && *p != '\n';
+}
+
+static void
+countPlyLines(void* data, uint32_t task, uint32_t thread)
+{
+    PlyContext* ctx   = data;
+    TextRange   r     = ctx->ranges[task];
+    uint64_t    count = 0;
+    for (const char* p = r.begin; p < r.end; p = nextLine(p, r.end))
+        count += isPlyLine(skipSpace(p));
+    ctx->firstLines[task] = count;
+}
+
+static const char*
+parsePlyValue(const char* p, PlyType type, double* v)
+{
+    p = skipSpace(p);
+    if (type >= PLY_FLOAT32)
+    {
+        float f;
+        p  = parseFloat(p, &f);
+        *v = f;
+        return p;
+    }
+    int64_t i;
+    p  = parseInt(p, &i);
+    *v = (double)i;
+    return p;
+}
+
+static void
+parsePlyLines(void* data, uint32_t task, uint32_t thread)
+{
+    PlyContext*      ctx       = data;
+    const PlyHeader* h         = ctx->header;
+    TextRange        r         = ctx->ranges[task];
+    uint64_t         line      = ctx->firstLines[task];
+    Array*           triangles = &ctx->faceIndices[task];
+    uint32_t         ei        = 0;
+    const double     vertexCount = ctx->out->vertexCount;
+    for (const char* p = r.begin; p < r.end; p = nextLine(p, r.end))
+    {
+        p = skipSpace(p);
+        if (!isPlyLine(p))
+            continue;
+        while (ei < h->elementCount && line >= ctx->elementFirstLines[ei + 1])
+            ei++;
+        if (ei == h->elementCount)
+            break;
+        const uint64_t    instance = line++ - ctx->elementFirstLines[ei];
+        const PlyElement* e        = &h->elements[ei];
+        if ((int)ei != h->vertexElement && (int)ei != h->faceElement)
+            continue;
+        for (uint32_t i = 0; i < e->propCount; i++)
+        {
+            const PlyProperty* prop = &e->props[i];
+            double             v;
+            if (!prop->countType)
+            {
+                if (!(p = parsePlyValue(p, prop->type, &v)))
+                    goto fail;
+                if (prop->slot >= 0)
+                    storeVertexSlot(ctx, prop->slot, instance, v);
+                continue;
+            }
+            double count;
+            if (!(p = parsePlyValue(p, prop->countType, &count)) || count < 0)
+                goto fail;
+            const bool isIndices = (int)ei == h->faceElement && (int)i == h->indexProp;
+            uint32_t   first = 0, prev = 0;
+            for (uint32_t k = 0; k < (uint32_t)count; k++)
+            {
+                if (!(p = parsePlyValue(p, prop->type, &v)))
+                    goto fail;
+                if (!isIndices)
+                    continue;
+                if (v < 0 || v >= vertexCount)
+                    goto fail;
+                const uint32_t cur = (uint32_t)v;
+                if (k == 0)
+                    first = cur;
+                else if (k >= 2)
+                {
+                    uint32_t* tri = arrayPush(triangles, 3 * sizeof(uint32_t), 1);
+                    tri[0]        = first;
+                    tri[1]        = prev;
+                    tri[2]        = cur;
+                }
+                prev = cur;
+            }
+        }
+    }
+    return;
+fail:
+    ctx->failed[task] = true;
+}
+
+static bool
+decodePlyAscii(PlyContext* ctx, uint32_t threadCount)
+{
+    const PlyHeader* h = ctx->header;
+    for (uint32_t i = 0; i < h->elementCount; i++)
+        ctx->elementFirstLines[i + 1] =
+            ctx->elementFirstLines[i] + h->elements[i].count;
+    ctx->rangeCount  = splitLines((const char*)ctx->body, ctx->end - ctx->body,
+                                  &ctx->ranges);
+    const uint32_t n = ctx->rangeCount ? ctx->rangeCount : 1;
+    ctx->firstLines  = hell_Malloc(n * sizeof(uint64_t));
+    ctx->faceIndices = hell_Malloc(n * sizeof(Array));
+    ctx->failed      = hell_Malloc(n * sizeof(bool));
+    memset(ctx->faceIndices, 0, n * sizeof(Array));
+    memset(ctx->failed, 0, n * sizeof(bool));
+
+    onyx_ParallelFor(threadCount, ctx->rangeCount, countPlyLines, ctx);
+    uint64_t lineCount = 0;
+    for (uint32_t i = 0; i < ctx->rangeCount; i++)
+    {
+        const uint64_t count = ctx->firstLines[i];
+        ctx->firstLines[i]   = lineCount;
+        lineCount += count;
+    }
+    bool ok = lineCount >= ctx->elementFirstLines[h->elementCount];
+    if (ok)
+        onyx_ParallelFor(threadCount, ctx->rangeCount, parsePlyLines, ctx);
+
+    uint64_t indexCount = 0;
+    for (uint32_t i = 0; i < ctx->rangeCount; i++)
+    {
+        ok &= !ctx->failed[i];
+        indexCount += ctx->faceIndices[i].count * 3;
+    }
+    ok &= indexCount <= UINT32_MAX;
+    if (ok)
+    {
+        uint32_t* indices = hell_Malloc((indexCount ? indexCount : 1) * sizeof(uint32_t));
+        uint64_t  offset  = 0;
+        for (uint32_t i = 0; i < ctx->rangeCount; i++)
+        {
+            const size_t count = ctx->faceIndices[i].count * 3;
+            if (count)
+                memcpy(indices + offset, ctx->faceIndices[i].data,
+                       count * sizeof(uint32_t));
+            offset += count;
+        }
+        setImportedIndices(ctx->out, indices, (uint32_t)indexCount);
+    }
+    for (uint32_t i = 0; i < ctx->rangeCount; i++)
+        arrayFree(&ctx->faceIndices[i]);
+    hell_Free(ctx->faceIndices);
+    hell_Free(ctx->failed);
+    hell_Free(ctx->firstLines);
+    hell_Free(ctx->ranges);
+    return ok;
+}
+
+bool
+onyx_ImportPly(const char* filename, uint32_t threadCount, Onyx_FileGeo* fprim)
+{
+    size_t size;
+    char*  text = onyx_ReadWholeFile(filename, &size);
+    if (!text)
+        return false;
+    PlyHeader header;
+    if (!parsePlyHeader(text, size, &header))
+    {
+        DPRINT("Malformed ply header in %s\n", filename);
+        hell_Free(text);
+        return false;
+    }
+    const bool hasNormals =
+        header.slots[SLOT_NX] && header.slots[SLOT_NY] && header.slots[SLOT_NZ];
+    const bool hasUvs = header.slots[SLOT_U] && header.slots[SLOT_V];
+    createImportedGeo((uint32_t)header.elements[header.vertexElement].count,
+                      hasNormals, hasUvs, fprim);
+
+    PlyContext ctx = {
+        .header = &header,
+        .body   = (const uint8_t*)text + header.bodyOffset,
+        .end    = (const uint8_t*)text + size,
+        .out    = fprim,
+    };
+    // partial normals or uvs are dropped, their slots keep a NULL destination
+    for (int s = SLOT_X; s <= SLOT_Z; s++)
+    {
+        ctx.slotDst[s]    = (float*)fprim->attributes[0] + s;
+        ctx.slotStride[s] = 3;
+    }
+    if (hasNormals)
+        for (int s = SLOT_NX; s <= SLOT_NZ; s++)
+        {
+            ctx.slotDst[s]    = (float*)fprim->attributes[1] + s - SLOT_NX;
+            ctx.slotStride[s] = 3;
+        }
+    if (hasUvs)
+        for (int s = SLOT_U; s <= SLOT_V; s++)
+        {
+            ctx.slotDst[s]    = (float*)fprim->attributes[fprim->attrCount - 1] + s - SLOT_U;
+            ctx.slotStride[s] = 2;
+        }
+
+    bool ok;
+    if (header.format == PLY_ASCII)
+        ok = decodePlyAscii(&ctx, threadCount);
+    else
+        ok = decodePlyBinary(&ctx, threadCount);
+    if (ok)
+        onyx_UpdateFileGeoBounds(fprim);
+    hell_Free(text);
+    if (!ok)
+    {
+        DPRINT("Malformed ply file %s\n", filename);
+        onyx_FreeFileGeo(fprim);
+    }
+    return ok;
+}
+
+Onyx_GeoImportFormat
+onyx_GetGeoImportFormat(const char* filename)
+{
+    const char* ext = strrchr(filename, '.');
+    if (!ext || strlen(ext) != 4)
+        return ONYX_GEO_IMPORT_FORMAT_NONE;
+    char lower[4];
+    for (int i = 0; i < 4; i++)
+        lower[i] = tolower((unsigned char)ext[i]);
+    if (memcmp(lower, ".obj", 4) == 0)
+        return ONYX_GEO_IMPORT_FORMAT_OBJ;
+    if (memcmp(lower, ".ply", 4) == 0)
+        return ONYX_GEO_IMPORT_FORMAT_PLY;
+    return ONYX_GEO_IMPORT_FORMAT_NONE;
+}
+
+bool
+onyx_ImportFileGeo(const char* filename, uint32_t threadCount,
+                   Onyx_FileGeo* fprim)
+{
+    switch (onyx_GetGeoImportFormat(filename))
+    {
+    case ONYX_GEO_IMPORT_FORMAT_OBJ:
+        return onyx_ImportObj(filename, threadCount, fprim);
+    case ONYX_GEO_IMPORT_FORMAT_PLY:
+        return onyx_ImportPly(filename, threadCount, fprim);
+    default:
+        return false;
+    }
+}
@@ -543,6 +543,7 @@ onyx_CreateMemory(const Onyx_Instance* instance, const uint32_t hostGraphicsBuff
         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
         VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
         VK_BUFFER_USAGE_SHADER_BINDING_TABLE_BIT_KHR |
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 
     DPRINT("Onyx: Initializing memory block chains...\n");
@@ -707,9 +708,37 @@ onyx_CreateImage(Onyx_Memory* memory, const uint32_t width,
         pNext                   = &externalImageInfo;
     }
 
+    // sRGB formats can't be storage images, storage views of them have to
+    // use the UNORM format. The image lists both formats and takes usages
+    // only the UNORM one supports.
+    VkFormat storageFormat = VK_FORMAT_UNDEFINED;
+    if (usageFlags & VK_IMAGE_USAGE_STORAGE_BIT)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_R8G8B8A8_SRGB: storageFormat = VK_FORMAT_R8G8B8A8_UNORM; break;
+        case VK_FORMAT_B8G8R8A8_SRGB: storageFormat = VK_FORMAT_B8G8R8A8_UNORM; break;
+        case VK_FORMAT_R8_SRGB:       storageFormat = VK_FORMAT_R8_UNORM; break;
+        default: break;
+        }
+    }
+
+    const VkFormat viewFormats[2] = {format, storageFormat};
+    VkImageFormatListCreateInfo formatList = {
+        .sType           = VK_STRUCTURE_TYPE_IMAGE_FORMAT_LIST_CREATE_INFO,
+        .pNext           = pNext,
+        .viewFormatCount = 2,
+        .pViewFormats    = viewFormats};
+    if (storageFormat != VK_FORMAT_UNDEFINED)
+        pNext = &formatList;
+
     uint32_t          queueFamilyIndex = memory->instance->graphicsQueueFamily.index;
     VkImageCreateInfo imageInfo = {.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
                                    .pNext = pNext,
+                                   .flags = storageFormat != VK_FORMAT_UNDEFINED
+                                                ? VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT |
+                                                      VK_IMAGE_CREATE_EXTENDED_USAGE_BIT
+                                                : 0,
                                    .imageType   = VK_IMAGE_TYPE_2D,
                                    .format      = format,
                                    .extent      = {width, height, 1},
@@ -0,0 +1,569 @@
+#include "mipgen.h"
+#include "dtags.h"
+#include "pipeline.h"
+#include "video.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <hell/minmax.h>
+#include <stdio.h>
+#include <string.h>
+
+// A pass covers the image with 64x64 tiles. Each workgroup writes the 6
+// levels of its tile, one texel of the sixth, and bumps a counter. The one
+// that brings it to the group count finishes the up to 6 levels below from
+// that level, which is at most 64x64 when the base is at most 4096 wide.
+// Larger images take extra passes starting where the previous one stopped.
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_IMG, fmt, ##__VA_ARGS__)
+
+#define TILE_LEVELS   6
+#define PASS_LEVELS   (TILE_LEVELS * 2)
+#define TILE_SIZE     (1 << TILE_LEVELS)
+#define SETS_PER_POOL ONYX_MAX_DESCRIPTOR_SETS
+
+typedef struct {
+    VkFormat    format;
+    // sRGB formats can't be storage images so they are written through a
+    // UNORM view and encoded in the shader
+    VkFormat    viewFormat;
+    const char* qualifier;
+    // needs shaderStorageImageExtendedFormats
+    bool        extended;
+} StorageFormat;
+
+static const StorageFormat storageFormats[] = {
+    {VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, "rgba8", false},
+    {VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_R8G8B8A8_UNORM, "rgba8", false},
+    {VK_FORMAT_R8G8B8A8_SNORM, VK_FORMAT_R8G8B8A8_SNORM, "rgba8_snorm", false},
+    {VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT, "rgba16f",
+     false},
+    {VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT, "rgba32f",
+     false},
+    {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32_SFLOAT, "r32f", false},
+    {VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8_UNORM, "rg8", true},
+    {VK_FORMAT_R8_UNORM, VK_FORMAT_R8_UNORM, "r8", true},
+    {VK_FORMAT_R8_SRGB, VK_FORMAT_R8_UNORM, "r8", true},
+    {VK_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R16G16B16A16_UNORM, "rgba16",
+     true},
+    {VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, "rg16f", true},
+    {VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16_SFLOAT, "r16f", true},
+    {VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, "rg32f", true},
+    {VK_FORMAT_A2B10G10R10_UNORM_PACK32, VK_FORMAT_A2B10G10R10_UNORM_PACK32,
+     "rgb10_a2", true},
+    {VK_FORMAT_B10G11R11_UFLOAT_PACK32, VK_FORMAT_B10G11R11_UFLOAT_PACK32,
+     "r11f_g11f_b10f", true},
+};
+
+#define FORMAT_COUNT (sizeof(storageFormats) / sizeof(storageFormats[0]))
+
+typedef struct {
+    int32_t  width;
+    int32_t  height;
+    uint32_t levelCount;
+    uint32_t flags;
+    uint32_t groupCount;
+} PushConstants;
+
+struct Onyx_MipGenerator {
+    VkDevice              device;
+    Onyx_Memory*          memory;
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkPipelineLayout      pipelineLayout;
+    // made the first time a format is used
+    VkPipeline            pipelines[FORMAT_COUNT];
+    // supported, unsupported or not checked yet
+    int8_t                formatSupport[FORMAT_COUNT];
+    VkDescriptorPool*     pools;
+    uint32_t              poolCount;
+    uint32_t              usedPoolCount;
+    uint32_t              setsInLastPool;
+    // held until the next reset
+    VkImageView*          views;
+    uint32_t              viewCount;
+    uint32_t              viewCapacity;
+    Onyx_BufferRegion*    counters;
+    uint32_t              counterCount;
+    uint32_t              counterCapacity;
+};
+
+// level 0 of the pass is read and written through mips[0], levels past the
+// pass's levelCount are never touched. Levels are indexed with constants so
+// the shader doesn't need dynamic indexing of storage image arrays.
+static const char* shaderSource =
+    "layout(local_size_x = 256) in;\n"
+    "\n"
+    "layout(set = 0, binding = 0, FORMAT) uniform coherent image2D mips[13];\n"
+    "layout(set = 0, binding = 1) coherent buffer Counter { uint counter; };\n"
+    "\n"
+    "layout(push_constant) uniform PushConstants {\n"
+    "    ivec2 size;\n"
+    "    uint  levelCount;\n"
+    "    uint  flags;\n"
+    "    uint  groupCount;\n"
+    "} pc;\n"
+    "\n"
+    "#define SRGB_BIT           1u\n"
+    "#define ALPHA_WEIGHTED_BIT 2u\n"
+    "\n"
+    "shared vec4 tile[16][16];\n"
+    "shared bool last;\n"
+    "\n"
+    "ivec2 levelSize(uint level)\n"
+    "{\n"
+    "    return max(pc.size >> int(level), ivec2(1));\n"
+    "}\n"
+    "\n"
+    "vec3 toLinear(vec3 c)\n"
+    "{\n"
+    "    return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)),\n"
+    "               greaterThan(c, vec3(0.04045)));\n"
+    "}\n"
+    "\n"
+    "vec3 toSrgb(vec3 c)\n"
+    "{\n"
+    "    c = clamp(c, 0.0, 1.0);\n"
+    "    return mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055,\n"
+    "               greaterThan(c, vec3(0.0031308)));\n"
+    "}\n"
+    "\n"
+    "vec4 load(uint level, ivec2 c)\n"
+    "{\n"
+    "    c = min(c, levelSize(level) - 1);\n"
+    "    vec4 v;\n"
+    "    if (level == 0)\n"
+    "        v = imageLoad(mips[0], c);\n"
+    "    else\n"
+    "        v = imageLoad(mips[6], c);\n"
+    "    if ((pc.flags & SRGB_BIT) != 0u)\n"
+    "        v.rgb = toLinear(v.rgb);\n"
+    "    return v;\n"
+    "}\n"
+    "\n"
+    "void store(uint level, ivec2 c, vec4 v)\n"
+    "{\n"
+    "    if (level > pc.levelCount || any(greaterThanEqual(c, levelSize(level))))\n"
+    "        return;\n"
+    "    if ((pc.flags & SRGB_BIT) != 0u)\n"
+    "        v.rgb = toSrgb(v.rgb);\n"
+    "    switch (level)\n"
+    "    {\n"
+    "    case 1: imageStore(mips[1], c, v); break;\n"
+    "    case 2: imageStore(mips[2], c, v); break;\n"
+    "    case 3: imageStore(mips[3], c, v); break;\n"
+    "    case 4: imageStore(mips[4], c, v); break;\n"
+    "    case 5: imageStore(mips[5], c, v); break;\n"
+    "    case 6: imageStore(mips[6], c, v); break;\n"
+    "    case 7: imageStore(mips[7], c, v); break;\n"
+    "    case 8: imageStore(mips[8], c, v); break;\n"
+    "    case 9: imageStore(mips[9], c, v); break;\n"
+    "    case 10: imageStore(mips[10], c, v); break;\n"
+    "    case 11: imageStore(mips[11], c, v); break;\n"
+    "    case 12: imageStore(mips[12], c, v); break;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "vec4 reduce(vec4 a, vec4 b, vec4 c, vec4 d)\n"
+    "{\n"
+    "    if ((pc.flags & ALPHA_WEIGHTED_BIT) != 0u)\n"
+    "    {\n"
+    "        float w = a.a + b.a + c.a + d.a;\n"
+    "        if (w > 0.0)\n"
+    "            return vec4((a.rgb * a.a + b.rgb * b.a + c.rgb * c.a +\n"
+    "                         d.rgb * d.a) / w, w * 0.25);\n"
+    "    }\n"
+    "    return (a + b + c + d) * 0.25;\n"
+    "}\n"
+    "\n"
+    "// reduces the 64x64 texels of src at tileId down to one, writing the six\n"
+    "// levels below src on the way. Values are linear in shared memory.\n"
+    "void downsample(uint src, ivec2 tileId, uint t)\n"
+    "{\n"
+    "    ivec2 p = ivec2(int(t % 16u), int(t / 16u));\n"
+    "    vec4  q[4];\n"
+    "    for (int i = 0; i < 4; i++)\n"
+    "    {\n"
+    "        ivec2 c = tileId * 32 + p * 2 + ivec2(i & 1, i >> 1);\n"
+    "        ivec2 s = c * 2;\n"
+    "        q[i] = reduce(load(src, s), load(src, s + ivec2(1, 0)),\n"
+    "                      load(src, s + ivec2(0, 1)), load(src, s + ivec2(1, 1)));\n"
+    "        store(src + 1u, c, q[i]);\n"
+    "    }\n"
+    "    vec4 v = reduce(q[0], q[1], q[2], q[3]);\n"
+    "    store(src + 2u, tileId * 16 + p, v);\n"
+    "    tile[p.y][p.x] = v;\n"
+    "    for (uint level = src + 3u, n = 8u; level <= src + 6u; level++, n >>= 1)\n"
+    "    {\n"
+    "        barrier();\n"
+    "        bool  active = t < n * n;\n"
+    "        ivec2 c      = ivec2(int(t % n), int(t / n));\n"
+    "        if (active)\n"
+    "            v = reduce(tile[2 * c.y][2 * c.x], tile[2 * c.y][2 * c.x + 1],\n"
+    "                       tile[2 * c.y + 1][2 * c.x],\n"
+    "                       tile[2 * c.y + 1][2 * c.x + 1]);\n"
+    "        barrier();\n"
+    "        if (active)\n"
+    "        {\n"
+    "            tile[c.y][c.x] = v;\n"
+    "            store(level, tileId * int(n) + c, v);\n"
+    "        }\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    uint t = gl_LocalInvocationIndex;\n"
+    "    downsample(0u, ivec2(gl_WorkGroupID.xy), t);\n"
+    "    if (pc.levelCount <= 6u)\n"
+    "        return;\n"
+    "    // level 6 of this tile was written by thread 0\n"
+    "    if (t == 0u)\n"
+    "    {\n"
+    "        memoryBarrierImage();\n"
+    "        last = atomicAdd(counter, 1u) == pc.groupCount - 1u;\n"
+    "    }\n"
+    "    barrier();\n"
+    "    if (!last)\n"
+    "        return;\n"
+    "    memoryBarrierImage();\n"
+    "    downsample(6u, ivec2(0), t);\n"
+    "}\n";
+
+static int
+findFormat(VkFormat format)
+{
+    for (int i = 0; i < (int)FORMAT_COUNT; i++)
+        if (storageFormats[i].format == format)
+            return i;
+    return -1;
+}
+
+static bool
+isSrgb(VkFormat format)
+{
+    return format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_R8_SRGB;
+}
+
+static VkPipeline
+getPipeline(Onyx_MipGenerator* gen, int f)
+{
+    if (gen->pipelines[f])
+        return gen->pipelines[f];
+    const char* qualifier = storageFormats[f].qualifier;
+    const size_t size = strlen(shaderSource) + strlen(qualifier) + 64;
+    char*        source = hell_Malloc(size);
+    snprintf(source, size, "#version 460\n#define FORMAT %s\n%s", qualifier,
+             shaderSource);
+
+    VkShaderModule module;
+    onyx_CreateShaderModule(gen->device, source, "mipgen.comp",
+                            ONYX_SHADER_TYPE_COMPUTE, &module);
+    hell_Free(source);
+
+    const OnyxComputePipelineInfo info = {
+        .layout       = gen->pipelineLayout,
+        .shader_stage = {.stage       = VK_SHADER_STAGE_COMPUTE_BIT,
+                         .module      = module,
+                         .entry_point = "main"}};
+    onyx_create_compute_pipeline(gen->device, VK_NULL_HANDLE, &info,
+                                 &gen->pipelines[f]);
+    vkDestroyShaderModule(gen->device, module, NULL);
+    DPRINT("Created mip pipeline for %s\n", qualifier);
+    return gen->pipelines[f];
+}
+
+static VkDescriptorSet
+allocateSet(Onyx_MipGenerator* gen)
+{
+    if (gen->usedPoolCount == 0 || gen->setsInLastPool == SETS_PER_POOL)
+    {
+        if (gen->usedPoolCount == gen->poolCount)
+        {
+            gen->pools = hell_Realloc(gen->pools, (gen->poolCount + 1) *
+                                                      sizeof(VkDescriptorPool));
+            onyx_CreateDescriptorPool(gen->device, 0, 0, 0,
+                                      SETS_PER_POOL * (PASS_LEVELS + 1),
+                                      SETS_PER_POOL, 0, 0,
+                                      &gen->pools[gen->poolCount++]);
+        }
+        gen->usedPoolCount++;
+        gen->setsInLastPool = 0;
+    }
+    gen->setsInLastPool++;
+    VkDescriptorSet set;
+    onyx_AllocateDescriptorSets(gen->device, gen->pools[gen->usedPoolCount - 1],
+                                1, &gen->descriptorSetLayout, &set);
+    return set;
+}
+
+static VkImageView*
+addViews(Onyx_MipGenerator* gen, uint32_t count)
+{
+    if (gen->viewCount + count > gen->viewCapacity)
+    {
+        while (gen->viewCount + count > gen->viewCapacity)
+            gen->viewCapacity = gen->viewCapacity ? gen->viewCapacity * 2 : 64;
+        gen->views =
+            hell_Realloc(gen->views, gen->viewCapacity * sizeof(VkImageView));
+    }
+    VkImageView* views = gen->views + gen->viewCount;
+    gen->viewCount += count;
+    return views;
+}
+
+static Onyx_BufferRegion*
+addCounter(Onyx_MipGenerator* gen)
+{
+    if (gen->counterCount == gen->counterCapacity)
+    {
+        gen->counterCapacity =
+            gen->counterCapacity ? gen->counterCapacity * 2 : 16;
+        gen->counters = hell_Realloc(
+            gen->counters, gen->counterCapacity * sizeof(Onyx_BufferRegion));
+    }
+    Onyx_BufferRegion* counter = &gen->counters[gen->counterCount++];
+    *counter = onyx_RequestBufferRegion(gen->memory, sizeof(uint32_t),
+                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                        ONYX_MEMORY_DEVICE_TYPE);
+    return counter;
+}
+
+Onyx_MipGenerator*
+onyx_CreateMipGenerator(Onyx_Memory* memory)
+{
+    Onyx_MipGenerator* gen = hell_Malloc(sizeof(Onyx_MipGenerator));
+    memset(gen, 0, sizeof(*gen));
+    gen->memory = memory;
+    gen->device = onyx_GetDevice(onyx_GetMemoryInstance(memory));
+
+    const Onyx_DescriptorBinding bindings[] = {
+        {.descriptorCount = PASS_LEVELS + 1,
+         .type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+         .stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT},
+        {.descriptorCount = 1,
+         .type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+         .stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT}};
+    onyx_CreateDescriptorSetLayout(gen->device, 2, bindings,
+                                   &gen->descriptorSetLayout);
+
+    const VkPushConstantRange pushConstants = {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset     = 0,
+        .size       = sizeof(PushConstants)};
+    const Onyx_PipelineLayoutInfo layoutInfo = {
+        .descriptorSetCount   = 1,
+        .descriptorSetLayouts = &gen->descriptorSetLayout,
+        .pushConstantCount    = 1,
+        .pushConstantsRanges  = &pushConstants};
+    onyx_create_pipeline_layout(gen->device, &layoutInfo, &gen->pipelineLayout);
+    return gen;
+}
+
+void
+onyx_DestroyMipGenerator(Onyx_MipGenerator* gen)
+{
+    onyx_ResetMipGenerator(gen);
+    for (uint32_t i = 0; i < FORMAT_COUNT; i++)
+        if (gen->pipelines[i])
+            vkDestroyPipeline(gen->device, gen->pipelines[i], NULL);
+    for (uint32_t i = 0; i < gen->poolCount; i++)
+        vkDestroyDescriptorPool(gen->device, gen->pools[i], NULL);
+    vkDestroyPipelineLayout(gen->device, gen->pipelineLayout, NULL);
+    vkDestroyDescriptorSetLayout(gen->device, gen->descriptorSetLayout, NULL);
+    hell_Free(gen->pools);
+    hell_Free(gen->views);
+    hell_Free(gen->counters);
+    hell_Free(gen);
+}
+
+bool
+onyx_CanGenerateMips(Onyx_MipGenerator* gen, VkFormat format)
+{
+    const int f = findFormat(format);
+    if (f < 0)
+        return false;
+    if (gen->formatSupport[f] == 0)
+    {
+        const Onyx_Instance* instance = onyx_GetMemoryInstance(gen->memory);
+        VkFormatProperties   props;
+        vkGetPhysicalDeviceFormatProperties(onyx_GetPhysicalDevice(instance),
+                                            storageFormats[f].viewFormat,
+                                            &props);
+        const bool supported =
+            (props.optimalTilingFeatures &
+             VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) &&
+            (!storageFormats[f].extended ||
+             instance->enabledFeatures.shaderStorageImageExtendedFormats);
+        gen->formatSupport[f] = supported ? 1 : -1;
+    }
+    return gen->formatSupport[f] > 0;
+}
+
+bool
+onyx_CmdGenerateMips(Onyx_MipGenerator* gen, VkCommandBuffer cmdBuf,
+                     Onyx_Image* image, Onyx_MipFlags flags,
+                     VkImageLayout finalLayout)
+{
+    assert(image->usageFlags & VK_IMAGE_USAGE_STORAGE_BIT);
+    if (!onyx_CanGenerateMips(gen, image->format))
+    {
+        DPRINT("Can't generate mips for format %d\n", image->format);
+        return false;
+    }
+    const int      f          = findFormat(image->format);
+    const uint32_t levelCount = image->mipLevels;
+    if (isSrgb(image->format))
+        flags |= ONYX_MIP_SRGB_BIT;
+
+    if (levelCount == 1)
+    {
+        const VkImageMemoryBarrier barrier = {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask       = VK_ACCESS_MEMORY_WRITE_BIT,
+            .dstAccessMask       = VK_ACCESS_MEMORY_READ_BIT,
+            .oldLayout           = image->layout,
+            .newLayout           = finalLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = image->handle,
+            .subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+        vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, NULL, 0,
+                             NULL, 1, &barrier);
+        image->layout = finalLayout;
+        return true;
+    }
+
+    VkImageMemoryBarrier barriers[2] = {
+        {.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+         .srcAccessMask       = VK_ACCESS_MEMORY_WRITE_BIT,
+         .dstAccessMask       = VK_ACCESS_SHADER_READ_BIT,
+         .oldLayout           = image->layout,
+         .newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+         .image               = image->handle,
+         .subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}},
+        // the old contents of the other levels are thrown away
+        {.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+         .srcAccessMask       = 0,
+         .dstAccessMask       = VK_ACCESS_SHADER_READ_BIT |
+                          VK_ACCESS_SHADER_WRITE_BIT,
+         .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+         .newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+         .image               = image->handle,
+         .subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, 1,
+                                 VK_REMAINING_MIP_LEVELS, 0, 1}}};
+
+    VkImageView* views = addViews(gen, levelCount);
+    for (uint32_t i = 0; i < levelCount; i++)
+    {
+        const VkImageViewCreateInfo viewInfo = {
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image            = image->handle,
+            .viewType         = VK_IMAGE_VIEW_TYPE_2D,
+            .format           = storageFormats[f].viewFormat,
+            .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1}};
+        V_ASSERT(vkCreateImageView(gen->device, &viewInfo, NULL, &views[i]));
+    }
+
+    vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE,
+                      getPipeline(gen, f));
+    uint32_t n;
+    for (uint32_t base = 0; base + 1 < levelCount; base += n)
+    {
+        const uint32_t w = MAX(image->extent.width >> base, 1);
+        const uint32_t h = MAX(image->extent.height >> base, 1);
+        n = MIN(levelCount - 1 - base, PASS_LEVELS);
+        // the last workgroup can only take one tile
+        if (MAX(w, h) > TILE_SIZE << TILE_LEVELS)
+            n = MIN(n, TILE_LEVELS);
+
+        const Onyx_BufferRegion* counter = addCounter(gen);
+        vkCmdFillBuffer(cmdBuf, counter->buffer, counter->offset,
+                        sizeof(uint32_t), 0);
+        const VkMemoryBarrier memoryBarrier = {
+            .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT |
+                             VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT |
+                             VK_ACCESS_SHADER_WRITE_BIT};
+        if (base == 0)
+            vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                                 &memoryBarrier, 0, NULL, 2, barriers);
+        else
+            vkCmdPipelineBarrier(cmdBuf,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT |
+                                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                                 &memoryBarrier, 0, NULL, 0, NULL);
+
+        // every element has to be valid, the ones past n repeat the last level
+        VkDescriptorImageInfo imageInfos[PASS_LEVELS + 1];
+        for (uint32_t i = 0; i <= PASS_LEVELS; i++)
+            imageInfos[i] = (VkDescriptorImageInfo){
+                .imageView   = views[base + MIN(i, n)],
+                .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+        const VkDescriptorBufferInfo bufferInfo = {
+            .buffer = counter->buffer,
+            .offset = counter->offset,
+            .range  = sizeof(uint32_t)};
+        const VkDescriptorSet      set    = allocateSet(gen);
+        const VkWriteDescriptorSet writes[] = {
+            {.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+             .dstSet          = set,
+             .dstBinding      = 0,
+             .descriptorCount = PASS_LEVELS + 1,
+             .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+             .pImageInfo      = imageInfos},
+            {.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+             .dstSet          = set,
+             .dstBinding      = 1,
+             .descriptorCount = 1,
+             .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+             .pBufferInfo     = &bufferInfo}};
+        vkUpdateDescriptorSets(gen->device, 2, writes, 0, NULL);
+        vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                gen->pipelineLayout, 0, 1, &set, 0, NULL);
+
+        const uint32_t groupsX = (w + TILE_SIZE - 1) / TILE_SIZE;
+        const uint32_t groupsY = (h + TILE_SIZE - 1) / TILE_SIZE;
+        const PushConstants pc = {.width      = w,
+                                  .height     = h,
+                                  .levelCount = n,
+                                  .flags      = flags,
+                                  .groupCount = groupsX * groupsY};
+        vkCmdPushConstants(cmdBuf, gen->pipelineLayout,
+                           VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pc), &pc);
+        vkCmdDispatch(cmdBuf, groupsX, groupsY, 1);
+    }
+
+    barriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    barriers[0].oldLayout     = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[0].newLayout     = finalLayout;
+    barriers[0].subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+    vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, NULL, 0,
+                         NULL, 1, barriers);
+    image->layout = finalLayout;
+    return true;
+}
+
+void
+onyx_ResetMipGenerator(Onyx_MipGenerator* gen)
+{
+    for (uint32_t i = 0; i < gen->usedPoolCount; i++)
+        vkResetDescriptorPool(gen->device, gen->pools[i], 0);
+    gen->usedPoolCount  = 0;
+    gen->setsInLastPool = 0;
+    for (uint32_t i = 0; i < gen->viewCount; i++)
+        vkDestroyImageView(gen->device, gen->views[i], NULL);
+    gen->viewCount = 0;
+    for (uint32_t i = 0; i < gen->counterCount; i++)
+        onyx_FreeBufferRegion(&gen->counters[i]);
+    gen->counterCount = 0;
+}
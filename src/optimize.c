@@ -0,0 +1,332 @@
+#include "meshproc.h"
+#include "attribute.h"
+#include <hell/common.h>
+#include <math.h>
+#include <string.h>
+
+// Triangles are reordered with Forsyth's linear speed vertex cache
+// optimization. Vertices are scored by their position in a simulated LRU
+// cache and by how many of their triangles are left, and the next triangle is
+// the best scoring one among those touching the cache. When none is left the
+// next triangle in input order starts over. Vertices are then reordered in
+// the order the triangles first use them, so vertex fetch walks memory
+// forward.
+
+#define NONE UINT32_MAX
+
+#define CACHE_SIZE       32
+#define CACHE_DECAY      1.5f
+#define LAST_TRI_SCORE   0.75f
+#define VALENCE_SCALE    2.0f
+#define VALENCE_POWER    0.5f
+// scores are looked up for valences up to this
+#define MAX_VALENCE      64
+
+typedef struct {
+    uint32_t  vertexCount;
+    uint32_t  triCount;
+    const uint32_t* indices;
+    // the triangles of each vertex that are not emitted yet, in a shared array
+    uint32_t* triOffsets;
+    uint32_t* triCounts;
+    uint32_t* tris;
+    int32_t*  cachePos;
+    float*    vertexScores;
+    float*    triScores;
+    bool*     emitted;
+    float     cacheScores[CACHE_SIZE];
+    float     valenceScores[MAX_VALENCE + 1];
+} CacheContext;
+
+static float
+scoreVertex(const CacheContext* c, uint32_t v)
+{
+    const uint32_t remaining = c->triCounts[v];
+    if (remaining == 0)
+        return -1.f;
+    const float cache = c->cachePos[v] < 0 ? 0.f : c->cacheScores[c->cachePos[v]];
+    const float valence =
+        remaining <= MAX_VALENCE
+            ? c->valenceScores[remaining]
+            : VALENCE_SCALE * powf((float)remaining, -VALENCE_POWER);
+    return cache + valence;
+}
+
+static void
+initCacheContext(CacheContext* c, const uint32_t* indices, uint32_t indexCount,
+                 uint32_t vertexCount)
+{
+    c->vertexCount  = vertexCount;
+    c->triCount     = indexCount / 3;
+    c->indices      = indices;
+    c->triOffsets   = hell_Malloc((vertexCount + 1) * sizeof(uint32_t));
+    c->triCounts    = hell_Malloc(vertexCount * sizeof(uint32_t));
+    c->tris         = hell_Malloc((c->triCount * 3 + 1) * sizeof(uint32_t));
+    c->cachePos     = hell_Malloc(vertexCount * sizeof(int32_t));
+    c->vertexScores = hell_Malloc(vertexCount * sizeof(float));
+    c->triScores    = hell_Malloc((c->triCount + 1) * sizeof(float));
+    c->emitted      = hell_Malloc(c->triCount + 1);
+
+    for (int i = 0; i < CACHE_SIZE; i++)
+        c->cacheScores[i] =
+            i < 3 ? LAST_TRI_SCORE
+                  : powf(1.f - (float)(i - 3) / (CACHE_SIZE - 3), CACHE_DECAY);
+    c->valenceScores[0] = 0.f;
+    for (int i = 1; i <= MAX_VALENCE; i++)
+        c->valenceScores[i] = VALENCE_SCALE * powf((float)i, -VALENCE_POWER);
+
+    memset(c->triCounts, 0, vertexCount * sizeof(uint32_t));
+    for (uint32_t i = 0; i < c->triCount * 3; i++)
+    {
+        assert(indices[i] < vertexCount);
+        c->triCounts[indices[i]]++;
+    }
+    uint32_t offset = 0;
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        c->triOffsets[v] = offset;
+        offset += c->triCounts[v];
+        c->triCounts[v] = 0;
+    }
+    c->triOffsets[vertexCount] = offset;
+    for (uint32_t t = 0; t < c->triCount; t++)
+        for (int k = 0; k < 3; k++)
+        {
+            const uint32_t v = indices[t * 3 + k];
+            c->tris[c->triOffsets[v] + c->triCounts[v]++] = t;
+        }
+
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        c->cachePos[v]     = -1;
+        c->vertexScores[v] = scoreVertex(c, v);
+    }
+    for (uint32_t t = 0; t < c->triCount; t++)
+    {
+        const uint32_t* tri = indices + t * 3;
+        c->triScores[t]     = c->vertexScores[tri[0]] +
+                          c->vertexScores[tri[1]] +
+                          c->vertexScores[tri[2]];
+        c->emitted[t] = false;
+    }
+}
+
+static void
+freeCacheContext(CacheContext* c)
+{
+    hell_Free(c->triOffsets);
+    hell_Free(c->triCounts);
+    hell_Free(c->tris);
+    hell_Free(c->cachePos);
+    hell_Free(c->vertexScores);
+    hell_Free(c->triScores);
+    hell_Free(c->emitted);
+}
+
+static void
+removeTri(CacheContext* c, uint32_t v, uint32_t t)
+{
+    uint32_t* tris = c->tris + c->triOffsets[v];
+    for (uint32_t i = 0; i < c->triCounts[v]; i++)
+    {
+        if (tris[i] == t)
+        {
+            tris[i] = tris[--c->triCounts[v]];
+            return;
+        }
+    }
+    assert(0 && "triangle not in vertex list");
+}
+
+void
+onyx_OptimizeVertexCache(uint32_t* dst, const uint32_t* indices,
+                         uint32_t indexCount, uint32_t vertexCount)
+{
+    assert(indexCount % 3 == 0);
+    if (indexCount == 0)
+        return;
+    // dst may alias indices
+    uint32_t* src = hell_Malloc(indexCount * sizeof(uint32_t));
+    memcpy(src, indices, indexCount * sizeof(uint32_t));
+
+    CacheContext c;
+    initCacheContext(&c, src, indexCount, vertexCount);
+
+    // the cache holds up to 3 more entries while a triangle is added
+    uint32_t cache[CACHE_SIZE + 3];
+    uint32_t cacheCount = 0;
+    uint32_t cursor     = 0;
+    uint32_t best       = NONE;
+    for (uint32_t out = 0; out < c.triCount; out++)
+    {
+        if (best == NONE)
+        {
+            while (c.emitted[cursor])
+                cursor++;
+            best = cursor;
+        }
+        const uint32_t* tri = src + best * 3;
+        memcpy(dst + out * 3, tri, 3 * sizeof(uint32_t));
+        c.emitted[best] = true;
+
+        // the triangle's vertices move to the front, the rest keep their
+        // order behind them
+        uint32_t newCache[CACHE_SIZE + 3];
+        uint32_t newCount = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            removeTri(&c, tri[k], best);
+            newCache[newCount++] = tri[k];
+        }
+        for (uint32_t i = 0; i < cacheCount; i++)
+        {
+            const uint32_t v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                newCache[newCount++] = v;
+        }
+        for (uint32_t i = 0; i < newCount; i++)
+        {
+            const uint32_t v = newCache[i];
+            c.cachePos[v]    = i < CACHE_SIZE ? (int32_t)i : -1;
+            const float score = scoreVertex(&c, v);
+            const float delta = score - c.vertexScores[v];
+            c.vertexScores[v] = score;
+            const uint32_t* vtris = c.tris + c.triOffsets[v];
+            for (uint32_t j = 0; j < c.triCounts[v]; j++)
+                c.triScores[vtris[j]] += delta;
+        }
+        cacheCount = newCount < CACHE_SIZE ? newCount : CACHE_SIZE;
+        memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+
+        best            = NONE;
+        float bestScore = -1.f;
+        for (uint32_t i = 0; i < cacheCount; i++)
+        {
+            const uint32_t  v     = cache[i];
+            const uint32_t* vtris = c.tris + c.triOffsets[v];
+            for (uint32_t j = 0; j < c.triCounts[v]; j++)
+            {
+                if (c.triScores[vtris[j]] > bestScore)
+                {
+                    bestScore = c.triScores[vtris[j]];
+                    best      = vtris[j];
+                }
+            }
+        }
+    }
+
+    freeCacheContext(&c);
+    hell_Free(src);
+}
+
+float
+onyx_GetVertexCacheAcmr(const uint32_t* indices, uint32_t indexCount,
+                        uint32_t vertexCount, uint32_t cacheSize)
+{
+    if (indexCount < 3)
+        return 0.f;
+    // a FIFO cache. timestamps tell whether a vertex is still in it.
+    uint32_t* stamps = hell_Malloc(vertexCount * sizeof(uint32_t));
+    memset(stamps, 0, vertexCount * sizeof(uint32_t));
+    uint32_t misses = 0;
+    for (uint32_t i = 0; i < indexCount; i++)
+    {
+        const uint32_t v = indices[i];
+        assert(v < vertexCount);
+        if (stamps[v] == 0 || misses + 1 - stamps[v] > cacheSize)
+            stamps[v] = ++misses;
+    }
+    hell_Free(stamps);
+    return (float)misses / (indexCount / 3);
+}
+
+void
+onyx_OptimizeFileGeo(Onyx_FileGeo* fgeo)
+{
+    assert(!fgeo->mapData && "read the geo with onyx_ReadFileGeo to modify it");
+    if (fgeo->indexCount == 0 || fgeo->vertexCount == 0)
+        return;
+    // each level is drawn on its own so each gets its own order
+    if (fgeo->lodCount < 2)
+        onyx_OptimizeVertexCache(fgeo->indices, fgeo->indices,
+                                 fgeo->indexCount, fgeo->vertexCount);
+    else
+        for (uint32_t l = 0; l < fgeo->lodCount; l++)
+        {
+            uint32_t* lod = fgeo->indices + fgeo->lods[l].firstIndex;
+            onyx_OptimizeVertexCache(lod, lod, fgeo->lods[l].indexCount,
+                                     fgeo->vertexCount);
+        }
+
+    // vertices in the order the full detail level first uses them, then those
+    // only the coarser levels use, then unused ones
+    const uint32_t total =
+        onyx_GetTotalIndexCount(fgeo->indexCount, fgeo->lodCount, fgeo->lods);
+    uint32_t* remap = hell_Malloc(fgeo->vertexCount * sizeof(uint32_t));
+    memset(remap, 0xff, fgeo->vertexCount * sizeof(uint32_t));
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < total; i++)
+    {
+        uint32_t* index = &fgeo->indices[i];
+        if (remap[*index] == NONE)
+            remap[*index] = next++;
+        *index = remap[*index];
+    }
+    for (uint32_t v = 0; v < fgeo->vertexCount; v++)
+        if (remap[v] == NONE)
+            remap[v] = next++;
+
+    size_t maxSize = 0;
+    for (uint32_t a = 0; a < fgeo->attrCount; a++)
+        maxSize = fgeo->attrSizes[a] > maxSize ? fgeo->attrSizes[a] : maxSize;
+    uint8_t* scratch = hell_Malloc(fgeo->vertexCount * maxSize);
+    for (uint32_t a = 0; a < fgeo->attrCount; a++)
+    {
+        const size_t size  = fgeo->attrSizes[a];
+        uint8_t*     plane = fgeo->attributes[a];
+        for (uint32_t v = 0; v < fgeo->vertexCount; v++)
+            memcpy(scratch + remap[v] * size, plane + v * size, size);
+        memcpy(plane, scratch, fgeo->vertexCount * size);
+    }
+    hell_Free(scratch);
+    hell_Free(remap);
+}
+
+bool
+onyx_QuantizeFileGeo(Onyx_FileGeo* fgeo, const char* attrName,
+                     uint32_t mantissaBits)
+{
+    assert(!fgeo->mapData && "read the geo with onyx_ReadFileGeo to modify it");
+    if (mantissaBits >= 23)
+        return true;
+    // round to nearest, ties away from zero, by adding half of the dropped
+    // part. a carry into the exponent is the correct rounded value.
+    const uint32_t dropped = 23 - mantissaBits;
+    const uint32_t half    = 1u << (dropped - 1);
+    const uint32_t mask    = ~((1u << dropped) - 1);
+    bool           found   = false;
+    for (uint32_t a = 0; a < fgeo->attrCount; a++)
+    {
+        if (fgeo->attrSizes[a] % sizeof(float) != 0)
+            continue;
+        if (attrName &&
+            strncmp(fgeo->attrNames[a], attrName, ATTR_NAME_LEN) != 0)
+            continue;
+        found                = true;
+        uint32_t*    words   = fgeo->attributes[a];
+        const size_t count   =
+            (size_t)fgeo->vertexCount * fgeo->attrSizes[a] / sizeof(float);
+        for (size_t i = 0; i < count; i++)
+        {
+            // leave infinities and nans alone
+            if ((words[i] & 0x7f800000) == 0x7f800000)
+                continue;
+            const uint32_t q = (words[i] + half) & mask;
+            // the largest values would round up to infinity
+            words[i] = (q & 0x7f800000) == 0x7f800000 ? words[i] & mask : q;
+        }
+        if (strncmp(fgeo->attrNames[a], POS_NAME, ATTR_NAME_LEN) == 0)
+            fgeo->boundsValid = false;
+    }
+    return found;
+}
@@ -0,0 +1,344 @@
+#include "parallel.h"
+#include "dtags.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if UNIX
+#include <pthread.h>
+#include <unistd.h>
+#elif WIN32
+#include <windows.h>
+#endif
+
+#define DPRINT(fmt, ...) \
+    hell_DebugPrint(ONYX_DEBUG_TAG_PARALLEL, fmt, ##__VA_ARGS__)
+
+#define MAX_THREADS 64
+
+typedef struct {
+    Onyx_ParallelTaskFn fn;
+    void*               data;
+    uint32_t            taskCount;
+    volatile uint32_t   nextTask;
+} Job;
+
+typedef struct {
+    Job*     job;
+    uint32_t thread;
+} Worker;
+
+static uint32_t
+fetchAdd(volatile uint32_t* v)
+{
+#if WIN32
+    return InterlockedIncrement((volatile LONG*)v) - 1;
+#else
+    return __atomic_fetch_add(v, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+static void
+runJob(Job* job, uint32_t thread)
+{
+    for (uint32_t task = fetchAdd(&job->nextTask); task < job->taskCount;
+         task          = fetchAdd(&job->nextTask))
+        job->fn(job->data, task, thread);
+}
+
+#if UNIX
+static void*
+workerMain(void* arg)
+{
+    Worker* w = arg;
+    runJob(w->job, w->thread);
+    return NULL;
+}
+#elif WIN32
+static DWORD WINAPI
+workerMain(LPVOID arg)
+{
+    Worker* w = arg;
+    runJob(w->job, w->thread);
+    return 0;
+}
+#endif
+
+uint32_t
+onyx_GetHardwareThreadCount(void)
+{
+#if UNIX
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (uint32_t)n : 1;
+#elif WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    return 1;
+#endif
+}
+
+void
+onyx_ParallelFor(uint32_t threadCount, uint32_t taskCount,
+                 Onyx_ParallelTaskFn fn, void* data)
+{
+    if (threadCount == 0)
+        threadCount = onyx_GetHardwareThreadCount();
+    if (threadCount > taskCount)
+        threadCount = taskCount;
+    if (threadCount > MAX_THREADS)
+        threadCount = MAX_THREADS;
+
+    Job job = {.fn = fn, .data = data, .taskCount = taskCount};
+
+    if (threadCount <= 1)
+    {
+        runJob(&job, 0);
+        return;
+    }
+
+    Worker workers[MAX_THREADS];
+#if UNIX
+    pthread_t threads[MAX_THREADS];
+#elif WIN32
+    HANDLE threads[MAX_THREADS];
+#endif
+    // thread 0 is the caller
+    uint32_t spawned = 1;
+    for (; spawned < threadCount; spawned++)
+    {
+        workers[spawned] = (Worker){.job = &job, .thread = spawned};
+#if UNIX
+        if (pthread_create(&threads[spawned], NULL, workerMain,
+                           &workers[spawned]) != 0)
+            break;
+#elif WIN32
+        threads[spawned] =
+            CreateThread(NULL, 0, workerMain, &workers[spawned], 0, NULL);
+        if (!threads[spawned])
+            break;
+#endif
+    }
+    if (spawned < threadCount)
+        DPRINT("Could only start %d of %d threads\n", spawned, threadCount);
+
+    runJob(&job, 0);
+
+    for (uint32_t i = 1; i < spawned; i++)
+    {
+#if UNIX
+        pthread_join(threads[i], NULL);
+#elif WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#endif
+    }
+}
+
+// TASK POOL
+
+typedef struct PoolTask {
+    Onyx_PoolTaskFn  fn;
+    void*            data;
+    struct PoolTask* next;
+} PoolTask;
+
+typedef struct {
+    Onyx_TaskPool* pool;
+    uint32_t       thread;
+} PoolWorker;
+
+struct Onyx_TaskPool {
+#if UNIX
+    pthread_mutex_t mutex;
+    // signaled when a task is queued or the pool stops
+    pthread_cond_t  queued;
+    // signaled when a task finishes
+    pthread_cond_t  done;
+    pthread_t       threads[MAX_THREADS];
+#elif WIN32
+    SRWLOCK            mutex;
+    CONDITION_VARIABLE queued;
+    CONDITION_VARIABLE done;
+    HANDLE             threads[MAX_THREADS];
+#endif
+    PoolWorker workers[MAX_THREADS];
+    uint32_t   threadCount;
+    PoolTask*  head;
+    PoolTask*  tail;
+    // queued plus running
+    uint32_t   pending;
+    uint64_t   finished;
+    bool       stopping;
+};
+
+#if UNIX
+#define LOCK(p)          pthread_mutex_lock(&(p)->mutex)
+#define UNLOCK(p)        pthread_mutex_unlock(&(p)->mutex)
+#define WAIT(p, cond)    pthread_cond_wait(&(p)->cond, &(p)->mutex)
+#define SIGNAL(p, cond)  pthread_cond_signal(&(p)->cond)
+#define BROADCAST(p, cond) pthread_cond_broadcast(&(p)->cond)
+#elif WIN32
+#define LOCK(p)          AcquireSRWLockExclusive(&(p)->mutex)
+#define UNLOCK(p)        ReleaseSRWLockExclusive(&(p)->mutex)
+#define WAIT(p, cond)                                                          \
+    SleepConditionVariableSRW(&(p)->cond, &(p)->mutex, INFINITE, 0)
+#define SIGNAL(p, cond)  WakeConditionVariable(&(p)->cond)
+#define BROADCAST(p, cond) WakeAllConditionVariable(&(p)->cond)
+#endif
+
+static void
+runPoolWorker(PoolWorker* w)
+{
+    Onyx_TaskPool* pool = w->pool;
+    LOCK(pool);
+    for (;;)
+    {
+        while (!pool->head && !pool->stopping)
+            WAIT(pool, queued);
+        if (!pool->head)
+            break;
+        PoolTask* task = pool->head;
+        pool->head     = task->next;
+        if (!pool->head)
+            pool->tail = NULL;
+        UNLOCK(pool);
+        task->fn(task->data, w->thread);
+        hell_Free(task);
+        LOCK(pool);
+        pool->pending--;
+        pool->finished++;
+        BROADCAST(pool, done);
+    }
+    UNLOCK(pool);
+}
+
+#if UNIX
+static void*
+poolWorkerMain(void* arg)
+{
+    runPoolWorker(arg);
+    return NULL;
+}
+#elif WIN32
+static DWORD WINAPI
+poolWorkerMain(LPVOID arg)
+{
+    runPoolWorker(arg);
+    return 0;
+}
+#endif
+
+Onyx_TaskPool*
+onyx_CreateTaskPool(uint32_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = onyx_GetHardwareThreadCount();
+    if (threadCount > MAX_THREADS)
+        threadCount = MAX_THREADS;
+    Onyx_TaskPool* pool = hell_Malloc(sizeof(Onyx_TaskPool));
+    memset(pool, 0, sizeof(*pool));
+#if UNIX
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->queued, NULL);
+    pthread_cond_init(&pool->done, NULL);
+#elif WIN32
+    InitializeSRWLock(&pool->mutex);
+    InitializeConditionVariable(&pool->queued);
+    InitializeConditionVariable(&pool->done);
+#endif
+    for (; pool->threadCount < threadCount; pool->threadCount++)
+    {
+        PoolWorker* w = &pool->workers[pool->threadCount];
+        *w            = (PoolWorker){.pool = pool, .thread = pool->threadCount};
+#if UNIX
+        if (pthread_create(&pool->threads[pool->threadCount], NULL,
+                           poolWorkerMain, w) != 0)
+            break;
+#elif WIN32
+        pool->threads[pool->threadCount] =
+            CreateThread(NULL, 0, poolWorkerMain, w, 0, NULL);
+        if (!pool->threads[pool->threadCount])
+            break;
+#endif
+    }
+    if (pool->threadCount < threadCount)
+        DPRINT("Could only start %d of %d pool threads\n", pool->threadCount,
+               threadCount);
+    if (pool->threadCount == 0)
+    {
+        onyx_DestroyTaskPool(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+uint32_t
+onyx_GetTaskPoolThreadCount(const Onyx_TaskPool* pool)
+{
+    return pool->threadCount;
+}
+
+void
+onyx_SubmitPoolTask(Onyx_TaskPool* pool, Onyx_PoolTaskFn fn, void* data)
+{
+    PoolTask* task = hell_Malloc(sizeof(PoolTask));
+    *task          = (PoolTask){.fn = fn, .data = data};
+    LOCK(pool);
+    assert(!pool->stopping);
+    if (pool->tail)
+        pool->tail->next = task;
+    else
+        pool->head = task;
+    pool->tail = task;
+    pool->pending++;
+    SIGNAL(pool, queued);
+    UNLOCK(pool);
+}
+
+void
+onyx_WaitTaskPool(Onyx_TaskPool* pool)
+{
+    LOCK(pool);
+    while (pool->pending)
+        WAIT(pool, done);
+    UNLOCK(pool);
+}
+
+uint64_t
+onyx_WaitPoolTaskDone(Onyx_TaskPool* pool, uint64_t finished)
+{
+    LOCK(pool);
+    while (pool->finished <= finished && pool->pending)
+        WAIT(pool, done);
+    finished = pool->finished;
+    UNLOCK(pool);
+    return finished;
+}
+
+void
+onyx_DestroyTaskPool(Onyx_TaskPool* pool)
+{
+    LOCK(pool);
+    pool->stopping = true;
+    BROADCAST(pool, queued);
+    UNLOCK(pool);
+    for (uint32_t i = 0; i < pool->threadCount; i++)
+    {
+#if UNIX
+        pthread_join(pool->threads[i], NULL);
+#elif WIN32
+        WaitForSingleObject(pool->threads[i], INFINITE);
+        CloseHandle(pool->threads[i]);
+#endif
+    }
+#if UNIX
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->queued);
+    pthread_cond_destroy(&pool->done);
+#endif
+    hell_Free(pool);
+}
@@ -1,4 +1,5 @@
 #include "pipeline.h"
+#include "asyncio.h"
 #include "raytrace.h"
 #include "video.h"
 #include "render.h"
@@ -105,38 +106,6 @@ static void setBlendModeEraseMonochrome(VkPipelineColorBlendAttachmentState* sta
     state->alphaBlendOp = VK_BLEND_OP_ADD;
 }
 
-static void initShaderModule(const VkDevice device, const char* filepath, VkShaderModule* module)
-{
-    int fr;
-    FILE* fp;
-    fp = fopen(filepath, "rb");
-    if (fp == 0)
-    {
-        hell_Error(HELL_ERR_FATAL, "Failed to open %s\n", filepath);
-    }
-    fr = fseek(fp, 0, SEEK_END);
-    if (fr != 0)
-    {
-        hell_Error(HELL_ERR_FATAL, "Seek failed on %s\n", filepath);
-    }
-    assert( fr == 0 ); // success 
-    size_t codeSize = ftell(fp);
-    rewind(fp);
-
-    unsigned char* code = hell_Malloc(codeSize);
-    fread(code, 1, codeSize, fp);
-    fclose(fp);
-
-    const VkShaderModuleCreateInfo shaderInfo = {
-        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-        .codeSize = codeSize,
-        .pCode = (uint32_t*)code,
-    };
-
-    V_ASSERT( vkCreateShaderModule(device, &shaderInfo, NULL, module) );
-    hell_Free(code);
-}
-
 #define SPVDIR "onyx"
 
 static void setResolvedShaderPath(const char* shaderName, char* pathBuffer)
@@ -200,12 +169,35 @@ static void setResolvedShaderPath(const char* shaderName, char* pathBuffer)
     hell_Error(HELL_ERR_FATAL, "Shader %s not found.", shaderName);
 }
 
-static const char* getResolvedSprivPath(const char* shaderName)
+// Reads every shader with one batch of reads before creating the modules.
+static void initShaderModules(const VkDevice device, const uint32_t count, const char* const shaderNames[/*count*/],
+        VkShaderModule modules[/*count*/])
 {
-    static char spvpath[ONYX_MAX_PATH_LEN];
-    setResolvedShaderPath(shaderName, spvpath);
-    hell_DebugPrint(ONYX_DEBUG_TAG_SHADE, "Resolved spv path: %s\n", spvpath);
-    return spvpath;
+    char (*spvpaths)[ONYX_MAX_PATH_LEN] = hell_Malloc((count + 1) * ONYX_MAX_PATH_LEN);
+    Onyx_FileRead* reads = hell_Malloc((count + 1) * sizeof(Onyx_FileRead));
+    for (uint32_t i = 0; i < count; i++) 
+    {
+        setResolvedShaderPath(shaderNames[i], spvpaths[i]);
+        hell_DebugPrint(ONYX_DEBUG_TAG_SHADE, "Resolved spv path: %s\n", spvpaths[i]);
+        reads[i] = (Onyx_FileRead){.filename = spvpaths[i], .size = ONYX_READ_TO_END};
+    }
+    onyx_ReadFiles(count, reads);
+    for (uint32_t i = 0; i < count; i++) 
+    {
+        if (!reads[i].ok)
+            hell_Error(HELL_ERR_FATAL, "Failed to read %s\n", spvpaths[i]);
+
+        const VkShaderModuleCreateInfo shaderInfo = {
+            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+            .codeSize = reads[i].bytesRead,
+            .pCode = (uint32_t*)reads[i].dst,
+        };
+
+        V_ASSERT( vkCreateShaderModule(device, &shaderInfo, NULL, &modules[i]) );
+        hell_Free(reads[i].dst);
+    }
+    hell_Free(reads);
+    hell_Free(spvpaths);
 }
 
 #define MAX_GP_SHADER_STAGES 4
@@ -233,19 +225,34 @@ void onyx_CreateGraphicsPipelines(const VkDevice device, const uint8_t count, co
 
     VkGraphicsPipelineCreateInfo createInfos[ONYX_MAX_PIPELINES];
 
+    const char*    shaderNames[ONYX_MAX_PIPELINES * MAX_GP_SHADER_STAGES];
+    VkShaderModule shaderModules[ONYX_MAX_PIPELINES * MAX_GP_SHADER_STAGES];
+    uint32_t       shaderCount = 0;
     for (int i = 0; i < count; i++) 
     {
         const Onyx_GraphicsPipelineInfo* rasterInfo = &pipelineInfos[i];
         assert( rasterInfo->vertShader && rasterInfo->fragShader ); // must have at least these 2
+        shaderNames[shaderCount++] = rasterInfo->vertShader;
+        shaderNames[shaderCount++] = rasterInfo->fragShader;
+        if (rasterInfo->tessCtrlShader)
+        {
+            assert(rasterInfo->tessEvalShader);
+            shaderNames[shaderCount++] = rasterInfo->tessCtrlShader;
+            shaderNames[shaderCount++] = rasterInfo->tessEvalShader;
+        }
+    }
+    initShaderModules(device, shaderCount, shaderNames, shaderModules);
+    uint32_t nextModule = 0;
+
+    for (int i = 0; i < count; i++) 
+    {
+        const Onyx_GraphicsPipelineInfo* rasterInfo = &pipelineInfos[i];
 
-        VkShaderModule vertModule;
-        VkShaderModule fragModule;
+        VkShaderModule vertModule = shaderModules[nextModule++];
+        VkShaderModule fragModule = shaderModules[nextModule++];
         VkShaderModule tessCtrlModule;
         VkShaderModule tessEvalModule;
 
-        initShaderModule(device, getResolvedSprivPath(rasterInfo->vertShader), &vertModule);
-        initShaderModule(device, getResolvedSprivPath(rasterInfo->fragShader), &fragModule);
-
         uint8_t shaderStageCount = 2;
         for (int j = 0; j < MAX_GP_SHADER_STAGES; j++) 
         {
@@ -264,9 +271,8 @@ void onyx_CreateGraphicsPipelines(const VkDevice device, const uint8_t count, co
         shaderStages[i][1].pSpecializationInfo = rasterInfo->pFragSpecializationInfo;
         if (rasterInfo->tessCtrlShader)
         {
-            assert(rasterInfo->tessEvalShader);
-            initShaderModule(device, getResolvedSprivPath(rasterInfo->tessCtrlShader), &tessCtrlModule);
-            initShaderModule(device, getResolvedSprivPath(rasterInfo->tessEvalShader), &tessEvalModule);
+            tessCtrlModule = shaderModules[nextModule++];
+            tessEvalModule = shaderModules[nextModule++];
             shaderStages[i][2].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
             shaderStages[i][2].stage = VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
             shaderStages[i][2].module = tessCtrlModule;
@@ -472,6 +478,23 @@ void onyx_CreateRayTracePipelines(VkDevice device, Onyx_Memory* memory, const ui
     memset(libraryInfos, 0, sizeof(libraryInfos));
     memset(createInfos,  0, sizeof(createInfos));
 
+    const char*    shaderNames[ONYX_MAX_PIPELINES * MAX_RT_SHADER_COUNT];
+    VkShaderModule shaderModules[ONYX_MAX_PIPELINES * MAX_RT_SHADER_COUNT];
+    uint32_t       totalShaderCount = 0;
+    for (int p = 0; p < count; p++) 
+    {
+        const Onyx_RayTracePipelineInfo* rayTraceInfo = &pipelineInfos[p];
+        assert(rayTraceInfo->raygenCount + rayTraceInfo->missCount + rayTraceInfo->chitCount < MAX_RT_SHADER_COUNT);
+        for (int i = 0; i < rayTraceInfo->raygenCount; i++) 
+            shaderNames[totalShaderCount++] = rayTraceInfo->raygenShaders[i];
+        for (int i = 0; i < rayTraceInfo->missCount; i++) 
+            shaderNames[totalShaderCount++] = rayTraceInfo->missShaders[i];
+        for (int i = 0; i < rayTraceInfo->chitCount; i++) 
+            shaderNames[totalShaderCount++] = rayTraceInfo->chitShaders[i];
+    }
+    initShaderModules(device, totalShaderCount, shaderNames, shaderModules);
+    uint32_t nextModule = 0;
+
     for (int p = 0; p < count; p++) 
     {
         const Onyx_RayTracePipelineInfo* rayTraceInfo = &pipelineInfos[p];
@@ -494,16 +517,12 @@ void onyx_CreateRayTracePipelines(VkDevice device, Onyx_Memory* memory, const ui
         memset(missSM, 0, sizeof(missSM));
         memset(chitSM, 0, sizeof(chitSM));
 
-        char* const* const raygenShaders = rayTraceInfo->raygenShaders;
-        char* const* const missShaders =   rayTraceInfo->missShaders;
-        char* const* const chitShaders =   rayTraceInfo->chitShaders;
-
         for (int i = 0; i < raygenCount; i++) 
-            initShaderModule(device, getResolvedSprivPath(raygenShaders[i]), &raygenSM[i]);
+            raygenSM[i] = shaderModules[nextModule++];
         for (int i = 0; i < missCount; i++) 
-            initShaderModule(device, getResolvedSprivPath(missShaders[i]), &missSM[i]);
+            missSM[i] = shaderModules[nextModule++];
         for (int i = 0; i < chitCount; i++) 
-            initShaderModule(device, getResolvedSprivPath(chitShaders[i]), &chitSM[i]);
+            chitSM[i] = shaderModules[nextModule++];
 
         const int shaderCount = raygenCount + missCount + chitCount;
 
@@ -807,6 +826,7 @@ onyx_CreateDescriptorSetLayout(
     assert(bindingCount <= MAX_BINDING_COUNT);
     VkDescriptorBindingFlags     vkbindFlags[MAX_BINDING_COUNT];
     VkDescriptorSetLayoutBinding vkbindings[MAX_BINDING_COUNT];
+    VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
     for (int b = 0; b < bindingCount; b++)
     {
         vkbindings[b].binding            = b;
@@ -815,6 +835,11 @@ onyx_CreateDescriptorSetLayout(
         vkbindings[b].stageFlags         = bindings[b].stageFlags;
         vkbindings[b].pImmutableSamplers = NULL;
         vkbindFlags[b]                   = bindings[b].bindingFlags;
+        // such sets must come from a pool created with the matching flag
+        if (bindings[b].bindingFlags &
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT)
+            layoutFlags |=
+                VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
     }
 
     // this is only useful for texture arrays really. not sure what the
@@ -830,6 +855,7 @@ onyx_CreateDescriptorSetLayout(
     const VkDescriptorSetLayoutCreateInfo layoutInfo = {
         .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
         .pNext        = &flagsInfo,
+        .flags        = layoutFlags,
         .bindingCount = bindingCount,
         .pBindings    = vkbindings};
 
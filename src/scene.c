@@ -10,7 +10,9 @@
 #include "memory.h"
 #include "common.h"
 #include "geo.h"
+#include "meshproc.h"
 #include "image.h"
+#include <math.h>
 #include <string.h>
 #define ARCBALL_CAMERA_IMPLEMENTATION
 #include "arcball_camera.h"
@@ -135,13 +137,16 @@ static void growArray(void** curptr, obint* curcap, const u32 elemsize)
     *curcap = newcap;
 }
 
-static obint addSceneObject(const void* object, void* objectArray, obint* objectCount, obint* cap, const u32 elemSize, ObjectMap* map)
+static obint addSceneObject(const void* object, void** objectArray, obint* objectCount, obint* cap, const u32 elemSize, ObjectMap* map)
 {
     const obint index = (*objectCount)++;
     if (index == *cap)
     {
+        // ids in use and ids free for reuse never outnumber the capacity, so
+        // the map grows along with the objects
+        obint mapcap = *cap;
+        growArray((void**)&map->indices, &mapcap, sizeof(map->indices[0]));
         growArray(objectArray, cap, elemSize);
-        growArray((void**)&map->indices, cap, elemSize);
     }
     assert(index < *cap);
     obint id = 0;
@@ -150,7 +155,7 @@ static obint addSceneObject(const void* object, void* objectArray, obint* object
     else
         hell_ArrayPop(&map->availableIds, &id);
     map->indices[id] = index;
-    void* dst = (u8*)(objectArray) + index * elemSize;
+    void* dst = (u8*)(*objectArray) + index * elemSize;
     memcpy(dst, object, elemSize);
     return id;
 }
@@ -168,7 +173,7 @@ static void removeSceneObject(obint id, void* objectArray, obint* objectCount, c
 
 static PrimitiveHandle addPrim(Scene* s, Onyx_Primitive prim)
 {
-    obint id = addSceneObject(&prim, s->prims, &s->primCount, &s->primCapacity, sizeof(prim), &s->primMap);
+    obint id = addSceneObject(&prim, (void**)&s->prims, &s->primCount, &s->primCapacity, sizeof(prim), &s->primMap);
     PrimitiveHandle handle = {id};
     addPrimToDirtyPrims(s, handle);
     PRIM(s, handle).dirt |= ONYX_PRIM_ADDED_BIT;
@@ -178,7 +183,7 @@ static PrimitiveHandle addPrim(Scene* s, Onyx_Primitive prim)
 
 static LightHandle addLight(Scene* s, Light light)
 {
-    obint id = addSceneObject(&light, s->lights, &s->lightCount, &s->lightCapacity, sizeof(light), &s->lightMap);
+    obint id = addSceneObject(&light, (void**)&s->lights, &s->lightCount, &s->lightCapacity, sizeof(light), &s->lightMap);
     LightHandle handle = {id};
     s->dirt |= ONYX_SCENE_LIGHTS_BIT;
     return handle;
@@ -186,7 +191,7 @@ static LightHandle addLight(Scene* s, Light light)
 
 static TextureHandle addTexture(Scene* s, Onyx_Texture texture)
 {
-    obint id = addSceneObject(&texture, s->textures, &s->textureCount, &s->textureCapacity, sizeof(texture), &s->texMap);
+    obint id = addSceneObject(&texture, (void**)&s->textures, &s->textureCount, &s->textureCapacity, sizeof(texture), &s->texMap);
     TextureHandle handle = {id};
     addTextureToDirtyTextures(s, handle);
     TEXTURE(s, handle).dirt |= ONYX_TEX_ADDED_BIT;
@@ -196,7 +201,7 @@ static TextureHandle addTexture(Scene* s, Onyx_Texture texture)
 
 static MaterialHandle addMaterial(Scene* s, Onyx_Material material)
 {
-    obint id = addSceneObject(&material, s->materials, &s->materialCount, &s->materialCapacity, sizeof(s->materials[0]), &s->matMap);
+    obint id = addSceneObject(&material, (void**)&s->materials, &s->materialCount, &s->materialCapacity, sizeof(s->materials[0]), &s->matMap);
     MaterialHandle handle = {id};
     addMaterialToDirtyMaterials(s, handle);
     MATERIAL(s, handle).dirt |= ONYX_MAT_ADDED_BIT;
@@ -752,6 +757,10 @@ void onyx_SceneEndFrame(Onyx_Scene* s)
             }
             else
             {
+                // the geo was written through onyx_SceneGetPrimGeo this frame
+                Onyx_Geometry* geo = PRIM(s, handle).geo;
+                if (geo && !geo->boundsValid && geo->vertexRegion.hostData)
+                    onyx_UpdateGeoBounds(geo);
                 PRIM(s, dp[i]).dirt = 0;
             }
         }
@@ -779,6 +788,15 @@ Onyx_TextureHandle onyx_SceneAddTexture(Onyx_Scene* scene, Onyx_Image* image)
     return addTexture(scene, tex);
 }
 
+void
+onyx_SceneUpdateTexture(Onyx_Scene* scene, Onyx_TextureHandle tex, Onyx_Image* image)
+{
+    TEXTURE(scene, tex).devImage = image;
+    TEXTURE(scene, tex).dirt |= ONYX_TEX_CHANGED_BIT;
+    addTextureToDirtyTextures(scene, tex);
+    scene->dirt |= ONYX_SCENE_TEXTURES_BIT;
+}
+
 void
 onyx_SceneRemoveTexture(Onyx_Scene* scene, Onyx_TextureHandle tex)
 {
@@ -878,7 +896,50 @@ Onyx_Geometry* onyx_SceneGetPrimGeo(Onyx_Scene* scene, PrimitiveHandle prim, Ony
     addPrimToDirtyPrims(scene, prim);
     PRIM(scene, prim).dirt |= flags;
     scene->dirt |= ONYX_SCENE_PRIMS_BIT;
-    return PRIM(scene, prim).geo;
+    Onyx_Geometry* geo = PRIM(scene, prim).geo;
+    if (geo && (flags & (ONYX_PRIM_TOPOLOGY_CHANGED_BIT |
+                         ONYX_PRIM_ATTRIBUTES_CHANGED_BIT)))
+        geo->boundsValid = false;
+    if (geo && geo->deviceVertexRegion.buffer &&
+        (flags & ONYX_PRIM_TOPOLOGY_CHANGED_BIT))
+        onyx_MarkGeoDirty(geo);
+    return geo;
+}
+
+const Onyx_GeoBounds*
+onyx_SceneGetPrimBounds(Onyx_Scene* scene, Onyx_PrimitiveHandle prim)
+{
+    Onyx_Geometry* geo = PRIM(scene, prim).geo;
+    return geo ? onyx_GetGeoBounds(geo) : NULL;
+}
+
+uint32_t
+onyx_SceneSelectPrimLod(const Onyx_Scene* scene, Onyx_PrimitiveHandle prim,
+                        float viewportHeight, float maxPixelError)
+{
+    const Primitive* p = &PRIM(scene, prim);
+    if (!p->geo || p->geo->lodCount < 2)
+        return 0;
+    const Mat4* m   = &p->xform;
+    const Mat4* cam = &scene->camera.xform;
+    float       dx  = m->e[3][0] - cam->e[3][0];
+    float       dy  = m->e[3][1] - cam->e[3][1];
+    float       dz  = m->e[3][2] - cam->e[3][2];
+    // lod errors are in object space so take the largest axis scale
+    float scale = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        float s = sqrtf(m->e[i][0] * m->e[i][0] + m->e[i][1] * m->e[i][1] +
+                        m->e[i][2] * m->e[i][2]);
+        scale   = s > scale ? s : scale;
+    }
+    float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+    if (scale > 0)
+        distance /= scale;
+    // proj[1][1] holds cot(fovy / 2)
+    float projScale =
+        viewportHeight * 0.5f * fabsf(scene->camera.proj.e[1][1]);
+    return onyx_SelectGeoLod(p->geo, distance, projScale, maxPixelError);
 }
 
 Onyx_Primitive*
@@ -910,6 +971,128 @@ const Onyx_PrimitiveHandle* onyx_SceneGetDirtyPrimitives(const Onyx_Scene* s, ui
     return s->dirtyPrims.elems;
 }
 
+typedef struct {
+    void**     objects;
+    obint*     count;
+    obint*     capacity;
+    u32        elemSize;
+    ObjectMap* map;
+} ObjectTable;
+
+static ObjectTable getObjectTable(Scene* s, Onyx_SceneObjectType type)
+{
+    switch (type)
+    {
+    case ONYX_SCENE_OBJECT_PRIM:
+        return (ObjectTable){(void**)&s->prims, &s->primCount, &s->primCapacity, sizeof(s->prims[0]), &s->primMap};
+    case ONYX_SCENE_OBJECT_LIGHT:
+        return (ObjectTable){(void**)&s->lights, &s->lightCount, &s->lightCapacity, sizeof(s->lights[0]), &s->lightMap};
+    case ONYX_SCENE_OBJECT_MATERIAL:
+        return (ObjectTable){(void**)&s->materials, &s->materialCount, &s->materialCapacity, sizeof(s->materials[0]), &s->matMap};
+    default:
+        assert(type == ONYX_SCENE_OBJECT_TEXTURE);
+        return (ObjectTable){(void**)&s->textures, &s->textureCount, &s->textureCapacity, sizeof(s->textures[0]), &s->texMap};
+    }
+}
+
+void onyx_SceneGetObjectIds(const Onyx_Scene* s, Onyx_SceneObjectType type, Onyx_SceneObjectIds* ids)
+{
+    const ObjectTable t = getObjectTable((Scene*)s, type);
+    ids->count     = *t.count;
+    ids->freeCount = t.map->availableIds.count;
+    ids->ids       = hell_Malloc((ids->count + 1) * sizeof(obint));
+    ids->freeIds   = hell_Malloc((ids->freeCount + 1) * sizeof(obint));
+    memcpy(ids->freeIds, t.map->availableIds.elems, ids->freeCount * sizeof(obint));
+    // the ids in use and the ids free for reuse are exactly [0, count + freeCount)
+    const obint idCount = ids->count + ids->freeCount;
+    u8* isFree = hell_Malloc(idCount + 1);
+    memset(isFree, 0, idCount + 1);
+    for (u32 i = 0; i < ids->freeCount; i++)
+        isFree[ids->freeIds[i]] = 1;
+    for (obint id = 0; id < idCount; id++)
+        if (!isFree[id])
+            ids->ids[t.map->indices[id]] = id;
+    hell_Free(isFree);
+}
+
+void onyx_FreeSceneObjectIds(Onyx_SceneObjectIds* ids)
+{
+    hell_Free(ids->ids);
+    hell_Free(ids->freeIds);
+    memset(ids, 0, sizeof(*ids));
+}
+
+void onyx_SceneRestoreObjects(Onyx_Scene* s, Onyx_SceneObjectType type, const void* objects, const Onyx_SceneObjectIds* ids)
+{
+    const ObjectTable t = getObjectTable(s, type);
+    const obint idCount = ids->count + ids->freeCount;
+    if (idCount > *t.capacity)
+    {
+        *t.objects = hell_Realloc(*t.objects, idCount * t.elemSize);
+        t.map->indices = hell_Realloc(t.map->indices, idCount * sizeof(obint));
+        *t.capacity = idCount;
+    }
+    *t.count = ids->count;
+    memcpy(*t.objects, objects, ids->count * t.elemSize);
+    for (u32 i = 0; i < ids->count; i++)
+    {
+        assert(ids->ids[i] < idCount);
+        t.map->indices[ids->ids[i]] = i;
+    }
+    hell_ArrayClear(&t.map->availableIds);
+    for (u32 i = 0; i < ids->freeCount; i++)
+        hell_ArrayPush(&t.map->availableIds, &ids->freeIds[i]);
+
+    // every object is new to the scene's consumers. the dirty sets start over
+    // instead of being searched once per object.
+    switch (type)
+    {
+    case ONYX_SCENE_OBJECT_PRIM:
+        hell_ArrayClear(&s->dirtyPrims);
+        for (u32 i = 0; i < ids->count; i++)
+        {
+            PrimitiveHandle handle = {ids->ids[i]};
+            hell_ArrayPush(&s->dirtyPrims, &handle);
+            s->prims[i].dirt = ONYX_PRIM_ADDED_BIT;
+        }
+        s->dirt |= ONYX_SCENE_PRIMS_BIT | ONYX_SCENE_XFORMS_BIT;
+        break;
+    case ONYX_SCENE_OBJECT_LIGHT:
+        s->dirt |= ONYX_SCENE_LIGHTS_BIT;
+        break;
+    case ONYX_SCENE_OBJECT_MATERIAL:
+        hell_ArrayClear(&s->dirtyMaterials);
+        for (u32 i = 0; i < ids->count; i++)
+        {
+            MaterialHandle handle = {ids->ids[i]};
+            hell_ArrayPush(&s->dirtyMaterials, &handle);
+            s->materials[i].dirt = ONYX_MAT_ADDED_BIT;
+        }
+        s->dirt |= ONYX_SCENE_MATERIALS_BIT;
+        break;
+    default:
+        hell_ArrayClear(&s->dirtyTextures);
+        for (u32 i = 0; i < ids->count; i++)
+        {
+            TextureHandle handle = {ids->ids[i]};
+            hell_ArrayPush(&s->dirtyTextures, &handle);
+            s->textures[i].dirt = ONYX_TEX_ADDED_BIT;
+        }
+        s->dirt |= ONYX_SCENE_TEXTURES_BIT;
+        break;
+    }
+}
+
+Onyx_Geometry* onyx_SceneGetDefaultGeo(Onyx_Scene* s)
+{
+    return &s->defaultGeo;
+}
+
+Onyx_Image* onyx_SceneGetDefaultImage(Onyx_Scene* s)
+{
+    return &s->defaultImage;
+}
+
 void onyx_SceneCameraUpdateAspectRatio(Onyx_Scene* s, float ar)
 {
     float fov = -s->camera.proj.e[1][1];
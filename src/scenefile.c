@@ -0,0 +1,1107 @@
+#include "scenefile.h"
+#include "asyncio.h"
+#include "dtags.h"
+#include "geo.h"
+#include "image.h"
+#include "import.h"
+#include "parallel.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "stb_image.h"
+
+// A header, a table of sections with a CRC-32C each like version 2 geo files,
+// then the embedded geo files and images. The object sections are written
+// last since they hold the offsets of what is embedded. Embedded geo files
+// start 256 byte aligned and check themselves, embedded images have their CRC
+// in their record.
+//
+// Loading checks everything first, then decodes geometry and images on every
+// thread, creates and uploads them in batches and finally swaps the objects
+// into the scene with onyx_SceneRestoreObjects, which skips the per object
+// bookkeeping of onyx_SceneAdd*.
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_SCENE, fmt, ##__VA_ARGS__)
+
+#define SCENE_MAGIC    "OSCN"
+#define SCENE_VERSION  1
+#define DATA_ALIGNMENT 256
+
+// resource indices of prims and textures that aren't into the records
+#define NO_RESOURCE      UINT32_MAX
+#define DEFAULT_RESOURCE (UINT32_MAX - 1)
+
+enum {
+    SECTION_CAMERA,
+    SECTION_PRIMS,
+    SECTION_LIGHTS,
+    SECTION_MATERIALS,
+    SECTION_TEXTURES,
+    // the free ids of every object type, one after the other
+    SECTION_FREE_IDS,
+    SECTION_GEOS,
+    SECTION_IMAGES,
+    // the paths of referenced resources
+    SECTION_STRINGS,
+    SECTION_COUNT
+};
+
+static const char g_sectionTags[SECTION_COUNT][4] = {
+    {'C', 'A', 'M', 'R'}, {'P', 'R', 'I', 'M'}, {'L', 'G', 'H', 'T'},
+    {'M', 'A', 'T', 'L'}, {'T', 'E', 'X', 'R'}, {'F', 'R', 'E', 'E'},
+    {'G', 'E', 'O', 'S'}, {'I', 'M', 'G', 'S'}, {'S', 'T', 'R', 'S'}};
+
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint32_t sectionCount;
+    // CRC-32C of the header with this field zeroed and then the section table
+    uint32_t tableCrc;
+    // indexed by Onyx_SceneObjectType
+    uint32_t counts[ONYX_SCENE_OBJECT_TYPE_COUNT];
+    uint32_t freeCounts[ONYX_SCENE_OBJECT_TYPE_COUNT];
+    uint32_t geoCount;
+    uint32_t imageCount;
+    uint32_t padding[2];
+} SceneHeader;
+
+typedef struct {
+    char     tag[4];
+    uint32_t crc;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t padding;
+} SceneSection;
+
+typedef struct {
+    float xform[16];
+    float proj[16];
+} SceneCamera;
+
+typedef struct {
+    uint32_t id;
+    uint32_t geo;
+    uint32_t material;
+    uint32_t flags;
+    float    xform[16];
+} ScenePrim;
+
+typedef struct {
+    uint32_t id;
+    uint32_t type;
+    float    intensity;
+    float    color[3];
+    // position or direction
+    float    vector[3];
+    uint32_t padding;
+} SceneLight;
+
+typedef struct {
+    uint32_t id;
+    float    color[3];
+    float    roughness;
+    uint32_t albedo;
+    uint32_t roughnessTexture;
+    uint32_t normal;
+} SceneMaterial;
+
+typedef struct {
+    uint32_t id;
+    uint32_t image;
+} SceneTexture;
+
+typedef enum {
+    RESOURCE_EMBEDDED,
+    RESOURCE_PATH,
+} ResourceKind;
+
+// Embedded resources are at offset in the file, paths at offset in the
+// strings section.
+typedef struct {
+    uint32_t kind;
+    // of embedded images
+    uint32_t crc;
+    uint64_t offset;
+    uint64_t size;
+    // the VkFormat of images and the channels they are decoded to
+    uint32_t format;
+    uint32_t channelCount;
+} SceneResource;
+
+_Static_assert(sizeof(SceneHeader) == 64, "SceneHeader must be 64 bytes");
+_Static_assert(sizeof(SceneSection) == 32, "SceneSection must be 32 bytes");
+_Static_assert(sizeof(ScenePrim) == 80, "ScenePrim must be 80 bytes");
+_Static_assert(sizeof(SceneLight) == 40, "SceneLight must be 40 bytes");
+_Static_assert(sizeof(SceneResource) == 32, "SceneResource must be 32 bytes");
+
+static uint64_t
+alignUp(uint64_t offset, uint64_t alignment)
+{
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+// Open addressing from pointers to indices, for finding the geos and images
+// shared by many prims and textures.
+typedef struct {
+    const void** keys;
+    uint32_t*    values;
+    uint32_t     mask;
+} PtrMap;
+
+static void
+createPtrMap(uint32_t count, PtrMap* map)
+{
+    uint32_t capacity = 16;
+    while (capacity < count * 2)
+        capacity *= 2;
+    map->keys   = hell_Malloc(capacity * sizeof(map->keys[0]));
+    map->values = hell_Malloc(capacity * sizeof(map->values[0]));
+    map->mask   = capacity - 1;
+    memset(map->keys, 0, capacity * sizeof(map->keys[0]));
+}
+
+static void
+freePtrMap(PtrMap* map)
+{
+    hell_Free(map->keys);
+    hell_Free(map->values);
+}
+
+static uint32_t
+ptrSlot(const PtrMap* map, const void* key)
+{
+    uint64_t h = (uintptr_t)key;
+    h          = (h ^ (h >> 31)) * 0x9E3779B97F4A7C15ull;
+    uint32_t i = (uint32_t)(h >> 32) & map->mask;
+    while (map->keys[i] && map->keys[i] != key)
+        i = (i + 1) & map->mask;
+    return i;
+}
+
+// the index of key, inserting value if it isn't there yet
+static uint32_t
+ptrMapInsert(PtrMap* map, const void* key, uint32_t value)
+{
+    const uint32_t i = ptrSlot(map, key);
+    if (!map->keys[i])
+    {
+        map->keys[i]   = key;
+        map->values[i] = value;
+    }
+    return map->values[i];
+}
+
+static uint32_t
+ptrMapFind(const PtrMap* map, const void* key)
+{
+    const uint32_t i = ptrSlot(map, key);
+    return map->keys[i] ? map->values[i] : NO_RESOURCE;
+}
+
+typedef struct {
+    FILE*    file;
+    uint64_t pos;
+    bool     ok;
+} Writer;
+
+static void
+writeBytes(Writer* w, const void* data, uint64_t size)
+{
+    if (size && fwrite(data, size, 1, w->file) != 1)
+        w->ok = false;
+    w->pos += size;
+}
+
+static void
+writeAlign(Writer* w, uint64_t alignment)
+{
+    static const uint8_t zeros[DATA_ALIGNMENT] = {0};
+    writeBytes(w, zeros, alignUp(w->pos, alignment) - w->pos);
+}
+
+static void
+writeSection(Writer* w, SceneSection* sections, int index, const void* data,
+             uint64_t size)
+{
+    writeAlign(w, 16);
+    SceneSection* s = &sections[index];
+    memcpy(s->tag, g_sectionTags[index], 4);
+    s->offset = w->pos;
+    s->size   = size;
+    s->crc    = onyx_Crc32c(0, data, size);
+    writeBytes(w, data, size);
+}
+
+typedef struct {
+    char*    data;
+    uint64_t size;
+    uint64_t capacity;
+} Strings;
+
+static void
+addPath(Strings* strings, const char* path, SceneResource* r)
+{
+    const size_t len = strlen(path);
+    if (strings->size + len > strings->capacity)
+    {
+        strings->capacity = (strings->size + len) * 2;
+        strings->data     = hell_Realloc(strings->data, strings->capacity);
+    }
+    memcpy(strings->data + strings->size, path, len);
+    r->kind   = RESOURCE_PATH;
+    r->offset = strings->size;
+    r->size   = len;
+    strings->size += len;
+}
+
+static void
+writeGeo(Writer* w, Onyx_Memory* memory, const Onyx_Geometry* geo,
+         const Onyx_WriteSceneParms* parms, SceneResource* r)
+{
+    Onyx_FileGeo fgeo = onyx_CreateFileGeoFromGeo(memory, geo);
+    const Onyx_WriteGeoParms geoParms = {
+        .version        = ONYX_GEO_FILE_VERSION_2,
+        .attributeCodec = parms->attributeCodec,
+        .indexCodec     = parms->indexCodec,
+    };
+    writeAlign(w, DATA_ALIGNMENT);
+    r->kind   = RESOURCE_EMBEDDED;
+    r->offset = w->pos;
+    r->size   = onyx_WriteFileGeoToStream(w->file, &fgeo, &geoParms);
+    w->pos += r->size;
+    onyx_FreeFileGeo(&fgeo);
+}
+
+// what onyx_write_image_to_png_buf writes
+static uint32_t
+getChannelCount(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SNORM:
+    case VK_FORMAT_R8_USCALED:
+    case VK_FORMAT_R8_SSCALED:
+    case VK_FORMAT_R8_UINT:
+    case VK_FORMAT_R8_SINT:
+    case VK_FORMAT_R8_SRGB: return 1;
+    default: return 4;
+    }
+}
+
+static bool
+writeImage(Writer* w, Onyx_Image* image, SceneResource* r)
+{
+    uint8_t* png;
+    int      pngSize;
+    if (onyx_write_image_to_png_buf(image, image->layout, &png, &pngSize) != 0 ||
+        !png)
+        return false;
+    writeAlign(w, 16);
+    r->kind   = RESOURCE_EMBEDDED;
+    r->offset = w->pos;
+    r->size   = pngSize;
+    r->crc    = onyx_Crc32c(0, png, pngSize);
+    writeBytes(w, png, pngSize);
+    hell_Free(png);
+    return true;
+}
+
+static void
+copyMat4(const Coal_Mat4* m, float dst[16])
+{
+    memcpy(dst, m->e, 16 * sizeof(float));
+}
+
+static void
+writeFreeIds(const Onyx_SceneObjectIds ids[ONYX_SCENE_OBJECT_TYPE_COUNT],
+             Writer* w, SceneSection* sections)
+{
+    uint32_t total = 0;
+    for (int t = 0; t < ONYX_SCENE_OBJECT_TYPE_COUNT; t++)
+        total += ids[t].freeCount;
+    uint32_t* freeIds = hell_Malloc((total + 1) * sizeof(uint32_t));
+    uint32_t  n       = 0;
+    for (int t = 0; t < ONYX_SCENE_OBJECT_TYPE_COUNT; t++)
+        for (uint32_t i = 0; i < ids[t].freeCount; i++)
+            freeIds[n++] = ids[t].freeIds[i];
+    writeSection(w, sections, SECTION_FREE_IDS, freeIds, total * sizeof(uint32_t));
+    hell_Free(freeIds);
+}
+
+bool
+onyx_WriteSceneFileObjects(Onyx_Memory* memory, const Onyx_SceneFileObjects* objects,
+                           const char* filename, const Onyx_WriteSceneParms* parms)
+{
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        DPRINT("Can't open %s for writing\n", filename);
+        return false;
+    }
+    const Onyx_SceneObjectIds* ids           = objects->ids;
+    const uint32_t             primCount     = ids[ONYX_SCENE_OBJECT_PRIM].count;
+    const uint32_t             lightCount    = ids[ONYX_SCENE_OBJECT_LIGHT].count;
+    const uint32_t             materialCount = ids[ONYX_SCENE_OBJECT_MATERIAL].count;
+    const uint32_t             textureCount  = ids[ONYX_SCENE_OBJECT_TEXTURE].count;
+    const Onyx_Primitive*      prims         = objects->prims;
+    const Onyx_Light*          lights        = objects->lights;
+    const Onyx_Material*       materials     = objects->materials;
+    const Onyx_Texture*        textures      = objects->textures;
+    const Onyx_Geometry*       defaultGeo    = objects->defaultGeo;
+    const Onyx_Image*          defaultImage  = objects->defaultImage;
+
+    // the distinct geos and images in order of first use
+    PtrMap geoMap, imageMap, geoRefs, imageRefs;
+    createPtrMap(primCount, &geoMap);
+    createPtrMap(textureCount, &imageMap);
+    createPtrMap(parms->geoRefCount, &geoRefs);
+    createPtrMap(parms->imageRefCount, &imageRefs);
+    for (uint32_t i = 0; i < parms->geoRefCount; i++)
+        ptrMapInsert(&geoRefs, parms->refGeos[i], i);
+    for (uint32_t i = 0; i < parms->imageRefCount; i++)
+        ptrMapInsert(&imageRefs, parms->refImages[i], i);
+    const Onyx_Geometry** geos   = hell_Malloc((primCount + 1) * sizeof(geos[0]));
+    Onyx_Image**          images = hell_Malloc((textureCount + 1) * sizeof(images[0]));
+    uint32_t              geoCount = 0, imageCount = 0;
+    ScenePrim*     primRecords     = hell_Malloc((primCount + 1) * sizeof(ScenePrim));
+    SceneLight*    lightRecords    = hell_Malloc((lightCount + 1) * sizeof(SceneLight));
+    SceneMaterial* materialRecords = hell_Malloc((materialCount + 1) * sizeof(SceneMaterial));
+    SceneTexture*  textureRecords  = hell_Malloc((textureCount + 1) * sizeof(SceneTexture));
+    memset(lightRecords, 0, (lightCount + 1) * sizeof(SceneLight));
+    for (uint32_t i = 0; i < primCount; i++)
+    {
+        const Onyx_Geometry* geo = prims[i].geo;
+        ScenePrim*           r   = &primRecords[i];
+        r->id                    = ids[ONYX_SCENE_OBJECT_PRIM].ids[i];
+        r->material              = prims[i].material.id;
+        r->flags                 = prims[i].flags;
+        copyMat4(&prims[i].xform, r->xform);
+        if (!geo)
+            r->geo = NO_RESOURCE;
+        else if (geo == defaultGeo)
+            r->geo = DEFAULT_RESOURCE;
+        else
+        {
+            r->geo = ptrMapInsert(&geoMap, geo, geoCount);
+            if (r->geo == geoCount)
+                geos[geoCount++] = geo;
+        }
+    }
+    for (uint32_t i = 0; i < lightCount; i++)
+    {
+        SceneLight* r = &lightRecords[i];
+        r->id         = ids[ONYX_SCENE_OBJECT_LIGHT].ids[i];
+        r->type       = lights[i].type;
+        r->intensity  = lights[i].intensity;
+        const Coal_Vec3 v = lights[i].type == ONYX_LIGHT_POINT_TYPE
+                                ? lights[i].structure.pointLight.pos
+                                : lights[i].structure.directionLight.dir;
+        for (int k = 0; k < 3; k++)
+        {
+            r->color[k]  = lights[i].color.e[k];
+            r->vector[k] = v.e[k];
+        }
+    }
+    for (uint32_t i = 0; i < materialCount; i++)
+    {
+        SceneMaterial* r    = &materialRecords[i];
+        r->id               = ids[ONYX_SCENE_OBJECT_MATERIAL].ids[i];
+        r->roughness        = materials[i].roughness;
+        r->albedo           = materials[i].textureAlbedo.id;
+        r->roughnessTexture = materials[i].textureRoughness.id;
+        r->normal           = materials[i].textureNormal.id;
+        for (int k = 0; k < 3; k++)
+            r->color[k] = materials[i].color.e[k];
+    }
+    for (uint32_t i = 0; i < textureCount; i++)
+    {
+        Onyx_Image*   image = textures[i].devImage;
+        SceneTexture* r     = &textureRecords[i];
+        r->id               = ids[ONYX_SCENE_OBJECT_TEXTURE].ids[i];
+        if (!image)
+            r->image = NO_RESOURCE;
+        else if (image == defaultImage)
+            r->image = DEFAULT_RESOURCE;
+        else
+        {
+            r->image = ptrMapInsert(&imageMap, image, imageCount);
+            if (r->image == imageCount)
+                images[imageCount++] = image;
+        }
+    }
+
+    Writer       w = {.file = file, .ok = true};
+    SceneSection sections[SECTION_COUNT];
+    memset(sections, 0, sizeof(sections));
+    SceneHeader header = {0};
+    // written again once the table is known
+    writeBytes(&w, &header, sizeof(header));
+    writeBytes(&w, sections, sizeof(sections));
+
+    SceneResource* geoRecords   = hell_Malloc((geoCount + 1) * sizeof(SceneResource));
+    SceneResource* imageRecords = hell_Malloc((imageCount + 1) * sizeof(SceneResource));
+    memset(geoRecords, 0, (geoCount + 1) * sizeof(SceneResource));
+    memset(imageRecords, 0, (imageCount + 1) * sizeof(SceneResource));
+    Strings strings = {0};
+    bool    ok      = true;
+    for (uint32_t i = 0; i < geoCount; i++)
+    {
+        const uint32_t ref = ptrMapFind(&geoRefs, geos[i]);
+        if (ref != NO_RESOURCE)
+            addPath(&strings, parms->refGeoPaths[ref], &geoRecords[i]);
+        else
+            writeGeo(&w, memory, geos[i], parms, &geoRecords[i]);
+    }
+    for (uint32_t i = 0; i < imageCount && ok; i++)
+    {
+        const uint32_t ref = ptrMapFind(&imageRefs, images[i]);
+        imageRecords[i].format       = images[i]->format;
+        imageRecords[i].channelCount = getChannelCount(images[i]->format);
+        if (ref != NO_RESOURCE)
+            addPath(&strings, parms->refImagePaths[ref], &imageRecords[i]);
+        else if (!(ok = writeImage(&w, images[i], &imageRecords[i])))
+            DPRINT("Image of format %d can't be embedded\n", images[i]->format);
+    }
+
+    SceneCamera cam;
+    copyMat4(&objects->cameraXform, cam.xform);
+    copyMat4(&objects->cameraProj, cam.proj);
+    writeSection(&w, sections, SECTION_CAMERA, &cam, sizeof(cam));
+    writeSection(&w, sections, SECTION_PRIMS, primRecords, primCount * sizeof(ScenePrim));
+    writeSection(&w, sections, SECTION_LIGHTS, lightRecords, lightCount * sizeof(SceneLight));
+    writeSection(&w, sections, SECTION_MATERIALS, materialRecords,
+                 materialCount * sizeof(SceneMaterial));
+    writeSection(&w, sections, SECTION_TEXTURES, textureRecords,
+                 textureCount * sizeof(SceneTexture));
+    writeFreeIds(ids, &w, sections);
+    writeSection(&w, sections, SECTION_GEOS, geoRecords, geoCount * sizeof(SceneResource));
+    writeSection(&w, sections, SECTION_IMAGES, imageRecords,
+                 imageCount * sizeof(SceneResource));
+    writeSection(&w, sections, SECTION_STRINGS, strings.data, strings.size);
+
+    memcpy(header.magic, SCENE_MAGIC, 4);
+    header.version      = SCENE_VERSION;
+    header.sectionCount = SECTION_COUNT;
+    header.geoCount     = geoCount;
+    header.imageCount   = imageCount;
+    for (int t = 0; t < ONYX_SCENE_OBJECT_TYPE_COUNT; t++)
+    {
+        header.counts[t]     = ids[t].count;
+        header.freeCounts[t] = ids[t].freeCount;
+    }
+    header.tableCrc = onyx_Crc32c(0, &header, sizeof(header));
+    header.tableCrc = onyx_Crc32c(header.tableCrc, sections, sizeof(sections));
+    if (fseek(file, 0, SEEK_SET) != 0)
+        w.ok = false;
+    w.pos = 0;
+    writeBytes(&w, &header, sizeof(header));
+    writeBytes(&w, sections, sizeof(sections));
+    ok = ok && w.ok;
+    ok = fclose(file) == 0 && ok;
+    if (!ok)
+    {
+        DPRINT("Failed to write scene file %s\n", filename);
+        remove(filename);
+    }
+
+    freePtrMap(&geoMap);
+    freePtrMap(&imageMap);
+    freePtrMap(&geoRefs);
+    freePtrMap(&imageRefs);
+    hell_Free(geos);
+    hell_Free(images);
+    hell_Free(primRecords);
+    hell_Free(lightRecords);
+    hell_Free(materialRecords);
+    hell_Free(textureRecords);
+    hell_Free(geoRecords);
+    hell_Free(imageRecords);
+    hell_Free(strings.data);
+    return ok;
+}
+
+bool
+onyx_WriteSceneFile(Onyx_Memory* memory, Onyx_Scene* scene, const char* filename,
+                    const Onyx_WriteSceneParms* parms)
+{
+    Onyx_SceneFileObjects objects = {
+        .defaultGeo   = onyx_SceneGetDefaultGeo(scene),
+        .defaultImage = onyx_SceneGetDefaultImage(scene),
+    };
+    for (int t = 0; t < ONYX_SCENE_OBJECT_TYPE_COUNT; t++)
+        onyx_SceneGetObjectIds(scene, t, &objects.ids[t]);
+    Onyx_SceneObjectInt count;
+    uint32_t            lightCount;
+    objects.prims     = onyx_SceneGetPrimitives(scene, &count);
+    objects.lights    = onyx_SceneGetLights(scene, &lightCount);
+    objects.materials = onyx_SceneGetMaterials(scene, &count);
+    objects.textures  = onyx_SceneGetTextures(scene, &count);
+    const Onyx_Camera* camera = onyx_SceneGetCamera(scene);
+    objects.cameraXform       = camera->xform;
+    objects.cameraProj        = camera->proj;
+    const bool ok = onyx_WriteSceneFileObjects(memory, &objects, filename, parms);
+    for (int t = 0; t < ONYX_SCENE_OBJECT_TYPE_COUNT; t++)
+        onyx_FreeSceneObjectIds(&objects.ids[t]);
+    return ok;
+}
+
+// where the sections of a loaded file are, checked against the header
+typedef struct {
+    const uint8_t*       data;
+    size_t               size;
+    SceneHeader          header;
+    const SceneCamera*   camera;
+    const ScenePrim*     prims;
+    const SceneLight*    lights;
+    const SceneMaterial* materials;
+    const SceneTexture*  textures;
+    const uint32_t*      freeIds;
+    const SceneResource* geos;
+    const SceneResource* images;
+    const char*          strings;
+    uint64_t             stringsSize;
+    // live ids of every type
+    uint8_t*             live[ONYX_SCENE_OBJECT_TYPE_COUNT];
+    Onyx_SceneObjectIds  ids[ONYX_SCENE_OBJECT_TYPE_COUNT];
+} SceneLayout;
+
+static bool
+parseSections(const uint8_t* data, size_t size, SceneLayout* l)
+{
+    if (size < sizeof(SceneHeader) + SECTION_COUNT * sizeof(SceneSection))
+        return false;
+    memcpy(&l->header, data, sizeof(SceneHeader));
+    SceneHeader header = l->header;
+    if (memcmp(header.magic, SCENE_MAGIC, 4) != 0 ||
+        header.version != SCENE_VERSION || header.sectionCount != SECTION_COUNT)
+        return false;
+    header.tableCrc = 0;
+    uint32_t crc    = onyx_Crc32c(0, &header, sizeof(header));
+    crc = onyx_Crc32c(crc, data + sizeof(header), SECTION_COUNT * sizeof(SceneSection));
+    if (crc != l->header.tableCrc)
+        return false;
+
+    uint64_t freeTotal = 0;
+    for (int t = 0; t < ONYX_SCENE_OBJECT_TYPE_COUNT; t++)
+        freeTotal += l->header.freeCounts[t];
+    const uint64_t sizes[SECTION_COUNT] = {
+        [SECTION_CAMERA]    = sizeof(SceneCamera),
+        [SECTION_PRIMS]     = (uint64_t)l->header.counts[ONYX_SCENE_OBJECT_PRIM] * sizeof(ScenePrim),
+        [SECTION_LIGHTS]    = (uint64_t)l->header.counts[ONYX_SCENE_OBJECT_LIGHT] * sizeof(SceneLight),
+        [SECTION_MATERIALS] = (uint64_t)l->header.counts[ONYX_SCENE_OBJECT_MATERIAL] * sizeof(SceneMaterial),
+        [SECTION_TEXTURES]  = (uint64_t)l->header.counts[ONYX_SCENE_OBJECT_TEXTURE] * sizeof(SceneTexture),
+        [SECTION_FREE_IDS]  = freeTotal * sizeof(uint32_t),
+        [SECTION_GEOS]      = (uint64_t)l->header.geoCount * sizeof(SceneResource),
+        [SECTION_IMAGES]    = (uint64_t)l->header.imageCount * sizeof(SceneResource),
+    };
+    const void* bodies[SECTION_COUNT];
+    for (int i = 0; i < SECTION_COUNT; i++)
+    {
+        SceneSection s;
+        memcpy(&s, data + sizeof(header) + i * sizeof(s), sizeof(s));
+        if (memcmp(s.tag, g_sectionTags[i], 4) != 0 || s.offset % 16 ||
+            s.offset > size || s.size > size - s.offset ||
+            (i != SECTION_STRINGS && s.size != sizes[i]) ||
+            onyx_Crc32c(0, data + s.offset, s.size) != s.crc)
+            return false;
+        bodies[i] = data + s.offset;
+        if (i == SECTION_STRINGS)
+            l->stringsSize = s.size;
+    }
+    // the file is read into memory aligned for all of these
+    l->camera    = bodies[SECTION_CAMERA];
+    l->prims     = bodies[SECTION_PRIMS];
+    l->lights    = bodies[SECTION_LIGHTS];
+    l->materials = bodies[SECTION_MATERIALS];
+    l->textures  = bodies[SECTION_TEXTURES];
+    l->freeIds   = bodies[SECTION_FREE_IDS];
+    l->geos      = bodies[SECTION_GEOS];
+    l->images    = bodies[SECTION_IMAGES];
+    l->strings   = bodies[SECTION_STRINGS];
+    return true;
+}
+
+static uint32_t
+getRecordId(const SceneLayout* l, Onyx_SceneObjectType type, uint32_t i)
+{
+    switch (type)
+    {
+    case ONYX_SCENE_OBJECT_PRIM: return l->prims[i].id;
+    case ONYX_SCENE_OBJECT_LIGHT: return l->lights[i].id;
+    case ONYX_SCENE_OBJECT_MATERIAL: return l->materials[i].id;
+    default: return l->textures[i].id;
+    }
+}
+
+// every id below count + freeCount is either live or free, exactly once
+static bool
+parseIds(SceneLayout* l)
+{
+    const uint32_t* freeIds = l->freeIds;
+    for (int t = 0; t < ONYX_SCENE_OBJECT_TYPE_COUNT; t++)
+    {
+        Onyx_SceneObjectIds* ids     = &l->ids[t];
+        const uint64_t       idCount = (uint64_t)l->header.counts[t] + l->header.freeCounts[t];
+        if (idCount > UINT32_MAX)
+            return false;
+        ids->count     = l->header.counts[t];
+        ids->freeCount = l->header.freeCounts[t];
+        ids->ids       = hell_Malloc((ids->count + 1) * sizeof(uint32_t));
+        ids->freeIds   = hell_Malloc((ids->freeCount + 1) * sizeof(uint32_t));
+        l->live[t]     = hell_Malloc(idCount + 1);
+        memset(l->live[t], 0, idCount + 1);
+        uint8_t* seen = hell_Malloc(idCount + 1);
+        memset(seen, 0, idCount + 1);
+        bool ok = true;
+        for (uint32_t i = 0; i < ids->count && ok; i++)
+        {
+            const uint32_t id = getRecordId(l, t, i);
+            ok                = id < idCount && !seen[id];
+            if (ok)
+                seen[id] = l->live[t][id] = 1;
+            ids->ids[i] = id;
+        }
+        for (uint32_t i = 0; i < ids->freeCount && ok; i++)
+        {
+            const uint32_t id = freeIds[i];
+            ok                = id < idCount && !seen[id];
+            if (ok)
+                seen[id] = 1;
+            ids->freeIds[i] = id;
+        }
+        hell_Free(seen);
+        freeIds += ids->freeCount;
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+static bool
+isLive(const SceneLayout* l, Onyx_SceneObjectType type, uint32_t id)
+{
+    return id < l->header.counts[type] + l->header.freeCounts[type] &&
+           l->live[type][id];
+}
+
+static bool
+isResource(uint32_t index, uint32_t count)
+{
+    return index < count || index == NO_RESOURCE || index == DEFAULT_RESOURCE;
+}
+
+static bool
+checkResources(const SceneLayout* l, const SceneResource* r, uint32_t count,
+               bool images)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint64_t limit = r[i].kind == RESOURCE_PATH ? l->stringsSize : l->size;
+        if (r[i].kind > RESOURCE_PATH || r[i].offset > limit ||
+            (images && r[i].channelCount != 1 && r[i].channelCount != 4) ||
+            r[i].size > limit - r[i].offset)
+            return false;
+    }
+    return true;
+}
+
+// handles between objects must be to live objects
+static bool
+checkReferences(const SceneLayout* l)
+{
+    for (uint32_t i = 0; i < l->header.counts[ONYX_SCENE_OBJECT_PRIM]; i++)
+        if (!isResource(l->prims[i].geo, l->header.geoCount) ||
+            !isLive(l, ONYX_SCENE_OBJECT_MATERIAL, l->prims[i].material))
+            return false;
+    for (uint32_t i = 0; i < l->header.counts[ONYX_SCENE_OBJECT_LIGHT]; i++)
+        if (l->lights[i].type > ONYX_DIRECTION_LIGHT_TYPE)
+            return false;
+    for (uint32_t i = 0; i < l->header.counts[ONYX_SCENE_OBJECT_MATERIAL]; i++)
+    {
+        const SceneMaterial* m = &l->materials[i];
+        if (!isLive(l, ONYX_SCENE_OBJECT_TEXTURE, m->albedo) ||
+            !isLive(l, ONYX_SCENE_OBJECT_TEXTURE, m->roughnessTexture) ||
+            !isLive(l, ONYX_SCENE_OBJECT_TEXTURE, m->normal))
+            return false;
+    }
+    for (uint32_t i = 0; i < l->header.counts[ONYX_SCENE_OBJECT_TEXTURE]; i++)
+        if (!isResource(l->textures[i].image, l->header.imageCount))
+            return false;
+    return checkResources(l, l->geos, l->header.geoCount, false) &&
+           checkResources(l, l->images, l->header.imageCount, true);
+}
+
+typedef struct {
+    const SceneLayout* layout;
+    const char*        dir;
+    Onyx_FileGeo*      fileGeos;
+    Onyx_ImageData*    imageDatas;
+    bool*              ok;
+} DecodeContext;
+
+// relative paths are relative to the scene file
+static char*
+resolvePath(const DecodeContext* ctx, const SceneResource* r)
+{
+    const char* path = ctx->layout->strings + r->offset;
+    bool absolute    = r->size > 0 && (path[0] == '/' || path[0] == '\\');
+#if WIN32
+    absolute = absolute || (r->size > 1 && path[1] == ':');
+#endif
+    const size_t dirLen = absolute ? 0 : strlen(ctx->dir);
+    char*        full   = hell_Malloc(dirLen + r->size + 1);
+    memcpy(full, ctx->dir, dirLen);
+    memcpy(full + dirLen, path, r->size);
+    full[dirLen + r->size] = '\0';
+    return full;
+}
+
+static bool
+decodeGeo(const DecodeContext* ctx, const SceneResource* r, Onyx_FileGeo* fgeo)
+{
+    if (r->kind == RESOURCE_EMBEDDED)
+        return onyx_ReadFileGeoFromMemory(ctx->layout->data + r->offset, r->size,
+                                          fgeo);
+    char* path = resolvePath(ctx, r);
+    bool  ok;
+    if (onyx_GetGeoImportFormat(path) != ONYX_GEO_IMPORT_FORMAT_NONE)
+        ok = onyx_ImportFileGeo(path, 1, fgeo);
+    else
+    {
+        // onyx_ReadFileGeo expects the file to exist
+        FILE* file = fopen(path, "rb");
+        ok         = file != NULL;
+        if (file)
+            fclose(file);
+        ok = ok && onyx_ReadFileGeo(path, fgeo);
+    }
+    if (!ok)
+        DPRINT("Can't read referenced geo %s\n", path);
+    hell_Free(path);
+    return ok;
+}
+
+static bool
+decodeImage(const DecodeContext* ctx, const SceneResource* r, Onyx_ImageData* d)
+{
+    int      channels;
+    uint8_t* pixels;
+    if (r->kind == RESOURCE_EMBEDDED)
+    {
+        const uint8_t* png = ctx->layout->data + r->offset;
+        if (r->size > INT32_MAX || onyx_Crc32c(0, png, r->size) != r->crc)
+            return false;
+        pixels = stbi_load_from_memory(png, (int)r->size, &d->width, &d->height,
+                                       &channels, r->channelCount);
+    }
+    else
+    {
+        char* path = resolvePath(ctx, r);
+        pixels = stbi_load(path, &d->width, &d->height, &channels, r->channelCount);
+        if (!pixels)
+            DPRINT("Can't read referenced image %s\n", path);
+        hell_Free(path);
+    }
+    d->channelCount = r->channelCount;
+    d->format       = r->format;
+    d->data         = pixels;
+    return pixels != NULL;
+}
+
+static void
+decodeResource(void* data, uint32_t task, uint32_t thread)
+{
+    DecodeContext*     ctx = data;
+    const SceneLayout* l   = ctx->layout;
+    if (task < l->header.geoCount)
+        ctx->ok[task] = decodeGeo(ctx, &l->geos[task], &ctx->fileGeos[task]);
+    else
+    {
+        const uint32_t i = task - l->header.geoCount;
+        ctx->ok[task]    = decodeImage(ctx, &l->images[i], &ctx->imageDatas[i]);
+    }
+}
+
+static char*
+getDirectory(const char* filename)
+{
+    const char* slash = strrchr(filename, '/');
+#if WIN32
+    const char* back = strrchr(filename, '\\');
+    if (back > slash)
+        slash = back;
+#endif
+    const size_t len = slash ? slash - filename + 1 : 0;
+    char*        dir = hell_Malloc(len + 1);
+    memcpy(dir, filename, len);
+    dir[len] = '\0';
+    return dir;
+}
+
+static void
+freeLayout(SceneLayout* l)
+{
+    for (int t = 0; t < ONYX_SCENE_OBJECT_TYPE_COUNT; t++)
+    {
+        hell_Free(l->live[t]);
+        hell_Free(l->ids[t].ids);
+        hell_Free(l->ids[t].freeIds);
+    }
+}
+
+static Coal_Mat4
+toMat4(const float m[16])
+{
+    Coal_Mat4 r;
+    memcpy(r.e, m, 16 * sizeof(float));
+    return r;
+}
+
+// Builds the objects of the layout, taking over its ids. Prims and textures
+// point into geos and images or at the defaults.
+static void
+buildObjects(SceneLayout* l, Onyx_Geometry* geos, Onyx_Image* images,
+             const Onyx_Geometry* defaultGeo, const Onyx_Image* defaultImage,
+             Onyx_SceneFileObjects* o)
+{
+    const uint32_t* counts = l->header.counts;
+    memset(o, 0, sizeof(*o));
+    memcpy(o->ids, l->ids, sizeof(o->ids));
+    memset(l->ids, 0, sizeof(l->ids));
+    o->defaultGeo   = defaultGeo;
+    o->defaultImage = defaultImage;
+    o->cameraXform  = toMat4(l->camera->xform);
+    o->cameraProj   = toMat4(l->camera->proj);
+
+    Onyx_Texture* textures =
+        hell_Malloc((counts[ONYX_SCENE_OBJECT_TEXTURE] + 1) * sizeof(Onyx_Texture));
+    for (uint32_t i = 0; i < counts[ONYX_SCENE_OBJECT_TEXTURE]; i++)
+    {
+        const uint32_t image = l->textures[i].image;
+        textures[i]          = (Onyx_Texture){
+            .devImage = image == DEFAULT_RESOURCE ? (Onyx_Image*)defaultImage
+                        : image == NO_RESOURCE    ? NULL
+                                                  : &images[image],
+        };
+    }
+    o->textures = textures;
+
+    Onyx_Material* materials =
+        hell_Malloc((counts[ONYX_SCENE_OBJECT_MATERIAL] + 1) * sizeof(Onyx_Material));
+    for (uint32_t i = 0; i < counts[ONYX_SCENE_OBJECT_MATERIAL]; i++)
+    {
+        const SceneMaterial* r = &l->materials[i];
+        Onyx_Material*       m = &materials[i];
+        memset(m, 0, sizeof(*m));
+        for (int k = 0; k < 3; k++)
+            m->color.e[k] = r->color[k];
+        m->roughness        = r->roughness;
+        m->textureAlbedo    = onyx_CreateTextureHandle(r->albedo);
+        m->textureRoughness = onyx_CreateTextureHandle(r->roughnessTexture);
+        m->textureNormal    = onyx_CreateTextureHandle(r->normal);
+    }
+    o->materials = materials;
+
+    Onyx_Light* lights =
+        hell_Malloc((counts[ONYX_SCENE_OBJECT_LIGHT] + 1) * sizeof(Onyx_Light));
+    for (uint32_t i = 0; i < counts[ONYX_SCENE_OBJECT_LIGHT]; i++)
+    {
+        const SceneLight* r = &l->lights[i];
+        Onyx_Light*       light = &lights[i];
+        memset(light, 0, sizeof(*light));
+        light->type      = r->type;
+        light->intensity = r->intensity;
+        Coal_Vec3* v     = r->type == ONYX_LIGHT_POINT_TYPE
+                               ? &light->structure.pointLight.pos
+                               : &light->structure.directionLight.dir;
+        for (int k = 0; k < 3; k++)
+        {
+            light->color.e[k] = r->color[k];
+            v->e[k]           = r->vector[k];
+        }
+    }
+    o->lights = lights;
+
+    Onyx_Primitive* prims =
+        hell_Malloc((counts[ONYX_SCENE_OBJECT_PRIM] + 1) * sizeof(Onyx_Primitive));
+    for (uint32_t i = 0; i < counts[ONYX_SCENE_OBJECT_PRIM]; i++)
+    {
+        const ScenePrim* r   = &l->prims[i];
+        const uint32_t   geo = r->geo;
+        prims[i]             = (Onyx_Primitive){
+            .geo      = geo == DEFAULT_RESOURCE ? (Onyx_Geometry*)defaultGeo
+                        : geo == NO_RESOURCE    ? NULL
+                                                : &geos[geo],
+            .xform    = toMat4(r->xform),
+            .material = onyx_CreateMaterialHandle(r->material),
+            .flags    = r->flags,
+        };
+    }
+    o->prims = prims;
+}
+
+// textures before the materials that use them and materials before prims
+static void
+restoreObjects(Onyx_Scene* scene, const Onyx_SceneFileObjects* o)
+{
+    onyx_SceneRestoreObjects(scene, ONYX_SCENE_OBJECT_TEXTURE, o->textures,
+                             &o->ids[ONYX_SCENE_OBJECT_TEXTURE]);
+    onyx_SceneRestoreObjects(scene, ONYX_SCENE_OBJECT_MATERIAL, o->materials,
+                             &o->ids[ONYX_SCENE_OBJECT_MATERIAL]);
+    onyx_SceneRestoreObjects(scene, ONYX_SCENE_OBJECT_LIGHT, o->lights,
+                             &o->ids[ONYX_SCENE_OBJECT_LIGHT]);
+    onyx_SceneRestoreObjects(scene, ONYX_SCENE_OBJECT_PRIM, o->prims,
+                             &o->ids[ONYX_SCENE_OBJECT_PRIM]);
+    onyx_SceneSetCameraXform(scene, o->cameraXform);
+    onyx_SceneSetCameraProjection(scene, o->cameraProj);
+}
+
+// reads the file and checks everything but the embedded resources
+static uint8_t*
+readLayout(const char* filename, SceneLayout* l)
+{
+    size_t   size = 0;
+    uint8_t* data = onyx_ReadWholeFile(filename, &size);
+    *l            = (SceneLayout){.data = data, .size = size};
+    if (!data)
+        return NULL;
+    if (!parseSections(data, size, l) || !parseIds(l) || !checkReferences(l))
+    {
+        DPRINT("Malformed scene file %s\n", filename);
+        freeLayout(l);
+        hell_Free(data);
+        return NULL;
+    }
+    return data;
+}
+
+bool
+onyx_LoadSceneFile(Onyx_Memory* memory, const char* filename,
+                   const Onyx_LoadSceneParms* parms, Onyx_Scene* scene,
+                   Onyx_SceneFileResources* res)
+{
+    memset(res, 0, sizeof(*res));
+    SceneLayout l;
+    uint8_t*    data = readLayout(filename, &l);
+    if (!data)
+        return false;
+
+    const uint32_t geoCount   = l.header.geoCount;
+    const uint32_t imageCount = l.header.imageCount;
+    DecodeContext  ctx        = {
+        .layout     = &l,
+        .dir        = getDirectory(filename),
+        .fileGeos   = hell_Malloc((geoCount + 1) * sizeof(Onyx_FileGeo)),
+        .imageDatas = hell_Malloc((imageCount + 1) * sizeof(Onyx_ImageData)),
+        .ok         = hell_Malloc(geoCount + imageCount + 1),
+    };
+    memset(ctx.fileGeos, 0, (geoCount + 1) * sizeof(Onyx_FileGeo));
+    memset(ctx.imageDatas, 0, (imageCount + 1) * sizeof(Onyx_ImageData));
+    onyx_ParallelFor(parms->threadCount, geoCount + imageCount, decodeResource,
+                     &ctx);
+    bool ok = true;
+    for (uint32_t i = 0; i < geoCount + imageCount; i++)
+        ok = ok && ctx.ok[i];
+
+    if (ok)
+    {
+        res->geoCount   = geoCount;
+        res->geos       = hell_Malloc((geoCount + 1) * sizeof(Onyx_Geometry));
+        Onyx_Geometry** geoPtrs = hell_Malloc((geoCount + 1) * sizeof(geoPtrs[0]));
+        for (uint32_t i = 0; i < geoCount; i++)
+        {
+            res->geos[i] = onyx_CreateGeoFromFileGeo(
+                memory, parms->extraBufferUsageFlags, &ctx.fileGeos[i]);
+            onyx_FreeFileGeo(&ctx.fileGeos[i]);
+            geoPtrs[i] = &res->geos[i];
+        }
+        if (parms->transferToDevice)
+            onyx_TransferGeosToDevice(memory, geoCount, geoPtrs);
+        hell_Free(geoPtrs);
+
+        res->imageCount = imageCount;
+        res->images     = hell_Malloc((imageCount + 1) * sizeof(Onyx_Image));
+        memset(res->images, 0, (imageCount + 1) * sizeof(Onyx_Image));
+        onyx_LoadImagesData(memory, imageCount, ctx.imageDatas,
+                            VK_IMAGE_USAGE_SAMPLED_BIT | parms->extraImageUsageFlags,
+                            VK_IMAGE_ASPECT_COLOR_BIT, VK_SAMPLE_COUNT_1_BIT,
+                            VK_FILTER_LINEAR, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                            parms->createMips, ONYX_MEMORY_DEVICE_TYPE, res->images);
+
+        Onyx_SceneFileObjects objects;
+        buildObjects(&l, res->geos, res->images, onyx_SceneGetDefaultGeo(scene),
+                     onyx_SceneGetDefaultImage(scene), &objects);
+        restoreObjects(scene, &objects);
+        onyx_FreeSceneFileObjects(&objects);
+    }
+    else
+    {
+        DPRINT("Failed to decode the resources of scene file %s\n", filename);
+        for (uint32_t i = 0; i < geoCount; i++)
+            if (ctx.ok[i])
+                onyx_FreeFileGeo(&ctx.fileGeos[i]);
+    }
+    for (uint32_t i = 0; i < imageCount; i++)
+        if (ctx.imageDatas[i].data)
+            stbi_image_free((void*)ctx.imageDatas[i].data);
+
+    hell_Free((void*)ctx.dir);
+    hell_Free(ctx.fileGeos);
+    hell_Free(ctx.imageDatas);
+    hell_Free(ctx.ok);
+    freeLayout(&l);
+    hell_Free(data);
+    return ok;
+}
+
+void
+onyx_FreeSceneFileResources(Onyx_SceneFileResources* res)
+{
+    for (uint32_t i = 0; i < res->geoCount; i++)
+        onyx_FreeGeo(&res->geos[i]);
+    for (uint32_t i = 0; i < res->imageCount; i++)
+        onyx_FreeImage(&res->images[i]);
+    hell_Free(res->geos);
+    hell_Free(res->images);
+    memset(res, 0, sizeof(*res));
+}
+
+bool
+onyx_ReadSceneFileObjects(const char* filename, Onyx_SceneFileObjects* objects)
+{
+    memset(objects, 0, sizeof(*objects));
+    SceneLayout l;
+    uint8_t*    data = readLayout(filename, &l);
+    if (!data)
+        return false;
+    const uint32_t geoCount   = l.header.geoCount;
+    const uint32_t imageCount = l.header.imageCount;
+    Onyx_Geometry* geos       = hell_Malloc((geoCount + 1) * sizeof(Onyx_Geometry));
+    Onyx_Image*    images     = hell_Malloc((imageCount + 1) * sizeof(Onyx_Image));
+    memset(geos, 0, (geoCount + 1) * sizeof(Onyx_Geometry));
+    memset(images, 0, (imageCount + 1) * sizeof(Onyx_Image));
+    buildObjects(&l, geos, images, &geos[geoCount], &images[imageCount], objects);
+    objects->geoCount   = geoCount;
+    objects->geos       = geos;
+    objects->imageCount = imageCount;
+    objects->images     = images;
+    freeLayout(&l);
+    hell_Free(data);
+    return true;
+}
+
+void
+onyx_FreeSceneFileObjects(Onyx_SceneFileObjects* objects)
+{
+    for (int t = 0; t < ONYX_SCENE_OBJECT_TYPE_COUNT; t++)
+        onyx_FreeSceneObjectIds(&objects->ids[t]);
+    hell_Free((void*)objects->prims);
+    hell_Free((void*)objects->lights);
+    hell_Free((void*)objects->materials);
+    hell_Free((void*)objects->textures);
+    hell_Free(objects->geos);
+    hell_Free(objects->images);
+    memset(objects, 0, sizeof(*objects));
+}
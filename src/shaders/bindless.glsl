@@ -0,0 +1,16 @@
+// Bindless scene textures and materials. Mirrors Onyx_BindlessMaterial in
+// bindless.h. Define ONYX_BINDLESS_SET as the set the texture array is bound
+// to and ONYX_BINDLESS_TEXTURE_COUNT as onyx_GetBindlessTextureCount before
+// including. A slot that varies within a draw needs
+// GL_EXT_nonuniform_qualifier and nonuniformEXT around it.
+
+struct BindlessMaterial {
+    vec3  color;
+    float roughness;
+    uint  albedoSlot;
+    uint  roughnessSlot;
+    uint  normalSlot;
+    uint  padding;
+};
+
+layout(set = ONYX_BINDLESS_SET, binding = 0) uniform sampler2D bindlessTextures[ONYX_BINDLESS_TEXTURE_COUNT];
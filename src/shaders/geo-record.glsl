@@ -0,0 +1,51 @@
+// Vertex pulling through buffer device addresses. Mirrors Onyx_GeoRecord in
+// geo.h. Needs GL_EXT_buffer_reference, GL_EXT_scalar_block_layout and
+// GL_EXT_shader_explicit_arithmetic_types_int64.
+
+// indices into GeoRecord.attributes, in the order of OnyxAttributeTypes
+#define ONYX_ATTR_POS       0
+#define ONYX_ATTR_UV        1
+#define ONYX_ATTR_NORMAL    2
+#define ONYX_ATTR_TANGENT   3
+#define ONYX_ATTR_BITANGENT 4
+#define ONYX_ATTR_UVW       5
+#define ONYX_ATTR_SIGN      6
+#define ONYX_ATTR_COUNT     7
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer GeoFloats {
+    float v[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer GeoIndices {
+    uint i[];
+};
+
+struct GeoRecord {
+    GeoFloats  attributes[ONYX_ATTR_COUNT];
+    GeoIndices indices;
+    uint       vertexCount;
+    uint       indexCount;
+    uint       padding[2];
+};
+
+bool geoHasAttribute(GeoRecord g, int type)
+{
+    return uint64_t(g.attributes[type]) != 0;
+}
+
+vec2 geoFetchVec2(GeoRecord g, int type, uint vertex)
+{
+    GeoFloats p = g.attributes[type];
+    return vec2(p.v[vertex * 2], p.v[vertex * 2 + 1]);
+}
+
+vec3 geoFetchVec3(GeoRecord g, int type, uint vertex)
+{
+    GeoFloats p = g.attributes[type];
+    return vec3(p.v[vertex * 3], p.v[vertex * 3 + 1], p.v[vertex * 3 + 2]);
+}
+
+float geoFetchFloat(GeoRecord g, int type, uint vertex)
+{
+    return g.attributes[type].v[vertex];
+}
@@ -0,0 +1,36 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_shader_explicit_arithmetic_types_int64 : require
+#extension GL_GOOGLE_include_directive : enable
+
+#include "geo-record.glsl"
+
+// default.vert with the vertices pulled from the geo record selected by
+// firstInstance, see onyx_DrawGeoPulled
+
+layout(location = 0) out vec3 outColor;
+layout(location = 1) out vec3 outNormal;
+
+layout(set = 0, binding = 0) uniform Matrices {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    mat4 viewInv;
+    mat4 projInv;
+} matrices;
+
+layout(set = 0, binding = 1, scalar) readonly buffer GeoRecords {
+    GeoRecord records[];
+};
+
+void main()
+{
+    GeoRecord g    = records[gl_InstanceIndex];
+    uint      v    = gl_VertexIndex;
+    vec3      pos  = geoFetchVec3(g, ONYX_ATTR_POS, v);
+    vec3      norm = geoHasAttribute(g, ONYX_ATTR_NORMAL) ? geoFetchVec3(g, ONYX_ATTR_NORMAL, v) : vec3(0, 1, 0);
+    gl_Position = matrices.proj * matrices.view * matrices.model * vec4(pos, 1.0);
+    outColor  = norm * 0.5 + 0.5;
+    outNormal = norm;
+}
@@ -0,0 +1,792 @@
+#include "meshproc.h"
+#include "file.h"
+#include "attribute.h"
+#include "dtags.h"
+#include "memory.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Edge collapse simplifier in the style of Garland & Heckbert. Every pass
+// gathers candidate collapses over all edges, sorts them by quadric error and
+// applies as many as possible without two collapses touching the same
+// one-ring. Collapses are half-edge collapses: the source vertex is merged into
+// the target vertex, so no new vertex data is ever produced.
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_GEO, fmt, ##__VA_ARGS__)
+
+#define NONE UINT32_MAX
+
+// weight of the quadrics keeping open borders in place, relative to the
+// triangle quadrics
+#define BORDER_WEIGHT 10.f
+// a collapse is rejected if it rotates any triangle normal by more than ~75deg
+#define FLIP_THRESHOLD 0.25f
+
+typedef struct {
+    float x, y, z;
+} Pos;
+
+// symmetric 4x4 matrix plus the total weight of the accumulated planes
+typedef struct {
+    float a00, a11, a22;
+    float a10, a20, a21;
+    float b0, b1, b2;
+    float c;
+    float w;
+} Quadric;
+
+typedef enum {
+    KIND_MANIFOLD,
+    KIND_BORDER,
+    KIND_SEAM,
+    KIND_LOCKED,
+} VertexKind;
+
+typedef struct {
+    uint32_t v0;
+    uint32_t v1;
+    float    cost;
+} Collapse;
+
+typedef struct {
+    uint32_t* offsets;
+    uint32_t* counts;
+    uint32_t* tris;
+} Adjacency;
+
+static uint32_t
+hashPos(const Pos* p)
+{
+    uint32_t h[3];
+    memcpy(h, p, sizeof(h));
+    // murmur style mix of the three words
+    uint32_t r = (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+    r ^= r >> 16;
+    r *= 0x85ebca6bu;
+    r ^= r >> 13;
+    return r;
+}
+
+// remap maps each vertex to the first vertex with the same position. wedge
+// links all vertices sharing a position into a circular list.
+static void
+buildPositionRemap(const Pos* pos, uint32_t vertexCount, uint32_t* remap,
+                   uint32_t* wedge)
+{
+    uint32_t tableSize = 1;
+    while (tableSize < vertexCount + vertexCount / 4)
+        tableSize *= 2;
+    const uint32_t mask  = tableSize - 1;
+    uint32_t*      table = hell_Malloc(tableSize * sizeof(uint32_t));
+    memset(table, 0xff, tableSize * sizeof(uint32_t));
+
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        uint32_t h = hashPos(&pos[v]) & mask;
+        while (table[h] != NONE &&
+               memcmp(&pos[table[h]], &pos[v], sizeof(Pos)) != 0)
+            h = (h + 1) & mask;
+        if (table[h] == NONE)
+        {
+            table[h] = v;
+            remap[v] = v;
+            wedge[v] = v;
+        }
+        else
+        {
+            uint32_t r = table[h];
+            remap[v]   = r;
+            wedge[v]   = wedge[r];
+            wedge[r]   = v;
+        }
+    }
+
+    hell_Free(table);
+}
+
+static void
+buildAdjacency(Adjacency* adj, const uint32_t* indices, uint32_t indexCount,
+               uint32_t vertexCount)
+{
+    memset(adj->counts, 0, vertexCount * sizeof(uint32_t));
+    for (uint32_t i = 0; i < indexCount; i++)
+        adj->counts[indices[i]]++;
+    uint32_t offset = 0;
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        adj->offsets[v] = offset;
+        offset += adj->counts[v];
+    }
+    // counts are rebuilt while filling
+    memset(adj->counts, 0, vertexCount * sizeof(uint32_t));
+    for (uint32_t i = 0; i < indexCount; i++)
+    {
+        uint32_t v = indices[i];
+        adj->tris[adj->offsets[v] + adj->counts[v]++] = i / 3;
+    }
+}
+
+// whether some triangle holds the directed edge a -> b
+static bool
+hasEdge(const Adjacency* adj, const uint32_t* indices, uint32_t a, uint32_t b)
+{
+    const uint32_t* tris = adj->tris + adj->offsets[a];
+    for (uint32_t i = 0; i < adj->counts[a]; i++)
+    {
+        const uint32_t* tri = indices + tris[i] * 3;
+        for (int k = 0; k < 3; k++)
+        {
+            if (tri[k] == a && tri[(k + 1) % 3] == b)
+                return true;
+        }
+    }
+    return false;
+}
+
+// loop[a] = b for every open edge a -> b, loopback is the reverse. vertices
+// with more than one open edge in either direction are flagged as locked.
+static void
+buildOpenEdges(const Adjacency* adj, const uint32_t* indices,
+               uint32_t indexCount, uint32_t vertexCount, uint32_t* loop,
+               uint32_t* loopback, bool* multi)
+{
+    memset(loop, 0xff, vertexCount * sizeof(uint32_t));
+    memset(loopback, 0xff, vertexCount * sizeof(uint32_t));
+    memset(multi, 0, vertexCount * sizeof(bool));
+    for (uint32_t i = 0; i < indexCount; i += 3)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t a = indices[i + k];
+            uint32_t b = indices[i + (k + 1) % 3];
+            if (hasEdge(adj, indices, b, a))
+                continue;
+            if (loop[a] != NONE && loop[a] != b)
+                multi[a] = true;
+            if (loopback[b] != NONE && loopback[b] != a)
+                multi[b] = true;
+            loop[a]     = b;
+            loopback[b] = a;
+        }
+    }
+}
+
+static void
+classifyVertices(uint8_t* kinds, uint32_t vertexCount, const uint32_t* remap,
+                 const uint32_t* wedge, const uint32_t* loop,
+                 const uint32_t* loopback, const bool* multi,
+                 Onyx_SimplifyFlags flags)
+{
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        const uint32_t w = wedge[v];
+        if (w == v)
+        {
+            // unique position
+            if (multi[v])
+                kinds[v] = KIND_LOCKED;
+            else if (loop[v] == NONE && loopback[v] == NONE)
+                kinds[v] = KIND_MANIFOLD;
+            else if (loop[v] != NONE && loopback[v] != NONE)
+                kinds[v] = (flags & ONYX_SIMPLIFY_LOCK_BORDER_BIT)
+                               ? KIND_LOCKED
+                               : KIND_BORDER;
+            else
+                kinds[v] = KIND_LOCKED;
+        }
+        else if (wedge[w] == v)
+        {
+            // exactly two vertices share this position. it is a seam if both
+            // sides run along the same pair of neighbouring positions.
+            if (!multi[v] && !multi[w] && loop[v] != NONE &&
+                loopback[v] != NONE && loop[w] != NONE &&
+                loopback[w] != NONE &&
+                remap[loop[v]] == remap[loopback[w]] &&
+                remap[loopback[v]] == remap[loop[w]])
+                kinds[v] = KIND_SEAM;
+            else
+                kinds[v] = KIND_LOCKED;
+        }
+        else
+            kinds[v] = KIND_LOCKED;
+    }
+}
+
+static void
+quadricFromPlane(Quadric* q, float a, float b, float c, float d, float w)
+{
+    q->a00 = a * a * w;
+    q->a11 = b * b * w;
+    q->a22 = c * c * w;
+    q->a10 = a * b * w;
+    q->a20 = a * c * w;
+    q->a21 = b * c * w;
+    q->b0  = a * d * w;
+    q->b1  = b * d * w;
+    q->b2  = c * d * w;
+    q->c   = d * d * w;
+    q->w   = w;
+}
+
+static void
+quadricAdd(Quadric* dst, const Quadric* src)
+{
+    dst->a00 += src->a00;
+    dst->a11 += src->a11;
+    dst->a22 += src->a22;
+    dst->a10 += src->a10;
+    dst->a20 += src->a20;
+    dst->a21 += src->a21;
+    dst->b0 += src->b0;
+    dst->b1 += src->b1;
+    dst->b2 += src->b2;
+    dst->c += src->c;
+    dst->w += src->w;
+}
+
+// squared distance, normalized by the accumulated weight
+static float
+quadricError(const Quadric* q, const Pos* p)
+{
+    float rx = q->a00 * p->x + q->a10 * p->y + q->a20 * p->z;
+    float ry = q->a10 * p->x + q->a11 * p->y + q->a21 * p->z;
+    float rz = q->a20 * p->x + q->a21 * p->y + q->a22 * p->z;
+    float r  = rx * p->x + ry * p->y + rz * p->z;
+    r += 2.f * (q->b0 * p->x + q->b1 * p->y + q->b2 * p->z);
+    r += q->c;
+    return q->w > 0.f ? fabsf(r) / q->w : 0.f;
+}
+
+static Pos
+sub(const Pos* a, const Pos* b)
+{
+    return (Pos){a->x - b->x, a->y - b->y, a->z - b->z};
+}
+
+static Pos
+cross(const Pos* a, const Pos* b)
+{
+    return (Pos){a->y * b->z - a->z * b->y, a->z * b->x - a->x * b->z,
+                 a->x * b->y - a->y * b->x};
+}
+
+static float
+dot(const Pos* a, const Pos* b)
+{
+    return a->x * b->x + a->y * b->y + a->z * b->z;
+}
+
+static void
+fillQuadrics(Quadric* quadrics, const Pos* pos, const uint32_t* indices,
+             uint32_t indexCount, uint32_t vertexCount, const uint32_t* remap,
+             const uint32_t* loop)
+{
+    memset(quadrics, 0, vertexCount * sizeof(Quadric));
+    for (uint32_t i = 0; i < indexCount; i += 3)
+    {
+        const uint32_t* tri = indices + i;
+        Pos             e0  = sub(&pos[tri[1]], &pos[tri[0]]);
+        Pos             e1  = sub(&pos[tri[2]], &pos[tri[0]]);
+        Pos             n   = cross(&e0, &e1);
+        float           len = sqrtf(dot(&n, &n));
+        if (len == 0.f)
+            continue;
+        n.x /= len;
+        n.y /= len;
+        n.z /= len;
+        float   d = -dot(&n, &pos[tri[0]]);
+        Quadric q;
+        quadricFromPlane(&q, n.x, n.y, n.z, d, len);
+        for (int k = 0; k < 3; k++)
+            quadricAdd(&quadrics[remap[tri[k]]], &q);
+
+        // planes perpendicular to the triangle through its open edges keep
+        // borders from wandering off
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t a = tri[k];
+            uint32_t b = tri[(k + 1) % 3];
+            if (loop[a] != b)
+                continue;
+            Pos   e    = sub(&pos[b], &pos[a]);
+            Pos   en   = cross(&e, &n);
+            float elen = sqrtf(dot(&en, &en));
+            if (elen == 0.f)
+                continue;
+            en.x /= elen;
+            en.y /= elen;
+            en.z /= elen;
+            float ed = -dot(&en, &pos[a]);
+            quadricFromPlane(&q, en.x, en.y, en.z, ed,
+                             dot(&e, &e) * BORDER_WEIGHT);
+            quadricAdd(&quadrics[remap[a]], &q);
+            quadricAdd(&quadrics[remap[b]], &q);
+        }
+    }
+}
+
+// the partner of a seam collapse v0 -> v1 on the other side of the seam
+static bool
+seamPartner(uint32_t v0, uint32_t v1, const uint32_t* remap,
+            const uint32_t* wedge, const uint32_t* loopback, uint32_t* p0,
+            uint32_t* p1)
+{
+    uint32_t w0 = wedge[v0];
+    uint32_t w1 = loopback[w0];
+    if (w0 == v0 || w1 == NONE || remap[w1] != remap[v1])
+        return false;
+    *p0 = w0;
+    *p1 = w1;
+    return true;
+}
+
+static bool
+canCollapse(uint32_t v0, uint32_t v1, const uint8_t* kinds,
+            const uint32_t* remap, const uint32_t* wedge, const uint32_t* loop,
+            const uint32_t* loopback)
+{
+    uint32_t p0, p1;
+    switch (kinds[v0])
+    {
+    case KIND_MANIFOLD: return true;
+    case KIND_BORDER: return loop[v0] == v1;
+    case KIND_SEAM:
+        return loop[v0] == v1 &&
+               seamPartner(v0, v1, remap, wedge, loopback, &p0, &p1);
+    default: return false;
+    }
+}
+
+// whether moving v0 onto v1 flips or badly distorts a triangle around v0
+static bool
+hasTriangleFlip(uint32_t v0, uint32_t v1, const Pos* pos,
+                const uint32_t* indices, const Adjacency* adj)
+{
+    const uint32_t* tris = adj->tris + adj->offsets[v0];
+    for (uint32_t i = 0; i < adj->counts[v0]; i++)
+    {
+        const uint32_t* tri = indices + tris[i] * 3;
+        if (tri[0] == v1 || tri[1] == v1 || tri[2] == v1)
+            continue; // collapses to nothing
+        int k = tri[0] == v0 ? 0 : tri[1] == v0 ? 1 : 2;
+        const Pos* a  = &pos[tri[(k + 1) % 3]];
+        const Pos* b  = &pos[tri[(k + 2) % 3]];
+        Pos        e0 = sub(a, &pos[v0]);
+        Pos        e1 = sub(b, &pos[v0]);
+        Pos        n0 = cross(&e0, &e1);
+        e0            = sub(a, &pos[v1]);
+        e1            = sub(b, &pos[v1]);
+        Pos n1        = cross(&e0, &e1);
+        if (dot(&n0, &n1) <= FLIP_THRESHOLD * sqrtf(dot(&n0, &n0) * dot(&n1, &n1)))
+            return true;
+    }
+    return false;
+}
+
+static void
+touchOneRing(uint32_t v, const uint32_t* indices, const Adjacency* adj,
+             const uint32_t* remap, bool* touched)
+{
+    const uint32_t* tris = adj->tris + adj->offsets[v];
+    for (uint32_t i = 0; i < adj->counts[v]; i++)
+    {
+        const uint32_t* tri = indices + tris[i] * 3;
+        touched[remap[tri[0]]] = true;
+        touched[remap[tri[1]]] = true;
+        touched[remap[tri[2]]] = true;
+    }
+}
+
+// costs are non-negative so their bit patterns sort like unsigned integers
+static void
+sortCollapses(uint32_t* order, uint32_t* scratch, const Collapse* collapses,
+              uint32_t count)
+{
+    uint32_t hist[3][2048];
+    memset(hist, 0, sizeof(hist));
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t key;
+        memcpy(&key, &collapses[i].cost, sizeof(key));
+        hist[0][key & 2047]++;
+        hist[1][(key >> 11) & 2047]++;
+        hist[2][key >> 22]++;
+    }
+    for (int p = 0; p < 3; p++)
+    {
+        uint32_t sum = 0;
+        for (int i = 0; i < 2048; i++)
+        {
+            uint32_t c = hist[p][i];
+            hist[p][i] = sum;
+            sum += c;
+        }
+    }
+    for (uint32_t i = 0; i < count; i++)
+        order[i] = i;
+    for (int p = 0; p < 3; p++)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t key;
+            memcpy(&key, &collapses[order[i]].cost, sizeof(key));
+            uint32_t digit            = (key >> (p * 11)) & 2047;
+            scratch[hist[p][digit]++] = order[i];
+        }
+        uint32_t* t = order;
+        order       = scratch;
+        scratch     = t;
+    }
+    // an odd number of passes leaves the result in the caller's scratch
+}
+
+uint32_t
+onyx_SimplifyIndices(uint32_t* dst, const uint32_t* src, uint32_t indexCount,
+                     const float* positions, uint32_t vertexCount,
+                     uint32_t positionStride, uint32_t targetIndexCount,
+                     float targetError, Onyx_SimplifyFlags flags, float* error)
+{
+    assert(indexCount % 3 == 0);
+    assert(positionStride >= sizeof(Pos));
+
+    if (error)
+        *error = 0.f;
+    if (targetIndexCount >= indexCount || vertexCount == 0)
+    {
+        memmove(dst, src, indexCount * sizeof(uint32_t));
+        return indexCount;
+    }
+
+    Pos*      pos      = hell_Malloc(vertexCount * sizeof(Pos));
+    uint32_t* remap    = hell_Malloc(vertexCount * sizeof(uint32_t));
+    uint32_t* wedge    = hell_Malloc(vertexCount * sizeof(uint32_t));
+    uint32_t* loop     = hell_Malloc(vertexCount * sizeof(uint32_t));
+    uint32_t* loopback = hell_Malloc(vertexCount * sizeof(uint32_t));
+    uint32_t* collapseRemap = hell_Malloc(vertexCount * sizeof(uint32_t));
+    bool*     multi    = hell_Malloc(vertexCount * sizeof(bool));
+    bool*     touched  = hell_Malloc(vertexCount * sizeof(bool));
+    uint8_t*  kinds    = hell_Malloc(vertexCount);
+    Quadric*  quadrics = hell_Malloc(vertexCount * sizeof(Quadric));
+    uint32_t* indices  = hell_Malloc(indexCount * sizeof(uint32_t));
+    Collapse* candidates = hell_Malloc(indexCount * sizeof(Collapse));
+    uint32_t* order    = hell_Malloc(indexCount * sizeof(uint32_t));
+    uint32_t* scratch  = hell_Malloc(indexCount * sizeof(uint32_t));
+    Adjacency adj      = {
+        .offsets = hell_Malloc(vertexCount * sizeof(uint32_t)),
+        .counts  = hell_Malloc(vertexCount * sizeof(uint32_t)),
+        .tris    = hell_Malloc(indexCount * sizeof(uint32_t)),
+    };
+
+    memcpy(indices, src, indexCount * sizeof(uint32_t));
+    for (uint32_t v = 0; v < vertexCount; v++)
+        memcpy(&pos[v], (const uint8_t*)positions + (size_t)v * positionStride,
+               sizeof(Pos));
+
+    buildPositionRemap(pos, vertexCount, remap, wedge);
+
+    // work in a unit box so error thresholds are scale independent
+    Pos minP = {FLT_MAX, FLT_MAX, FLT_MAX};
+    Pos maxP = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        minP.x = fminf(minP.x, pos[v].x);
+        minP.y = fminf(minP.y, pos[v].y);
+        minP.z = fminf(minP.z, pos[v].z);
+        maxP.x = fmaxf(maxP.x, pos[v].x);
+        maxP.y = fmaxf(maxP.y, pos[v].y);
+        maxP.z = fmaxf(maxP.z, pos[v].z);
+    }
+    float extent = fmaxf(maxP.x - minP.x, fmaxf(maxP.y - minP.y, maxP.z - minP.z));
+    float scale  = extent > 0.f ? 1.f / extent : 0.f;
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        pos[v].x = (pos[v].x - minP.x) * scale;
+        pos[v].y = (pos[v].y - minP.y) * scale;
+        pos[v].z = (pos[v].z - minP.z) * scale;
+    }
+
+    buildAdjacency(&adj, indices, indexCount, vertexCount);
+    buildOpenEdges(&adj, indices, indexCount, vertexCount, loop, loopback,
+                   multi);
+    classifyVertices(kinds, vertexCount, remap, wedge, loop, loopback, multi,
+                     flags);
+    fillQuadrics(quadrics, pos, indices, indexCount, vertexCount, remap, loop);
+
+    for (uint32_t v = 0; v < vertexCount; v++)
+        collapseRemap[v] = v;
+
+    const float errorLimit  = targetError * scale * targetError * scale;
+    float       resultError = 0.f;
+
+    while (indexCount > targetIndexCount)
+    {
+        // adjacency of the indices left over by the previous pass
+        buildAdjacency(&adj, indices, indexCount, vertexCount);
+
+        uint32_t candidateCount = 0;
+        for (uint32_t i = 0; i < indexCount; i += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t a = indices[i + k];
+                uint32_t b = indices[i + (k + 1) % 3];
+                // each interior edge shows up in both directions, take it once
+                if (a > b && loop[a] != b)
+                    continue;
+                if (remap[a] == remap[b])
+                    continue;
+                const Quadric* qa = &quadrics[remap[a]];
+                const Quadric* qb = &quadrics[remap[b]];
+                // collapsing a onto b leaves the vertex at b, so the combined
+                // quadric is evaluated there
+                float ca = FLT_MAX, cb = FLT_MAX;
+                if (canCollapse(a, b, kinds, remap, wedge, loop, loopback))
+                    ca = quadricError(qa, &pos[b]) + quadricError(qb, &pos[b]);
+                if (canCollapse(b, a, kinds, remap, wedge, loop, loopback))
+                    cb = quadricError(qa, &pos[a]) + quadricError(qb, &pos[a]);
+                if (ca == FLT_MAX && cb == FLT_MAX)
+                    continue;
+                Collapse* c = &candidates[candidateCount++];
+                c->v0       = ca <= cb ? a : b;
+                c->v1       = ca <= cb ? b : a;
+                c->cost     = ca <= cb ? ca : cb;
+            }
+        }
+
+        sortCollapses(order, scratch, candidates, candidateCount);
+
+        // each collapse removes about two triangles
+        uint32_t budget = (indexCount - targetIndexCount) / 6;
+        if (budget == 0)
+            budget = 1;
+        memset(touched, 0, vertexCount * sizeof(bool));
+
+        uint32_t collapseCount = 0;
+        for (uint32_t i = 0; i < candidateCount; i++)
+        {
+            const Collapse* c = &candidates[scratch[i]];
+            if (c->cost > errorLimit)
+                break;
+            uint32_t v0 = c->v0, v1 = c->v1;
+            if (touched[remap[v0]] || touched[remap[v1]])
+                continue;
+            uint32_t p0 = NONE, p1 = NONE;
+            if (kinds[v0] == KIND_SEAM)
+                seamPartner(v0, v1, remap, wedge, loopback, &p0, &p1);
+            if (hasTriangleFlip(v0, v1, pos, indices, &adj))
+                continue;
+            if (p0 != NONE && hasTriangleFlip(p0, p1, pos, indices, &adj))
+                continue;
+
+            collapseRemap[v0] = v1;
+            if (p0 != NONE)
+                collapseRemap[p0] = p1;
+            quadricAdd(&quadrics[remap[v1]], &quadrics[remap[v0]]);
+
+            touchOneRing(v0, indices, &adj, remap, touched);
+            if (p0 != NONE)
+                touchOneRing(p0, indices, &adj, remap, touched);
+
+            if (c->cost > resultError)
+                resultError = c->cost;
+            if (++collapseCount >= budget)
+                break;
+        }
+
+        if (collapseCount == 0)
+            break;
+
+        // apply the collapses and drop the triangles that degenerated
+        uint32_t writeCount = 0;
+        for (uint32_t i = 0; i < indexCount; i += 3)
+        {
+            uint32_t a = collapseRemap[indices[i + 0]];
+            uint32_t b = collapseRemap[indices[i + 1]];
+            uint32_t c = collapseRemap[indices[i + 2]];
+            if (a == b || b == c || c == a)
+                continue;
+            indices[writeCount++] = a;
+            indices[writeCount++] = b;
+            indices[writeCount++] = c;
+        }
+        indexCount = writeCount;
+
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            if (loop[v] != NONE)
+                loop[v] = collapseRemap[loop[v]];
+            if (loopback[v] != NONE)
+                loopback[v] = collapseRemap[loopback[v]];
+        }
+        for (uint32_t v = 0; v < vertexCount; v++)
+            collapseRemap[v] = v;
+    }
+
+    DPRINT("Simplified to %d indices, error %f\n", indexCount,
+           sqrtf(resultError) * extent);
+
+    memcpy(dst, indices, indexCount * sizeof(uint32_t));
+    if (error)
+        *error = sqrtf(resultError) * extent;
+
+    hell_Free(pos);
+    hell_Free(remap);
+    hell_Free(wedge);
+    hell_Free(loop);
+    hell_Free(loopback);
+    hell_Free(collapseRemap);
+    hell_Free(multi);
+    hell_Free(touched);
+    hell_Free(kinds);
+    hell_Free(quadrics);
+    hell_Free(indices);
+    hell_Free(candidates);
+    hell_Free(order);
+    hell_Free(scratch);
+    hell_Free(adj.offsets);
+    hell_Free(adj.counts);
+    hell_Free(adj.tris);
+
+    return indexCount;
+}
+
+// builds the coarser levels of the chain. returns a new allocation holding
+// their indices back to back and fills lods[1..] with offsets relative to
+// baseIndex.
+static uint32_t*
+buildLodChain(const uint32_t* indices, uint32_t indexCount,
+              const float* positions, uint32_t vertexCount, uint32_t stride,
+              uint32_t lodCount, float reduction, Onyx_SimplifyFlags flags,
+              uint32_t baseIndex, Onyx_GeoLod* lods, uint32_t* outLodCount,
+              uint32_t* outIndexCount)
+{
+    assert(lodCount <= ONYX_R_MAX_LODS);
+    assert(reduction > 0.f && reduction < 1.f);
+
+    lods[0] = (Onyx_GeoLod){.firstIndex = 0, .indexCount = indexCount};
+
+    uint32_t* chain     = NULL;
+    uint32_t  chainSize = 0;
+    uint32_t* level     = hell_Malloc(indexCount * sizeof(uint32_t));
+    uint32_t  count     = 1;
+    const uint32_t* prev      = indices;
+    uint32_t        prevCount = indexCount;
+
+    for (; count < lodCount; count++)
+    {
+        uint32_t target = (uint32_t)(prevCount / 3 * reduction) * 3;
+        float    err    = 0.f;
+        uint32_t n = onyx_SimplifyIndices(level, prev, prevCount, positions,
+                                          vertexCount, stride, target, FLT_MAX,
+                                          flags, &err);
+        // not worth another level
+        if (n == 0 || n > prevCount - prevCount / 20)
+            break;
+        chain = hell_Realloc(chain, (chainSize + n) * sizeof(uint32_t));
+        memcpy(chain + chainSize, level, n * sizeof(uint32_t));
+        lods[count] = (Onyx_GeoLod){
+            .firstIndex = baseIndex + chainSize,
+            .indexCount = n,
+            // errors of the individual steps add up at most
+            .error = lods[count - 1].error + err,
+        };
+        prev      = chain + chainSize;
+        prevCount = n;
+        chainSize += n;
+    }
+
+    hell_Free(level);
+    *outLodCount   = count;
+    *outIndexCount = chainSize;
+    return chain;
+}
+
+static int
+findPositionAttr(uint32_t attrCount, const char* const* names)
+{
+    for (uint32_t i = 0; i < attrCount; i++)
+    {
+        if (names[i] && strncmp(names[i], POS_NAME, ATTR_NAME_LEN) == 0)
+            return i;
+    }
+    // unnamed geometry keeps positions first
+    return 0;
+}
+
+uint32_t
+onyx_GenerateGeoLods(Onyx_Geometry* geo, uint32_t lodCount, float reduction,
+                     Onyx_SimplifyFlags flags)
+{
+    assert(geo->indexRegion.hostData && geo->vertexRegion.hostData);
+    assert(geo->indexCount % 3 == 0);
+
+    // unnamed geometry keeps positions first
+    int posIndex = onyx_GetGeoAttrIndexOfType(geo, ONYX_ATTRIBUTE_TYPE_POS);
+    if (posIndex < 0)
+        posIndex = 0;
+    assert(geo->attrSizes[posIndex] == sizeof(Pos));
+
+    const float* positions =
+        (const float*)(geo->vertexRegion.hostData + geo->attrOffsets[posIndex]);
+    const uint32_t* indices = (const uint32_t*)geo->indexRegion.hostData;
+
+    uint32_t  chainCount = 0;
+    uint32_t* chain      = buildLodChain(
+        indices, geo->indexCount, positions, geo->vertexCount, sizeof(Pos),
+        lodCount, reduction, flags, geo->indexCount, geo->lods, &geo->lodCount,
+        &chainCount);
+
+    if (chain)
+    {
+        size_t size = (geo->indexCount + chainCount) * sizeof(uint32_t);
+        // arena geos can't grow their index range. generate the lods before
+        // copying the geo into the arena.
+        assert(!geo->arena || size <= geo->indexRegion.size);
+        if (size > geo->indexRegion.size)
+            onyx_ResizeBufferRegion(&geo->indexRegion, size);
+        memcpy(geo->indexRegion.hostData + geo->indexCount * sizeof(uint32_t),
+               chain, chainCount * sizeof(uint32_t));
+        hell_Free(chain);
+    }
+    if (geo->lodCount < 2)
+        geo->lodCount = 0;
+
+    return geo->lodCount;
+}
+
+uint32_t
+onyx_GenerateFileGeoLods(Onyx_FileGeo* fgeo, uint32_t lodCount,
+                         float reduction, Onyx_SimplifyFlags flags)
+{
+    assert(fgeo->indexCount % 3 == 0);
+    // the indices get reallocated
+    assert(!fgeo->mapData && "read the geo with onyx_ReadFileGeo to modify it");
+
+    int posIndex = findPositionAttr(fgeo->attrCount,
+                                    (const char* const*)fgeo->attrNames);
+    assert(fgeo->attrSizes[posIndex] == sizeof(Pos));
+
+    uint32_t  chainCount = 0;
+    uint32_t* chain      = buildLodChain(
+        fgeo->indices, fgeo->indexCount, fgeo->attributes[posIndex],
+        fgeo->vertexCount, sizeof(Pos), lodCount, reduction, flags,
+        fgeo->indexCount, fgeo->lods, &fgeo->lodCount, &chainCount);
+
+    if (chain)
+    {
+        fgeo->indices = onyx_ResizeFileGeoArray(
+            fgeo, fgeo->indices, fgeo->indexCount * sizeof(uint32_t),
+            (fgeo->indexCount + chainCount) * sizeof(uint32_t));
+        memcpy(fgeo->indices + fgeo->indexCount, chain,
+               chainCount * sizeof(uint32_t));
+        hell_Free(chain);
+    }
+    if (fgeo->lodCount < 2)
+        fgeo->lodCount = 0;
+
+    return fgeo->lodCount;
+}
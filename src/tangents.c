@@ -0,0 +1,360 @@
+#include "meshproc.h"
+#include "attribute.h"
+#include "dtags.h"
+#include "mikktspace.h"
+#include "parallel.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <string.h>
+
+// mikktspace only ever relates corners whose position, normal and uv are
+// equal, so faces that share no such vertex value produce the same tangents
+// whether they are processed together or apart. We split the mesh into these
+// connected pieces, pack them into buckets and run mikktspace on the buckets in
+// parallel. Faces keep their original order inside a bucket which keeps the
+// result identical to a single serial run.
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_GEO, fmt, ##__VA_ARGS__)
+
+#define NONE UINT32_MAX
+
+// buckets per thread, to even out uneven piece sizes
+#define BUCKETS_PER_THREAD 4
+
+typedef struct {
+    const uint32_t* indices;
+    const float*    positions;
+    const float*    normals;
+    const float*    uvs;
+    float*          tangents;
+    float*          signs;
+    // maps the faces mikktspace sees to mesh faces. NULL if they are the same.
+    const uint32_t* faces;
+    uint32_t        faceCount;
+} TangentContext;
+
+typedef struct {
+    const Onyx_TangentSpaceInfo* info;
+    const uint32_t*              bucketOffsets;
+    const uint32_t*              bucketFaces;
+    bool                         failed;
+} BucketJob;
+
+static inline uint32_t
+cornerVertex(const TangentContext* tc, int iFace, int iVert)
+{
+    uint32_t face = tc->faces ? tc->faces[iFace] : (uint32_t)iFace;
+    return tc->indices[face * 3 + iVert];
+}
+
+// mikkt callbacks
+static int
+mikkt_GetNumFaces(const SMikkTSpaceContext* ctx)
+{
+    const TangentContext* tc = ctx->m_pUserData;
+    return tc->faceCount;
+}
+
+static int
+mikkt_GetNumVerticesOfFace(const SMikkTSpaceContext* ctx, const int iFace)
+{
+    return 3;
+}
+
+static void
+mikkt_GetPosition(const SMikkTSpaceContext* ctx, float fvPosOut[],
+                  const int iFace, const int iVert)
+{
+    const TangentContext* tc = ctx->m_pUserData;
+    const float*          p  = tc->positions + cornerVertex(tc, iFace, iVert) * 3;
+    fvPosOut[0]              = p[0];
+    fvPosOut[1]              = p[1];
+    fvPosOut[2]              = p[2];
+}
+
+static void
+mikkt_GetNormal(const SMikkTSpaceContext* ctx, float fvNormOut[],
+                const int iFace, const int iVert)
+{
+    const TangentContext* tc = ctx->m_pUserData;
+    const float*          n  = tc->normals + cornerVertex(tc, iFace, iVert) * 3;
+    fvNormOut[0]             = n[0];
+    fvNormOut[1]             = n[1];
+    fvNormOut[2]             = n[2];
+}
+
+static void
+mikkt_GetTexCoord(const SMikkTSpaceContext* ctx, float fvTexcOut[],
+                  const int iFace, const int iVert)
+{
+    const TangentContext* tc = ctx->m_pUserData;
+    const float*          t  = tc->uvs + cornerVertex(tc, iFace, iVert) * 2;
+    fvTexcOut[0]             = t[0];
+    fvTexcOut[1]             = t[1];
+}
+
+static void
+mikkt_SetTSpaceBasic(const SMikkTSpaceContext* ctx, const float fvTangent[],
+                     const float fSign, const int iFace, const int iVert)
+{
+    const TangentContext* tc = ctx->m_pUserData;
+    uint32_t              v  = cornerVertex(tc, iFace, iVert);
+    tc->tangents[v * 3 + 0]  = fvTangent[0];
+    tc->tangents[v * 3 + 1]  = fvTangent[1];
+    tc->tangents[v * 3 + 2]  = fvTangent[2];
+    tc->signs[v]             = fSign;
+}
+
+static bool
+runMikkt(const Onyx_TangentSpaceInfo* info, const uint32_t* faces,
+         uint32_t faceCount)
+{
+    SMikkTSpaceInterface mikkt_interface = {
+        .m_getNumFaces          = mikkt_GetNumFaces,
+        .m_getNormal            = mikkt_GetNormal,
+        .m_getNumVerticesOfFace = mikkt_GetNumVerticesOfFace,
+        .m_getPosition          = mikkt_GetPosition,
+        .m_getTexCoord          = mikkt_GetTexCoord,
+        .m_setTSpaceBasic       = mikkt_SetTSpaceBasic,
+    };
+
+    TangentContext tc = {
+        .indices   = info->indices,
+        .positions = info->positions,
+        .normals   = info->normals,
+        .uvs       = info->uvs,
+        .tangents  = info->tangents,
+        .signs     = info->signs,
+        .faces     = faces,
+        .faceCount = faceCount,
+    };
+
+    SMikkTSpaceContext mikkt_context = {.m_pInterface = &mikkt_interface,
+                                        .m_pUserData  = &tc};
+
+    return genTangSpaceDefault(&mikkt_context);
+}
+
+// the 8 floats mikktspace compares to weld corners. -0 is folded into 0 since
+// the two compare equal.
+static void
+vertexKey(const Onyx_TangentSpaceInfo* info, uint32_t v, float key[8])
+{
+    memcpy(key + 0, info->positions + v * 3, 3 * sizeof(float));
+    memcpy(key + 3, info->normals + v * 3, 3 * sizeof(float));
+    memcpy(key + 6, info->uvs + v * 2, 2 * sizeof(float));
+    for (int i = 0; i < 8; i++)
+        key[i] = key[i] == 0.f ? 0.f : key[i];
+}
+
+static uint32_t
+hashKey(const float key[8])
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 8; i++)
+    {
+        uint32_t w;
+        memcpy(&w, &key[i], sizeof(w));
+        h = (h ^ w) * 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+static bool
+keysEqual(const float a[8], const float b[8])
+{
+    for (int i = 0; i < 8; i++)
+        if (a[i] != b[i])
+            return false;
+    return true;
+}
+
+static uint32_t
+findRoot(uint32_t* parents, uint32_t v)
+{
+    while (parents[v] != v)
+    {
+        parents[v] = parents[parents[v]];
+        v          = parents[v];
+    }
+    return v;
+}
+
+static void
+unite(uint32_t* parents, uint32_t a, uint32_t b)
+{
+    a = findRoot(parents, a);
+    b = findRoot(parents, b);
+    if (a < b)
+        parents[b] = a;
+    else if (b < a)
+        parents[a] = b;
+}
+
+// returns for every vertex the first vertex with an equal key
+static uint32_t*
+weldVertexKeys(const Onyx_TangentSpaceInfo* info)
+{
+    const uint32_t vertexCount = info->vertexCount;
+    uint32_t       tableSize   = 1;
+    while (tableSize < vertexCount + vertexCount / 4)
+        tableSize *= 2;
+    const uint32_t mask  = tableSize - 1;
+    uint32_t*      table = hell_Malloc(tableSize * sizeof(uint32_t));
+    uint32_t*      welds = hell_Malloc(vertexCount * sizeof(uint32_t));
+    memset(table, 0xff, tableSize * sizeof(uint32_t));
+
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        float key[8], other[8];
+        vertexKey(info, v, key);
+        uint32_t h = hashKey(key) & mask;
+        welds[v]   = v;
+        for (; table[h] != NONE; h = (h + 1) & mask)
+        {
+            vertexKey(info, table[h], other);
+            if (keysEqual(key, other))
+            {
+                welds[v] = table[h];
+                break;
+            }
+        }
+        if (table[h] == NONE)
+            table[h] = v;
+    }
+
+    hell_Free(table);
+    return welds;
+}
+
+static void
+bucketTask(void* data, uint32_t bucket, uint32_t thread)
+{
+    BucketJob*     job   = data;
+    const uint32_t first = job->bucketOffsets[bucket];
+    const uint32_t count = job->bucketOffsets[bucket + 1] - first;
+    if (count == 0)
+        return;
+    if (!runMikkt(job->info, job->bucketFaces + first, count))
+        job->failed = true;
+}
+
+bool
+onyx_GenerateTangents(const Onyx_TangentSpaceInfo* info)
+{
+    assert(info->indexCount % 3 == 0);
+    const uint32_t faceCount   = info->indexCount / 3;
+    uint32_t       threadCount = info->threadCount;
+    if (threadCount == 0)
+        threadCount = onyx_GetHardwareThreadCount();
+
+    if (threadCount == 1 || faceCount < 1024)
+        return runMikkt(info, NULL, faceCount);
+
+    // connect the faces sharing a welded vertex
+    uint32_t* parents = weldVertexKeys(info);
+    for (uint32_t f = 0; f < faceCount; f++)
+    {
+        const uint32_t* tri = info->indices + f * 3;
+        unite(parents, parents[tri[0]], parents[tri[1]]);
+        unite(parents, parents[tri[0]], parents[tri[2]]);
+    }
+
+    // piece sizes, indexed by root vertex
+    uint32_t* pieceSizes = hell_Malloc(info->vertexCount * sizeof(uint32_t));
+    uint32_t* faceRoots  = hell_Malloc(faceCount * sizeof(uint32_t));
+    memset(pieceSizes, 0, info->vertexCount * sizeof(uint32_t));
+    for (uint32_t f = 0; f < faceCount; f++)
+    {
+        faceRoots[f] = findRoot(parents, info->indices[f * 3]);
+        pieceSizes[faceRoots[f]]++;
+    }
+
+    // hand each piece to the emptiest bucket. pieceSizes is reused to hold the
+    // bucket of each root.
+    const uint32_t bucketCount   = threadCount * BUCKETS_PER_THREAD;
+    uint32_t*      bucketOffsets = hell_Malloc((bucketCount + 1) * sizeof(uint32_t));
+    uint32_t*      bucketLoads   = hell_Malloc(bucketCount * sizeof(uint32_t));
+    memset(bucketLoads, 0, bucketCount * sizeof(uint32_t));
+    uint32_t pieceCount = 0;
+    for (uint32_t f = 0; f < faceCount; f++)
+    {
+        const uint32_t root = faceRoots[f];
+        if (pieceSizes[root] & 0x80000000u)
+            continue;
+        uint32_t best = 0;
+        for (uint32_t b = 1; b < bucketCount; b++)
+            if (bucketLoads[b] < bucketLoads[best])
+                best = b;
+        bucketLoads[best] += pieceSizes[root];
+        pieceSizes[root] = best | 0x80000000u;
+        pieceCount++;
+    }
+
+    // stable counting sort of the faces into their buckets
+    uint32_t offset = 0;
+    for (uint32_t b = 0; b < bucketCount; b++)
+    {
+        bucketOffsets[b] = offset;
+        offset += bucketLoads[b];
+        bucketLoads[b] = bucketOffsets[b];
+    }
+    bucketOffsets[bucketCount] = offset;
+    uint32_t* bucketFaces = hell_Malloc(faceCount * sizeof(uint32_t));
+    for (uint32_t f = 0; f < faceCount; f++)
+    {
+        uint32_t b                      = pieceSizes[faceRoots[f]] & ~0x80000000u;
+        bucketFaces[bucketLoads[b]++] = f;
+    }
+
+    DPRINT("Generating tangents for %d pieces on %d threads\n", pieceCount,
+           threadCount);
+
+    BucketJob job = {
+        .info          = info,
+        .bucketOffsets = bucketOffsets,
+        .bucketFaces   = bucketFaces,
+    };
+    onyx_ParallelFor(threadCount, bucketCount, bucketTask, &job);
+
+    hell_Free(parents);
+    hell_Free(pieceSizes);
+    hell_Free(faceRoots);
+    hell_Free(bucketOffsets);
+    hell_Free(bucketLoads);
+    hell_Free(bucketFaces);
+
+    return !job.failed;
+}
+
+bool
+onyx_GenerateGeoTangents(Onyx_Geometry* geo, uint32_t threadCount)
+{
+    assert(geo->vertexRegion.hostData && geo->indexRegion.hostData);
+    const float* positions = onyx_GetGeoPositions(geo);
+    const float* normals   = onyx_GetGeoNormals(geo);
+    const float* uvs       = onyx_GetGeoUVs(geo);
+    float*       tangents  = onyx_GetGeoTangents(geo);
+    float*       signs =
+        onyx_GetGeoAttributeOfType(geo, ONYX_ATTRIBUTE_TYPE_SIGN);
+    if (!positions || !normals || !uvs || !tangents || !signs)
+    {
+        DPRINT("Geo needs pos, nor, uv, tan and sin attributes for tangents\n");
+        return false;
+    }
+
+    // lods share the vertices of level 0 so only level 0 is used
+    Onyx_TangentSpaceInfo info = {
+        .vertexCount = geo->vertexCount,
+        .indexCount  = geo->indexCount,
+        .indices     = (const uint32_t*)geo->indexRegion.hostData,
+        .positions   = positions,
+        .normals     = normals,
+        .uvs         = uvs,
+        .tangents    = tangents,
+        .signs       = signs,
+        .threadCount = threadCount,
+    };
+
+    return onyx_GenerateTangents(&info);
+}
@@ -0,0 +1,758 @@
+#include "texfile.h"
+#include "asyncio.h"
+#include "command.h"
+#include "dtags.h"
+#include "video.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <hell/minmax.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "stb_image.h"
+
+// KTX2 and DDS reading, KTX2 writing and the upload of pre-built levels. The
+// block codecs are in bc.c.
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_IMG, fmt, ##__VA_ARGS__)
+
+static const uint8_t ktx2Identifier[12] = {0xab, 0x4b, 0x54, 0x58, 0x20, 0x32,
+                                           0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a};
+
+#define KTX2_HEADER_SIZE      80
+#define KTX2_LEVEL_INDEX_SIZE 24
+
+#define DDS_HEADER_SIZE       128
+#define DDS_DX10_HEADER_SIZE  20
+#define DDSD_MIPMAPCOUNT      0x20000
+#define DDSD_DEPTH            0x800000
+#define DDPF_FOURCC           0x4
+#define DDPF_RGB              0x40
+#define DDSCAPS2_CUBEMAP      0x200
+#define DDS_DIMENSION_2D      3
+#define DDS_MISC_CUBE         0x4
+
+#define FOURCC(a, b, c, d)                                                     \
+    ((uint32_t)(a) | (uint32_t)(b) << 8 | (uint32_t)(c) << 16 |                \
+     (uint32_t)(d) << 24)
+
+// Khronos data format descriptor values used by the writer
+#define DF_MODEL_RGBSDA      1
+#define DF_MODEL_BC1A        128
+#define DF_MODEL_BC7         134
+#define DF_PRIMARIES_BT709   1
+#define DF_TRANSFER_LINEAR   1
+#define DF_TRANSFER_SRGB     2
+#define DF_CHANNEL_ALPHA     15
+#define DF_SAMPLE_LINEAR     0x10
+
+static uint32_t
+readU32(const uint8_t* p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t
+readU64(const uint8_t* p)
+{
+    return readU32(p) | (uint64_t)readU32(p + 4) << 32;
+}
+
+static void
+writeU32(uint8_t* p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = v >> 8 * i;
+}
+
+static void
+writeU64(uint8_t* p, uint64_t v)
+{
+    writeU32(p, (uint32_t)v);
+    writeU32(p + 4, v >> 32);
+}
+
+static bool
+isBc(VkFormat format)
+{
+    return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK &&
+           format <= VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+static bool
+isAstc(VkFormat format)
+{
+    return format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK &&
+           format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK;
+}
+
+static bool
+isSrgb(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool
+onyx_GetFormatBlock(VkFormat format, uint32_t* blockWidth,
+                    uint32_t* blockHeight, uint32_t* blockSize)
+{
+    // ASTC formats come in UNORM and SRGB pairs
+    static const uint8_t astcBlocks[14][2] = {
+        {4, 4},  {5, 4},  {5, 5},  {6, 5},   {6, 6},   {8, 5},   {8, 6},
+        {8, 8},  {10, 5}, {10, 6}, {10, 8},  {10, 10}, {12, 10}, {12, 12}};
+    *blockWidth  = 1;
+    *blockHeight = 1;
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+        *blockWidth = *blockHeight = 4;
+        *blockSize                 = 8;
+        return true;
+    case VK_FORMAT_R8_UNORM:
+        *blockSize = 1;
+        return true;
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R16_SFLOAT:
+        *blockSize = 2;
+        return true;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_R8G8B8A8_SNORM:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT:
+        *blockSize = 4;
+        return true;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        *blockSize = 8;
+        return true;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        *blockSize = 16;
+        return true;
+    default:
+        if (isBc(format))
+        {
+            *blockWidth = *blockHeight = 4;
+            *blockSize                 = 16;
+            return true;
+        }
+        if (isAstc(format))
+        {
+            const uint32_t i = (format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2;
+            *blockWidth      = astcBlocks[i][0];
+            *blockHeight     = astcBlocks[i][1];
+            *blockSize       = 16;
+            return true;
+        }
+        return false;
+    }
+}
+
+size_t
+onyx_GetTextureLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+    uint32_t bw, bh, blockSize;
+    if (!onyx_GetFormatBlock(format, &bw, &bh, &blockSize))
+        return 0;
+    return (size_t)((width + bw - 1) / bw) * ((height + bh - 1) / bh) *
+           blockSize;
+}
+
+static uint32_t
+levelDim(uint32_t size, uint32_t level)
+{
+    return MAX(size >> level, 1);
+}
+
+// levels must be filled in, checks that they fit the file and the format.
+// Formats without a known level size are rejected, as nothing could check
+// what gets copied from their levels.
+static bool
+checkLevels(const Onyx_TextureFile* tex, size_t fileSize)
+{
+    uint32_t bw, bh, blockSize;
+    if (!onyx_GetFormatBlock(tex->format, &bw, &bh, &blockSize))
+    {
+        DPRINT("Texture format %d isn't supported\n", tex->format);
+        return false;
+    }
+    for (uint32_t l = 0; l < tex->levelCount; l++)
+    {
+        const Onyx_TextureLevel* level = &tex->levels[l];
+        if (level->offset > fileSize || level->size > fileSize - level->offset)
+            return false;
+        const size_t expected =
+            onyx_GetTextureLevelSize(tex->format, levelDim(tex->width, l),
+                                     levelDim(tex->height, l));
+        if (expected != level->size)
+            return false;
+    }
+    return true;
+}
+
+// bytes holds size bytes from the start of a file of fileSize bytes, which is
+// at least the header for the reads to succeed
+static bool
+parseKtx2(const uint8_t* bytes, size_t size, size_t fileSize,
+          Onyx_TextureFile* tex)
+{
+    if (size < KTX2_HEADER_SIZE)
+        return false;
+    tex->format                  = readU32(bytes + 12);
+    tex->width                   = readU32(bytes + 20);
+    tex->height                  = readU32(bytes + 24);
+    const uint32_t depth         = readU32(bytes + 28);
+    const uint32_t layerCount    = readU32(bytes + 32);
+    const uint32_t faceCount     = readU32(bytes + 36);
+    // 0 asks for mips to be generated, which isn't done here
+    tex->levelCount              = MAX(readU32(bytes + 40), 1);
+    const uint32_t supercompress = readU32(bytes + 44);
+    if (tex->format == VK_FORMAT_UNDEFINED || supercompress)
+    {
+        DPRINT("KTX2 supercompression and basis textures aren't supported\n");
+        return false;
+    }
+    if (!tex->width || !tex->height || depth > 1 || layerCount > 1 ||
+        faceCount != 1 || tex->levelCount > ONYX_TEXTURE_MAX_LEVELS)
+    {
+        DPRINT("Only 2D KTX2 textures are supported\n");
+        return false;
+    }
+    if (size < KTX2_HEADER_SIZE + tex->levelCount * KTX2_LEVEL_INDEX_SIZE)
+        return false;
+    for (uint32_t l = 0; l < tex->levelCount; l++)
+    {
+        const uint8_t* index =
+            bytes + KTX2_HEADER_SIZE + l * KTX2_LEVEL_INDEX_SIZE;
+        const uint64_t offset = readU64(index);
+        const uint64_t length = readU64(index + 8);
+        if (offset > SIZE_MAX || length > SIZE_MAX)
+            return false;
+        tex->levels[l] = (Onyx_TextureLevel){offset, length};
+    }
+    return checkLevels(tex, fileSize);
+}
+
+static VkFormat
+formatFromDxgi(uint32_t dxgi)
+{
+    switch (dxgi)
+    {
+    case 2:  return VK_FORMAT_R32G32B32A32_SFLOAT;
+    case 10: return VK_FORMAT_R16G16B16A16_SFLOAT;
+    case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+    case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+    case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+    case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+    case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+    case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+    case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+    case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+    case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+    case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+    case 87: return VK_FORMAT_B8G8R8A8_UNORM;
+    case 91: return VK_FORMAT_B8G8R8A8_SRGB;
+    case 95: return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+    case 96: return VK_FORMAT_BC6H_SFLOAT_BLOCK;
+    case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+    case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+    default: return VK_FORMAT_UNDEFINED;
+    }
+}
+
+static VkFormat
+formatFromFourCC(uint32_t fourCC)
+{
+    switch (fourCC)
+    {
+    // DXT1 may use the three color mode's transparent black
+    case FOURCC('D', 'X', 'T', '1'): return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case FOURCC('D', 'X', 'T', '3'): return VK_FORMAT_BC2_UNORM_BLOCK;
+    case FOURCC('D', 'X', 'T', '5'): return VK_FORMAT_BC3_UNORM_BLOCK;
+    case FOURCC('A', 'T', 'I', '1'):
+    case FOURCC('B', 'C', '4', 'U'): return VK_FORMAT_BC4_UNORM_BLOCK;
+    case FOURCC('B', 'C', '4', 'S'): return VK_FORMAT_BC4_SNORM_BLOCK;
+    case FOURCC('A', 'T', 'I', '2'):
+    case FOURCC('B', 'C', '5', 'U'): return VK_FORMAT_BC5_UNORM_BLOCK;
+    case FOURCC('B', 'C', '5', 'S'): return VK_FORMAT_BC5_SNORM_BLOCK;
+    default: return VK_FORMAT_UNDEFINED;
+    }
+}
+
+static bool
+parseDds(const uint8_t* bytes, size_t size, size_t fileSize,
+         Onyx_TextureFile* tex)
+{
+    if (size < DDS_HEADER_SIZE || readU32(bytes + 4) != 124)
+        return false;
+    const uint32_t flags    = readU32(bytes + 8);
+    tex->height             = readU32(bytes + 12);
+    tex->width              = readU32(bytes + 16);
+    const uint32_t depth    = readU32(bytes + 24);
+    const uint32_t mipCount = readU32(bytes + 28);
+    const uint32_t pfFlags  = readU32(bytes + 80);
+    const uint32_t fourCC   = readU32(bytes + 84);
+    const uint32_t rgbBits  = readU32(bytes + 88);
+    const uint32_t redMask  = readU32(bytes + 92);
+    const uint32_t caps2    = readU32(bytes + 112);
+    size_t         offset   = DDS_HEADER_SIZE;
+
+    tex->format = VK_FORMAT_UNDEFINED;
+    if ((pfFlags & DDPF_FOURCC) && fourCC == FOURCC('D', 'X', '1', '0'))
+    {
+        if (size < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE)
+            return false;
+        const uint8_t* dx10 = bytes + DDS_HEADER_SIZE;
+        if (readU32(dx10 + 4) != DDS_DIMENSION_2D ||
+            (readU32(dx10 + 8) & DDS_MISC_CUBE) || readU32(dx10 + 12) > 1)
+        {
+            DPRINT("Only 2D DDS textures are supported\n");
+            return false;
+        }
+        tex->format = formatFromDxgi(readU32(dx10));
+        offset += DDS_DX10_HEADER_SIZE;
+    }
+    else if (pfFlags & DDPF_FOURCC)
+        tex->format = formatFromFourCC(fourCC);
+    else if ((pfFlags & DDPF_RGB) && rgbBits == 32)
+        tex->format = redMask == 0xff ? VK_FORMAT_R8G8B8A8_UNORM
+                                      : VK_FORMAT_B8G8R8A8_UNORM;
+    if (tex->format == VK_FORMAT_UNDEFINED)
+    {
+        DPRINT("Unsupported DDS pixel format\n");
+        return false;
+    }
+    if (!tex->width || !tex->height || (caps2 & DDSCAPS2_CUBEMAP) ||
+        ((flags & DDSD_DEPTH) && depth > 1))
+    {
+        DPRINT("Only 2D DDS textures are supported\n");
+        return false;
+    }
+
+    tex->levelCount = (flags & DDSD_MIPMAPCOUNT) ? MAX(mipCount, 1) : 1;
+    if (tex->levelCount > ONYX_TEXTURE_MAX_LEVELS)
+        return false;
+    // levels follow each other, largest first
+    for (uint32_t l = 0; l < tex->levelCount; l++)
+    {
+        const size_t levelSize =
+            onyx_GetTextureLevelSize(tex->format, levelDim(tex->width, l),
+                                     levelDim(tex->height, l));
+        tex->levels[l] = (Onyx_TextureLevel){offset, levelSize};
+        offset += levelSize;
+    }
+    return checkLevels(tex, fileSize);
+}
+
+static bool
+parseTextureFile(const uint8_t* bytes, size_t size, size_t fileSize,
+                 Onyx_TextureFile* tex)
+{
+    if (size >= sizeof(ktx2Identifier) &&
+        memcmp(bytes, ktx2Identifier, sizeof(ktx2Identifier)) == 0)
+        return parseKtx2(bytes, size, fileSize, tex);
+    if (size >= 4 && memcmp(bytes, "DDS ", 4) == 0)
+        return parseDds(bytes, size, fileSize, tex);
+    return false;
+}
+
+bool
+onyx_ReadTextureFile(const char* filename, Onyx_TextureFile* tex)
+{
+    memset(tex, 0, sizeof(*tex));
+    size_t   size;
+    uint8_t* bytes = onyx_ReadWholeFile(filename, &size);
+    if (!bytes)
+        return false;
+    if (!parseTextureFile(bytes, size, size, tex))
+    {
+        DPRINT("Can't read texture %s\n", filename);
+        hell_Free(bytes);
+        memset(tex, 0, sizeof(*tex));
+        return false;
+    }
+    tex->data     = bytes;
+    tex->dataSize = size;
+    return true;
+}
+
+bool
+onyx_ReadTextureFileInfo(const char* filename, Onyx_TextureFile* tex)
+{
+    memset(tex, 0, sizeof(*tex));
+    // the level index of either format is well within this
+    uint8_t header[1024];
+    FILE*   f = fopen(filename, "rb");
+    if (!f)
+    {
+        DPRINT("Can't open %s\n", filename);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    const long fileSize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    const size_t size = fread(header, 1, sizeof(header), f);
+    fclose(f);
+    if (fileSize < 0 || !parseTextureFile(header, size, fileSize, tex))
+    {
+        DPRINT("Can't read texture %s\n", filename);
+        memset(tex, 0, sizeof(*tex));
+        return false;
+    }
+    return true;
+}
+
+void
+onyx_FreeTextureFile(Onyx_TextureFile* tex)
+{
+    hell_Free(tex->data);
+    memset(tex, 0, sizeof(*tex));
+}
+
+// the data format descriptor, which KTX2 requires, into dfd. Returns its size
+// or 0 if the format doesn't have one here.
+static uint32_t
+writeDfd(VkFormat format, uint8_t dfd[92])
+{
+    const bool srgb = isSrgb(format);
+    uint32_t   model, bytesPlane, sampleCount;
+    uint8_t    blockDim;
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        model = DF_MODEL_BC1A, bytesPlane = 8, sampleCount = 1, blockDim = 3;
+        break;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        model = DF_MODEL_BC7, bytesPlane = 16, sampleCount = 1, blockDim = 3;
+        break;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        model = DF_MODEL_RGBSDA, bytesPlane = 4, sampleCount = 4, blockDim = 0;
+        break;
+    default:
+        return 0;
+    }
+    const uint32_t blockSize = 24 + 16 * sampleCount;
+    memset(dfd, 0, 4 + blockSize);
+    writeU32(dfd, 4 + blockSize);
+    writeU32(dfd + 8, 2 | blockSize << 16);
+    writeU32(dfd + 12, model | DF_PRIMARIES_BT709 << 8 |
+                           (srgb ? DF_TRANSFER_SRGB : DF_TRANSFER_LINEAR) << 16);
+    writeU32(dfd + 16, blockDim | blockDim << 8);
+    dfd[20] = bytesPlane;
+    for (uint32_t s = 0; s < sampleCount; s++)
+    {
+        uint8_t* sample = dfd + 28 + 16 * s;
+        if (model == DF_MODEL_RGBSDA)
+        {
+            // alpha is never sRGB encoded
+            const uint32_t channel =
+                s < 3 ? s : DF_CHANNEL_ALPHA | (srgb ? DF_SAMPLE_LINEAR : 0);
+            writeU32(sample, s * 8 | 7 << 16 | channel << 24);
+            writeU32(sample + 12, 255);
+        }
+        else
+        {
+            writeU32(sample, (bytesPlane * 8 - 1) << 16);
+            writeU32(sample + 12, UINT32_MAX);
+        }
+    }
+    return 4 + blockSize;
+}
+
+bool
+onyx_WriteKtx2(const char* filename, const Onyx_TextureFile* tex)
+{
+    uint8_t        dfd[92];
+    const uint32_t dfdSize = writeDfd(tex->format, dfd);
+    uint32_t       bw, bh, blockSize;
+    if (!dfdSize || !onyx_GetFormatBlock(tex->format, &bw, &bh, &blockSize))
+    {
+        DPRINT("Can't write a KTX2 file of format %d\n", tex->format);
+        return false;
+    }
+    const uint32_t dfdOffset =
+        KTX2_HEADER_SIZE + tex->levelCount * KTX2_LEVEL_INDEX_SIZE;
+    // levels go smallest first, each aligned to the block size and 4
+    const size_t align  = MAX(blockSize, 4);
+    size_t       offset = dfdOffset + dfdSize;
+    size_t       offsets[ONYX_TEXTURE_MAX_LEVELS];
+    for (int l = tex->levelCount - 1; l >= 0; l--)
+    {
+        offset     = (offset + align - 1) / align * align;
+        offsets[l] = offset;
+        offset += tex->levels[l].size;
+    }
+
+    uint8_t* file = hell_Malloc(offset);
+    memset(file, 0, offset);
+    memcpy(file, ktx2Identifier, sizeof(ktx2Identifier));
+    writeU32(file + 12, tex->format);
+    writeU32(file + 16, 1);
+    writeU32(file + 20, tex->width);
+    writeU32(file + 24, tex->height);
+    writeU32(file + 36, 1);
+    writeU32(file + 40, tex->levelCount);
+    writeU32(file + 48, dfdOffset);
+    writeU32(file + 52, dfdSize);
+    for (uint32_t l = 0; l < tex->levelCount; l++)
+    {
+        uint8_t* index = file + KTX2_HEADER_SIZE + l * KTX2_LEVEL_INDEX_SIZE;
+        writeU64(index, offsets[l]);
+        writeU64(index + 8, tex->levels[l].size);
+        writeU64(index + 16, tex->levels[l].size);
+        memcpy(file + offsets[l], tex->data + tex->levels[l].offset,
+               tex->levels[l].size);
+    }
+    memcpy(file + dfdOffset, dfd, dfdSize);
+
+    FILE* f  = fopen(filename, "wb");
+    bool  ok = f && fwrite(file, 1, offset, f) == offset;
+    if (f)
+        ok = fclose(f) == 0 && ok;
+    hell_Free(file);
+    if (!ok)
+        DPRINT("Can't write %s\n", filename);
+    return ok;
+}
+
+static float
+srgbToLinear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float
+linearToSrgb(float c)
+{
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.f / 2.4f) - 0.055f;
+}
+
+// 2x2 box filter, the last row or column is repeated for odd sizes
+static uint8_t*
+downsample(const uint8_t* texels, uint32_t width, uint32_t height, bool srgb)
+{
+    float toLinear[256];
+    for (int i = 0; i < 256; i++)
+        toLinear[i] = srgb ? srgbToLinear(i / 255.f) : i / 255.f;
+    const uint32_t w   = levelDim(width, 1);
+    const uint32_t h   = levelDim(height, 1);
+    uint8_t*       out = hell_Malloc((size_t)w * h * 4);
+    for (uint32_t y = 0; y < h; y++)
+        for (uint32_t x = 0; x < w; x++)
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                float sum = 0;
+                for (uint32_t k = 0; k < 4; k++)
+                {
+                    const uint32_t sx = MIN(2 * x + (k & 1), width - 1);
+                    const uint32_t sy = MIN(2 * y + (k >> 1), height - 1);
+                    const uint8_t  v  = texels[((size_t)sy * width + sx) * 4 + c];
+                    sum += c < 3 ? toLinear[v] : v / 255.f;
+                }
+                float v = sum / 4.f;
+                if (c < 3 && srgb)
+                    v = linearToSrgb(v);
+                out[((size_t)y * w + x) * 4 + c] = (uint8_t)(v * 255.f + 0.5f);
+            }
+    return out;
+}
+
+void
+onyx_CompressTexture(uint32_t width, uint32_t height, const uint8_t* texels,
+                     VkFormat format, bool createMips, Onyx_TextureFile* tex)
+{
+    assert(format == VK_FORMAT_BC1_RGB_UNORM_BLOCK ||
+           format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ||
+           format == VK_FORMAT_BC7_UNORM_BLOCK ||
+           format == VK_FORMAT_BC7_SRGB_BLOCK ||
+           format == VK_FORMAT_R8G8B8A8_UNORM ||
+           format == VK_FORMAT_R8G8B8A8_SRGB);
+    memset(tex, 0, sizeof(*tex));
+    tex->format     = format;
+    tex->width      = width;
+    tex->height     = height;
+    tex->levelCount = createMips ? onyx_CalcMipLevelsForImage(width, height) : 1;
+    tex->levelCount = MIN(tex->levelCount, ONYX_TEXTURE_MAX_LEVELS);
+    for (uint32_t l = 0; l < tex->levelCount; l++)
+    {
+        tex->levels[l].offset = tex->dataSize;
+        tex->levels[l].size   = onyx_GetTextureLevelSize(
+            format, levelDim(width, l), levelDim(height, l));
+        tex->dataSize += tex->levels[l].size;
+    }
+    tex->data = hell_Malloc(tex->dataSize);
+
+    const uint8_t* level = texels;
+    for (uint32_t l = 0; l < tex->levelCount; l++)
+    {
+        const uint32_t w   = levelDim(width, l);
+        const uint32_t h   = levelDim(height, l);
+        uint8_t*       dst = tex->data + tex->levels[l].offset;
+        if (format == VK_FORMAT_BC1_RGB_UNORM_BLOCK ||
+            format == VK_FORMAT_BC1_RGB_SRGB_BLOCK)
+            onyx_EncodeBC1(w, h, level, dst);
+        else if (format == VK_FORMAT_BC7_UNORM_BLOCK ||
+                 format == VK_FORMAT_BC7_SRGB_BLOCK)
+            onyx_EncodeBC7(w, h, level, dst);
+        else
+            memcpy(dst, level, tex->levels[l].size);
+        if (l + 1 < tex->levelCount)
+        {
+            uint8_t* next = downsample(level, w, h, isSrgb(format));
+            if (level != texels)
+                hell_Free((void*)level);
+            level = next;
+        }
+    }
+    if (level != texels)
+        hell_Free((void*)level);
+}
+
+bool
+onyx_CompressImageFile(const char* filename, VkFormat format, bool createMips,
+                       Onyx_TextureFile* tex)
+{
+    int      w, h, n;
+    uint8_t* texels = stbi_load(filename, &w, &h, &n, 4);
+    if (!texels)
+    {
+        DPRINT("Can't load %s: %s\n", filename, stbi_failure_reason());
+        return false;
+    }
+    onyx_CompressTexture(w, h, texels, format, createMips, tex);
+    stbi_image_free(texels);
+    return true;
+}
+
+bool
+onyx_CanSampleFormat(const Onyx_Memory* memory, VkFormat format)
+{
+    const Onyx_Instance* instance = onyx_GetMemoryInstance(memory);
+    if (isBc(format) && !instance->enabledFeatures.textureCompressionBC)
+        return false;
+    if (isAstc(format) && !instance->enabledFeatures.textureCompressionASTC_LDR)
+        return false;
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(onyx_GetPhysicalDevice(instance), format,
+                                        &props);
+    return props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+}
+
+bool
+onyx_LoadTextureFile(Onyx_Memory* memory, const Onyx_TextureFile* tex,
+                     VkImageUsageFlags usageFlags, VkFilter filter,
+                     VkImageLayout layout, Onyx_MemoryType memoryType,
+                     Onyx_Image* image)
+{
+    VkFormat          format = tex->format;
+    const uint8_t*    data   = tex->data;
+    Onyx_TextureLevel levels[ONYX_TEXTURE_MAX_LEVELS];
+    memcpy(levels, tex->levels, sizeof(levels));
+    uint8_t* decoded = NULL;
+    if (!onyx_CanSampleFormat(memory, format))
+    {
+        const VkFormat decodedFormat = onyx_GetDecodedFormat(format);
+        if (decodedFormat == VK_FORMAT_UNDEFINED ||
+            !onyx_CanSampleFormat(memory, decodedFormat))
+        {
+            DPRINT("Format %d can't be sampled or decoded\n", format);
+            return false;
+        }
+        DPRINT("Format %d can't be sampled, decoding to %d\n", format,
+               decodedFormat);
+        size_t size = 0;
+        for (uint32_t l = 0; l < tex->levelCount; l++)
+        {
+            levels[l].offset = size;
+            levels[l].size   = (size_t)levelDim(tex->width, l) *
+                             levelDim(tex->height, l) * 4;
+            size += levels[l].size;
+        }
+        decoded = hell_Malloc(size);
+        for (uint32_t l = 0; l < tex->levelCount; l++)
+            onyx_DecodeBlocks(format, levelDim(tex->width, l),
+                              levelDim(tex->height, l),
+                              tex->data + tex->levels[l].offset,
+                              decoded + levels[l].offset);
+        format = decodedFormat;
+        data   = decoded;
+    }
+
+    // copies need offsets that are multiples of the block size
+    VkBufferImageCopy copies[ONYX_TEXTURE_MAX_LEVELS];
+    VkDeviceSize      stagingSize = 0;
+    for (uint32_t l = 0; l < tex->levelCount; l++)
+    {
+        stagingSize = (stagingSize + 15) & ~(VkDeviceSize)15;
+        copies[l]   = (VkBufferImageCopy){
+            .bufferOffset     = stagingSize,
+            .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, l, 0, 1},
+            .imageExtent      = {levelDim(tex->width, l),
+                                 levelDim(tex->height, l), 1}};
+        stagingSize += levels[l].size;
+    }
+
+    *image = onyx_CreateImageAndSampler(
+        memory, tex->width, tex->height, format,
+        usageFlags | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_SAMPLE_COUNT_1_BIT, tex->levelCount, filter, memoryType);
+
+    Onyx_BufferRegion staging = onyx_RequestBufferRegion(
+        memory, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        ONYX_MEMORY_HOST_GRAPHICS_TYPE);
+    for (uint32_t l = 0; l < tex->levelCount; l++)
+    {
+        memcpy(staging.hostData + copies[l].bufferOffset,
+               data + levels[l].offset, levels[l].size);
+        copies[l].bufferOffset += staging.offset;
+    }
+    hell_Free(decoded);
+
+    Onyx_Command cmd = onyx_CreateCommand(onyx_GetMemoryInstance(memory),
+                                          ONYX_V_QUEUE_GRAPHICS_TYPE);
+    onyx_BeginCommandBuffer(cmd.buffer);
+    Onyx_Barrier barrier = {.srcStageFlags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                            .dstStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            .srcAccessMask = 0,
+                            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+    onyx_CmdTransitionImageLayout(cmd.buffer, barrier, VK_IMAGE_LAYOUT_UNDEFINED,
+                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                  tex->levelCount, image->handle);
+    vkCmdCopyBufferToImage(cmd.buffer, staging.buffer, image->handle,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           tex->levelCount, copies);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.srcStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    barrier.dstStageFlags = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    onyx_CmdTransitionImageLayout(cmd.buffer, barrier,
+                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout,
+                                  tex->levelCount, image->handle);
+    image->layout = layout;
+    onyx_EndCommandBuffer(cmd.buffer);
+    onyx_SubmitAndWait(&cmd, 0);
+    onyx_DestroyCommand(cmd);
+    onyx_FreeBufferRegion(&staging);
+    DPRINT("Loaded a %dx%d texture with %d levels\n", tex->width, tex->height,
+           tex->levelCount);
+    return true;
+}
@@ -0,0 +1,613 @@
+#include "texstream.h"
+#include "asyncio.h"
+#include "dtags.h"
+#include "video.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <hell/minmax.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Every update plans first and records after. Planning gives each texture a
+// target level: tails of new textures, then what was asked for with the
+// coarsest requests first, each cut short by the upload limit and made room
+// for by dropping levels from the least recently asked for textures. The
+// levels to upload are read into one staging region in a single batch, then
+// every texture whose target differs from what is resident gets a new image.
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_IMG, fmt, ##__VA_ARGS__)
+
+#define DEFAULT_MAX_UPLOAD       (16 << 20)
+#define DEFAULT_TAIL_SIZE        64
+#define DEFAULT_FRAMES_IN_FLIGHT 2
+// copy offsets must be multiples of the texel block size
+#define STAGING_ALIGN            16
+#define NO_SLOT                  UINT32_MAX
+
+typedef struct {
+    char*              filename;
+    Onyx_TextureHandle handle;
+    // the image's format differs from the file's when that can't be sampled
+    // and is decoded
+    VkFormat           fileFormat;
+    VkFormat           format;
+    uint32_t           width;
+    uint32_t           height;
+    uint32_t           levelCount;
+    Onyx_TextureLevel  fileLevels[ONYX_TEXTURE_MAX_LEVELS];
+    // image bytes of levels [mip, levelCount)
+    uint64_t           bytes[ONYX_TEXTURE_MAX_LEVELS + 1];
+    uint32_t           tailMip;
+    // levelCount while image is NULL and the default image is shown
+    uint32_t           residentMip;
+    uint32_t           requestedMip;
+    uint64_t           lastRequest;
+    Onyx_Image*        image;
+    // set while planning an update
+    uint32_t           targetMip;
+    uint32_t           firstUpload;
+} Texture;
+
+typedef struct {
+    Onyx_Image*       image;
+    Onyx_BufferRegion staging;
+    // the last update whose commands may use them
+    uint64_t          update;
+} Retired;
+
+typedef struct {
+    uint32_t index;
+    uint32_t mip;
+    bool     tail;
+    uint64_t lastRequest;
+} Candidate;
+
+struct Onyx_TextureStreamer {
+    Onyx_Memory*              memory;
+    Onyx_Scene*               scene;
+    Onyx_TextureStreamerParms parms;
+    uint32_t                  textureCount;
+    uint32_t                  textureCapacity;
+    Texture*                  textures;
+    // texture handle id to index into textures
+    uint32_t                  slotCount;
+    uint32_t*                 slots;
+    uint32_t                  retiredCount;
+    uint32_t                  retiredCapacity;
+    Retired*                  retired;
+    uint64_t                  updateCount;
+    uint64_t                  residentBytes;
+    uint64_t                  uploadedBytes;
+    uint64_t                  evictedBytes;
+};
+
+static uint32_t
+levelDim(uint32_t size, uint32_t level)
+{
+    return MAX(size >> level, 1);
+}
+
+static Texture*
+findTexture(const Onyx_TextureStreamer* st, Onyx_TextureHandle handle)
+{
+    if (handle.id >= st->slotCount || st->slots[handle.id] == NO_SLOT)
+        return NULL;
+    return &st->textures[st->slots[handle.id]];
+}
+
+static void
+retire(Onyx_TextureStreamer* st, Onyx_Image* image,
+       const Onyx_BufferRegion* staging, uint64_t update)
+{
+    if (st->retiredCount == st->retiredCapacity)
+    {
+        st->retiredCapacity = MAX(st->retiredCapacity * 2, 16);
+        st->retired = hell_Realloc(st->retired,
+                                   st->retiredCapacity * sizeof(Retired));
+    }
+    st->retired[st->retiredCount++] = (Retired){
+        .image = image, .staging = staging ? *staging : (Onyx_BufferRegion){0},
+        .update = update};
+}
+
+static void
+freeRetired(Retired* r)
+{
+    if (r->image)
+    {
+        onyx_FreeImage(r->image);
+        hell_Free(r->image);
+    }
+    if (r->staging.size)
+        onyx_FreeBufferRegion(&r->staging);
+}
+
+Onyx_TextureStreamer*
+onyx_CreateTextureStreamer(Onyx_Memory* memory, Onyx_Scene* scene,
+                           const Onyx_TextureStreamerParms* parms)
+{
+    Onyx_TextureStreamer* st = hell_Malloc(sizeof(*st));
+    memset(st, 0, sizeof(*st));
+    st->memory = memory;
+    st->scene  = scene;
+    st->parms  = *parms;
+    if (!st->parms.budget)
+        st->parms.budget = UINT64_MAX;
+    if (!st->parms.maxUploadBytes)
+        st->parms.maxUploadBytes = DEFAULT_MAX_UPLOAD;
+    if (!st->parms.tailSize)
+        st->parms.tailSize = DEFAULT_TAIL_SIZE;
+    if (!st->parms.framesInFlight)
+        st->parms.framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+    return st;
+}
+
+void
+onyx_DestroyTextureStreamer(Onyx_TextureStreamer* st)
+{
+    for (uint32_t i = 0; i < st->retiredCount; i++)
+        freeRetired(&st->retired[i]);
+    for (uint32_t i = 0; i < st->textureCount; i++)
+    {
+        Retired r = {.image = st->textures[i].image};
+        freeRetired(&r);
+        hell_Free(st->textures[i].filename);
+    }
+    hell_Free(st->retired);
+    hell_Free(st->textures);
+    hell_Free(st->slots);
+    hell_Free(st);
+}
+
+Onyx_TextureHandle
+onyx_StreamTexture(Onyx_TextureStreamer* st, const char* filename)
+{
+    Onyx_TextureFile info;
+    if (!onyx_ReadTextureFileInfo(filename, &info))
+        return NULL_TEXTURE;
+    VkFormat format = info.format;
+    if (!onyx_CanSampleFormat(st->memory, format))
+    {
+        format = onyx_GetDecodedFormat(format);
+        if (format == VK_FORMAT_UNDEFINED ||
+            !onyx_CanSampleFormat(st->memory, format))
+        {
+            DPRINT("Can't stream %s, its format %d can't be sampled or "
+                   "decoded\n", filename, info.format);
+            return NULL_TEXTURE;
+        }
+    }
+    // the budget and the staging region are sized from the image's level
+    // sizes
+    if (!onyx_GetTextureLevelSize(format, info.width, info.height))
+    {
+        DPRINT("Can't stream %s, the level size of format %d is unknown\n",
+               filename, format);
+        return NULL_TEXTURE;
+    }
+
+    Texture t = {.fileFormat = info.format,
+                 .format     = format,
+                 .width      = info.width,
+                 .height     = info.height,
+                 .levelCount = info.levelCount};
+    memcpy(t.fileLevels, info.levels, sizeof(t.fileLevels));
+    for (int l = t.levelCount - 1; l >= 0; l--)
+    {
+        const uint32_t w = levelDim(t.width, l);
+        const uint32_t h = levelDim(t.height, l);
+        t.bytes[l] = t.bytes[l + 1] + onyx_GetTextureLevelSize(format, w, h);
+        if (MAX(w, h) <= st->parms.tailSize || l + 1 == (int)t.levelCount)
+            t.tailMip = l;
+    }
+    t.residentMip    = t.levelCount;
+    const size_t len = strlen(filename) + 1;
+    t.filename       = hell_Malloc(len);
+    memcpy(t.filename, filename, len);
+    t.handle = onyx_SceneAddTexture(st->scene,
+                                    onyx_SceneGetDefaultImage(st->scene));
+
+    if (st->textureCount == st->textureCapacity)
+    {
+        st->textureCapacity = MAX(st->textureCapacity * 2, 16);
+        st->textures =
+            hell_Realloc(st->textures, st->textureCapacity * sizeof(Texture));
+    }
+    if (t.handle.id >= st->slotCount)
+    {
+        const uint32_t count = MAX(st->slotCount * 2, t.handle.id + 1);
+        st->slots = hell_Realloc(st->slots, count * sizeof(uint32_t));
+        for (uint32_t i = st->slotCount; i < count; i++)
+            st->slots[i] = NO_SLOT;
+        st->slotCount = count;
+    }
+    st->slots[t.handle.id]            = st->textureCount;
+    st->textures[st->textureCount++] = t;
+    return t.handle;
+}
+
+void
+onyx_RemoveStreamedTexture(Onyx_TextureStreamer* st, Onyx_TextureHandle tex)
+{
+    Texture* t = findTexture(st, tex);
+    assert(t);
+    // frames recorded since the last update may still sample it
+    if (t->image)
+        retire(st, t->image, NULL, st->updateCount + 1);
+    st->residentBytes -= t->bytes[t->residentMip];
+    onyx_SceneRemoveTexture(st->scene, tex);
+    hell_Free(t->filename);
+    const uint32_t index              = st->slots[tex.id];
+    st->textures[index]               = st->textures[--st->textureCount];
+    st->slots[st->textures[index].handle.id] = index;
+    st->slots[tex.id]                 = NO_SLOT;
+}
+
+void
+onyx_RequestTextureMip(Onyx_TextureStreamer* st, Onyx_TextureHandle tex,
+                       uint32_t mip)
+{
+    Texture* t = findTexture(st, tex);
+    if (!t)
+        return;
+    const uint64_t next = st->updateCount + 1;
+    mip                 = MIN(mip, t->levelCount - 1);
+    if (t->lastRequest != next)
+    {
+        t->lastRequest  = next;
+        t->requestedMip = mip;
+    }
+    else
+        t->requestedMip = MIN(t->requestedMip, mip);
+}
+
+void
+onyx_ApplyTextureFeedback(Onyx_TextureStreamer* st, uint32_t count,
+                          const uint8_t* mips)
+{
+    count = MIN(count, st->slotCount);
+    for (uint32_t id = 0; id < count; id++)
+        if (mips[id] != ONYX_TEXTURE_NOT_SAMPLED && st->slots[id] != NO_SLOT)
+            onyx_RequestTextureMip(st, onyx_CreateTextureHandle(id), mips[id]);
+}
+
+// the levels a texture keeps when the budget runs out
+static uint32_t
+floorMip(const Texture* t, uint64_t update)
+{
+    return t->lastRequest == update ? MIN(t->requestedMip, t->tailMip)
+                                    : t->tailMip;
+}
+
+// Drops the largest planned level of the texture asked for least recently
+// that has levels past its floor. False if none has.
+static bool
+evictLevel(Onyx_TextureStreamer* st, uint64_t update, uint64_t* planned)
+{
+    Texture* victim = NULL;
+    for (uint32_t i = 0; i < st->textureCount; i++)
+    {
+        Texture* t = &st->textures[i];
+        if (t->targetMip < floorMip(t, update) &&
+            (!victim || t->lastRequest < victim->lastRequest))
+            victim = t;
+    }
+    if (!victim)
+        return false;
+    *planned -= victim->bytes[victim->targetMip] -
+                victim->bytes[victim->targetMip + 1];
+    victim->targetMip++;
+    return true;
+}
+
+static int
+compareCandidates(const void* a, const void* b)
+{
+    const Candidate* x = a;
+    const Candidate* y = b;
+    if (x->tail != y->tail)
+        return x->tail ? -1 : 1;
+    if (x->mip != y->mip)
+        return x->mip > y->mip ? -1 : 1;
+    if (x->lastRequest != y->lastRequest)
+        return x->lastRequest > y->lastRequest ? -1 : 1;
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+static void
+planUpdate(Onyx_TextureStreamer* st, uint64_t update)
+{
+    Candidate* candidates =
+        hell_Malloc((st->textureCount + 1) * sizeof(Candidate));
+    uint32_t candidateCount = 0;
+    for (uint32_t i = 0; i < st->textureCount; i++)
+    {
+        Texture* t   = &st->textures[i];
+        t->targetMip = t->residentMip;
+        // new textures get their tail alone so every one of them shows
+        // something before any gets more
+        uint32_t mip = t->tailMip;
+        if (t->image && t->lastRequest == update)
+            mip = MIN(t->residentMip, t->requestedMip);
+        else if (t->image)
+            mip = t->residentMip;
+        if (mip < t->residentMip)
+            candidates[candidateCount++] = (Candidate){
+                .index = i, .mip = mip, .tail = !t->image,
+                .lastRequest = t->lastRequest};
+    }
+    qsort(candidates, candidateCount, sizeof(Candidate), compareCandidates);
+
+    uint64_t planned    = st->residentBytes;
+    uint64_t uploadLeft = st->parms.maxUploadBytes;
+    bool     uploading  = false;
+    for (uint32_t c = 0; c < candidateCount; c++)
+    {
+        Texture*       t        = &st->textures[candidates[c].index];
+        const uint64_t resident = t->bytes[t->residentMip];
+        // a texture without an image gets its whole tail
+        const uint32_t coarsest = t->image ? t->residentMip - 1 : t->tailMip;
+        uint32_t       target   = candidates[c].mip;
+        while (target < coarsest && t->bytes[target] - resident > uploadLeft)
+            target++;
+        // the first upload goes through whatever its size
+        if (t->bytes[target] - resident > uploadLeft && uploading)
+            continue;
+        while (planned + t->bytes[target] - resident > st->parms.budget)
+        {
+            if (evictLevel(st, update, &planned))
+                continue;
+            // tails go in regardless
+            if (!t->image)
+                break;
+            if (target == coarsest)
+            {
+                target = t->residentMip;
+                break;
+            }
+            target++;
+        }
+        if (target == t->residentMip)
+            continue;
+        const uint64_t size = t->bytes[target] - resident;
+        t->targetMip        = target;
+        planned += size;
+        uploadLeft = size < uploadLeft ? uploadLeft - size : 0;
+        uploading  = true;
+    }
+    // tails may have gone past the budget, or it was lowered
+    while (planned > st->parms.budget && evictLevel(st, update, &planned))
+        ;
+    hell_Free(candidates);
+}
+
+// Reads the levels every texture needs into one staging region and fills
+// uploads, textures whose levels can't be read keep what they have.
+static Onyx_BufferRegion
+readLevels(Onyx_TextureStreamer* st, VkBufferImageCopy** uploads)
+{
+    uint32_t     readCount = 0;
+    VkDeviceSize size      = 0;
+    size_t       scratch   = 0;
+    for (uint32_t i = 0; i < st->textureCount; i++)
+    {
+        const Texture* t = &st->textures[i];
+        for (uint32_t l = t->targetMip; l < t->residentMip; l++)
+        {
+            size = (size + STAGING_ALIGN - 1) & ~(VkDeviceSize)(STAGING_ALIGN - 1);
+            size += t->bytes[l] - t->bytes[l + 1];
+            if (t->format != t->fileFormat)
+                scratch += t->fileLevels[l].size;
+            readCount++;
+        }
+    }
+    *uploads = NULL;
+    if (!readCount)
+        return (Onyx_BufferRegion){0};
+
+    Onyx_BufferRegion staging = onyx_RequestBufferRegion(
+        st->memory, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        ONYX_MEMORY_HOST_GRAPHICS_TYPE);
+    uint8_t*       decode  = scratch ? hell_Malloc(scratch) : NULL;
+    Onyx_FileRead* reads   = hell_Malloc(readCount * sizeof(Onyx_FileRead));
+    *uploads               = hell_Malloc(readCount * sizeof(VkBufferImageCopy));
+    uint32_t     r         = 0;
+    VkDeviceSize offset    = 0;
+    size_t       decodeOff = 0;
+    for (uint32_t i = 0; i < st->textureCount; i++)
+    {
+        Texture* t     = &st->textures[i];
+        t->firstUpload = r;
+        for (uint32_t l = t->targetMip; l < t->residentMip; l++, r++)
+        {
+            offset = (offset + STAGING_ALIGN - 1) & ~(VkDeviceSize)(STAGING_ALIGN - 1);
+            (*uploads)[r] = (VkBufferImageCopy){
+                .bufferOffset     = staging.offset + offset,
+                .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, l - t->targetMip,
+                                     0, 1},
+                .imageExtent = {levelDim(t->width, l), levelDim(t->height, l),
+                                1}};
+            void* dst = staging.hostData + offset;
+            if (t->format != t->fileFormat)
+            {
+                dst = decode + decodeOff;
+                decodeOff += t->fileLevels[l].size;
+            }
+            reads[r] = (Onyx_FileRead){.filename = t->filename,
+                                       .offset   = t->fileLevels[l].offset,
+                                       .size     = t->fileLevels[l].size,
+                                       .dst      = dst};
+            offset += t->bytes[l] - t->bytes[l + 1];
+        }
+    }
+    onyx_ReadFiles(readCount, reads);
+
+    for (uint32_t i = 0; i < st->textureCount; i++)
+    {
+        Texture* t  = &st->textures[i];
+        bool     ok = true;
+        for (uint32_t l = t->targetMip; l < t->residentMip; l++)
+            ok = ok && reads[t->firstUpload + l - t->targetMip].ok;
+        if (!ok)
+        {
+            DPRINT("Can't read the levels of %s\n", t->filename);
+            t->targetMip = t->residentMip;
+            continue;
+        }
+        if (t->format == t->fileFormat)
+            continue;
+        for (uint32_t l = t->targetMip; l < t->residentMip; l++)
+        {
+            const uint32_t r = t->firstUpload + l - t->targetMip;
+            onyx_DecodeBlocks(
+                t->fileFormat, levelDim(t->width, l), levelDim(t->height, l),
+                reads[r].dst,
+                staging.hostData + (*uploads)[r].bufferOffset - staging.offset);
+        }
+    }
+    hell_Free(reads);
+    hell_Free(decode);
+    return staging;
+}
+
+static void
+recordRealloc(Onyx_TextureStreamer* st, VkCommandBuffer cmdBuf, Texture* t,
+              const Onyx_BufferRegion* staging,
+              const VkBufferImageCopy* uploads, uint64_t update)
+{
+    const uint32_t mip   = t->targetMip;
+    Onyx_Image*    image = hell_Malloc(sizeof(*image));
+    *image               = onyx_CreateImageAndSampler(
+        st->memory, levelDim(t->width, mip), levelDim(t->height, mip),
+        t->format,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        VK_IMAGE_ASPECT_COLOR_BIT, VK_SAMPLE_COUNT_1_BIT, t->levelCount - mip,
+        st->parms.filter, ONYX_MEMORY_DEVICE_TYPE);
+
+    Onyx_Barrier barrier = {.srcStageFlags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                            .dstStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            .srcAccessMask = 0,
+                            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+    onyx_CmdTransitionImageLayout(cmdBuf, barrier, VK_IMAGE_LAYOUT_UNDEFINED,
+                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                  image->mipLevels, image->handle);
+    if (t->image)
+    {
+        barrier = (Onyx_Barrier){
+            .srcStageFlags = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            .dstStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .srcAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT};
+        onyx_CmdTransitionImageLayout(
+            cmdBuf, barrier, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, t->image->mipLevels,
+            t->image->handle);
+        VkImageCopy    copies[ONYX_TEXTURE_MAX_LEVELS];
+        const uint32_t first = MAX(mip, t->residentMip);
+        for (uint32_t l = first; l < t->levelCount; l++)
+            copies[l - first] = (VkImageCopy){
+                .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT,
+                                   l - t->residentMip, 0, 1},
+                .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, l - mip, 0, 1},
+                .extent = {levelDim(t->width, l), levelDim(t->height, l), 1}};
+        vkCmdCopyImage(cmdBuf, t->image->handle,
+                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image->handle,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       t->levelCount - first, copies);
+        retire(st, t->image, NULL, update);
+    }
+    if (mip < t->residentMip)
+        vkCmdCopyBufferToImage(cmdBuf, staging->buffer, image->handle,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               t->residentMip - mip, uploads + t->firstUpload);
+    barrier = (Onyx_Barrier){.srcStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             .dstStageFlags =
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                             .dstAccessMask = VK_ACCESS_SHADER_READ_BIT};
+    onyx_CmdTransitionImageLayout(cmdBuf, barrier,
+                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                  image->mipLevels, image->handle);
+    image->layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    const uint64_t before = t->bytes[t->residentMip];
+    if (mip < t->residentMip)
+        st->uploadedBytes += t->bytes[mip] - before;
+    else
+        st->evictedBytes += before - t->bytes[mip];
+    st->residentBytes += t->bytes[mip];
+    st->residentBytes -= before;
+    t->image       = image;
+    t->residentMip = mip;
+    onyx_SceneUpdateTexture(st->scene, t->handle, image);
+}
+
+void
+onyx_CmdUpdateTextureStreamer(Onyx_TextureStreamer* st, VkCommandBuffer cmdBuf)
+{
+    const uint64_t update = st->updateCount + 1;
+    // the commands of update - framesInFlight are done
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < st->retiredCount; i++)
+    {
+        if (st->retired[i].update + st->parms.framesInFlight <= update)
+            freeRetired(&st->retired[i]);
+        else
+            st->retired[kept++] = st->retired[i];
+    }
+    st->retiredCount  = kept;
+    st->uploadedBytes = 0;
+    st->evictedBytes  = 0;
+
+    planUpdate(st, update);
+    VkBufferImageCopy*      uploads = NULL;
+    const Onyx_BufferRegion staging = readLevels(st, &uploads);
+    for (uint32_t i = 0; i < st->textureCount; i++)
+    {
+        Texture* t = &st->textures[i];
+        if (t->targetMip != t->residentMip)
+            recordRealloc(st, cmdBuf, t, &staging, uploads, update);
+    }
+    if (staging.size)
+        retire(st, NULL, &staging, update);
+    hell_Free(uploads);
+    st->updateCount = update;
+    if (st->uploadedBytes || st->evictedBytes)
+        DPRINT("Texture streaming: %llu bytes uploaded, %llu evicted, %llu of "
+               "%llu resident\n",
+               (unsigned long long)st->uploadedBytes,
+               (unsigned long long)st->evictedBytes,
+               (unsigned long long)st->residentBytes,
+               (unsigned long long)st->parms.budget);
+}
+
+bool
+onyx_GetTextureResidency(const Onyx_TextureStreamer* st,
+                         Onyx_TextureHandle tex, Onyx_TextureResidency* r)
+{
+    const Texture* t = findTexture(st, tex);
+    if (!t)
+        return false;
+    *r = (Onyx_TextureResidency){
+        .levelCount    = t->levelCount,
+        .residentMip   = t->residentMip,
+        .tailMip       = t->tailMip,
+        .requestedMip  = t->requestedMip,
+        .lastRequest   = t->lastRequest,
+        .residentBytes = t->bytes[t->residentMip]};
+    return true;
+}
+
+void
+onyx_GetTextureStreamerStats(const Onyx_TextureStreamer* st,
+                             Onyx_TextureStreamerStats*  stats)
+{
+    *stats = (Onyx_TextureStreamerStats){.textureCount  = st->textureCount,
+                                         .residentBytes = st->residentBytes,
+                                         .budget        = st->parms.budget,
+                                         .uploadedBytes = st->uploadedBytes,
+                                         .evictedBytes  = st->evictedBytes,
+                                         .updateCount   = st->updateCount};
+}
@@ -1,4 +1,5 @@
 #include "text.h"
+#include "asyncio.h"
 #include "image.h"
 #include "memory.h"
 #include <ft2build.h>
@@ -15,6 +16,8 @@ static FT_Matrix     matrix;                 /* transformation matrix */
 static FT_Vector     pen;                    /* untransformed origin  */
 static FT_Error      error;
 
+static FT_Byte*      fontData;
+
 static bool initialized = false;
 /* origin is the upper left corner */
 
@@ -88,7 +91,11 @@ static void initFT(const size_t fontSize)
     const char* fontpath = "C:/Windows/Fonts/lucon.ttf";
     #endif
     hell_Print("Loading font at path %s...\n", fontpath);
-    error = FT_New_Face(library, fontpath, 0, &face);
+    // the face reads from the buffer for as long as it lives
+    size_t fontFileSize;
+    fontData = onyx_ReadWholeFile(fontpath, &fontFileSize);
+    assert(fontData);
+    error = FT_New_Memory_Face(library, fontData, fontFileSize, 0, &face);
     assert(!error);
     error = FT_Set_Pixel_Sizes(face, 0, fontSize);
     assert(!error);
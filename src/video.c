@@ -270,6 +270,8 @@ initDevice(
     QueueFamily*                                        transferQueueFamily,
     VkPhysicalDeviceRayTracingPipelinePropertiesKHR*    rtProperties,
     VkPhysicalDeviceAccelerationStructurePropertiesKHR* accelStructProperties,
+    VkPhysicalDeviceFeatures*                           pEnabledFeatures,
+    VkPhysicalDeviceDescriptorIndexingFeatures*         pDescriptorIndexing,
     VkDevice*                                           device)
 {
     graphicsQueueFamily->queueCount = UINT32_MAX;
@@ -511,10 +513,25 @@ initDevice(
         .sampleRateShading  = VK_TRUE,
         .tessellationShader = VK_TRUE,
         .samplerAnisotropy  = VK_TRUE,
+        // optional. used to draw geo arenas with a single indirect call
+        .multiDrawIndirect         = deviceFeatures.features.multiDrawIndirect,
+        .drawIndirectFirstInstance = deviceFeatures.features.drawIndirectFirstInstance,
+        // optional. lets the mip generator write formats other than rgba8,
+        // rgba16f, rgba32f and r32f
+        .shaderStorageImageExtendedFormats =
+            deviceFeatures.features.shaderStorageImageExtendedFormats,
+        // optional. block compressed textures are decoded without them
+        .textureCompressionBC = deviceFeatures.features.textureCompressionBC,
+        .textureCompressionASTC_LDR =
+            deviceFeatures.features.textureCompressionASTC_LDR,
     };
 
     deviceFeatures.features =
         enabledFeatures; // only enable a subset of available features
+    *pEnabledFeatures = enabledFeatures;
+    // the chain goes to the device as queried
+    *pDescriptorIndexing       = descIndexingFeatures;
+    pDescriptorIndexing->pNext = NULL;
 
     int          defExtCount = 0;
     const char** defaultExtNames;
@@ -672,7 +689,8 @@ onyx_CreateInstance(const Onyx_InstanceParms* parms, Onyx_Instance* instance)
         enabled_device_extension_names.elems, instance->physicalDevice,
         &instance->graphicsQueueFamily, &instance->computeQueueFamily,
         &instance->transferQueueFamily, &instance->rtProperties,
-        &instance->accelStructProperties, &instance->device);
+        &instance->accelStructProperties, &instance->enabledFeatures,
+        &instance->enabledDescriptorIndexing, &instance->device);
     if (r != VK_SUCCESS)
     {
         hell_Error(HELL_ERR_FATAL, "Could not initialize Vulkan device\n");
@@ -0,0 +1,373 @@
+#include "meshproc.h"
+#include "file.h"
+#include "dtags.h"
+#include "parallel.h"
+#include <hell/common.h>
+#include <hell/debug.h>
+#include <math.h>
+#include <string.h>
+
+// Vertices are hashed over every attribute plane. The hashes are split into
+// partitions by their high bits so each partition can be deduplicated on its
+// own thread with its own table. Vertices are visited in increasing order
+// within a partition, so the representative of a set of duplicates is always
+// the lowest vertex and the compacted vertices keep their relative order.
+
+#define DPRINT(fmt, ...) hell_DebugPrint(ONYX_DEBUG_TAG_GEO, fmt, ##__VA_ARGS__)
+
+#define NONE UINT32_MAX
+
+// below this many vertices threading costs more than it saves
+#define PARALLEL_VERTEX_COUNT 0x10000
+// vertices hashed or remapped per task
+#define CHUNK_SIZE 0x4000
+
+typedef struct {
+    uint32_t       attrCount;
+    uint32_t       vertexCount;
+    uint8_t        attrSizes[ONYX_R_MAX_VERT_ATTRIBUTES];
+    uint8_t*       planes[ONYX_R_MAX_VERT_ATTRIBUTES];
+    // 0 compares bytes, otherwise float attributes are snapped to a grid of
+    // this size before comparing
+    float          epsilon;
+    float          invEpsilon;
+    uint32_t*      hashes;
+    uint32_t*      remap;
+    // vertices sorted by partition, and where each partition starts
+    uint32_t*      partitionVerts;
+    uint32_t*      partitionOffsets;
+    uint32_t       partitionBits;
+    uint32_t*      indices;
+    uint32_t       indexCount;
+    const uint32_t* newIndices;
+} WeldContext;
+
+static inline bool
+isFloatAttr(const WeldContext* wc, uint32_t attr)
+{
+    return wc->epsilon > 0.f && wc->attrSizes[attr] % sizeof(float) == 0;
+}
+
+static inline float
+snap(const WeldContext* wc, float x)
+{
+    float q = floorf(x * wc->invEpsilon + 0.5f);
+    // -0 and 0 must hash the same
+    return q == 0.f ? 0.f : q;
+}
+
+static uint32_t
+hashVertex(const WeldContext* wc, uint32_t v)
+{
+    uint32_t h = 2166136261u;
+    for (uint32_t a = 0; a < wc->attrCount; a++)
+    {
+        const uint32_t size = wc->attrSizes[a];
+        const uint8_t* src  = wc->planes[a] + (size_t)v * size;
+        if (isFloatAttr(wc, a))
+        {
+            for (uint32_t i = 0; i < size; i += sizeof(float))
+            {
+                float    f;
+                uint32_t w;
+                memcpy(&f, src + i, sizeof(f));
+                f = snap(wc, f);
+                memcpy(&w, &f, sizeof(w));
+                h = (h ^ w) * 16777619u;
+            }
+        }
+        else
+        {
+            for (uint32_t i = 0; i < size; i++)
+                h = (h ^ src[i]) * 16777619u;
+        }
+    }
+    // the partition is taken from the top bits, give them some mixing
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+
+static bool
+verticesEqual(const WeldContext* wc, uint32_t v0, uint32_t v1)
+{
+    for (uint32_t a = 0; a < wc->attrCount; a++)
+    {
+        const uint32_t size = wc->attrSizes[a];
+        const uint8_t* p0   = wc->planes[a] + (size_t)v0 * size;
+        const uint8_t* p1   = wc->planes[a] + (size_t)v1 * size;
+        if (isFloatAttr(wc, a))
+        {
+            for (uint32_t i = 0; i < size; i += sizeof(float))
+            {
+                float f0, f1;
+                memcpy(&f0, p0 + i, sizeof(f0));
+                memcpy(&f1, p1 + i, sizeof(f1));
+                if (snap(wc, f0) != snap(wc, f1))
+                    return false;
+            }
+        }
+        else if (memcmp(p0, p1, size) != 0)
+            return false;
+    }
+    return true;
+}
+
+static void
+hashTask(void* data, uint32_t task, uint32_t thread)
+{
+    WeldContext*   wc    = data;
+    const uint32_t first = task * CHUNK_SIZE;
+    uint32_t       last  = first + CHUNK_SIZE;
+    if (last > wc->vertexCount)
+        last = wc->vertexCount;
+    for (uint32_t v = first; v < last; v++)
+        wc->hashes[v] = hashVertex(wc, v);
+}
+
+static void
+partitionTask(void* data, uint32_t partition, uint32_t thread)
+{
+    WeldContext*    wc    = data;
+    const uint32_t  first = wc->partitionOffsets[partition];
+    const uint32_t  count = wc->partitionOffsets[partition + 1] - first;
+    const uint32_t* verts = wc->partitionVerts + first;
+    if (count == 0)
+        return;
+
+    uint32_t tableSize = 1;
+    while (tableSize < count + count / 4)
+        tableSize *= 2;
+    const uint32_t mask  = tableSize - 1;
+    uint32_t*      table = hell_Malloc(tableSize * sizeof(uint32_t));
+    memset(table, 0xff, tableSize * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint32_t v = verts[i];
+        uint32_t       h = wc->hashes[v] & mask;
+        wc->remap[v]     = v;
+        for (; table[h] != NONE; h = (h + 1) & mask)
+        {
+            const uint32_t other = table[h];
+            if (wc->hashes[other] == wc->hashes[v] &&
+                verticesEqual(wc, other, v))
+            {
+                wc->remap[v] = other;
+                break;
+            }
+        }
+        if (table[h] == NONE)
+            table[h] = v;
+    }
+
+    hell_Free(table);
+}
+
+// representatives only ever move down, so a forward pass can compact in place
+static void
+compactTask(void* data, uint32_t attr, uint32_t thread)
+{
+    WeldContext*   wc    = data;
+    const uint32_t size  = wc->attrSizes[attr];
+    uint8_t*       plane = wc->planes[attr];
+    for (uint32_t v = 0; v < wc->vertexCount; v++)
+    {
+        const uint32_t n = wc->newIndices[v];
+        if (wc->remap[v] == v && n != v)
+            memcpy(plane + (size_t)n * size, plane + (size_t)v * size, size);
+    }
+}
+
+static void
+remapTask(void* data, uint32_t task, uint32_t thread)
+{
+    WeldContext*   wc    = data;
+    const uint32_t first = task * CHUNK_SIZE;
+    uint32_t       last  = first + CHUNK_SIZE;
+    if (last > wc->indexCount)
+        last = wc->indexCount;
+    if (wc->indices)
+    {
+        for (uint32_t i = first; i < last; i++)
+            wc->indices[i] = wc->newIndices[wc->remap[wc->indices[i]]];
+    }
+}
+
+static uint32_t
+taskCount(uint32_t count)
+{
+    return (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+}
+
+// dedups the vertices in wc and fills newIndices. the caller's indices are
+// rewritten. returns the new vertex count.
+static uint32_t
+weld(WeldContext* wc, uint32_t threadCount)
+{
+    const uint32_t vertexCount = wc->vertexCount;
+    if (threadCount == 0)
+        threadCount = onyx_GetHardwareThreadCount();
+    if (vertexCount < PARALLEL_VERTEX_COUNT)
+        threadCount = 1;
+
+    // a few partitions per thread keeps them balanced
+    wc->partitionBits = 0;
+    while ((1u << wc->partitionBits) < threadCount * 4 && threadCount > 1)
+        wc->partitionBits++;
+    const uint32_t partitionCount = 1u << wc->partitionBits;
+
+    wc->hashes           = hell_Malloc(vertexCount * sizeof(uint32_t));
+    wc->remap            = hell_Malloc(vertexCount * sizeof(uint32_t));
+    wc->partitionVerts   = hell_Malloc(vertexCount * sizeof(uint32_t));
+    wc->partitionOffsets = hell_Malloc((partitionCount + 1) * sizeof(uint32_t));
+    uint32_t* newIndices = hell_Malloc(vertexCount * sizeof(uint32_t));
+    wc->newIndices       = newIndices;
+
+    onyx_ParallelFor(threadCount, taskCount(vertexCount), hashTask, wc);
+
+    // stable counting sort by partition
+    const uint32_t shift = 32 - wc->partitionBits;
+    memset(wc->partitionOffsets, 0, (partitionCount + 1) * sizeof(uint32_t));
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        uint32_t p = wc->partitionBits ? wc->hashes[v] >> shift : 0;
+        wc->partitionOffsets[p + 1]++;
+    }
+    for (uint32_t p = 0; p < partitionCount; p++)
+        wc->partitionOffsets[p + 1] += wc->partitionOffsets[p];
+    // newIndices doubles as the fill cursor
+    memcpy(newIndices, wc->partitionOffsets, partitionCount * sizeof(uint32_t));
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        uint32_t p = wc->partitionBits ? wc->hashes[v] >> shift : 0;
+        wc->partitionVerts[newIndices[p]++] = v;
+    }
+
+    onyx_ParallelFor(threadCount, partitionCount, partitionTask, wc);
+
+    uint32_t uniqueCount = 0;
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        if (wc->remap[v] == v)
+            newIndices[v] = uniqueCount++;
+    }
+
+    onyx_ParallelFor(threadCount, wc->attrCount, compactTask, wc);
+    onyx_ParallelFor(threadCount, taskCount(wc->indexCount), remapTask, wc);
+
+    DPRINT("Welded %d vertices into %d\n", vertexCount, uniqueCount);
+
+    hell_Free(wc->hashes);
+    hell_Free(wc->partitionVerts);
+    hell_Free(wc->partitionOffsets);
+    // remap and newIndices stay alive for the caller
+    return uniqueCount;
+}
+
+// soup is turned into a list indexing the welded vertices
+static void
+fillSoupIndices(const WeldContext* wc, uint32_t* indices)
+{
+    for (uint32_t v = 0; v < wc->vertexCount; v++)
+        indices[v] = wc->newIndices[wc->remap[v]];
+}
+
+static void
+freeWeldContext(WeldContext* wc)
+{
+    hell_Free(wc->remap);
+    hell_Free((void*)wc->newIndices);
+}
+
+uint32_t
+onyx_WeldFileGeo(Onyx_FileGeo* fgeo, float epsilon, uint32_t threadCount)
+{
+    assert(fgeo->attrCount <= ONYX_R_MAX_VERT_ATTRIBUTES);
+    assert(!fgeo->mapData && "read the geo with onyx_ReadFileGeo to modify it");
+    if (fgeo->vertexCount == 0)
+        return 0;
+
+    const bool     soup = fgeo->indexCount == 0;
+    WeldContext    wc   = {
+        .attrCount   = fgeo->attrCount,
+        .vertexCount = fgeo->vertexCount,
+        .epsilon     = epsilon,
+        .invEpsilon  = epsilon > 0.f ? 1.f / epsilon : 0.f,
+        .indices     = soup ? NULL : fgeo->indices,
+        .indexCount  = soup ? 0
+                            : onyx_GetTotalIndexCount(fgeo->indexCount,
+                                                      fgeo->lodCount, fgeo->lods),
+    };
+    for (uint32_t a = 0; a < fgeo->attrCount; a++)
+    {
+        wc.attrSizes[a] = fgeo->attrSizes[a];
+        wc.planes[a]    = fgeo->attributes[a];
+    }
+
+    const uint32_t vertexCount = weld(&wc, threadCount);
+
+    if (soup)
+    {
+        fgeo->indices = onyx_ResizeFileGeoArray(
+            fgeo, fgeo->indices, 0, fgeo->vertexCount * sizeof(uint32_t));
+        fillSoupIndices(&wc, fgeo->indices);
+        fgeo->indexCount = fgeo->vertexCount;
+        fgeo->lodCount   = 0;
+    }
+    for (uint32_t a = 0; a < fgeo->attrCount; a++)
+        fgeo->attributes[a] = onyx_ResizeFileGeoArray(
+            fgeo, fgeo->attributes[a], (size_t)fgeo->vertexCount * fgeo->attrSizes[a],
+            (size_t)vertexCount * fgeo->attrSizes[a]);
+    fgeo->vertexCount = vertexCount;
+    // dropped vertices may have been on the box when epsilon is used
+    fgeo->boundsValid = false;
+
+    freeWeldContext(&wc);
+    return vertexCount;
+}
+
+uint32_t
+onyx_WeldGeo(Onyx_Geometry* geo, float epsilon, uint32_t threadCount)
+{
+    assert(geo->vertexRegion.hostData && geo->indexRegion.hostData);
+    assert(geo->indexCount > 0);
+    // arena planes can't be repacked
+    assert(!geo->arena);
+
+    WeldContext wc = {
+        .attrCount   = geo->attrCount,
+        .vertexCount = geo->vertexCount,
+        .epsilon     = epsilon,
+        .invEpsilon  = epsilon > 0.f ? 1.f / epsilon : 0.f,
+        .indices     = (uint32_t*)geo->indexRegion.hostData,
+        .indexCount  = onyx_GetTotalIndexCount(geo->indexCount, geo->lodCount,
+                                               geo->lods),
+    };
+    for (uint32_t a = 0; a < geo->attrCount; a++)
+    {
+        wc.attrSizes[a] = geo->attrSizes[a];
+        wc.planes[a]    = geo->vertexRegion.hostData + geo->attrOffsets[a];
+    }
+
+    const uint32_t vertexCount = weld(&wc, threadCount);
+    freeWeldContext(&wc);
+
+    // the planes are packed back to back again. each one moves down so
+    // they are moved in order.
+    VkDeviceSize offset = 0;
+    for (uint32_t a = 0; a < geo->attrCount; a++)
+    {
+        const size_t size = (size_t)vertexCount * geo->attrSizes[a];
+        memmove(geo->vertexRegion.hostData + offset,
+                geo->vertexRegion.hostData + geo->attrOffsets[a], size);
+        geo->attrOffsets[a] = offset;
+        offset += size;
+    }
+    // the region keeps its size, which onyx_FreeBufferRegion needs
+    geo->vertexCount = vertexCount;
+    geo->boundsValid = false;
+
+    return vertexCount;
+}
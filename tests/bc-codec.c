@@ -0,0 +1,204 @@
+#include "test.h"
+
+// Encodes a smooth and a noisy image to BC1 and BC7, decodes them and checks
+// the error, then round trips textures through KTX2 and hand built DDS files.
+// Needs no device. Pass a different image size as the first argument.
+
+static uint8_t*
+makeImage(uint32_t w, uint32_t h, bool noise)
+{
+    uint8_t* texels = malloc((size_t)w * h * 4);
+    srand(3);
+    for (uint32_t y = 0; y < h; y++)
+        for (uint32_t x = 0; x < w; x++)
+        {
+            uint8_t* t = texels + ((size_t)y * w + x) * 4;
+            if (noise)
+                for (int c = 0; c < 4; c++)
+                    t[c] = rand();
+            else
+            {
+                t[0] = x * 255 / w;
+                t[1] = y * 255 / h;
+                t[2] = 128 + 100 * sinf((x + y) * 0.05f);
+                t[3] = 255 - x * 255 / w;
+            }
+        }
+    return texels;
+}
+
+static double
+psnr(const uint8_t* a, const uint8_t* b, size_t texelCount, int channels)
+{
+    double err = 0;
+    for (size_t i = 0; i < texelCount; i++)
+        for (int c = 0; c < channels; c++)
+        {
+            const double d = (double)a[i * 4 + c] - b[i * 4 + c];
+            err += d * d;
+        }
+    err /= texelCount * channels;
+    return err == 0 ? 99 : 10 * log10(255.0 * 255.0 / err);
+}
+
+static void
+checkCodec(VkFormat format, uint32_t w, uint32_t h, bool noise, double minPsnr)
+{
+    uint8_t*     texels  = makeImage(w, h, noise);
+    const size_t size    = onyx_GetTextureLevelSize(format, w, h);
+    uint8_t*     blocks  = malloc(size);
+    uint8_t*     decoded = malloc((size_t)w * h * 4);
+    const bool   bc1     = format == VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    double       t       = now();
+    if (bc1)
+        onyx_EncodeBC1(w, h, texels, blocks);
+    else
+        onyx_EncodeBC7(w, h, texels, blocks);
+    t = now() - t;
+    bool ok = onyx_DecodeBlocks(format, w, h, blocks, decoded);
+    assert(ok);
+    const double p = psnr(texels, decoded, (size_t)w * h, bc1 ? 3 : 4);
+    printf("%s %s %ux%u: %.2f dB, %.1f Mtexels/s\n", bc1 ? "BC1" : "BC7",
+           noise ? "noise" : "smooth", w, h, p, w * h / t * 1e-6);
+    assert(p >= minPsnr);
+    if (bc1)
+        for (size_t i = 0; i < (size_t)w * h; i++)
+            assert(decoded[i * 4 + 3] == 255);
+    free(texels);
+    free(blocks);
+    free(decoded);
+}
+
+// a p bit of 0 on either endpoint would bring opaque texels down to 254
+static void
+checkOpaqueBc7(uint32_t w, uint32_t h)
+{
+    uint8_t* texels = makeImage(w, h, false);
+    for (size_t i = 0; i < (size_t)w * h; i++)
+        texels[i * 4 + 3] = 255;
+    const VkFormat format  = VK_FORMAT_BC7_UNORM_BLOCK;
+    uint8_t*       blocks  = malloc(onyx_GetTextureLevelSize(format, w, h));
+    uint8_t*       decoded = malloc((size_t)w * h * 4);
+    onyx_EncodeBC7(w, h, texels, blocks);
+    bool ok = onyx_DecodeBlocks(format, w, h, blocks, decoded);
+    assert(ok);
+    for (size_t i = 0; i < (size_t)w * h; i++)
+        assert(decoded[i * 4 + 3] == 255);
+    assert(psnr(texels, decoded, (size_t)w * h, 3) >= 35);
+    free(texels);
+    free(blocks);
+    free(decoded);
+}
+
+static void
+checkSame(const Onyx_TextureFile* a, const Onyx_TextureFile* b)
+{
+    assert(a->format == b->format && a->width == b->width &&
+           a->height == b->height && a->levelCount == b->levelCount);
+    for (uint32_t l = 0; l < a->levelCount; l++)
+    {
+        assert(a->levels[l].size == b->levels[l].size);
+        assert(memcmp(a->data + a->levels[l].offset,
+                      b->data + b->levels[l].offset, a->levels[l].size) == 0);
+    }
+}
+
+static void
+checkKtx2(VkFormat format, uint32_t w, uint32_t h)
+{
+    uint8_t*         texels = makeImage(w, h, false);
+    Onyx_TextureFile tex, read;
+    onyx_CompressTexture(w, h, texels, format, true, &tex);
+    assert(tex.levelCount == onyx_CalcMipLevelsForImage(w, h));
+    bool ok = onyx_WriteKtx2("bc-codec.ktx2", &tex);
+    assert(ok);
+    ok = onyx_ReadTextureFile("bc-codec.ktx2", &read);
+    assert(ok);
+    checkSame(&tex, &read);
+    onyx_FreeTextureFile(&read);
+    onyx_FreeTextureFile(&tex);
+    free(texels);
+}
+
+static void
+put32(uint8_t* p, uint32_t v)
+{
+    memcpy(p, &v, 4);
+}
+
+// writes the levels of tex as a DDS file, with a DX10 header if dxgi isn't 0
+static void
+writeDds(const char* filename, const Onyx_TextureFile* tex, uint32_t dxgi,
+         const char* fourCC)
+{
+    uint8_t header[148] = "DDS ";
+    put32(header + 4, 124);
+    put32(header + 8, 0x1007 | 0x20000);
+    put32(header + 12, tex->height);
+    put32(header + 16, tex->width);
+    put32(header + 28, tex->levelCount);
+    put32(header + 76, 32);
+    put32(header + 80, 0x4);
+    memcpy(header + 84, dxgi ? "DX10" : fourCC, 4);
+    put32(header + 128, dxgi);
+    put32(header + 132, 3);
+    put32(header + 140, 1);
+    FILE* f = fopen(filename, "wb");
+    assert(f);
+    fwrite(header, 1, dxgi ? 148 : 128, f);
+    for (uint32_t l = 0; l < tex->levelCount; l++)
+        fwrite(tex->data + tex->levels[l].offset, 1, tex->levels[l].size, f);
+    fclose(f);
+}
+
+static void
+checkDds(void)
+{
+    const uint32_t   w = 40, h = 24;
+    uint8_t*         texels = makeImage(w, h, false);
+    Onyx_TextureFile tex, read;
+    onyx_CompressTexture(w, h, texels, VK_FORMAT_BC7_UNORM_BLOCK, true, &tex);
+    writeDds("bc-codec.dds", &tex, 98, NULL);
+    bool ok = onyx_ReadTextureFile("bc-codec.dds", &read);
+    assert(ok);
+    checkSame(&tex, &read);
+    onyx_FreeTextureFile(&read);
+    onyx_FreeTextureFile(&tex);
+
+    onyx_CompressTexture(w, h, texels, VK_FORMAT_BC1_RGB_UNORM_BLOCK, false,
+                         &tex);
+    writeDds("bc-codec.dds", &tex, 0, "DXT1");
+    ok = onyx_ReadTextureFile("bc-codec.dds", &read);
+    assert(ok);
+    assert(read.format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK);
+    read.format = tex.format;
+    checkSame(&tex, &read);
+    onyx_FreeTextureFile(&read);
+    onyx_FreeTextureFile(&tex);
+    free(texels);
+}
+
+int main(int argc, char *argv[])
+{
+    const uint32_t size = argc > 1 ? atoi(argv[1]) : 512;
+    checkCodec(VK_FORMAT_BC1_RGB_UNORM_BLOCK, size, size, false, 35);
+    checkCodec(VK_FORMAT_BC1_RGB_UNORM_BLOCK, size, size, true, 10);
+    checkCodec(VK_FORMAT_BC7_UNORM_BLOCK, size, size, false, 40);
+    checkCodec(VK_FORMAT_BC7_UNORM_BLOCK, size, size, true, 12);
+    // partial edge blocks, and a gradient steep enough that one endpoint
+    // line per block shows
+    checkCodec(VK_FORMAT_BC7_UNORM_BLOCK, 37, 21, false, 30);
+    checkOpaqueBc7(size, size);
+
+    checkKtx2(VK_FORMAT_BC1_RGB_SRGB_BLOCK, 100, 60);
+    checkKtx2(VK_FORMAT_BC7_UNORM_BLOCK, 64, 64);
+    checkKtx2(VK_FORMAT_R8G8B8A8_SRGB, 33, 17);
+    checkDds();
+
+    Onyx_TextureFile tex;
+    assert(!onyx_ReadTextureFile("bc-codec-missing.ktx2", &tex));
+    remove("bc-codec.ktx2");
+    remove("bc-codec.dds");
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "test.h"
+
+// Writes about a hundred files of different sizes, reads them back with every
+// io backend and checks the bytes, then compares the times with reading them
+// one after the other with stdio. Files are in the page cache by then, so
+// this measures syscall overhead more than the disk.
+
+#define FILE_COUNT 96
+#define MAX_SIZE   (2 << 20)
+
+static char     paths[FILE_COUNT][32];
+static size_t   sizes[FILE_COUNT];
+static uint8_t* contents[FILE_COUNT];
+
+static void
+writeFiles(void)
+{
+    srand(7);
+    for (int i = 0; i < FILE_COUNT; i++)
+    {
+        snprintf(paths[i], sizeof(paths[i]), "file-reads-%d.bin", i);
+        // empty, tiny and chunk sized files as well as larger ones
+        sizes[i] = i < 4 ? (size_t[]){0, 1, 1 << 20, (1 << 20) + 1}[i]
+                         : (size_t)rand() % MAX_SIZE;
+        contents[i] = malloc(sizes[i] + 1);
+        for (size_t k = 0; k < sizes[i]; k++)
+            contents[i][k] = rand();
+        FILE* f = fopen(paths[i], "wb");
+        assert(f);
+        fwrite(contents[i], 1, sizes[i], f);
+        fclose(f);
+    }
+}
+
+static double
+readWithBackend(Onyx_IoBackend backend)
+{
+    static Onyx_FileRead reads[FILE_COUNT + 2];
+    for (int i = 0; i < FILE_COUNT; i++)
+        reads[i] = (Onyx_FileRead){.filename = paths[i],
+                                   .size     = ONYX_READ_TO_END};
+    // a missing file and a range into caller memory that runs past the end
+    reads[FILE_COUNT] = (Onyx_FileRead){.filename = "file-reads-missing.bin",
+                                        .size     = ONYX_READ_TO_END};
+    static uint8_t range[MAX_SIZE];
+    reads[FILE_COUNT + 1] = (Onyx_FileRead){
+        .filename = paths[2], .offset = 100, .size = 1 << 20, .dst = range};
+    double     t  = now();
+    const bool ok = onyx_ReadFilesWithBackend(backend, FILE_COUNT + 2, reads);
+    t = now() - t;
+    assert(!ok);
+    assert(!reads[FILE_COUNT].ok && !reads[FILE_COUNT].dst);
+    for (int i = 0; i < FILE_COUNT; i++)
+    {
+        assert(reads[i].ok && reads[i].bytesRead == sizes[i]);
+        assert(memcmp(reads[i].dst, contents[i], sizes[i]) == 0);
+        assert(((uint8_t*)reads[i].dst)[sizes[i]] == 0);
+        hell_Free(reads[i].dst);
+    }
+    const Onyx_FileRead* r = &reads[FILE_COUNT + 1];
+    assert(!r->ok && r->bytesRead == (1 << 20) - 100);
+    assert(memcmp(range, contents[2] + 100, r->bytesRead) == 0);
+    return t;
+}
+
+static double
+readWithStdio(void)
+{
+    double t = now();
+    for (int i = 0; i < FILE_COUNT; i++)
+    {
+        FILE* f = fopen(paths[i], "rb");
+        assert(f);
+        uint8_t* data = malloc(sizes[i] + 1);
+        const size_t n = fread(data, 1, sizes[i], f);
+        assert(n == sizes[i]);
+        fclose(f);
+        free(data);
+    }
+    return now() - t;
+}
+
+int main(int argc, char *argv[])
+{
+    writeFiles();
+    size_t total = 0;
+    for (int i = 0; i < FILE_COUNT; i++)
+        total += sizes[i];
+    printf("%d files, %zu bytes\n", FILE_COUNT, total);
+    printf("  stdio   %.3fs\n", readWithStdio());
+    printf("  default %.3fs\n", readWithBackend(ONYX_IO_BACKEND_DEFAULT));
+    printf("  uring   %.3fs\n", readWithBackend(ONYX_IO_BACKEND_URING));
+    printf("  threads %.3fs\n", readWithBackend(ONYX_IO_BACKEND_THREADS));
+
+    size_t size;
+    void*  whole = onyx_ReadWholeFile(paths[5], &size);
+    assert(whole && size == sizes[5]);
+    hell_Free(whole);
+    assert(!onyx_ReadWholeFile("file-reads-missing.bin", &size));
+
+    for (int i = 0; i < FILE_COUNT; i++)
+    {
+        remove(paths[i]);
+        free(contents[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,267 @@
+#include "test.h"
+
+// Writes geos raw and with the section codecs, checks that both read back
+// the same and prints the compression ratio and the read and map times. Pass
+// .geo files to measure those, otherwise a wavy grid of about 1M triangles is
+// used. First a small grid with a coarser level is written as version 1 and
+// read back singly and in a batch, and version 2 files with a flipped byte in
+// each section or cut short must fail to read and map.
+
+#define RAW_PATH   "geo-codec-raw.geo"
+#define CODED_PATH "geo-codec-coded.geo"
+#define BAD_PATH   "geo-codec-bad.geo"
+
+// the version 2 layout: a 64 byte header with the section count at byte 24,
+// then 32 byte sections with the offset at byte 8 and the size at byte 16
+#define V2_HEADER_SIZE   64
+#define V2_SECTION_SIZE  32
+
+static long
+fileSize(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    assert(f);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+static void*
+readWhole(const char* path, long* size)
+{
+    *size      = fileSize(path);
+    FILE* f    = fopen(path, "rb");
+    void* data = malloc(*size);
+    assert(f && data);
+    const bool ok = fread(data, *size, 1, f) == 1;
+    assert(ok);
+    fclose(f);
+    return data;
+}
+
+static void
+writeWhole(const char* path, const void* data, long size)
+{
+    FILE* f = fopen(path, "wb");
+    assert(f);
+    const bool ok = fwrite(data, size, 1, f) == 1;
+    assert(ok);
+    fclose(f);
+}
+
+static Onyx_FileGeo
+createGrid(uint32_t targetTris)
+{
+    const uint32_t n           = (uint32_t)sqrt(targetTris / 2.0);
+    const uint32_t vertexCount = (n + 1) * (n + 1);
+    const uint32_t indexCount  = n * n * 6;
+    const Onyx_GeoAttributeSize sizes[3] = {12, 12, 8};
+    const char names[3][ONYX_R_ATTR_NAME_LEN] = {
+        POS_NAME, NORMAL_NAME, UV_NAME};
+    Onyx_FileGeo geo =
+        onyx_CreateFileGeo(vertexCount, indexCount, 3, sizes, names);
+    fillWaveGrid(n, geo.attributes[0], geo.attributes[1], geo.attributes[2],
+                 geo.indices);
+    return geo;
+}
+
+// the grid with its first quad as a second level of detail
+static Onyx_FileGeo
+createGridWithLod(uint32_t n)
+{
+    const uint32_t vertexCount = (n + 1) * (n + 1);
+    const uint32_t indexCount  = n * n * 6;
+    const Onyx_GeoAttributeSize sizes[3] = {12, 12, 8};
+    const char names[3][ONYX_R_ATTR_NAME_LEN] = {
+        POS_NAME, NORMAL_NAME, UV_NAME};
+    Onyx_FileGeo geo =
+        onyx_CreateFileGeo(vertexCount, indexCount + 6, 3, sizes, names);
+    fillWaveGrid(n, geo.attributes[0], geo.attributes[1], geo.attributes[2],
+                 geo.indices);
+    memcpy(geo.indices + indexCount, geo.indices, 6 * sizeof(Onyx_GeoIndex));
+    geo.indexCount = indexCount;
+    geo.lodCount   = 2;
+    geo.lods[0]    = (Onyx_GeoLod){.firstIndex = 0, .indexCount = indexCount};
+    geo.lods[1]    = (Onyx_GeoLod){.firstIndex = indexCount, .indexCount = 6};
+    return geo;
+}
+
+static bool
+sameGeo(const Onyx_FileGeo* a, const Onyx_FileGeo* b)
+{
+    if (a->attrCount != b->attrCount || a->vertexCount != b->vertexCount ||
+        a->indexCount != b->indexCount || a->lodCount != b->lodCount)
+        return false;
+    for (uint32_t i = 0; i < a->attrCount; i++)
+        if (a->attrSizes[i] != b->attrSizes[i] ||
+            memcmp(a->attributes[i], b->attributes[i],
+                   (size_t)a->vertexCount * a->attrSizes[i]))
+            return false;
+    if (a->lodCount && memcmp(a->lods, b->lods, a->lodCount * sizeof(Onyx_GeoLod)))
+        return false;
+    const uint32_t indexCount =
+        onyx_GetTotalIndexCount(a->indexCount, a->lodCount, a->lods);
+    return memcmp(a->indices, b->indices, indexCount * sizeof(uint32_t)) == 0;
+}
+
+static bool
+readsOrMaps(const char* path)
+{
+    Onyx_FileGeo geo;
+    bool         ok = false;
+    if (onyx_ReadFileGeo(path, &geo))
+    {
+        onyx_FreeFileGeo(&geo);
+        ok = true;
+    }
+    if (onyx_MapFileGeo(path, &geo))
+    {
+        onyx_FreeFileGeo(&geo);
+        ok = true;
+    }
+    return ok;
+}
+
+static void
+testVersion1(const Onyx_FileGeo* geo)
+{
+    const Onyx_WriteGeoParms parms = {.version = ONYX_GEO_FILE_VERSION_1};
+    int r = onyx_WriteFileGeoEx(RAW_PATH, geo, &parms);
+    assert(r);
+    Onyx_FileGeo read, mapped;
+    r = onyx_ReadFileGeo(RAW_PATH, &read);
+    assert(r);
+    r = onyx_MapFileGeo(RAW_PATH, &mapped);
+    assert(r);
+    assert(sameGeo(geo, &read));
+    assert(sameGeo(geo, &mapped));
+    onyx_FreeFileGeo(&read);
+    onyx_FreeFileGeo(&mapped);
+    // the batch reader parses version 1 from memory too
+    const char* path = RAW_PATH;
+    bool ok = onyx_ReadFileGeos(1, &path, 2, &read);
+    assert(ok);
+    assert(sameGeo(geo, &read));
+    onyx_FreeFileGeo(&read);
+
+    // level 0 must cover the full detail indices
+    Onyx_FileGeo bad = *geo;
+    bad.lods[0].indexCount -= 3;
+    r = onyx_WriteFileGeoEx(BAD_PATH, &bad, &parms);
+    assert(r);
+    assert(!readsOrMaps(BAD_PATH));
+    remove(RAW_PATH);
+    remove(BAD_PATH);
+}
+
+static void
+testCorruptVersion2(const Onyx_FileGeo* geo)
+{
+    const Onyx_WriteGeoParms parms = {.version = ONYX_GEO_FILE_VERSION_2};
+    int r = onyx_WriteFileGeoEx(RAW_PATH, geo, &parms);
+    assert(r);
+    long     size;
+    uint8_t* data = readWhole(RAW_PATH, &size);
+    assert(readsOrMaps(RAW_PATH));
+
+    uint32_t sectionCount;
+    memcpy(&sectionCount, data + 24, 4);
+    assert(sectionCount >= 5);
+    for (uint32_t i = 0; i <= sectionCount; i++)
+    {
+        // the section table itself, then the middle of every section
+        uint64_t at = V2_HEADER_SIZE;
+        if (i < sectionCount)
+        {
+            uint64_t offset, sectionSize;
+            memcpy(&offset, data + V2_HEADER_SIZE + i * V2_SECTION_SIZE + 8, 8);
+            memcpy(&sectionSize, data + V2_HEADER_SIZE + i * V2_SECTION_SIZE + 16, 8);
+            at = offset + sectionSize / 2;
+        }
+        data[at] ^= 0x10;
+        writeWhole(BAD_PATH, data, size);
+        data[at] ^= 0x10;
+        assert(!readsOrMaps(BAD_PATH));
+    }
+    const long cuts[3] = {size - 1, size / 2, V2_HEADER_SIZE - 1};
+    for (int i = 0; i < 3; i++)
+    {
+        writeWhole(BAD_PATH, data, cuts[i]);
+        assert(!readsOrMaps(BAD_PATH));
+    }
+    free(data);
+    remove(RAW_PATH);
+    remove(BAD_PATH);
+}
+
+static void
+bench(const char* name, const Onyx_FileGeo* geo)
+{
+    Onyx_WriteGeoParms parms = {.version = ONYX_GEO_FILE_VERSION_2};
+    onyx_WriteFileGeoEx(RAW_PATH, geo, &parms);
+    parms.attributeCodec = ONYX_GEO_CODEC_VERTEX;
+    parms.indexCodec     = ONYX_GEO_CODEC_INDEX;
+    double t0 = now();
+    onyx_WriteFileGeoEx(CODED_PATH, geo, &parms);
+    double t1 = now();
+
+    const char*  paths[2] = {RAW_PATH, CODED_PATH};
+    double       readTimes[2], mapTimes[2];
+    for (int i = 0; i < 2; i++)
+    {
+        Onyx_FileGeo read, mapped;
+        double       t2 = now();
+        int          r  = onyx_ReadFileGeo(paths[i], &read);
+        double       t3 = now();
+        assert(r);
+        r         = onyx_MapFileGeo(paths[i], &mapped);
+        double t4 = now();
+        assert(r);
+        assert(sameGeo(geo, &read));
+        assert(sameGeo(geo, &mapped));
+        readTimes[i] = t3 - t2;
+        mapTimes[i]  = t4 - t3;
+        onyx_FreeFileGeo(&read);
+        onyx_FreeFileGeo(&mapped);
+    }
+    const long rawSize   = fileSize(RAW_PATH);
+    const long codedSize = fileSize(CODED_PATH);
+    printf("%s: %d vertices %d triangles\n", name, geo->vertexCount,
+           geo->indexCount / 3);
+    printf("  raw   %10ld bytes read %.3fs map %.3fs\n", rawSize, readTimes[0],
+           mapTimes[0]);
+    printf("  coded %10ld bytes read %.3fs map %.3fs encode %.3fs ratio %.3f\n",
+           codedSize, readTimes[1], mapTimes[1], t1 - t0,
+           (double)codedSize / rawSize);
+    remove(RAW_PATH);
+    remove(CODED_PATH);
+}
+
+int main(int argc, char *argv[])
+{
+    printf("%d threads\n", onyx_GetHardwareThreadCount());
+    Onyx_FileGeo small = createGridWithLod(16);
+    testVersion1(&small);
+    testCorruptVersion2(&small);
+    onyx_FreeFileGeo(&small);
+    if (argc < 2)
+    {
+        Onyx_FileGeo geo = createGrid(1000000);
+        bench("grid", &geo);
+        onyx_FreeFileGeo(&geo);
+        return 0;
+    }
+    for (int i = 1; i < argc; i++)
+    {
+        Onyx_FileGeo geo;
+        if (!onyx_ReadFileGeo(argv[i], &geo))
+        {
+            printf("%s: could not read\n", argv[i]);
+            return 1;
+        }
+        bench(argv[i], &geo);
+        onyx_FreeFileGeo(&geo);
+    }
+    return 0;
+}
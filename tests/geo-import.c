@@ -0,0 +1,212 @@
+#include "test.h"
+
+// Writes a wavy grid as OBJ, ascii PLY and binary PLY, imports each, checks
+// the triangles match the grid and prints the import throughput. The OBJ
+// indexes its normals in reverse so the corner welding is exercised. The
+// default grid is small, pass a triangle count to measure a larger one,
+// 4000000 makes files of a few hundred MB.
+
+#define OBJ_PATH       "geo-import.obj"
+#define PLY_ASCII_PATH "geo-import-ascii.ply"
+#define PLY_BIN_PATH   "geo-import-bin.ply"
+
+static double
+fileMB(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    assert(f);
+    fseek(f, 0, SEEK_END);
+    double size = ftell(f) / (1024.0 * 1024.0);
+    fclose(f);
+    return size;
+}
+
+typedef struct {
+    uint32_t  n;
+    uint32_t  vertexCount;
+    uint32_t  indexCount;
+    float*    pos;
+    float*    nrm;
+    float*    uv;
+    uint32_t* indices;
+} Grid;
+
+static Grid
+createGrid(uint32_t targetTris)
+{
+    Grid g        = {.n = (uint32_t)sqrt(targetTris / 2.0)};
+    const uint32_t n = g.n;
+    g.vertexCount = (n + 1) * (n + 1);
+    g.indexCount  = n * n * 6;
+    g.pos         = malloc(g.vertexCount * 12);
+    g.nrm         = malloc(g.vertexCount * 12);
+    g.uv          = malloc(g.vertexCount * 8);
+    g.indices     = malloc(g.indexCount * 4);
+    fillWaveGrid(n, g.pos, g.nrm, g.uv, g.indices);
+    return g;
+}
+
+static void
+freeGrid(Grid* g)
+{
+    free(g->pos);
+    free(g->nrm);
+    free(g->uv);
+    free(g->indices);
+}
+
+static void
+writeObj(const Grid* g)
+{
+    FILE* f = fopen(OBJ_PATH, "wb");
+    assert(f);
+    fprintf(f, "# onyx import benchmark\no grid\n");
+    for (uint32_t v = 0; v < g->vertexCount; v++)
+        fprintf(f, "v %.9g %.9g %.9g\n", g->pos[v * 3], g->pos[v * 3 + 1],
+                g->pos[v * 3 + 2]);
+    for (uint32_t v = 0; v < g->vertexCount; v++)
+        fprintf(f, "vt %.9g %.9g\n", g->uv[v * 2], g->uv[v * 2 + 1]);
+    for (uint32_t v = g->vertexCount; v-- > 0;)
+        fprintf(f, "vn %.9g %.9g %.9g\n", g->nrm[v * 3], g->nrm[v * 3 + 1],
+                g->nrm[v * 3 + 2]);
+    // quads, so the fanning is exercised too
+    const uint32_t n = g->n;
+    for (uint32_t y = 0; y < n; y++)
+        for (uint32_t x = 0; x < n; x++)
+        {
+            uint32_t a = y * (n + 1) + x + 1;
+            uint32_t c = a + n + 1;
+            // fans into the grid's two triangles
+            uint32_t q[4] = {a + 1, a, c, c + 1};
+            fprintf(f, "f");
+            for (int k = 0; k < 4; k++)
+                fprintf(f, " %u/%u/%u", q[k], q[k], g->vertexCount + 1 - q[k]);
+            fprintf(f, "\n");
+        }
+    fclose(f);
+}
+
+static void
+writePly(const Grid* g, bool binary)
+{
+    FILE* f = fopen(binary ? PLY_BIN_PATH : PLY_ASCII_PATH, "wb");
+    assert(f);
+    fprintf(f,
+            "ply\nformat %s 1.0\ncomment onyx import benchmark\n"
+            "element vertex %u\n"
+            "property float x\nproperty float y\nproperty float z\n"
+            "property float nx\nproperty float ny\nproperty float nz\n"
+            "property float u\nproperty float v\n"
+            "element face %u\nproperty list uchar uint vertex_indices\n"
+            "end_header\n",
+            binary ? "binary_little_endian" : "ascii", g->vertexCount,
+            g->indexCount / 3);
+    for (uint32_t v = 0; v < g->vertexCount; v++)
+    {
+        float row[8] = {g->pos[v * 3], g->pos[v * 3 + 1], g->pos[v * 3 + 2],
+                        g->nrm[v * 3], g->nrm[v * 3 + 1], g->nrm[v * 3 + 2],
+                        g->uv[v * 2],  g->uv[v * 2 + 1]};
+        if (binary)
+            fwrite(row, sizeof(row), 1, f);
+        else
+            fprintf(f, "%.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n", row[0],
+                    row[1], row[2], row[3], row[4], row[5], row[6], row[7]);
+    }
+    for (uint32_t t = 0; t < g->indexCount / 3; t++)
+    {
+        const uint32_t* tri = g->indices + t * 3;
+        if (binary)
+        {
+            uint8_t count = 3;
+            fwrite(&count, 1, 1, f);
+            fwrite(tri, 12, 1, f);
+        }
+        else
+            fprintf(f, "3 %u %u %u\n", tri[0], tri[1], tri[2]);
+    }
+    fclose(f);
+}
+
+static bool
+close3(const float* a, const float* b, int n)
+{
+    for (int i = 0; i < n; i++)
+        if (fabsf(a[i] - b[i]) > 1e-6f)
+            return false;
+    return true;
+}
+
+static int
+getAttr(const Onyx_FileGeo* geo, const char* name)
+{
+    for (uint32_t i = 0; i < geo->attrCount; i++)
+        if (strcmp(geo->attrNames[i], name) == 0)
+            return i;
+    return -1;
+}
+
+// the imported triangles must reference the grid's vertex values in the same
+// order, the vertex order itself may differ
+static bool
+sameTriangles(const Grid* g, const Onyx_FileGeo* geo)
+{
+    const int pos = getAttr(geo, POS_NAME);
+    const int nrm = getAttr(geo, NORMAL_NAME);
+    const int uv  = getAttr(geo, UV_NAME);
+    if (geo->indexCount != g->indexCount || pos < 0 || nrm < 0 || uv < 0 ||
+        !geo->boundsValid)
+        return false;
+    for (uint32_t t = 0; t < g->indexCount / 3; t++)
+    {
+        // the obj triangles start on another corner
+        for (int k = 0; k < 3; k++)
+        {
+            const uint32_t i = geo->indices[t * 3 + k];
+            if (i >= geo->vertexCount)
+                return false;
+            bool found = false;
+            for (int j = 0; j < 3 && !found; j++)
+            {
+                const uint32_t gi = g->indices[t * 3 + j];
+                found = close3((float*)geo->attributes[pos] + i * 3, g->pos + gi * 3, 3) &&
+                        close3((float*)geo->attributes[nrm] + i * 3, g->nrm + gi * 3, 3) &&
+                        close3((float*)geo->attributes[uv] + i * 2, g->uv + gi * 2, 2);
+            }
+            if (!found)
+                return false;
+        }
+    }
+    return geo->vertexCount == g->vertexCount;
+}
+
+static void
+bench(const char* path, const Grid* g)
+{
+    Onyx_FileGeo geo;
+    double       t0 = now();
+    bool         ok = onyx_ImportFileGeo(path, 0, &geo);
+    double       t1 = now();
+    assert(ok);
+    assert(sameTriangles(g, &geo));
+    const double mb = fileMB(path);
+    printf("  %-22s %8.1f MB %7.3fs %8.1f MB/s\n", path, mb, t1 - t0,
+           mb / (t1 - t0));
+    onyx_FreeFileGeo(&geo);
+    remove(path);
+}
+
+int main(int argc, char *argv[])
+{
+    const uint32_t tris = argc > 1 ? (uint32_t)atol(argv[1]) : 20000;
+    Grid           g    = createGrid(tris);
+    printf("%d threads, %u vertices %u triangles\n",
+           onyx_GetHardwareThreadCount(), g.vertexCount, g.indexCount / 3);
+    writeObj(&g);
+    writePly(&g, false);
+    writePly(&g, true);
+    bench(OBJ_PATH, &g);
+    bench(PLY_ASCII_PATH, &g);
+    bench(PLY_BIN_PATH, &g);
+    freeGrid(&g);
+    return 0;
+}
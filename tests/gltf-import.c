@@ -0,0 +1,133 @@
+#include <hell/hell.h>
+#include <hell/len.h>
+#include <onyx/onyx.h>
+#include <stdio.h>
+#include <string.h>
+
+// Imports small hand built glb files: a node tree that instances one mesh
+// twice, then files that must be rejected without adding anything, a node
+// with two parents, a node that is its own child and an index past the
+// vertices.
+
+Hell_Grimoire*   grim;
+Hell_EventQueue* equeue;
+
+Onyx_Instance* instance;
+Onyx_Memory*   memory;
+Onyx_Scene*    scene;
+
+#define FILENAME "gltf-import.glb"
+
+// a triangle with three positions and 16 bit indices, padded to 4 bytes
+#define BIN_SIZE 44
+
+static void
+writeGlb(const char* nodes, const char* roots, uint16_t lastIndex)
+{
+    char json[1024];
+    int  len = snprintf(
+        json, sizeof(json),
+        "{\"asset\":{\"version\":\"2.0\"},"
+        "\"buffers\":[{\"byteLength\":%d}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteLength\":36},"
+        "{\"buffer\":0,\"byteOffset\":36,\"byteLength\":6}],"
+        "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":3,"
+        "\"type\":\"VEC3\"},{\"bufferView\":1,\"componentType\":5123,"
+        "\"count\":3,\"type\":\"SCALAR\"}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0},"
+        "\"indices\":1}]}],"
+        "\"nodes\":%s,\"scenes\":[{\"nodes\":%s}]}",
+        BIN_SIZE, nodes, roots);
+    assert(len > 0 && len < (int)sizeof(json) - 4);
+    while (len % 4)
+        json[len++] = ' ';
+
+    uint8_t        bin[BIN_SIZE] = {0};
+    const float    pos[9]        = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    const uint16_t indices[3]    = {0, 1, lastIndex};
+    memcpy(bin, pos, sizeof(pos));
+    memcpy(bin + 36, indices, sizeof(indices));
+
+    const uint32_t header[5] = {0x46546C67u, 2, 12 + 8 + len + 8 + BIN_SIZE,
+                                len, 0x4E4F534Au};
+    const uint32_t binHeader[2] = {BIN_SIZE, 0x004E4942u};
+    FILE*          f            = fopen(FILENAME, "wb");
+    assert(f);
+    fwrite(header, sizeof(header), 1, f);
+    fwrite(json, len, 1, f);
+    fwrite(binHeader, sizeof(binHeader), 1, f);
+    fwrite(bin, BIN_SIZE, 1, f);
+    fclose(f);
+}
+
+static bool
+import(Onyx_GltfScene* gltf)
+{
+    const Onyx_GltfImportParms parms = {.threadCount = 2};
+    return onyx_ImportGlb(memory, scene, FILENAME, &parms, gltf);
+}
+
+int main(int argc, char *argv[])
+{
+    grim = hell_AllocGrimoire();
+    equeue = hell_AllocEventQueue();
+
+    hell_CreateEventQueue(equeue);
+    hell_CreateGrimoire(equeue, grim);
+
+    instance = onyx_AllocInstance();
+    memory   = onyx_AllocMemory();
+    scene    = onyx_AllocScene();
+    #if UNIX
+    const char* instanceExtensions[] = {
+        VK_KHR_SURFACE_EXTENSION_NAME,
+        VK_KHR_XCB_SURFACE_EXTENSION_NAME
+    };
+    #elif WIN32
+    const char* instanceExtensions[] = {
+        VK_KHR_SURFACE_EXTENSION_NAME,
+        VK_KHR_WIN32_SURFACE_EXTENSION_NAME
+    };
+    #endif
+    Onyx_InstanceParms ip = {
+        .enabledInstanceExentensionCount = LEN(instanceExtensions),
+        .ppEnabledInstanceExtensionNames = instanceExtensions,
+    };
+    onyx_CreateInstance(&ip, instance);
+    onyx_CreateMemory(instance, 100, 100, 100, 0, 0, memory);
+    onyx_CreateScene(grim, memory, 1, 1, 0.01, 100, scene);
+
+    const uint32_t primCount = onyx_SceneGetPrimCount(scene);
+    Onyx_GltfScene gltf;
+
+    // a root with the mesh and a moved child with it again
+    writeGlb("[{\"mesh\":0,\"children\":[1]},"
+             "{\"mesh\":0,\"translation\":[2,0,0]}]",
+             "[0]", 2);
+    bool ok = import(&gltf);
+    assert(ok);
+    assert(gltf.geoCount == 1 && gltf.primCount == 2);
+    assert(onyx_SceneGetPrimCount(scene) == primCount + 2);
+    const Onyx_Geometry* geo = &gltf.geos[0];
+    assert(geo->vertexCount == 3 && geo->indexCount == 3);
+    const Onyx_GeoIndex* indices = onyx_GetGeoIndices(geo);
+    assert(indices[0] == 0 && indices[1] == 1 && indices[2] == 2);
+    onyx_FreeGltfScene(scene, &gltf);
+    onyx_SceneEndFrame(scene);
+    assert(onyx_SceneGetPrimCount(scene) == primCount);
+
+    // node 2 has two parents
+    writeGlb("[{\"children\":[2]},{\"children\":[2]},{\"mesh\":0}]", "[0,1]", 2);
+    assert(!import(&gltf));
+    // node 0 is its own child
+    writeGlb("[{\"mesh\":0,\"children\":[0]}]", "[0]", 2);
+    assert(!import(&gltf));
+    // the triangle's last index is past the three vertices
+    writeGlb("[{\"mesh\":0}]", "[0]", 3);
+    assert(!import(&gltf));
+    assert(onyx_SceneGetPrimCount(scene) == primCount);
+
+    remove(FILENAME);
+    hell_Print("ok\n");
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include "test.h"
+
+// Writes scene objects without a device, their geometry and images
+// referenced by path, and checks that they read back the same. Then a file
+// with a flipped byte in its prim section and one with a prim whose material
+// isn't live must both be rejected.
+
+#define PATH     "scene-file.oscn"
+#define BAD_PATH "scene-file-bad.oscn"
+
+// the 32 byte sections follow the 64 byte header, the prims are section 1
+// and a section's offset is at byte 8
+#define PRIM_SECTION_OFFSET (64 + 32 + 8)
+
+static Onyx_Geometry geos[2];
+static Onyx_Geometry defaultGeo;
+static Onyx_Image    image = {.format = VK_FORMAT_R8G8B8A8_UNORM};
+static Onyx_Image    defaultImage;
+
+static Coal_Mat4
+numbered(float first)
+{
+    Coal_Mat4 m;
+    for (int i = 0; i < 16; i++)
+        m.e[i / 4][i % 4] = first + i;
+    return m;
+}
+
+static bool
+sameMat4(const Coal_Mat4* a, const Coal_Mat4* b)
+{
+    return memcmp(a, b, sizeof(Coal_Mat4)) == 0;
+}
+
+static bool
+sameIds(const Onyx_SceneObjectIds* a, const Onyx_SceneObjectIds* b)
+{
+    if (a->count != b->count || a->freeCount != b->freeCount)
+        return false;
+    for (uint32_t i = 0; i < a->count; i++)
+        if (a->ids[i] != b->ids[i])
+            return false;
+    for (uint32_t i = 0; i < a->freeCount; i++)
+        if (a->freeIds[i] != b->freeIds[i])
+            return false;
+    return true;
+}
+
+static bool
+readsBack(const char* path)
+{
+    Onyx_SceneFileObjects objects;
+    if (!onyx_ReadSceneFileObjects(path, &objects))
+        return false;
+    onyx_FreeSceneFileObjects(&objects);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    // ids 0 to 3 with 2 free, so the records are not in id order
+    Onyx_SceneObjectInt primIds[3] = {1, 0, 3}, freePrimIds[1] = {2};
+    Onyx_SceneObjectInt lightIds[1] = {0};
+    Onyx_SceneObjectInt materialIds[1] = {0};
+    Onyx_SceneObjectInt textureIds[2] = {0, 2}, freeTextureIds[1] = {1};
+    Onyx_Primitive prims[3] = {
+        {.geo      = &geos[1],
+         .xform    = numbered(0),
+         .material = {0},
+         .flags    = ONYX_PRIM_INVISIBLE_BIT},
+        {.geo = &geos[0], .xform = numbered(16), .material = {0}},
+        {.geo = &defaultGeo, .xform = numbered(32), .material = {0}},
+    };
+    const Onyx_Light lights[1] = {{
+        .structure.pointLight.pos = {{1, 2, 3}},
+        .intensity                = 5,
+        .color                    = {{1, 0.5, 0.25}},
+        .type                     = ONYX_LIGHT_POINT_TYPE,
+    }};
+    const Onyx_Material materials[1] = {{
+        .color            = {{0.1, 0.2, 0.3}},
+        .roughness        = 0.7,
+        .textureAlbedo    = {0},
+        .textureRoughness = {2},
+        .textureNormal    = {0},
+    }};
+    const Onyx_Texture textures[2] = {{.devImage = &image},
+                                      {.devImage = &defaultImage}};
+    const Onyx_SceneFileObjects objects = {
+        .ids = {
+            [ONYX_SCENE_OBJECT_PRIM]     = {3, primIds, 1, freePrimIds},
+            [ONYX_SCENE_OBJECT_LIGHT]    = {1, lightIds, 0, NULL},
+            [ONYX_SCENE_OBJECT_MATERIAL] = {1, materialIds, 0, NULL},
+            [ONYX_SCENE_OBJECT_TEXTURE]  = {2, textureIds, 1, freeTextureIds},
+        },
+        .prims        = prims,
+        .lights       = lights,
+        .materials    = materials,
+        .textures     = textures,
+        .cameraXform  = numbered(48),
+        .cameraProj   = numbered(64),
+        .defaultGeo   = &defaultGeo,
+        .defaultImage = &defaultImage,
+    };
+    const Onyx_Geometry* refGeos[2]     = {&geos[0], &geos[1]};
+    const char*          refGeoPaths[2] = {"a.geo", "b.geo"};
+    const Onyx_Image*    refImages[1]   = {&image};
+    const char*          refImagePaths[1] = {"a.png"};
+    const Onyx_WriteSceneParms parms = {
+        .geoRefCount   = 2,
+        .refGeos       = refGeos,
+        .refGeoPaths   = refGeoPaths,
+        .imageRefCount = 1,
+        .refImages     = refImages,
+        .refImagePaths = refImagePaths,
+    };
+    bool ok = onyx_WriteSceneFileObjects(NULL, &objects, PATH, &parms);
+    assert(ok);
+
+    Onyx_SceneFileObjects read;
+    ok = onyx_ReadSceneFileObjects(PATH, &read);
+    assert(ok);
+    for (int t = 0; t < ONYX_SCENE_OBJECT_TYPE_COUNT; t++)
+        assert(sameIds(&objects.ids[t], &read.ids[t]));
+    // geos and images are numbered in order of first use
+    assert(read.geoCount == 2 && read.imageCount == 1);
+    assert(read.prims[0].geo == &read.geos[0]);
+    assert(read.prims[1].geo == &read.geos[1]);
+    assert(read.prims[2].geo == read.defaultGeo);
+    for (int i = 0; i < 3; i++)
+        assert(sameMat4(&prims[i].xform, &read.prims[i].xform) &&
+               read.prims[i].material.id == prims[i].material.id &&
+               read.prims[i].flags == prims[i].flags);
+    assert(read.lights[0].type == lights[0].type &&
+           read.lights[0].intensity == lights[0].intensity &&
+           memcmp(&read.lights[0].color, &lights[0].color, sizeof(Coal_Vec3)) == 0 &&
+           memcmp(&read.lights[0].structure.pointLight.pos,
+                  &lights[0].structure.pointLight.pos, sizeof(Coal_Vec3)) == 0);
+    assert(memcmp(&read.materials[0].color, &materials[0].color, sizeof(Coal_Vec3)) == 0 &&
+           read.materials[0].roughness == materials[0].roughness &&
+           read.materials[0].textureAlbedo.id == 0 &&
+           read.materials[0].textureRoughness.id == 2 &&
+           read.materials[0].textureNormal.id == 0);
+    assert(read.textures[0].devImage == &read.images[0]);
+    assert(read.textures[1].devImage == read.defaultImage);
+    assert(sameMat4(&read.cameraXform, &objects.cameraXform) &&
+           sameMat4(&read.cameraProj, &objects.cameraProj));
+    onyx_FreeSceneFileObjects(&read);
+
+    // a flipped byte in the prims fails the section's CRC
+    FILE* f = fopen(PATH, "rb");
+    assert(f);
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    uint8_t*   data = malloc(size);
+    fseek(f, 0, SEEK_SET);
+    ok = fread(data, size, 1, f) == 1;
+    assert(ok);
+    fclose(f);
+    uint64_t primOffset;
+    memcpy(&primOffset, data + PRIM_SECTION_OFFSET, sizeof(primOffset));
+    data[primOffset + 8] ^= 1;
+    f = fopen(BAD_PATH, "wb");
+    assert(f);
+    ok = fwrite(data, size, 1, f) == 1;
+    assert(ok);
+    fclose(f);
+    free(data);
+    assert(!readsBack(BAD_PATH));
+
+    // material 1 is past the live materials
+    prims[0].material.id = 1;
+    ok = onyx_WriteSceneFileObjects(NULL, &objects, BAD_PATH, &parms);
+    assert(ok);
+    assert(!readsBack(BAD_PATH));
+
+    remove(PATH);
+    remove(BAD_PATH);
+    printf("ok\n");
+    return 0;
+}
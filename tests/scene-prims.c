@@ -48,6 +48,23 @@ int main(int argc, char *argv[])
     assert(tri.vertexCount == 3);
     assert(tri.indexCount  == 3);
 
+    // repeated geos should not be rebound
+    Onyx_Command cmd = onyx_CreateCommand(instance, ONYX_V_QUEUE_GRAPHICS_TYPE);
+    onyx_BeginCommandBuffer(cmd.buffer);
+    Onyx_GeoBindState bindState;
+    onyx_InitGeoBindState(&bindState, cmd.buffer);
+    const Onyx_Geometry* order[] = {&cube, &cube, &cube, &tri, &tri, &cube};
+    for (int i = 0; i < LEN(order); i++)
+        onyx_BindGeoCached(&bindState, order[i]);
+    onyx_EndCommandBuffer(cmd.buffer);
+    onyx_DestroyCommand(cmd);
+    hell_Print("vertex binds %d skipped %d, index binds %d skipped %d\n",
+               bindState.vertexBindCount, bindState.vertexBindSkipCount,
+               bindState.indexBindCount, bindState.indexBindSkipCount);
+    assert(bindState.vertexBindSkipCount >= 3);
+    assert(bindState.vertexBindCount + bindState.vertexBindSkipCount == LEN(order));
+    assert(bindState.indexBindCount + bindState.indexBindSkipCount == LEN(order));
+
 
     return 0;
 }
@@ -0,0 +1,107 @@
+#include "test.h"
+
+// Checks that threaded tangent generation gives exactly the same result as a
+// single threaded mikktspace run and times both. The mesh is a wavy grid cut
+// into uv islands, about 90K triangles by default. Pass a larger triangle
+// count as the first argument for timings that mean something.
+
+#define ISLANDS_PER_SIDE 16
+
+int main(int argc, char *argv[])
+{
+    uint32_t targetTris = argc > 1 ? atoi(argv[1]) : 100000;
+    // quads per island side
+    uint32_t n = (uint32_t)sqrt(targetTris / 2.0) / ISLANDS_PER_SIDE;
+    if (n < 1)
+        n = 1;
+    const uint32_t side        = n * ISLANDS_PER_SIDE;
+    const uint32_t islandVerts = (n + 1) * (n + 1);
+    const uint32_t vertexCount = islandVerts * ISLANDS_PER_SIDE * ISLANDS_PER_SIDE;
+    const uint32_t indexCount  = side * side * 6;
+
+    float*    positions = hell_Malloc(vertexCount * 3 * sizeof(float));
+    float*    normals   = hell_Malloc(vertexCount * 3 * sizeof(float));
+    float*    uvs       = hell_Malloc(vertexCount * 2 * sizeof(float));
+    uint32_t* indices   = hell_Malloc(indexCount * sizeof(uint32_t));
+
+    uint32_t v = 0, i = 0;
+    for (uint32_t iy = 0; iy < ISLANDS_PER_SIDE; iy++)
+        for (uint32_t ix = 0; ix < ISLANDS_PER_SIDE; ix++)
+        {
+            const uint32_t base = v;
+            for (uint32_t y = 0; y <= n; y++)
+                for (uint32_t x = 0; x <= n; x++, v++)
+                {
+                    waveVertex((float)(ix * n + x) / side,
+                               (float)(iy * n + y) / side, positions + v * 3,
+                               normals + v * 3);
+                    uvs[v * 2 + 0] = (float)x / n;
+                    uvs[v * 2 + 1] = (float)y / n;
+                }
+            for (uint32_t y = 0; y < n; y++)
+                for (uint32_t x = 0; x < n; x++)
+                {
+                    uint32_t a = base + y * (n + 1) + x;
+                    uint32_t b = a + 1;
+                    uint32_t c = a + n + 1;
+                    uint32_t d = c + 1;
+                    indices[i++] = a;
+                    indices[i++] = c;
+                    indices[i++] = b;
+                    indices[i++] = b;
+                    indices[i++] = c;
+                    indices[i++] = d;
+                }
+        }
+
+    float* serialTangents   = hell_Malloc(vertexCount * 3 * sizeof(float));
+    float* serialSigns      = hell_Malloc(vertexCount * sizeof(float));
+    float* parallelTangents = hell_Malloc(vertexCount * 3 * sizeof(float));
+    float* parallelSigns    = hell_Malloc(vertexCount * sizeof(float));
+    memset(serialTangents, 0, vertexCount * 3 * sizeof(float));
+    memset(serialSigns, 0, vertexCount * sizeof(float));
+    memset(parallelTangents, 0, vertexCount * 3 * sizeof(float));
+    memset(parallelSigns, 0, vertexCount * sizeof(float));
+
+    Onyx_TangentSpaceInfo info = {
+        .vertexCount = vertexCount,
+        .indexCount  = indexCount,
+        .indices     = indices,
+        .positions   = positions,
+        .normals     = normals,
+        .uvs         = uvs,
+        .tangents    = serialTangents,
+        .signs       = serialSigns,
+        .threadCount = 1,
+    };
+
+    double t0 = now();
+    bool   r  = onyx_GenerateTangents(&info);
+    assert(r);
+    double t1 = now();
+
+    info.tangents    = parallelTangents;
+    info.signs       = parallelSigns;
+    info.threadCount = 0;
+    r = onyx_GenerateTangents(&info);
+    assert(r);
+    double t2 = now();
+
+    printf("%d triangles: 1 thread %.3fs, %d threads %.3fs\n", indexCount / 3,
+           t1 - t0, onyx_GetHardwareThreadCount(), t2 - t1);
+
+    assert(memcmp(serialTangents, parallelTangents,
+                  vertexCount * 3 * sizeof(float)) == 0);
+    assert(memcmp(serialSigns, parallelSigns, vertexCount * sizeof(float)) == 0);
+
+    hell_Free(positions);
+    hell_Free(normals);
+    hell_Free(uvs);
+    hell_Free(indices);
+    hell_Free(serialTangents);
+    hell_Free(serialSigns);
+    hell_Free(parallelTangents);
+    hell_Free(parallelSigns);
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef ONYX_TEST_H
+#define ONYX_TEST_H
+
+// What the tests that need no device share: the usual includes, a timer and
+// the wavy grid the mesh tests build their geometry from.
+
+#include <hell/common.h>
+#include <onyx/onyx.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static inline double
+now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// the point of the height field over (px, pz) and its analytic normal
+static inline void
+waveVertex(float px, float pz, float pos[3], float nrm[3])
+{
+    const float dx = cosf(px * 20.f) * cosf(pz * 20.f);
+    const float dz = -sinf(px * 20.f) * sinf(pz * 20.f);
+    const float l  = sqrtf(dx * dx + 1.f + dz * dz);
+    pos[0] = px;
+    pos[1] = 0.05f * sinf(px * 20.f) * cosf(pz * 20.f);
+    pos[2] = pz;
+    nrm[0] = -dx / l;
+    nrm[1] = 1.f / l;
+    nrm[2] = -dz / l;
+}
+
+// Fills n * n quads over the unit square, (n + 1)^2 vertices row by row and
+// two triangles per quad. The uvs are the grid position.
+static inline void
+fillWaveGrid(uint32_t n, float* pos, float* nrm, float* uv, uint32_t* indices)
+{
+    for (uint32_t y = 0, v = 0; y <= n; y++)
+        for (uint32_t x = 0; x <= n; x++, v++)
+        {
+            const float px = (float)x / n, pz = (float)y / n;
+            waveVertex(px, pz, pos + v * 3, nrm + v * 3);
+            uv[v * 2 + 0] = px;
+            uv[v * 2 + 1] = pz;
+        }
+    for (uint32_t y = 0, i = 0; y < n; y++)
+        for (uint32_t x = 0; x < n; x++, i += 6)
+        {
+            const uint32_t a = y * (n + 1) + x;
+            const uint32_t c = a + n + 1;
+            const uint32_t quad[6] = {a, c, a + 1, a + 1, c, c + 1};
+            memcpy(indices + i, quad, sizeof(quad));
+        }
+}
+
+#endif /* end of include guard: ONYX_TEST_H */
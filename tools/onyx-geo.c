@@ -0,0 +1,657 @@
+#include "tool.h"
+#include <hell/common.h>
+#include <hell/len.h>
+#include <onyx/file.h>
+#include <onyx/meshproc.h>
+#include <onyx/parallel.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Inspects, validates, converts, optimizes and benchmarks geo files. Needs no
+// window or device, so it can run in asset pipelines.
+
+#define MAX_QUANTIZE 8
+
+static const char* g_usage =
+    "usage: onyx-geo <command> [options] file...\n"
+    "\n"
+    "  info FILE...          counts, attributes, index statistics, lods and bounds\n"
+    "  validate FILE...      checks every file, exits with 1 if any is broken\n"
+    "  convert IN OUT        rewrites IN with the write options\n"
+    "  optimize IN OUT       runs the optimizations, then writes OUT\n"
+    "  bench FILE...         load throughput of the ways a geo can be read\n"
+    "\n"
+    "write options\n"
+    "  --version 1|2         file version, default 2\n"
+    "  --attr-codec C        none, lz or vertex, default none\n"
+    "  --index-codec C       none, lz or index, default none\n"
+    "  --drop NAME           leave out an attribute, may be repeated\n"
+    "\n"
+    "optimize options, run in this order\n"
+    "  --weld EPSILON        merge equal vertices, 0 compares exactly\n"
+    "  --lods N              build a chain of N levels of detail\n"
+    "  --cache               reorder triangles and vertices for the gpu caches\n"
+    "  --quantize [NAME=]B   round floats to B mantissa bits, may be repeated\n"
+    "\n"
+    "bench options\n"
+    "  --iterations N        runs per way, the best is reported, default 5\n"
+    "  --threads N           threads for batched reads, default all\n";
+
+typedef struct {
+    Onyx_WriteGeoParms write;
+    uint32_t           dropCount;
+    const char*        drops[ONYX_R_MAX_VERT_ATTRIBUTES];
+    bool               weld;
+    float              weldEpsilon;
+    uint32_t           lodCount;
+    bool               cache;
+    uint32_t           quantizeCount;
+    const char*        quantizeNames[MAX_QUANTIZE];
+    uint32_t           quantizeBits[MAX_QUANTIZE];
+    uint32_t           iterations;
+    uint32_t           threadCount;
+    Tool_Files         files;
+} Options;
+
+static long
+fileSize(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+static int
+fileVersion(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return 0;
+    char magic[4] = {0};
+    size_t r = fread(magic, 4, 1, f);
+    fclose(f);
+    return r == 1 && memcmp(magic, "OGEO", 4) == 0 ? 2 : 1;
+}
+
+static bool
+parseCodec(const char* s, Onyx_GeoCodec special, Onyx_GeoCodec* codec)
+{
+    if (strcmp(s, "none") == 0)
+        *codec = ONYX_GEO_CODEC_NONE;
+    else if (strcmp(s, "lz") == 0)
+        *codec = ONYX_GEO_CODEC_LZ;
+    else if ((strcmp(s, "vertex") == 0 && special == ONYX_GEO_CODEC_VERTEX) ||
+             (strcmp(s, "index") == 0 && special == ONYX_GEO_CODEC_INDEX))
+        *codec = special;
+    else
+        return false;
+    return true;
+}
+
+static int
+parseOption(void* options, const char* a, char* next, bool* tookValue)
+{
+    Options* o = options;
+    if (strcmp(a, "--cache") == 0)
+    {
+        o->cache = true;
+        return 0;
+    }
+    if (!next)
+        return tool_Fail("%s needs a value", a);
+    *tookValue = true;
+    if (strcmp(a, "--version") == 0)
+    {
+        o->write.version = atoi(next);
+        if (o->write.version != ONYX_GEO_FILE_VERSION_1 &&
+            o->write.version != ONYX_GEO_FILE_VERSION_2)
+            return tool_Fail("unknown version %s", next);
+    }
+    else if (strcmp(a, "--attr-codec") == 0)
+    {
+        if (!parseCodec(next, ONYX_GEO_CODEC_VERTEX, &o->write.attributeCodec))
+            return tool_Fail("unknown attribute codec %s", next);
+    }
+    else if (strcmp(a, "--index-codec") == 0)
+    {
+        if (!parseCodec(next, ONYX_GEO_CODEC_INDEX, &o->write.indexCodec))
+            return tool_Fail("unknown index codec %s", next);
+    }
+    else if (strcmp(a, "--drop") == 0)
+    {
+        if (o->dropCount == ONYX_R_MAX_VERT_ATTRIBUTES)
+            return tool_Fail("too many attributes to drop at %s", next);
+        o->drops[o->dropCount++] = next;
+    }
+    else if (strcmp(a, "--weld") == 0)
+    {
+        o->weld        = true;
+        o->weldEpsilon = strtof(next, NULL);
+    }
+    else if (strcmp(a, "--lods") == 0)
+    {
+        o->lodCount = atoi(next);
+        if (o->lodCount < 2 || o->lodCount > ONYX_R_MAX_LODS)
+            return tool_Fail("the lod count %s must be from 2 to 8", next);
+    }
+    else if (strcmp(a, "--quantize") == 0)
+    {
+        if (o->quantizeCount == MAX_QUANTIZE)
+            return tool_Fail("too many --quantize at %s", next);
+        char* eq = strchr(next, '=');
+        if (eq)
+        {
+            // the value is in argv, the name ends at the '='
+            *eq = '\0';
+            o->quantizeNames[o->quantizeCount] = next;
+        }
+        o->quantizeBits[o->quantizeCount++] = atoi(eq ? eq + 1 : next);
+    }
+    else if (strcmp(a, "--iterations") == 0)
+        o->iterations = atoi(next) > 0 ? atoi(next) : 1;
+    else if (strcmp(a, "--threads") == 0)
+        o->threadCount = atoi(next);
+    else
+        return tool_Fail("unknown option %s", a);
+    return 0;
+}
+
+static int
+findAttribute(const Onyx_FileGeo* geo, const char* name)
+{
+    for (uint32_t a = 0; a < geo->attrCount; a++)
+        if (strncmp(geo->attrNames[a], name, ONYX_R_ATTR_NAME_LEN) == 0)
+            return a;
+    return -1;
+}
+
+static bool
+isFloatAttribute(const Onyx_FileGeo* geo, uint32_t a)
+{
+    // the file doesn't say, everything onyx writes is floats
+    return geo->attrSizes[a] % sizeof(float) == 0;
+}
+
+// INFO
+
+static void
+printInfo(const char* path, const Onyx_FileGeo* geo)
+{
+    const uint32_t total =
+        onyx_GetTotalIndexCount(geo->indexCount, geo->lodCount, geo->lods);
+    size_t rawSize = (size_t)total * sizeof(uint32_t);
+    for (uint32_t a = 0; a < geo->attrCount; a++)
+        rawSize += (size_t)geo->vertexCount * geo->attrSizes[a];
+    const long size = fileSize(path);
+    printf("%s\n", path);
+    printf("  version     %d\n", fileVersion(path));
+    printf("  file size   %ld bytes, %.1f%% of the raw %zu\n", size,
+           rawSize ? 100.0 * size / rawSize : 0.0, rawSize);
+    printf("  vertices    %u\n", geo->vertexCount);
+    printf("  indices     %u, %u triangles\n", geo->indexCount,
+           geo->indexCount / 3);
+
+    printf("  attributes  %u\n", geo->attrCount);
+    for (uint32_t a = 0; a < geo->attrCount; a++)
+    {
+        printf("    %-8.*s %3u bytes", ONYX_R_ATTR_NAME_LEN, geo->attrNames[a],
+               geo->attrSizes[a]);
+        const uint32_t dim = geo->attrSizes[a] / sizeof(float);
+        if (isFloatAttribute(geo, a) && dim <= 4 && geo->vertexCount)
+        {
+            float        lo[4], hi[4];
+            const float* v = geo->attributes[a];
+            for (uint32_t k = 0; k < dim; k++)
+                lo[k] = hi[k] = v[k];
+            for (size_t i = 0; i < (size_t)geo->vertexCount * dim; i++)
+            {
+                const uint32_t k = i % dim;
+                lo[k]            = v[i] < lo[k] ? v[i] : lo[k];
+                hi[k]            = v[i] > hi[k] ? v[i] : hi[k];
+            }
+            printf("  min");
+            for (uint32_t k = 0; k < dim; k++)
+                printf(" %g", lo[k]);
+            printf("  max");
+            for (uint32_t k = 0; k < dim; k++)
+                printf(" %g", hi[k]);
+        }
+        printf("\n");
+    }
+
+    if (geo->indexCount)
+    {
+        bool*    used       = hell_Malloc(geo->vertexCount + 1);
+        uint32_t outOfRange = 0, degenerate = 0, unused = 0, maxIndex = 0;
+        memset(used, 0, geo->vertexCount + 1);
+        for (uint32_t i = 0; i < total; i++)
+        {
+            const uint32_t v = geo->indices[i];
+            maxIndex         = v > maxIndex ? v : maxIndex;
+            if (v < geo->vertexCount)
+                used[v] = true;
+            else
+                outOfRange++;
+        }
+        for (uint32_t t = 0; t + 2 < geo->indexCount; t += 3)
+        {
+            const uint32_t* tri = geo->indices + t;
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+                degenerate++;
+        }
+        for (uint32_t v = 0; v < geo->vertexCount; v++)
+            unused += !used[v];
+        hell_Free(used);
+        printf("  index stats max %u, %u out of range, %u degenerate "
+               "triangles, %u unused vertices\n",
+               maxIndex, outOfRange, degenerate, unused);
+        if (outOfRange == 0)
+            printf("  cache acmr  %.3f (16 entries) %.3f (32 entries)\n",
+                   onyx_GetVertexCacheAcmr(geo->indices, geo->indexCount,
+                                           geo->vertexCount, 16),
+                   onyx_GetVertexCacheAcmr(geo->indices, geo->indexCount,
+                                           geo->vertexCount, 32));
+    }
+
+    if (geo->lodCount)
+    {
+        printf("  lods        %u\n", geo->lodCount);
+        for (uint32_t l = 0; l < geo->lodCount; l++)
+            printf("    %u  first %u  triangles %u  error %g\n", l,
+                   geo->lods[l].firstIndex, geo->lods[l].indexCount / 3,
+                   geo->lods[l].error);
+    }
+    const Onyx_GeoBounds* b = &geo->bounds;
+    if (geo->boundsValid)
+        printf("  bounds      min %g %g %g  max %g %g %g  radius %g\n",
+               b->min[0], b->min[1], b->min[2], b->max[0], b->max[1],
+               b->max[2], b->radius);
+    else
+        printf("  bounds      none stored\n");
+}
+
+static int
+info(const void* options)
+{
+    const Options* o = options;
+    int status = 0;
+    for (uint32_t f = 0; f < o->files.count; f++)
+    {
+        Onyx_FileGeo geo;
+        if (!onyx_ReadFileGeo(o->files.names[f], &geo))
+        {
+            status = tool_Fail("can't read %s", o->files.names[f]);
+            continue;
+        }
+        printInfo(o->files.names[f], &geo);
+        onyx_FreeFileGeo(&geo);
+    }
+    return status;
+}
+
+// VALIDATE
+
+#define PROBLEM(...)                                                           \
+    do {                                                                       \
+        printf("%s: ", path);                                                  \
+        printf(__VA_ARGS__);                                                   \
+        printf("\n");                                                          \
+        problems++;                                                            \
+    } while (0)
+
+static uint32_t
+validateGeo(const char* path, Onyx_FileGeo* geo)
+{
+    uint32_t problems = 0;
+    for (uint32_t a = 0; a < geo->attrCount; a++)
+    {
+        if (memchr(geo->attrNames[a], '\0', ONYX_R_ATTR_NAME_LEN) == NULL)
+            PROBLEM("attribute %u has an unterminated name", a);
+        else if (findAttribute(geo, geo->attrNames[a]) != (int)a)
+            PROBLEM("attribute name %s is used twice", geo->attrNames[a]);
+        if (geo->attrSizes[a] == 0)
+            PROBLEM("attribute %u has size 0", a);
+        if (!isFloatAttribute(geo, a))
+            continue;
+        const float* v     = geo->attributes[a];
+        const size_t count = (size_t)geo->vertexCount * geo->attrSizes[a] / 4;
+        size_t       bad   = 0;
+        for (size_t i = 0; i < count; i++)
+            bad += !isfinite(v[i]);
+        if (bad)
+            PROBLEM("attribute %.*s has %zu values that are not finite",
+                    ONYX_R_ATTR_NAME_LEN, geo->attrNames[a], bad);
+    }
+
+    if (geo->indexCount % 3)
+        PROBLEM("index count %u is not a multiple of 3", geo->indexCount);
+    if (geo->lodCount == 1 || geo->lodCount > ONYX_R_MAX_LODS)
+        PROBLEM("lod count %u", geo->lodCount);
+    else if (geo->lodCount)
+    {
+        if (geo->lods[0].firstIndex != 0 ||
+            geo->lods[0].indexCount != geo->indexCount)
+            PROBLEM("lod 0 isn't the full index range");
+        for (uint32_t l = 1; l < geo->lodCount; l++)
+        {
+            const Onyx_GeoLod* prev = &geo->lods[l - 1];
+            if (geo->lods[l].firstIndex != prev->firstIndex + prev->indexCount)
+                PROBLEM("lod %u doesn't follow lod %u", l, l - 1);
+            if (geo->lods[l].indexCount % 3)
+                PROBLEM("lod %u index count is not a multiple of 3", l);
+        }
+    }
+    const uint32_t total =
+        onyx_GetTotalIndexCount(geo->indexCount, geo->lodCount, geo->lods);
+    uint32_t outOfRange = 0;
+    for (uint32_t i = 0; i < total; i++)
+        outOfRange += geo->indices[i] >= geo->vertexCount;
+    if (outOfRange)
+        PROBLEM("%u indices are out of range", outOfRange);
+
+    if (geo->boundsValid)
+    {
+        const Onyx_GeoBounds stored = geo->bounds;
+        if (onyx_UpdateFileGeoBounds(geo))
+        {
+            // the stored box may be looser but must hold every position
+            const float eps = 1e-5f * (1.f + stored.radius);
+            for (int k = 0; k < 3; k++)
+                if (geo->bounds.min[k] < stored.min[k] - eps ||
+                    geo->bounds.max[k] > stored.max[k] + eps)
+                {
+                    PROBLEM("stored bounds don't hold every position");
+                    break;
+                }
+        }
+    }
+    return problems;
+}
+
+#undef PROBLEM
+
+static int
+validate(const void* options)
+{
+    const Options* o = options;
+    uint32_t broken = 0;
+    for (uint32_t f = 0; f < o->files.count; f++)
+    {
+        Onyx_FileGeo geo;
+        if (!onyx_ReadFileGeo(o->files.names[f], &geo))
+        {
+            printf("%s: can't be read, is truncated or fails its checksums\n",
+                   o->files.names[f]);
+            broken++;
+            continue;
+        }
+        const uint32_t problems = validateGeo(o->files.names[f], &geo);
+        if (problems == 0)
+            printf("%s: ok\n", o->files.names[f]);
+        broken += problems > 0;
+        onyx_FreeFileGeo(&geo);
+    }
+    if (o->files.count > 1)
+        printf("%u of %u files broken\n", broken, o->files.count);
+    return broken ? 1 : 0;
+}
+
+// CONVERT AND OPTIMIZE
+
+static void
+dropAttributes(const Options* o, Onyx_FileGeo* geo)
+{
+    Onyx_GeoAttributeSize sizes[ONYX_R_MAX_VERT_ATTRIBUTES];
+    char     names[ONYX_R_MAX_VERT_ATTRIBUTES][ONYX_R_ATTR_NAME_LEN];
+    uint32_t kept[ONYX_R_MAX_VERT_ATTRIBUTES];
+    uint32_t count = 0;
+    for (uint32_t a = 0; a < geo->attrCount; a++)
+    {
+        bool drop = false;
+        for (uint32_t d = 0; d < o->dropCount; d++)
+            drop |= strncmp(geo->attrNames[a], o->drops[d],
+                            ONYX_R_ATTR_NAME_LEN) == 0;
+        if (drop)
+            continue;
+        sizes[count] = geo->attrSizes[a];
+        memcpy(names[count], geo->attrNames[a], ONYX_R_ATTR_NAME_LEN);
+        kept[count++] = a;
+    }
+    if (count == geo->attrCount)
+        return;
+    const uint32_t total =
+        onyx_GetTotalIndexCount(geo->indexCount, geo->lodCount, geo->lods);
+    Onyx_FileGeo out =
+        onyx_CreateFileGeo(geo->vertexCount, total, count, sizes, names);
+    for (uint32_t a = 0; a < count; a++)
+        memcpy(out.attributes[a], geo->attributes[kept[a]],
+               (size_t)geo->vertexCount * sizes[a]);
+    memcpy(out.indices, geo->indices, (size_t)total * sizeof(uint32_t));
+    out.indexCount  = geo->indexCount;
+    out.lodCount    = geo->lodCount;
+    memcpy(out.lods, geo->lods, sizeof(out.lods));
+    out.bounds      = geo->bounds;
+    out.boundsValid = geo->boundsValid;
+    onyx_FreeFileGeo(geo);
+    *geo = out;
+}
+
+static int
+optimize(const Options* o, Onyx_FileGeo* geo)
+{
+    if (o->weld)
+    {
+        const uint32_t before = geo->vertexCount;
+        onyx_WeldFileGeo(geo, o->weldEpsilon, o->threadCount);
+        printf("weld      %u -> %u vertices\n", before, geo->vertexCount);
+    }
+    if (o->lodCount)
+    {
+        const uint32_t count = onyx_GenerateFileGeoLods(geo, o->lodCount, 0.5f, 0);
+        printf("lods      %u levels\n", count);
+    }
+    if (o->cache && geo->indexCount)
+    {
+        const float before = onyx_GetVertexCacheAcmr(
+            geo->indices, geo->indexCount, geo->vertexCount, 32);
+        onyx_OptimizeFileGeo(geo);
+        printf("cache     acmr %.3f -> %.3f\n", before,
+               onyx_GetVertexCacheAcmr(geo->indices, geo->indexCount,
+                                       geo->vertexCount, 32));
+    }
+    for (uint32_t q = 0; q < o->quantizeCount; q++)
+    {
+        if (!onyx_QuantizeFileGeo(geo, o->quantizeNames[q], o->quantizeBits[q]))
+            return tool_Fail("no float attribute %s to quantize",
+                             o->quantizeNames[q] ? o->quantizeNames[q] : "");
+        printf("quantize  %s to %u bits\n",
+               o->quantizeNames[q] ? o->quantizeNames[q] : "all",
+               o->quantizeBits[q]);
+    }
+    return 0;
+}
+
+static int
+convert(const Options* o, bool optimizing)
+{
+    if (o->files.count != 2)
+        return tool_Fail("%s takes an input and an output file",
+                         optimizing ? "optimize" : "convert");
+    const char*  in  = o->files.names[0];
+    const char*  out = o->files.names[1];
+    Onyx_FileGeo geo;
+    if (!onyx_ReadFileGeo(in, &geo))
+        return tool_Fail("can't read %s", in);
+    for (uint32_t d = 0; d < o->dropCount; d++)
+        if (findAttribute(&geo, o->drops[d]) < 0)
+            fprintf(stderr, "onyx-geo: %s has no attribute %s\n", in,
+                    o->drops[d]);
+    dropAttributes(o, &geo);
+    int status = optimizing ? optimize(o, &geo) : 0;
+    if (status == 0)
+    {
+        if (!geo.boundsValid)
+            onyx_UpdateFileGeoBounds(&geo);
+        if (onyx_WriteFileGeoEx(out, &geo, &o->write))
+            printf("%s: %ld -> %ld bytes\n", out, fileSize(in), fileSize(out));
+        else
+            status = tool_Fail("can't write %s", out);
+    }
+    onyx_FreeFileGeo(&geo);
+    return status;
+}
+
+// BENCH
+
+typedef enum {
+    BENCH_READ,
+    BENCH_ARENA,
+    BENCH_MAP,
+    BENCH_BATCH,
+    BENCH_WAY_COUNT
+} BenchWay;
+
+static const char* g_wayNames[BENCH_WAY_COUNT] = {
+    "read", "arena", "map", "batch"};
+
+// every vertex and index is touched so lazily mapped pages are counted
+static uint32_t
+touch(const Onyx_FileGeo* geo)
+{
+    uint32_t sum = 0;
+    for (uint32_t a = 0; a < geo->attrCount; a++)
+    {
+        const uint8_t* p    = geo->attributes[a];
+        const size_t   size = (size_t)geo->vertexCount * geo->attrSizes[a];
+        for (size_t i = 0; i < size; i += 64)
+            sum += p[i];
+    }
+    const uint32_t total =
+        onyx_GetTotalIndexCount(geo->indexCount, geo->lodCount, geo->lods);
+    for (uint32_t i = 0; i < total; i += 16)
+        sum += geo->indices[i];
+    return sum;
+}
+
+static bool
+benchOnce(const Options* o, BenchWay way, Onyx_FileGeoArena* arena,
+          Onyx_FileGeo* geos, uint32_t* sum)
+{
+    bool ok = true;
+    if (way == BENCH_BATCH)
+        ok = onyx_ReadFileGeos(o->files.count, o->files.names, o->threadCount,
+                               geos);
+    else
+    {
+        onyx_ResetFileGeoArena(arena);
+        for (uint32_t f = 0; f < o->files.count && ok; f++)
+        {
+            if (way == BENCH_READ)
+                ok = onyx_ReadFileGeo(o->files.names[f], &geos[f]);
+            else if (way == BENCH_ARENA)
+                ok = onyx_ReadFileGeoInArena(o->files.names[f], arena, &geos[f]);
+            else
+                ok = onyx_MapFileGeo(o->files.names[f], &geos[f]);
+            if (!ok)
+                while (f--)
+                    onyx_FreeFileGeo(&geos[f]);
+        }
+    }
+    if (!ok)
+        return false;
+    for (uint32_t f = 0; f < o->files.count; f++)
+    {
+        *sum += touch(&geos[f]);
+        onyx_FreeFileGeo(&geos[f]);
+    }
+    return true;
+}
+
+static int
+bench(const void* options)
+{
+    const Options* o = options;
+    if (o->files.count == 0)
+        return tool_Fail("bench needs files");
+    Onyx_FileGeo* geos  = hell_Malloc(o->files.count * sizeof(Onyx_FileGeo));
+    size_t        bytes = 0, arenaSize = 0;
+    for (uint32_t f = 0; f < o->files.count; f++)
+    {
+        if (!onyx_ReadFileGeo(o->files.names[f], &geos[0]))
+        {
+            hell_Free(geos);
+            return tool_Fail("can't read %s", o->files.names[f]);
+        }
+        const uint32_t total = onyx_GetTotalIndexCount(
+            geos[0].indexCount, geos[0].lodCount, geos[0].lods);
+        arenaSize += onyx_GetFileGeoBlockSize(geos[0].vertexCount, total,
+                                              geos[0].attrCount,
+                                              geos[0].attrSizes);
+        bytes += fileSize(o->files.names[f]);
+        onyx_FreeFileGeo(&geos[0]);
+    }
+    Onyx_FileGeoArena arena = onyx_CreateFileGeoArena(arenaSize);
+    printf("%u files, %.1f MB, %u threads, best of %u\n", o->files.count,
+           bytes / 1e6,
+           o->threadCount ? o->threadCount : onyx_GetHardwareThreadCount(),
+           o->iterations);
+    uint32_t sum    = 0;
+    int      status = 0;
+    for (BenchWay way = 0; way < BENCH_WAY_COUNT && status == 0; way++)
+    {
+        double best = INFINITY;
+        for (uint32_t i = 0; i < o->iterations && status == 0; i++)
+        {
+            const double t = tool_Now();
+            if (!benchOnce(o, way, &arena, geos, &sum))
+                status = tool_Fail("%s failed", g_wayNames[way]);
+            const double elapsed = tool_Now() - t;
+            best = elapsed < best ? elapsed : best;
+        }
+        if (status == 0)
+            printf("  %-6s %8.2f ms %10.1f MB/s\n", g_wayNames[way],
+                   best * 1e3, bytes / best / 1e6);
+    }
+    // keeps the reads from being optimized away
+    if (sum == 1)
+        printf("\n");
+    onyx_FreeFileGeoArena(&arena);
+    hell_Free(geos);
+    return status;
+}
+
+static int
+convertCommand(const void* options)
+{
+    return convert(options, false);
+}
+
+static int
+optimizeCommand(const void* options)
+{
+    return convert(options, true);
+}
+
+static const Tool_Command g_commands[] = {
+    {"info", info},
+    {"validate", validate},
+    {"convert", convertCommand},
+    {"optimize", optimizeCommand},
+    {"bench", bench},
+};
+
+int
+main(int argc, char* argv[])
+{
+    const Tool tool = {"onyx-geo", g_usage, parseOption, LEN(g_commands),
+                       g_commands};
+    Options    o    = {.write      = {.version = ONYX_GEO_FILE_VERSION_2},
+                       .iterations = 5};
+    return tool_Main(&tool, argc, argv, &o, &o.files);
+}
@@ -0,0 +1,161 @@
+#include "tool.h"
+#include <hell/common.h>
+#include <hell/len.h>
+#include <onyx/texfile.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Inspects texture files and compresses images to KTX2 with a full mip
+// chain.
+
+static const char* g_usage =
+    "usage: onyx-tex <command> [options] file...\n"
+    "\n"
+    "  info FILE...          format, size and levels of KTX2 and DDS files\n"
+    "  convert IN OUT        compresses the image IN, or rewrites the KTX2\n"
+    "                        or DDS IN, to the KTX2 file OUT\n"
+    "\n"
+    "convert options\n"
+    "  --format F            bc1, bc7 or rgba8, default bc7\n"
+    "  --srgb                the texels are sRGB encoded colors\n"
+    "  --no-mips             only write the first level\n";
+
+typedef struct {
+    const char* formatName;
+    bool        srgb;
+    bool        mips;
+    Tool_Files  files;
+} Options;
+
+static int
+parseOption(void* options, const char* a, char* next, bool* tookValue)
+{
+    Options* o = options;
+    if (strcmp(a, "--srgb") == 0)
+        o->srgb = true;
+    else if (strcmp(a, "--no-mips") == 0)
+        o->mips = false;
+    else if (strcmp(a, "--format") == 0)
+    {
+        if (!next)
+            return tool_Fail("%s needs a value", a);
+        o->formatName = next;
+        *tookValue    = true;
+    }
+    else
+        return tool_Fail("unknown option %s", a);
+    return 0;
+}
+
+static VkFormat
+parseFormat(const char* name, bool srgb)
+{
+    if (strcmp(name, "bc1") == 0)
+        return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    if (strcmp(name, "bc7") == 0)
+        return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    if (strcmp(name, "rgba8") == 0)
+        return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    return VK_FORMAT_UNDEFINED;
+}
+
+static bool
+isTextureFile(const char* path)
+{
+    const char* dot = strrchr(path, '.');
+    return dot && (strcmp(dot, ".ktx2") == 0 || strcmp(dot, ".dds") == 0);
+}
+
+static size_t
+levelBytes(const Onyx_TextureFile* tex)
+{
+    size_t size = 0;
+    for (uint32_t l = 0; l < tex->levelCount; l++)
+        size += tex->levels[l].size;
+    return size;
+}
+
+static void
+printInfo(const char* path, const Onyx_TextureFile* tex)
+{
+    const VkFormat decoded = onyx_GetDecodedFormat(tex->format);
+    printf("%s\n", path);
+    printf("  format      %d", tex->format);
+    if (decoded != VK_FORMAT_UNDEFINED)
+        printf(", decodes to %d", decoded);
+    printf("\n");
+    printf("  size        %ux%u\n", tex->width, tex->height);
+    const size_t size = levelBytes(tex);
+    // what the same levels take as RGBA8
+    size_t raw = 0;
+    for (uint32_t l = 0; l < tex->levelCount; l++)
+    {
+        const uint32_t w = tex->width >> l, h = tex->height >> l;
+        raw += (size_t)(w ? w : 1) * (h ? h : 1) * 4;
+    }
+    printf("  levels      %u, %zu bytes, %.1f%% of rgba8\n", tex->levelCount,
+           size, raw ? 100.0 * size / raw : 0.0);
+}
+
+static int
+info(const void* options)
+{
+    const Options* o = options;
+    int status = 0;
+    for (uint32_t f = 0; f < o->files.count; f++)
+    {
+        Onyx_TextureFile tex;
+        if (!onyx_ReadTextureFile(o->files.names[f], &tex))
+        {
+            status = tool_Fail("can't read %s", o->files.names[f]);
+            continue;
+        }
+        printInfo(o->files.names[f], &tex);
+        onyx_FreeTextureFile(&tex);
+    }
+    return status;
+}
+
+static int
+convert(const void* options)
+{
+    const Options* o = options;
+    if (o->files.count != 2)
+        return tool_Fail("convert takes an input and an output file");
+    const VkFormat format = parseFormat(o->formatName, o->srgb);
+    if (format == VK_FORMAT_UNDEFINED)
+        return tool_Fail("unknown format %s", o->formatName);
+    Onyx_TextureFile tex;
+    double           t = tool_Now();
+    if (isTextureFile(o->files.names[0]))
+    {
+        // already in its final format, only the container changes and
+        // --format is ignored
+        if (!onyx_ReadTextureFile(o->files.names[0], &tex))
+            return tool_Fail("can't read %s", o->files.names[0]);
+    }
+    else if (!onyx_CompressImageFile(o->files.names[0], format, o->mips, &tex))
+        return tool_Fail("can't read %s", o->files.names[0]);
+    t = tool_Now() - t;
+    const bool ok = onyx_WriteKtx2(o->files.names[1], &tex);
+    if (ok)
+        printf("%s: %ux%u, %u levels, %zu bytes in %.2f s\n", o->files.names[1],
+               tex.width, tex.height, tex.levelCount, levelBytes(&tex), t);
+    onyx_FreeTextureFile(&tex);
+    return ok ? 0 : tool_Fail("can't write %s", o->files.names[1]);
+}
+
+static const Tool_Command g_commands[] = {
+    {"info", info},
+    {"convert", convert},
+};
+
+int
+main(int argc, char* argv[])
+{
+    const Tool tool = {"onyx-tex", g_usage, parseOption, LEN(g_commands),
+                       g_commands};
+    Options    o    = {.formatName = "bc7", .mips = true};
+    return tool_Main(&tool, argc, argv, &o, &o.files);
+}
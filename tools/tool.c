@@ -0,0 +1,64 @@
+#include "tool.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static const Tool* g_tool;
+
+double
+tool_Now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int
+tool_Fail(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s: ", g_tool->name);
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    return 2;
+}
+
+int
+tool_Main(const Tool* tool, int argc, char* argv[], void* options,
+          Tool_Files* files)
+{
+    g_tool = tool;
+    if (argc < 2)
+    {
+        fprintf(stderr, "%s", tool->usage);
+        return 2;
+    }
+    const char* command = argv[1];
+    // files are gathered in place, never past the argument being parsed
+    *files = (Tool_Files){.names = (const char**)argv + 2};
+    for (int i = 2; i < argc; i++)
+    {
+        char* a    = argv[i];
+        char* next = i + 1 < argc ? argv[i + 1] : NULL;
+        if (a[0] != '-' || a[1] != '-')
+        {
+            files->names[files->count++] = a;
+            continue;
+        }
+        bool      tookValue = false;
+        const int status    = tool->parseOption(options, a, next, &tookValue);
+        if (status)
+            return status;
+        i += tookValue;
+    }
+    for (uint32_t c = 0; c < tool->commandCount; c++)
+        if (strcmp(command, tool->commands[c].name) == 0)
+            return tool->commands[c].run(options);
+    if (strcmp(command, "help") != 0 && strcmp(command, "--help") != 0)
+        fprintf(stderr, "%s: unknown command %s\n", tool->name, command);
+    fprintf(stderr, "%s", tool->usage);
+    return 2;
+}
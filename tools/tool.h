@@ -0,0 +1,51 @@
+#ifndef ONYX_TOOL_H
+#define ONYX_TOOL_H
+
+/*
+ * What the onyx command line tools share. A tool is a set of commands that
+ * take the same options and a list of files, run as
+ * <tool> <command> [options] file...
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Parses the option name, which starts with --, into options. value is the
+// argument after it, NULL if there is none. Sets *tookValue if the option
+// used value. Returns 0, or the exit code if the option is bad.
+typedef int (*Tool_OptionFn)(void* options, const char* name, char* value,
+                             bool* tookValue);
+// returns the exit code
+typedef int (*Tool_CommandFn)(const void* options);
+
+typedef struct {
+    const char*    name;
+    Tool_CommandFn run;
+} Tool_Command;
+
+typedef struct {
+    // starts every message, e.g. onyx-geo
+    const char*         name;
+    const char*         usage;
+    Tool_OptionFn       parseOption;
+    uint32_t            commandCount;
+    const Tool_Command* commands;
+} Tool;
+
+// the arguments that aren't options, in order. names points into argv.
+typedef struct {
+    uint32_t     count;
+    const char** names;
+} Tool_Files;
+
+double tool_Now(void);
+// prints the message after the tool's name to stderr and returns 2, the exit
+// code of a failed command
+int    tool_Fail(const char* fmt, ...);
+// Parses the options after argv[1] into options, which holds the defaults,
+// and the rest into files, then runs the command argv[1] names. Prints the
+// usage for help or an unknown command.
+int    tool_Main(const Tool* tool, int argc, char* argv[], void* options,
+                 Tool_Files* files);
+
+#endif /* end of include guard: ONYX_TOOL_H */